@@ -60,11 +60,9 @@ const auto config = json_to_pt(R"({
 
 constexpr float kMaxRange = 256;
 
-static void BM_UtrechtCostMatrix(benchmark::State& state) {
-  const int size = state.range(0);
-  baldr::GraphReader reader(config.get_child("mjolnir"));
-
-  // Generate N random locations within the Utrect bounding box;
+// Snaps the given number of random locations within the Utrecht bounding box
+google::protobuf::RepeatedPtrField<valhalla::Location>
+utrecht_locations(const int size, baldr::GraphReader& reader, const sif::cost_ptr_t& cost) {
   std::vector<valhalla::baldr::Location> locations;
   const double min_lon = 5.0163;
   const double max_lon = 5.1622;
@@ -80,25 +78,33 @@ static void BM_UtrechtCostMatrix(benchmark::State& state) {
     locations.emplace_back(midgard::PointLL{lng_distribution(gen), lat_distribution(gen)});
   }
 
-  Options options;
-  options.set_costing(Costing::auto_);
-  rapidjson::Document doc;
-  sif::ParseCostingOptions(doc, "/costing_options", options);
-  sif::TravelMode mode;
-  auto costs = sif::CostFactory().CreateModeCosting(options, mode);
-  auto cost = costs[static_cast<size_t>(mode)];
-
   const auto projections = loki::Search(locations, reader, cost);
   if (projections.size() == 0) {
     throw std::runtime_error("Found no matching locations");
   }
 
   google::protobuf::RepeatedPtrField<valhalla::Location> sources;
-
   for (const auto& projection : projections) {
     auto* p = sources.Add();
     baldr::PathLocation::toPBF(projection.second, p, reader);
   }
+  return sources;
+}
+
+sif::mode_costing_t auto_costing(sif::TravelMode& mode) {
+  Options options;
+  options.set_costing(Costing::auto_);
+  rapidjson::Document doc;
+  sif::ParseCostingOptions(doc, "/costing_options", options);
+  return sif::CostFactory().CreateModeCosting(options, mode);
+}
+
+static void BM_UtrechtCostMatrix(benchmark::State& state) {
+  const int size = state.range(0);
+  baldr::GraphReader reader(config.get_child("mjolnir"));
+  sif::TravelMode mode;
+  auto costs = auto_costing(mode);
+  const auto sources = utrecht_locations(size, reader, costs[static_cast<size_t>(mode)]);
 
   std::size_t result_size = 0;
 
@@ -116,6 +122,33 @@ BENCHMARK(BM_UtrechtCostMatrix)
     ->RangeMultiplier(2)
     ->Range(1, kMaxRange);
 
+// The same matrices with the searches on more threads, 1 thread is the serial search
+static void BM_UtrechtParallelCostMatrix(benchmark::State& state) {
+  const int size = state.range(0);
+  const int threads = state.range(1);
+  baldr::GraphReader reader(config.get_child("mjolnir"));
+  std::vector<std::shared_ptr<baldr::GraphReader>> readers;
+  for (int i = 1; i < threads; ++i) {
+    readers.push_back(std::make_shared<baldr::GraphReader>(config.get_child("mjolnir")));
+  }
+  sif::TravelMode mode;
+  auto costs = auto_costing(mode);
+  const auto sources = utrecht_locations(size, reader, costs[static_cast<size_t>(mode)]);
+
+  for (auto _ : state) {
+    thor::CostMatrix matrix;
+    matrix.set_readers(readers);
+    auto result = matrix.SourceToTarget(sources, sources, reader, costs, mode, 100000.);
+    benchmark::DoNotOptimize(result);
+  }
+  state.counters["Routes"] = benchmark::Counter(size, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK(BM_UtrechtParallelCostMatrix)
+    ->Unit(benchmark::kMillisecond)
+    ->RangeMultiplier(2)
+    ->Ranges({{16, 256}, {1, 4}});
+
 } // namespace
 
 BENCHMARK_MAIN();
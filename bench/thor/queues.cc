@@ -0,0 +1,75 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+#include "baldr/double_bucket_queue.h"
+#include "baldr/radix_queue.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+struct label_t {
+  float cost;
+  float sortcost() const {
+    return cost;
+  }
+};
+
+// A dijkstra like workload: every popped label adds a few labels which cost a bit more and every
+// few pops one of the queued labels gets cheaper. Costs are in seconds with buckets of one second
+// and the double bucket queue covers the same range as in the isochrone expansion.
+template <typename queue_t, typename reuse_t>
+void expand(benchmark::State& state, queue_t& queue, const reuse_t& reuse) {
+  const size_t count = state.range(0);
+  std::vector<label_t> labels;
+  labels.reserve(count);
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<float> increment(0, 120);
+
+  for (auto _ : state) {
+    labels.clear();
+    queue.clear();
+    reuse(queue, labels);
+    labels.push_back({0.f});
+    queue.add(0);
+    size_t pops = 0;
+    for (auto label = queue.pop(); label != kInvalidLabel; label = queue.pop(), ++pops) {
+      const float cost = labels[label].cost;
+      for (int i = 0; i < 3 && labels.size() < count; ++i) {
+        labels.push_back({cost + increment(gen)});
+        queue.add(labels.size() - 1);
+      }
+      if (pops % 4 == 0 && labels.back().cost > cost + 1.f) {
+        queue.decrease(labels.size() - 1, cost + 1.f);
+        labels.back().cost = cost + 1.f;
+      }
+    }
+    benchmark::DoNotOptimize(pops);
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+void BM_DoubleBucketQueue(benchmark::State& state) {
+  DoubleBucketQueue<label_t> queue;
+  expand(state, queue, [](DoubleBucketQueue<label_t>& queue, const std::vector<label_t>& labels) {
+    queue.reuse(0.f, 20000.f, 1, &labels);
+  });
+}
+
+void BM_RadixQueue(benchmark::State& state) {
+  RadixQueue<label_t> queue;
+  expand(state, queue, [](RadixQueue<label_t>& queue, const std::vector<label_t>& labels) {
+    queue.reuse(0.f, 1, &labels);
+  });
+}
+
+BENCHMARK(BM_DoubleBucketQueue)
+    ->Unit(benchmark::kMillisecond)
+    ->RangeMultiplier(10)
+    ->Range(1000, 10000000);
+BENCHMARK(BM_RadixQueue)->Unit(benchmark::kMillisecond)->RangeMultiplier(10)->Range(1000, 10000000);
+
+} // namespace
+
+BENCHMARK_MAIN();
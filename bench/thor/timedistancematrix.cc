@@ -0,0 +1,44 @@
+#include <benchmark/benchmark.h>
+#include <random>
+
+#include "thor/timedistancematrix.h"
+
+using namespace valhalla::thor;
+
+namespace {
+
+// Exposes the destinations of the time distance matrix
+struct bench_timedistancematrix_t : public TimeDistanceMatrix {
+  using TimeDistanceMatrix::Destinations;
+};
+
+// The sweep after every settled edge with a destination on it, late in a one to many matrix:
+// every destination has a path, a few are settled and none of the others settle now
+void BM_UpdateDestinations(benchmark::State& state) {
+  bench_timedistancematrix_t::Destinations destinations;
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<float> cost(0, 3600);
+  std::uniform_int_distribution<int> kind(0, 9);
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    destinations.add();
+    destinations.thresholds[i] = 60.f;
+    destinations.costs[i] = cost(gen);
+    destinations.settled[i] = kind(gen) == 0;
+  }
+
+  for (auto _ : state) {
+    float threshold = 0.f;
+    if (destinations.unfound() == 0) {
+      threshold = destinations.max_bound();
+    }
+    benchmark::DoNotOptimize(threshold);
+    benchmark::DoNotOptimize(destinations.settle(0.f));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_UpdateDestinations)->RangeMultiplier(10)->Range(10, 100000);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,238 @@
+#include "baldr/contraction.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr char kContractionMagic[8] = "vhcch";
+constexpr uint32_t kContractionVersion = 1;
+
+struct contraction_header_t {
+  char magic[8];
+  uint32_t version;
+  uint32_t node_count;
+  uint64_t node_rank_count;
+  uint64_t arc_count;
+  uint64_t input_edge_count;
+};
+static_assert(sizeof(contraction_header_t) == 40, "Unexpected contraction header size");
+
+struct node_rank_t {
+  uint64_t node;
+  uint32_t rank;
+  uint32_t spare;
+};
+static_assert(sizeof(node_rank_t) == 16, "Unexpected contraction node size");
+
+struct input_edge_record_t {
+  uint64_t edgeid;
+  uint32_t arc;
+  uint32_t upward;
+};
+static_assert(sizeof(input_edge_record_t) == 16, "Unexpected contraction edge size");
+
+template <typename T> void read_array(std::ifstream& file, std::vector<T>& values, uint64_t count) {
+  values.resize(count);
+  file.read(reinterpret_cast<char*>(values.data()), count * sizeof(T));
+}
+
+template <typename T> void write_array(std::ofstream& file, const std::vector<T>& values) {
+  file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+ContractionHierarchy::ContractionHierarchy(std::vector<std::pair<GraphId, uint32_t>>&& node_ranks,
+                                           std::vector<uint32_t>&& first_arcs,
+                                           std::vector<uint32_t>&& arc_heads,
+                                           std::vector<input_edge_t>&& input_edges)
+    : node_ranks_(std::move(node_ranks)), first_arcs_(std::move(first_arcs)),
+      arc_heads_(std::move(arc_heads)), input_edges_(std::move(input_edges)) {
+  if (first_arcs_.empty() || first_arcs_.back() != arc_heads_.size()) {
+    throw std::runtime_error("Contraction hierarchy arcs do not match its nodes");
+  }
+
+  // the lowest upward neighbour is the parent in the elimination tree, arcs are sorted by head
+  const uint32_t nodes = static_cast<uint32_t>(first_arcs_.size() - 1);
+  parents_.resize(nodes, kInvalidContractionIndex);
+  arc_tails_.resize(arc_heads_.size());
+  for (uint32_t rank = 0; rank < nodes; ++rank) {
+    if (first_arcs_[rank] > first_arcs_[rank + 1]) {
+      throw std::runtime_error("Contraction hierarchy arcs are not sorted");
+    }
+    for (uint32_t arc = first_arcs_[rank]; arc < first_arcs_[rank + 1]; ++arc) {
+      if (arc_heads_[arc] <= rank || arc_heads_[arc] >= nodes) {
+        throw std::runtime_error("Contraction hierarchy arc does not go upward");
+      }
+      arc_tails_[arc] = rank;
+    }
+    if (first_arcs_[rank] != first_arcs_[rank + 1]) {
+      parents_[rank] = arc_heads_[first_arcs_[rank]];
+    }
+  }
+
+  // the arcs from below each node, walking the arcs in order keeps them sorted by their tail
+  first_down_arcs_.resize(nodes + 1, 0);
+  for (auto head : arc_heads_) {
+    ++first_down_arcs_[head + 1];
+  }
+  for (uint32_t rank = 0; rank < nodes; ++rank) {
+    first_down_arcs_[rank + 1] += first_down_arcs_[rank];
+  }
+  down_arcs_.resize(arc_heads_.size());
+  std::vector<uint32_t> next(first_down_arcs_.begin(), first_down_arcs_.end() - 1);
+  for (uint32_t arc = 0; arc < arc_heads_.size(); ++arc) {
+    down_arcs_[next[arc_heads_[arc]]++] = arc;
+  }
+
+  // the height of each node in the elimination tree, children always come before their parent
+  std::vector<uint32_t> heights(nodes, 0);
+  uint32_t levels = nodes ? 1 : 0;
+  for (uint32_t rank = 0; rank < nodes; ++rank) {
+    if (parents_[rank] != kInvalidContractionIndex) {
+      heights[parents_[rank]] = std::max(heights[parents_[rank]], heights[rank] + 1);
+      levels = std::max(levels, heights[parents_[rank]] + 1);
+    }
+  }
+  first_level_nodes_.resize(levels + 1, 0);
+  for (auto height : heights) {
+    ++first_level_nodes_[height + 1];
+  }
+  for (uint32_t level = 0; level < levels; ++level) {
+    first_level_nodes_[level + 1] += first_level_nodes_[level];
+  }
+  level_nodes_.resize(nodes);
+  next.assign(first_level_nodes_.begin(), first_level_nodes_.end() - 1);
+  for (uint32_t rank = 0; rank < nodes; ++rank) {
+    level_nodes_[next[heights[rank]]++] = rank;
+  }
+
+  for (const auto& node_rank : node_ranks_) {
+    if (node_rank.second >= nodes) {
+      throw std::runtime_error("Contraction hierarchy node rank is out of range");
+    }
+  }
+  for (const auto& input_edge : input_edges_) {
+    if (input_edge.arc >= arc_heads_.size()) {
+      throw std::runtime_error("Contraction hierarchy edge arc is out of range");
+    }
+  }
+}
+
+std::shared_ptr<const ContractionHierarchy> ContractionHierarchy::Load(const std::string& file) {
+  std::ifstream in(file, std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("Could not open contraction hierarchy " + file);
+  }
+
+  contraction_header_t header{};
+  in.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!in || memcmp(header.magic, kContractionMagic, sizeof(kContractionMagic)) != 0 ||
+      header.version != kContractionVersion) {
+    throw std::runtime_error("Not a contraction hierarchy or unsupported version: " + file);
+  }
+
+  std::vector<node_rank_t> nodes;
+  std::vector<uint32_t> first_arcs, arc_heads;
+  std::vector<input_edge_record_t> edges;
+  read_array(in, nodes, header.node_rank_count);
+  read_array(in, first_arcs, static_cast<uint64_t>(header.node_count) + 1);
+  read_array(in, arc_heads, header.arc_count);
+  read_array(in, edges, header.input_edge_count);
+  if (!in) {
+    throw std::runtime_error("Contraction hierarchy is truncated: " + file);
+  }
+
+  std::vector<std::pair<GraphId, uint32_t>> node_ranks;
+  node_ranks.reserve(nodes.size());
+  for (const auto& node : nodes) {
+    node_ranks.emplace_back(GraphId(node.node), node.rank);
+  }
+  std::vector<input_edge_t> input_edges;
+  input_edges.reserve(edges.size());
+  for (const auto& edge : edges) {
+    input_edges.push_back({GraphId(edge.edgeid), edge.arc, edge.upward});
+  }
+
+  LOG_INFO("Loaded contraction hierarchy with " + std::to_string(header.node_count) +
+           " nodes and " + std::to_string(header.arc_count) + " arcs from " + file);
+  return std::make_shared<const ContractionHierarchy>(std::move(node_ranks), std::move(first_arcs),
+                                                      std::move(arc_heads),
+                                                      std::move(input_edges));
+}
+
+void ContractionHierarchy::Save(const std::string& file) const {
+  contraction_header_t header{};
+  memcpy(header.magic, kContractionMagic, sizeof(kContractionMagic));
+  header.version = kContractionVersion;
+  header.node_count = node_count();
+  header.node_rank_count = node_ranks_.size();
+  header.arc_count = arc_heads_.size();
+  header.input_edge_count = input_edges_.size();
+
+  std::vector<node_rank_t> nodes;
+  nodes.reserve(node_ranks_.size());
+  for (const auto& node_rank : node_ranks_) {
+    nodes.push_back({node_rank.first.value, node_rank.second, 0});
+  }
+  std::vector<input_edge_record_t> edges;
+  edges.reserve(input_edges_.size());
+  for (const auto& input_edge : input_edges_) {
+    edges.push_back({input_edge.edgeid.value, input_edge.arc, input_edge.upward});
+  }
+
+  // write to the side and move it into place so readers never see half of a file
+  const std::string temp_file = file + ".tmp";
+  {
+    std::ofstream out(temp_file, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_array(out, nodes);
+    write_array(out, first_arcs_);
+    write_array(out, arc_heads_);
+    write_array(out, edges);
+    if (!out) {
+      throw std::runtime_error("Could not write contraction hierarchy " + temp_file);
+    }
+  }
+  if (std::rename(temp_file.c_str(), file.c_str())) {
+    std::remove(temp_file.c_str());
+    throw std::runtime_error("Could not move contraction hierarchy into place at " + file);
+  }
+}
+
+uint32_t ContractionHierarchy::rank(const GraphId& node) const {
+  auto found = std::lower_bound(node_ranks_.begin(), node_ranks_.end(), node,
+                                [](const std::pair<GraphId, uint32_t>& node_rank,
+                                   const GraphId& node) { return node_rank.first < node; });
+  return found != node_ranks_.end() && found->first == node ? found->second
+                                                            : kInvalidContractionIndex;
+}
+
+uint32_t ContractionHierarchy::find_arc(const uint32_t lower, const uint32_t higher) const {
+  auto begin = arc_heads_.begin() + first_arcs_[lower];
+  auto end = arc_heads_.begin() + first_arcs_[lower + 1];
+  auto found = std::lower_bound(begin, end, higher);
+  return found != end && *found == higher ? static_cast<uint32_t>(found - arc_heads_.begin())
+                                          : kInvalidContractionIndex;
+}
+
+uint32_t ContractionHierarchy::input_edge(const GraphId& edgeid) const {
+  auto found = std::lower_bound(input_edges_.begin(), input_edges_.end(), edgeid,
+                                [](const input_edge_t& input_edge, const GraphId& edgeid) {
+                                  return input_edge.edgeid < edgeid;
+                                });
+  return found != input_edges_.end() && found->edgeid == edgeid
+             ? static_cast<uint32_t>(found - input_edges_.begin())
+             : kInvalidContractionIndex;
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -37,6 +37,11 @@ static std::shared_ptr<CURL> init_curl() {
 
 char ALL_ENCODINGS[] = "";
 
+// how many connections a batch may open to the same host when it cant multiplex
+constexpr long kMaxHostConnections = 8;
+// how long to block waiting for activity on any transfer of a batch
+constexpr int kMultiWaitMillis = 100;
+
 size_t write_callback(char* in, size_t block_size, size_t blocks, std::vector<char>* out) {
   if (!out) {
     return static_cast<size_t>(0);
@@ -82,33 +87,38 @@ struct curler_t::pimpl_t {
                 "Failed to disable host verification ");
   }
 
-  // TODO: retries?
-  std::vector<char> fetch(const std::string& url,
-                          long& http_code,
-                          bool gzipped,
-                          const curler_t::interrupt_t* interrupt) const {
+  // sets up the options which are the same for every request this curler makes
+  void prepare(CURL* handle, bool gzipped, const curler_t::interrupt_t* interrupt) const {
     if (interrupt) {
-      assert_curl(curl_easy_setopt(connection.get(), CURLOPT_XFERINFOFUNCTION, progress_callback),
+      assert_curl(curl_easy_setopt(handle, CURLOPT_XFERINFOFUNCTION, progress_callback),
                   "Failed to set custom progress callback ");
-      assert_curl(curl_easy_setopt(connection.get(), CURLOPT_XFERINFODATA, interrupt),
+      assert_curl(curl_easy_setopt(handle, CURLOPT_XFERINFODATA, interrupt),
                   "Failed to set custom progress data");
-      assert_curl(curl_easy_setopt(connection.get(), CURLOPT_NOPROGRESS, 0L),
+      assert_curl(curl_easy_setopt(handle, CURLOPT_NOPROGRESS, 0L),
                   "Failed to turn the progress callback on ");
     }
 
     // use gzip compression in any case
-    assert_curl(curl_easy_setopt(connection.get(), CURLOPT_ACCEPT_ENCODING, "gzip"),
+    assert_curl(curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, "gzip"),
                 "Failed to set content encoding header ");
     // Curler do uncompressing by default. So if user asks for compressed data,
     // we just disable default uncompressing
     if (gzipped) {
-      assert_curl(curl_easy_setopt(connection.get(), CURLOPT_HTTP_CONTENT_DECODING, 0L),
+      assert_curl(curl_easy_setopt(handle, CURLOPT_HTTP_CONTENT_DECODING, 0L),
                   "Failed to disable decoding ");
     }
     // set the user agent
     if (!user_agent.empty())
-      assert_curl(curl_easy_setopt(connection.get(), CURLOPT_USERAGENT, user_agent.c_str()),
+      assert_curl(curl_easy_setopt(handle, CURLOPT_USERAGENT, user_agent.c_str()),
                   "Failed to set User-Agent ");
+  }
+
+  // TODO: retries?
+  std::vector<char> fetch(const std::string& url,
+                          long& http_code,
+                          bool gzipped,
+                          const curler_t::interrupt_t* interrupt) const {
+    prepare(connection.get(), gzipped, interrupt);
     // set the url
     assert_curl(curl_easy_setopt(connection.get(), CURLOPT_URL, url.c_str()), "Failed to set URL ");
     // set the location of the result
@@ -123,6 +133,100 @@ struct curler_t::pimpl_t {
     return result;
   }
 
+  std::vector<std::vector<char>> fetch_many(const std::vector<std::string>& urls,
+                                            std::vector<long>& http_codes,
+                                            bool gzipped,
+                                            const curler_t::interrupt_t* interrupt) {
+    std::vector<std::vector<char>> results(urls.size());
+    http_codes.assign(urls.size(), 0);
+    if (urls.empty()) {
+      return results;
+    }
+
+    // the multi handle owns the connection cache so we keep it around to reuse connections
+    if (!multi) {
+      multi.reset(curl_multi_init(), [](CURLM* m) { curl_multi_cleanup(m); });
+      if (multi.get() == nullptr) {
+        LOG_ERROR("Failed to created CURL multi handle");
+        throw std::runtime_error("Failed to created CURL multi handle");
+      }
+      // requests to the same host share a connection where the server speaks HTTP/2
+      assert_multi(curl_multi_setopt(multi.get(), CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX),
+                   "Failed to enable multiplexing ");
+      assert_multi(curl_multi_setopt(multi.get(), CURLMOPT_MAX_HOST_CONNECTIONS,
+                                     kMaxHostConnections),
+                   "Failed to limit host connections ");
+    }
+
+    // one transfer per url, removed from the multi handle no matter how we leave here
+    std::vector<std::shared_ptr<CURL>> transfers;
+    transfers.reserve(urls.size());
+    for (size_t i = 0; i < urls.size(); ++i) {
+      auto* m = multi.get();
+      auto transfer = init_curl();
+      if (transfer.get() == nullptr) {
+        LOG_ERROR("Failed to created CURL connection");
+        throw std::runtime_error("Failed to created CURL connection");
+      }
+      assert_curl(curl_easy_setopt(transfer.get(), CURLOPT_FOLLOWLOCATION, 1L),
+                  "Failed to set redirect option ");
+      assert_curl(curl_easy_setopt(transfer.get(), CURLOPT_WRITEFUNCTION, write_callback),
+                  "Failed to set writer ");
+      assert_curl(curl_easy_setopt(transfer.get(), CURLOPT_SSL_VERIFYPEER, 0L),
+                  "Failed to disable peer verification ");
+      assert_curl(curl_easy_setopt(transfer.get(), CURLOPT_SSL_VERIFYHOST, 0L),
+                  "Failed to disable host verification ");
+      // rather wait for a multiplexed connection than opening another one
+      assert_curl(curl_easy_setopt(transfer.get(), CURLOPT_PIPEWAIT, 1L),
+                  "Failed to set pipe wait ");
+      prepare(transfer.get(), gzipped, interrupt);
+      assert_curl(curl_easy_setopt(transfer.get(), CURLOPT_URL, urls[i].c_str()),
+                  "Failed to set URL ");
+      assert_curl(curl_easy_setopt(transfer.get(), CURLOPT_WRITEDATA, &results[i]),
+                  "Failed to set write data ");
+      assert_curl(curl_easy_setopt(transfer.get(), CURLOPT_PRIVATE, reinterpret_cast<void*>(i)),
+                  "Failed to set transfer index ");
+      assert_multi(curl_multi_add_handle(m, transfer.get()), "Failed to add transfer ");
+      transfers.emplace_back(transfer.get(), [m, transfer](CURL* c) {
+        curl_multi_remove_handle(m, c);
+      });
+    }
+
+    // drive all the transfers until they are done
+    int running = 0;
+    do {
+      assert_multi(curl_multi_perform(multi.get(), &running), "Failed to perform transfers ");
+      if (running) {
+        assert_multi(curl_multi_wait(multi.get(), nullptr, 0, kMultiWaitMillis, nullptr),
+                     "Failed to wait for transfers ");
+      }
+    } while (running);
+
+    // grab the return codes, like the single fetch we bail if any transfer failed outright
+    std::string what;
+    int remaining = 0;
+    while (CURLMsg* message = curl_multi_info_read(multi.get(), &remaining)) {
+      if (message->msg != CURLMSG_DONE) {
+        continue;
+      }
+      void* index = nullptr;
+      curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &index);
+      auto i = reinterpret_cast<size_t>(index);
+      if (message->data.result != CURLE_OK) {
+        what = "Failed to get URL " + urls[i] + ": " + curl_easy_strerror(message->data.result);
+        continue;
+      }
+      curl_easy_getinfo(message->easy_handle, CURLINFO_RESPONSE_CODE, &http_codes[i]);
+    }
+    if (!what.empty()) {
+      LOG_ERROR(what);
+      throw std::runtime_error(what);
+    }
+
+    // hand over the results
+    return results;
+  }
+
   void assert_curl(CURLcode code, const std::string& msg) const {
     if (code != CURLE_OK) {
       std::string what = msg + error;
@@ -131,7 +235,16 @@ struct curler_t::pimpl_t {
     }
   }
 
+  void assert_multi(CURLMcode code, const std::string& msg) const {
+    if (code != CURLM_OK) {
+      std::string what = msg + curl_multi_strerror(code);
+      LOG_ERROR(what);
+      throw std::runtime_error(what);
+    }
+  }
+
   std::shared_ptr<CURL> connection;
+  std::shared_ptr<CURLM> multi;
   char error[CURL_ERROR_SIZE]{};
   std::string user_agent;
 };
@@ -146,6 +259,13 @@ std::vector<char> curler_t::operator()(const std::string& url,
   return pimpl->fetch(url, http_code, gzipped, interrupt);
 }
 
+std::vector<std::vector<char>> curler_t::operator()(const std::vector<std::string>& urls,
+                                                    std::vector<long>& http_codes,
+                                                    bool gzipped,
+                                                    const curler_t::interrupt_t* interrupt) const {
+  return pimpl->fetch_many(urls, http_codes, gzipped, interrupt);
+}
+
 // curler_pool_t
 
 curler_pool_t::curler_pool_t(const size_t pool_size, const std::string& user_agent)
@@ -190,6 +310,13 @@ operator()(const std::string&, long&, bool gzipped, const curler_t::interrupt_t*
   LOG_ERROR("This version of libvalhalla was not built with CURL support");
   throw std::runtime_error("This version of libvalhalla was not built with CURL support");
 }
+std::vector<std::vector<char>> curler_t::operator()(const std::vector<std::string>&,
+                                                    std::vector<long>&,
+                                                    bool,
+                                                    const curler_t::interrupt_t*) const {
+  LOG_ERROR("This version of libvalhalla was not built with CURL support");
+  throw std::runtime_error("This version of libvalhalla was not built with CURL support");
+}
 
 curler_pool_t::curler_pool_t(const size_t pool_size, const std::string&) : size_(pool_size) {
 }
@@ -1,7 +1,16 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
 #include <fstream>
 #include <iostream>
+#include <list>
+#include <sstream>
 #include <string>
 #include <sys/stat.h>
+#include <thread>
 #include <utility>
 
 #include "baldr/connectivity_map.h"
@@ -11,6 +20,7 @@
 #include "incident_singleton.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
+#include "midgard/util.h"
 #include "shortcut_recovery.h"
 
 using namespace valhalla::midgard;
@@ -20,6 +30,123 @@ namespace {
 constexpr size_t DEFAULT_MAX_CACHE_SIZE = 1073741824; // 1 gig
 constexpr size_t AVERAGE_TILE_SIZE = 2097152;         // 2 megs
 constexpr size_t AVERAGE_MM_TILE_SIZE = 1024;         // 1k
+constexpr size_t DEFAULT_CACHE_SHARDS = 16;
+constexpr size_t DEFAULT_PREFETCH_MAX_TILES = 256;
+constexpr float DEFAULT_SLRU_PROTECTED_FRACTION = 0.8f;
+constexpr uint32_t DEFAULT_SLRU_PINNED_MAX_LEVEL = 1;
+constexpr size_t kMaxPrefetchTilesPerLevel = 64;
+constexpr float kPrefetchPaddingFactor = 0.1f;
+constexpr size_t kMaxPrefetchBatchSize = 16;
+
+// The sidecar index of a tile extract is a header followed by entries sorted by tile id
+constexpr char kTileExtractIndexMagic[8] = "vhtxidx";
+constexpr uint32_t kTileExtractIndexVersion = 1;
+constexpr char kTileExtractIndexSuffix[] = ".index";
+
+struct tile_extract_index_header_t {
+  char magic[8];
+  uint32_t version;
+  uint32_t entry_size;
+  uint64_t archive_size;
+  int64_t archive_mtime;
+  uint64_t entry_count;
+};
+static_assert(sizeof(tile_extract_index_header_t) == 40, "Unexpected index header size");
+
+struct tile_extract_index_entry_t {
+  uint64_t tile_id;
+  uint64_t offset;
+  uint64_t size;
+};
+static_assert(sizeof(tile_extract_index_entry_t) == 24, "Unexpected index entry size");
+
+using extract_tiles_t = std::unordered_map<uint64_t, std::pair<char*, size_t>>;
+
+// Fills out the tiles from the index written by a previous load of the same extract, returns
+// false if there is no index or it doesnt belong to this version of the extract
+bool read_extract_index(const std::string& index_file,
+                        const valhalla::midgard::tar& archive,
+                        extract_tiles_t& tiles) {
+  struct stat index_stat, extract_stat;
+  if (stat(index_file.c_str(), &index_stat) || stat(archive.tar_file.c_str(), &extract_stat) ||
+      static_cast<size_t>(index_stat.st_size) < sizeof(tile_extract_index_header_t)) {
+    return false;
+  }
+
+  valhalla::midgard::mem_map<char> index;
+  index.map_readonly(index_file, index_stat.st_size);
+  const auto* header = reinterpret_cast<const tile_extract_index_header_t*>(index.get());
+  if (memcmp(header->magic, kTileExtractIndexMagic, sizeof(kTileExtractIndexMagic)) != 0 ||
+      header->version != kTileExtractIndexVersion ||
+      header->entry_size != sizeof(tile_extract_index_entry_t) ||
+      header->archive_size != archive.mm.size() ||
+      header->archive_mtime != static_cast<int64_t>(extract_stat.st_mtime) ||
+      index.size() != sizeof(tile_extract_index_header_t) +
+                          header->entry_count * sizeof(tile_extract_index_entry_t)) {
+    LOG_WARN("Tile extract index " + index_file + " does not match the extract, ignoring it");
+    return false;
+  }
+
+  const auto* entries = reinterpret_cast<const tile_extract_index_entry_t*>(
+      index.get() + sizeof(tile_extract_index_header_t));
+  tiles.reserve(header->entry_count);
+  for (uint64_t i = 0; i < header->entry_count; ++i) {
+    const auto& entry = entries[i];
+    if (entry.offset + entry.size > archive.mm.size()) {
+      LOG_WARN("Tile extract index " + index_file + " points outside of the extract, ignoring it");
+      tiles.clear();
+      return false;
+    }
+    tiles[entry.tile_id] = std::make_pair(archive.mm.get() + entry.offset, entry.size);
+  }
+  return true;
+}
+
+// Writes the index for the tiles found in the extract so the next load can skip reading the tar
+void write_extract_index(const std::string& index_file,
+                         const valhalla::midgard::tar& archive,
+                         const extract_tiles_t& tiles) {
+  struct stat extract_stat;
+  if (stat(archive.tar_file.c_str(), &extract_stat)) {
+    return;
+  }
+
+  tile_extract_index_header_t header{};
+  memcpy(header.magic, kTileExtractIndexMagic, sizeof(kTileExtractIndexMagic));
+  header.version = kTileExtractIndexVersion;
+  header.entry_size = sizeof(tile_extract_index_entry_t);
+  header.archive_size = archive.mm.size();
+  header.archive_mtime = extract_stat.st_mtime;
+  header.entry_count = tiles.size();
+
+  std::vector<tile_extract_index_entry_t> entries;
+  entries.reserve(tiles.size());
+  for (const auto& tile : tiles) {
+    entries.push_back({tile.first, static_cast<uint64_t>(tile.second.first - archive.mm.get()),
+                       tile.second.second});
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const tile_extract_index_entry_t& a, const tile_extract_index_entry_t& b) {
+              return a.tile_id < b.tile_id;
+            });
+
+  // write it off to the side and move it into place so nobody reads a partial index
+  std::stringstream tmp_suffix;
+  tmp_suffix << ".tmp_" << std::this_thread::get_id() << "_"
+             << std::chrono::high_resolution_clock::now().time_since_epoch().count();
+  auto tmp_file = index_file + tmp_suffix.str();
+  std::ofstream file(tmp_file, std::ios::out | std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(entries.data()),
+             entries.size() * sizeof(tile_extract_index_entry_t));
+  file.close();
+  if (file.fail() || std::rename(tmp_file.c_str(), index_file.c_str())) {
+    LOG_WARN("Could not write tile extract index " + index_file);
+    filesystem::remove(tmp_file);
+    return;
+  }
+  LOG_INFO("Wrote tile extract index " + index_file);
+}
 
 } // namespace
 
@@ -39,19 +166,39 @@ GraphReader::tile_extract_t::tile_extract_t(const boost::property_tree::ptree& p
   // if you really meant to load it
   if (pt.get_optional<std::string>("tile_extract")) {
     try {
-      // load the tar
-      archive.reset(new midgard::tar(pt.get<std::string>("tile_extract")));
-      // map files to graph ids
-      for (auto& c : archive->contents) {
-        try {
-          auto id = GraphTile::GetTileId(c.first);
-          tiles[id] = std::make_pair(const_cast<char*>(c.second.first), c.second.second);
-        } catch (...) {
-          // It's possible to put non-tile files inside the tarfile.  As we're only
-          // parsing the file *name* as a GraphId here, we will just silently skip
-          // any file paths that can't be parsed by GraphId::GetTileId()
-          // If we end up with *no* recognizable tile files in the tarball at all,
-          // checks lower down will warn on that.
+      const auto tile_extract = pt.get<std::string>("tile_extract");
+      const auto use_index = pt.get<bool>("use_tile_extract_index", false);
+      const auto index_file = tile_extract + kTileExtractIndexSuffix;
+
+      // if a previous load left an index we can skip reading through the whole tar
+      if (use_index) {
+        archive.reset(new midgard::tar(tile_extract, true, false));
+        if (read_extract_index(index_file, *archive, tiles)) {
+          LOG_INFO("Tile extract index " + index_file + " successfully loaded");
+        } else {
+          archive.reset();
+        }
+      }
+
+      if (!archive) {
+        // load the tar
+        archive.reset(new midgard::tar(tile_extract));
+        // map files to graph ids
+        for (auto& c : archive->contents) {
+          try {
+            auto id = GraphTile::GetTileId(c.first);
+            tiles[id] = std::make_pair(const_cast<char*>(c.second.first), c.second.second);
+          } catch (...) {
+            // It's possible to put non-tile files inside the tarfile.  As we're only
+            // parsing the file *name* as a GraphId here, we will just silently skip
+            // any file paths that can't be parsed by GraphId::GetTileId()
+            // If we end up with *no* recognizable tile files in the tarball at all,
+            // checks lower down will warn on that.
+          }
+        }
+        // save the next load the trouble
+        if (use_index && !tiles.empty()) {
+          write_extract_index(index_file, *archive, tiles);
         }
       }
       // couldn't load it
@@ -113,6 +260,36 @@ GraphReader::get_extract_instance(const boost::property_tree::ptree& pt) {
   return tile_extract;
 }
 
+// ----------------------------------------------------------------------------
+// TileCacheStats implementation
+// ----------------------------------------------------------------------------
+
+TileCacheStats::Level& TileCacheStats::Level::operator+=(const Level& other) {
+  hits += other.hits;
+  misses += other.misses;
+  inserts += other.inserts;
+  evictions += other.evictions;
+  tiles += other.tiles;
+  bytes += other.bytes;
+  load_micros += other.load_micros;
+  return *this;
+}
+
+TileCacheStats::Level TileCacheStats::total() const {
+  Level total;
+  for (const auto& level : levels) {
+    total += level;
+  }
+  return total;
+}
+
+TileCacheStats& TileCacheStats::operator+=(const TileCacheStats& other) {
+  for (size_t i = 0; i < levels.size(); ++i) {
+    levels[i] += other.levels[i];
+  }
+  return *this;
+}
+
 // ----------------------------------------------------------------------------
 // FlatTileCache implementation
 // ----------------------------------------------------------------------------
@@ -143,6 +320,7 @@ bool FlatTileCache::OverCommitted() const {
 
 // Clears the cache.
 void FlatTileCache::Clear() {
+  stats_.evict_all();
   cache_size_ = 0;
   cache_.clear();
   // TODO: this could be optimized by using the remaining bits in tileid. we need to track a 7bit
@@ -165,6 +343,7 @@ graph_tile_ptr FlatTileCache::Get(const GraphId& graphid) const {
 graph_tile_ptr FlatTileCache::Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) {
   // TODO: protect against crazy tileid?
   cache_size_ += size;
+  stats_.insert(graphid, size);
   cache_indices_[get_offset(graphid)] = cache_.size();
   cache_.emplace_back(std::move(tile));
   return cache_.back();
@@ -174,6 +353,10 @@ void FlatTileCache::Trim() {
   Clear();
 }
 
+TileCacheStats FlatTileCache::Stats() const {
+  return stats_;
+}
+
 // ----------------------------------------------------------------------------
 // SimpleTileCache implementation
 // ----------------------------------------------------------------------------
@@ -199,6 +382,7 @@ bool SimpleTileCache::OverCommitted() const {
 
 // Clears the cache.
 void SimpleTileCache::Clear() {
+  stats_.evict_all();
   cache_size_ = 0;
   cache_.clear();
 }
@@ -215,6 +399,7 @@ graph_tile_ptr SimpleTileCache::Get(const GraphId& graphid) const {
 // Puts a copy of a tile of into the cache.
 graph_tile_ptr SimpleTileCache::Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) {
   cache_size_ += size;
+  stats_.insert(graphid, size);
   return cache_.emplace(graphid, std::move(tile)).first->second;
 }
 
@@ -222,6 +407,10 @@ void SimpleTileCache::Trim() {
   Clear();
 }
 
+TileCacheStats SimpleTileCache::Stats() const {
+  return stats_;
+}
+
 // ----------------------------------------------------------------------------
 // TileCacheLRU implementation
 // ----------------------------------------------------------------------------
@@ -247,6 +436,7 @@ bool TileCacheLRU::OverCommitted() const {
 }
 
 void TileCacheLRU::Clear() {
+  stats_.evict_all();
   cache_size_ = 0;
   cache_.clear();
   key_val_lru_list_.clear();
@@ -256,6 +446,10 @@ void TileCacheLRU::Trim() {
   TrimToFit(0);
 }
 
+TileCacheStats TileCacheLRU::Stats() const {
+  return stats_;
+}
+
 graph_tile_ptr TileCacheLRU::Get(const GraphId& graphid) const {
   auto cached = cache_.find(graphid);
   if (cached == cache_.cend()) {
@@ -273,9 +467,10 @@ size_t TileCacheLRU::TrimToFit(const size_t required_size) {
   while ((OverCommitted() || (max_cache_size_ - cache_size_) < required_size) &&
          !key_val_lru_list_.empty()) {
     const KeyValue& entry_to_evict = key_val_lru_list_.back();
-    const auto tile_size = entry_to_evict.tile->header()->end_offset();
+    const auto tile_size = entry_to_evict.size;
     cache_size_ -= tile_size;
     freed_space += tile_size;
+    stats_.evict(entry_to_evict.id, tile_size);
     cache_.erase(entry_to_evict.id);
     key_val_lru_list_.pop_back();
   }
@@ -296,8 +491,9 @@ graph_tile_ptr TileCacheLRU::Put(const GraphId& graphid, graph_tile_ptr tile, si
     if (mem_control_ == MemoryLimitControl::HARD) {
       TrimToFit(new_tile_size);
     }
-    key_val_lru_list_.emplace_front(KeyValue{graphid, std::move(tile)});
+    key_val_lru_list_.emplace_front(KeyValue{graphid, std::move(tile), new_tile_size});
     cache_.emplace(graphid, key_val_lru_list_.begin());
+    stats_.insert(graphid, new_tile_size);
   } else {
     // Value update; the new size may be different form the previous
     // TODO: in practice tile size for a specific id never changes
@@ -305,7 +501,7 @@ graph_tile_ptr TileCacheLRU::Put(const GraphId& graphid, graph_tile_ptr tile, si
     //  do we need to take it into account here? (can dramatically simplify the code)
     // note: SimpleTileCache does not handle the overwrite at the moment
     auto& entry_iter = cached->second;
-    const auto old_tile_size = entry_iter->tile->header()->end_offset();
+    const auto old_tile_size = entry_iter->size;
 
     // do it before TrimToFit avoid its eviction to free space
     MoveToLruHead(entry_iter);
@@ -320,13 +516,150 @@ graph_tile_ptr TileCacheLRU::Put(const GraphId& graphid, graph_tile_ptr tile, si
     }
 
     entry_iter->tile = std::move(tile);
+    entry_iter->size = new_tile_size;
     cache_size_ -= old_tile_size;
+    stats_.levels[graphid.level()].bytes += new_tile_size - old_tile_size;
   }
   cache_size_ += new_tile_size;
 
   return key_val_lru_list_.front().tile;
 }
 
+// ----------------------------------------------------------------------------
+// TileCacheSLRU implementation
+// ----------------------------------------------------------------------------
+
+// Constructor.
+TileCacheSLRU::TileCacheSLRU(size_t max_size,
+                             TileCacheLRU::MemoryLimitControl mem_control,
+                             float protected_fraction,
+                             uint32_t pinned_max_level)
+    : mem_control_(mem_control), cache_size_(0), protected_size_(0), max_cache_size_(max_size),
+      max_protected_size_(max_size * std::min(std::max(protected_fraction, 0.f), 1.f)),
+      pinned_max_level_(pinned_max_level) {
+}
+
+void TileCacheSLRU::Reserve(size_t tile_size) {
+  assert(tile_size != 0);
+  cache_.reserve(max_cache_size_ / tile_size);
+}
+
+bool TileCacheSLRU::Contains(const GraphId& graphid) const {
+  return cache_.find(graphid) != cache_.cend();
+}
+
+bool TileCacheSLRU::OverCommitted() const {
+  return cache_size_ > max_cache_size_;
+}
+
+void TileCacheSLRU::Clear() {
+  stats_.evict_all();
+  cache_size_ = 0;
+  protected_size_ = 0;
+  cache_.clear();
+  probation_.clear();
+  protected_.clear();
+}
+
+void TileCacheSLRU::Trim() {
+  TrimToFit(0);
+}
+
+TileCacheStats TileCacheSLRU::Stats() const {
+  return stats_;
+}
+
+graph_tile_ptr TileCacheSLRU::Get(const GraphId& graphid) const {
+  auto cached = cache_.find(graphid);
+  if (cached == cache_.cend()) {
+    return nullptr;
+  }
+
+  // the second time we see a tile it has earned its protection
+  const KeyValueIter& entry_iter = cached->second;
+  Protect(entry_iter);
+
+  return entry_iter->tile;
+}
+
+void TileCacheSLRU::Protect(const KeyValueIter& entry_iter) const {
+  if (entry_iter->is_protected) {
+    protected_.splice(protected_.begin(), protected_, entry_iter);
+  } else {
+    entry_iter->is_protected = true;
+    protected_size_ += entry_iter->size;
+    protected_.splice(protected_.begin(), probation_, entry_iter);
+  }
+
+  // make room by giving the least recently used protected tiles another chance on probation
+  while (protected_size_ > max_protected_size_ && protected_.size() > 1) {
+    auto demoted = std::prev(protected_.end());
+    demoted->is_protected = false;
+    protected_size_ -= demoted->size;
+    probation_.splice(probation_.begin(), protected_, demoted);
+  }
+}
+
+size_t TileCacheSLRU::TrimToFit(const size_t required_size) {
+  size_t freed_space = 0;
+  while ((OverCommitted() || (max_cache_size_ - cache_size_) < required_size) &&
+         (!probation_.empty() || !protected_.empty())) {
+    auto& segment = probation_.empty() ? protected_ : probation_;
+    const KeyValue& entry_to_evict = segment.back();
+    const auto tile_size = entry_to_evict.size;
+    cache_size_ -= tile_size;
+    freed_space += tile_size;
+    if (entry_to_evict.is_protected) {
+      protected_size_ -= tile_size;
+    }
+    stats_.evict(entry_to_evict.id, tile_size);
+    cache_.erase(entry_to_evict.id);
+    segment.pop_back();
+  }
+  return freed_space;
+}
+
+graph_tile_ptr TileCacheSLRU::Put(const GraphId& graphid, graph_tile_ptr tile, size_t new_tile_size) {
+  if (new_tile_size > max_cache_size_) {
+    throw std::runtime_error("TileCacheSLRU: tile size is bigger than max cache size");
+  }
+
+  auto cached = cache_.find(graphid);
+  if (cached == cache_.end()) {
+    if (mem_control_ == TileCacheLRU::MemoryLimitControl::HARD) {
+      TrimToFit(new_tile_size);
+    }
+    probation_.emplace_front(KeyValue{graphid, std::move(tile), new_tile_size});
+    auto entry_iter = cache_.emplace(graphid, probation_.begin()).first->second;
+    stats_.insert(graphid, new_tile_size);
+    cache_size_ += new_tile_size;
+    // the levels most routes go through dont have to prove themselves
+    if (graphid.level() <= pinned_max_level_) {
+      Protect(entry_iter);
+    }
+    return entry_iter->tile;
+  }
+
+  // Value update; the new size may be different from the previous
+  auto& entry_iter = cached->second;
+  const auto old_tile_size = entry_iter->size;
+  if (mem_control_ == TileCacheLRU::MemoryLimitControl::HARD && new_tile_size > old_tile_size) {
+    // protect it first so that it isnt the one that gets evicted to make room
+    Protect(entry_iter);
+    TrimToFit(new_tile_size - old_tile_size);
+  }
+  entry_iter->tile = std::move(tile);
+  entry_iter->size = new_tile_size;
+  if (entry_iter->is_protected) {
+    protected_size_ += new_tile_size - old_tile_size;
+  }
+  cache_size_ += new_tile_size - old_tile_size;
+  stats_.levels[graphid.level()].bytes += new_tile_size - old_tile_size;
+  Protect(entry_iter);
+
+  return entry_iter->tile;
+}
+
 // ----------------------------------------------------------------------------
 // SynchronizedTileCache implementation
 // ----------------------------------------------------------------------------
@@ -365,6 +698,11 @@ void SynchronizedTileCache::Trim() {
   cache_.Trim();
 }
 
+TileCacheStats SynchronizedTileCache::Stats() const {
+  std::lock_guard<std::mutex> lock(mutex_ref_);
+  return cache_.Stats();
+}
+
 // Get a pointer to a graph tile object given a GraphId.
 graph_tile_ptr SynchronizedTileCache::Get(const GraphId& graphid) const {
   std::lock_guard<std::mutex> lock(mutex_ref_);
@@ -377,6 +715,220 @@ graph_tile_ptr SynchronizedTileCache::Put(const GraphId& graphid, graph_tile_ptr
   return cache_.Put(graphid, std::move(tile), size);
 }
 
+// ----------------------------------------------------------------------------
+// ShardedTileCache implementation
+// ----------------------------------------------------------------------------
+
+// Constructor.
+ShardedTileCache::ShardedTileCache(size_t max_size,
+                                   size_t shard_count,
+                                   TileCacheLRU::MemoryLimitControl mem_control)
+    : shards_(std::make_shared<std::vector<std::unique_ptr<Shard>>>()) {
+  shard_count = std::max(shard_count, static_cast<size_t>(1));
+  shards_->reserve(shard_count);
+  for (size_t i = 0; i < shard_count; ++i) {
+    shards_->emplace_back(new Shard(max_size / shard_count, mem_control));
+  }
+}
+
+// Reserves enough cache to hold (max_cache_size / tile_size) items.
+void ShardedTileCache::Reserve(size_t tile_size) {
+  for (auto& shard : *shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    shard->cache.Reserve(tile_size);
+  }
+}
+
+// Checks if tile exists in the cache.
+bool ShardedTileCache::Contains(const GraphId& graphid) const {
+  auto& shard = get_shard(graphid);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return shard.cache.Contains(graphid);
+}
+
+// Lets you know if the cache is too large.
+bool ShardedTileCache::OverCommitted() const {
+  for (const auto& shard : *shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    if (shard->cache.OverCommitted())
+      return true;
+  }
+  return false;
+}
+
+// Clears the cache.
+void ShardedTileCache::Clear() {
+  for (auto& shard : *shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    shard->cache.Clear();
+  }
+}
+
+void ShardedTileCache::Trim() {
+  for (auto& shard : *shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    shard->cache.Trim();
+  }
+}
+
+TileCacheStats ShardedTileCache::Stats() const {
+  TileCacheStats stats;
+  for (const auto& shard : *shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    stats += shard->cache.Stats();
+  }
+  return stats;
+}
+
+// Get a pointer to a graph tile object given a GraphId.
+graph_tile_ptr ShardedTileCache::Get(const GraphId& graphid) const {
+  auto& shard = get_shard(graphid);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return shard.cache.Get(graphid);
+}
+
+// Puts a copy of a tile of into the cache.
+graph_tile_ptr ShardedTileCache::Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) {
+  auto& shard = get_shard(graphid);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return shard.cache.Put(graphid, std::move(tile), size);
+}
+
+// ----------------------------------------------------------------------------
+// SharedFlatTileCache implementation
+// ----------------------------------------------------------------------------
+
+SharedFlatTileCache::Slots::Slots(size_t slot_count)
+    : slots(new std::atomic<const graph_tile_ptr*>[slot_count]), slot_count(slot_count), epoch(0),
+      cache_size(0) {
+  for (size_t i = 0; i < slot_count; ++i) {
+    slots[i].store(nullptr, std::memory_order_relaxed);
+  }
+  for (auto& stripe : readers) {
+    stripe.count[0].store(0, std::memory_order_relaxed);
+    stripe.count[1].store(0, std::memory_order_relaxed);
+  }
+}
+
+SharedFlatTileCache::Slots::~Slots() {
+  for (auto offset : occupied) {
+    delete slots[offset].load(std::memory_order_relaxed);
+  }
+}
+
+SharedFlatTileCache::ReadGuard::ReadGuard(Slots& slots) {
+  static thread_local const size_t stripe =
+      std::hash<std::thread::id>{}(std::this_thread::get_id()) % kReaderStripes;
+  // announce ourselves in the current epoch, if a writer moved the epoch on in the meantime
+  // it may not have seen us so we have to announce ourselves again in the new epoch
+  while (true) {
+    auto epoch = slots.epoch.load();
+    count_ = &slots.readers[stripe].count[epoch & 1];
+    count_->fetch_add(1);
+    if (slots.epoch.load() == epoch)
+      break;
+    count_->fetch_sub(1);
+  }
+}
+
+SharedFlatTileCache::ReadGuard::~ReadGuard() {
+  count_->fetch_sub(1, std::memory_order_release);
+}
+
+// Constructor.
+SharedFlatTileCache::SharedFlatTileCache(size_t max_size) : max_cache_size_(max_size) {
+  index_offsets_[0] = 0;
+  index_offsets_[1] = index_offsets_[0] + TileHierarchy::levels()[0].tiles.TileCount();
+  index_offsets_[2] = index_offsets_[1] + TileHierarchy::levels()[1].tiles.TileCount();
+  index_offsets_[3] = index_offsets_[2] + TileHierarchy::levels()[2].tiles.TileCount();
+  slots_ = std::make_shared<Slots>(index_offsets_[3] +
+                                   TileHierarchy::GetTransitLevel().tiles.TileCount());
+}
+
+// Reserves enough cache to hold (max_cache_size / tile_size) items.
+void SharedFlatTileCache::Reserve(size_t tile_size) {
+  std::lock_guard<std::mutex> lock(slots_->writer_mutex);
+  slots_->occupied.reserve(max_cache_size_ / tile_size);
+}
+
+// Checks if tile exists in the cache.
+bool SharedFlatTileCache::Contains(const GraphId& graphid) const {
+  auto offset = get_offset(graphid);
+  return offset < slots_->slot_count &&
+         slots_->slots[offset].load(std::memory_order_acquire) != nullptr;
+}
+
+// Lets you know if the cache is too large.
+bool SharedFlatTileCache::OverCommitted() const {
+  return slots_->cache_size.load(std::memory_order_relaxed) > max_cache_size_;
+}
+
+// Get a pointer to a graph tile object given a GraphId.
+graph_tile_ptr SharedFlatTileCache::Get(const GraphId& graphid) const {
+  auto offset = get_offset(graphid);
+  if (offset >= slots_->slot_count)
+    return nullptr;
+  // the holder cannot be freed while we are inside the guard so its safe to copy the tile
+  ReadGuard guard(*slots_);
+  const auto* holder = slots_->slots[offset].load(std::memory_order_acquire);
+  return holder ? *holder : nullptr;
+}
+
+// Puts a copy of a tile of into the cache.
+graph_tile_ptr SharedFlatTileCache::Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) {
+  auto offset = get_offset(graphid);
+  if (offset >= slots_->slot_count)
+    return tile;
+  std::lock_guard<std::mutex> lock(slots_->writer_mutex);
+  // someone beat us to it so we keep theirs
+  if (const auto* holder = slots_->slots[offset].load(std::memory_order_relaxed))
+    return *holder;
+  auto* holder = new graph_tile_ptr(std::move(tile));
+  slots_->occupied.push_back(offset);
+  slots_->cache_size.fetch_add(size, std::memory_order_relaxed);
+  slots_->stats.insert(graphid, size);
+  slots_->slots[offset].store(holder, std::memory_order_release);
+  return *holder;
+}
+
+// Clears the cache.
+void SharedFlatTileCache::Clear() {
+  std::lock_guard<std::mutex> lock(slots_->writer_mutex);
+  // unlink everything so new readers cannot find it
+  std::vector<const graph_tile_ptr*> retired;
+  retired.reserve(slots_->occupied.size());
+  for (auto offset : slots_->occupied) {
+    retired.push_back(slots_->slots[offset].exchange(nullptr));
+  }
+  slots_->occupied.clear();
+  slots_->cache_size.store(0, std::memory_order_relaxed);
+  slots_->stats.evict_all();
+  // wait for the readers which might have seen them before we drop our references
+  Synchronize();
+  for (const auto* holder : retired) {
+    delete holder;
+  }
+}
+
+void SharedFlatTileCache::Trim() {
+  Clear();
+}
+
+TileCacheStats SharedFlatTileCache::Stats() const {
+  std::lock_guard<std::mutex> lock(slots_->writer_mutex);
+  return slots_->stats;
+}
+
+// Waits for a grace period in which all readers of the previous epoch have finished.
+void SharedFlatTileCache::Synchronize() {
+  auto epoch = slots_->epoch.fetch_add(1);
+  for (auto& stripe : slots_->readers) {
+    while (stripe.count[epoch & 1].load() != 0) {
+      std::this_thread::yield();
+    }
+  }
+}
+
 // Constructs tile cache.
 TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree& pt) {
   size_t max_cache_size = pt.get<size_t>("max_cache_size", DEFAULT_MAX_CACHE_SIZE);
@@ -388,6 +940,49 @@ TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree&
 
   bool use_simple_cache = pt.get<bool>("use_simple_mem_cache", false);
 
+  // a process wide flat cache with lock free lookups
+  if (pt.get<bool>("use_shared_flat_cache", false)) {
+    static std::unique_ptr<SharedFlatTileCache> globalFlatCache_;
+    static std::mutex factoryMutex;
+    std::lock_guard<std::mutex> lock(factoryMutex);
+    if (!globalFlatCache_) {
+      globalFlatCache_.reset(new SharedFlatTileCache(max_cache_size));
+    }
+    // copies share the underlying slots
+    return new SharedFlatTileCache(*globalFlatCache_);
+  }
+
+  // a process wide cache split into independently locked shards
+  if (pt.get<bool>("use_sharded_cache", false)) {
+    static std::unique_ptr<ShardedTileCache> globalShardedCache_;
+    static std::mutex factoryMutex;
+    std::lock_guard<std::mutex> lock(factoryMutex);
+    if (!globalShardedCache_) {
+      globalShardedCache_.reset(
+          new ShardedTileCache(max_cache_size,
+                               pt.get<size_t>("sharded_cache_shards", DEFAULT_CACHE_SHARDS),
+                               lru_mem_control));
+    }
+    // copies share the underlying shards
+    return new ShardedTileCache(*globalShardedCache_);
+  }
+
+  // the lru caches can also be segmented to keep the tiles which are used over and over around
+  auto make_lru_cache = [&pt, max_cache_size, lru_mem_control]() -> TileCache* {
+    auto policy = pt.get<std::string>("lru_mem_cache_policy", "lru");
+    if (policy == "slru") {
+      return new TileCacheSLRU(max_cache_size, lru_mem_control,
+                               pt.get<float>("slru_protected_fraction",
+                                             DEFAULT_SLRU_PROTECTED_FRACTION),
+                               pt.get<uint32_t>("slru_pinned_max_level",
+                                                DEFAULT_SLRU_PINNED_MAX_LEVEL));
+    }
+    if (policy != "lru") {
+      LOG_WARN("Unknown lru_mem_cache_policy " + policy + ", using lru");
+    }
+    return new TileCacheLRU(max_cache_size, lru_mem_control);
+  };
+
   // wrap tile cache with thread-safe version
   if (pt.get<bool>("global_synchronized_cache", false)) {
     // Handle synchronization of cache
@@ -398,7 +993,7 @@ TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree&
     std::lock_guard<std::mutex> lock(factoryMutex);
     if (!globalTileCache_) {
       if (use_lru_cache) {
-        globalTileCache_.reset(new TileCacheLRU(max_cache_size, lru_mem_control));
+        globalTileCache_.reset(make_lru_cache());
       } else {
         // globalTileCache_.reset(new SimpleTileCache(max_cache_size));
         globalTileCache_.reset(new FlatTileCache(max_cache_size));
@@ -409,7 +1004,7 @@ TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree&
 
   // or do you want to use an LRU cache
   if (use_lru_cache) {
-    return new TileCacheLRU(max_cache_size, lru_mem_control);
+    return make_lru_cache();
   }
 
   // maybe you want a basic hashmap of tiles
@@ -421,17 +1016,177 @@ TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree&
   return new FlatTileCache(max_cache_size);
 }
 
+// ----------------------------------------------------------------------------
+// Background tile loading
+// ----------------------------------------------------------------------------
+
+struct GraphReader::tile_prefetcher_t {
+  tile_prefetcher_t(GraphReader& reader, size_t thread_count, size_t max_tiles)
+      : reader(reader), max_tiles(max_tiles), stop(false) {
+    for (size_t i = 0; i < thread_count; ++i) {
+      threads.emplace_back(&tile_prefetcher_t::work, this);
+    }
+  }
+
+  ~tile_prefetcher_t() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    work_cond.notify_all();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+
+  // queue up tiles which arent already on their way, making room by dropping the tiles which were
+  // loaded the longest time ago and still nobody asked for
+  void enqueue(const std::vector<GraphId>& graphids) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (const auto& graphid : graphids) {
+        if (queued.count(graphid) || loading.count(graphid) || ready.count(graphid)) {
+          continue;
+        }
+        if (queued.size() + loading.size() + ready.size() >= max_tiles) {
+          if (ready_order.empty()) {
+            break;
+          }
+          ready.erase(ready_order.front());
+          ready_order.pop_front();
+        }
+        queue.push_back(graphid);
+        queued.insert(graphid);
+      }
+    }
+    work_cond.notify_all();
+  }
+
+  // hands over a loaded tile, if its currently loading we wait for it and if its still queued we
+  // drop it from the queue so the caller can load it
+  graph_tile_ptr take(const GraphId& graphid) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (queued.erase(graphid)) {
+      return nullptr;
+    }
+    ready_cond.wait(lock, [this, &graphid]() { return loading.count(graphid) == 0; });
+    auto found = ready.find(graphid);
+    if (found == ready.end()) {
+      return nullptr;
+    }
+    auto tile = std::move(found->second.first);
+    ready_order.erase(found->second.second);
+    ready.erase(found);
+    return tile;
+  }
+
+  // forget everything which isnt currently being loaded
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.clear();
+    queued.clear();
+    ready.clear();
+    ready_order.clear();
+  }
+
+  bool is_ready(const GraphId& graphid) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return ready.count(graphid) != 0;
+  }
+
+  // blocks until nothing is queued or loading anymore
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    ready_cond.wait(lock, [this]() { return queued.empty() && loading.empty(); });
+  }
+
+  void work() {
+    while (true) {
+      std::vector<GraphId> graphids;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        work_cond.wait(lock, [this]() { return stop || !queue.empty(); });
+        if (stop) {
+          return;
+        }
+        // tiles from a url are downloaded together so grab our share of the queue at once
+        size_t batch = 1;
+        if (reader.tile_getter_) {
+          batch = std::min(kMaxPrefetchBatchSize,
+                           std::max<size_t>(1, queue.size() / threads.size()));
+        }
+        while (graphids.size() < batch && !queue.empty()) {
+          auto graphid = queue.front();
+          queue.pop_front();
+          // someone took it off our hands in the meantime
+          if (!queued.erase(graphid)) {
+            continue;
+          }
+          loading.insert(graphid);
+          graphids.push_back(graphid);
+        }
+        if (graphids.empty()) {
+          continue;
+        }
+      }
+
+      // it is only a hint so if anything goes wrong the search will just load it itself
+      std::vector<graph_tile_ptr> tiles;
+      try {
+        tiles = reader.LoadGraphTiles(graphids);
+      } catch (const std::exception& e) {
+        LOG_WARN("Failed to prefetch " + std::to_string(graphids.size()) +
+                 " tiles starting at " + GraphTile::FileSuffix(graphids.front()) + ": " +
+                 e.what());
+      } catch (...) {}
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < graphids.size(); ++i) {
+          loading.erase(graphids[i]);
+          if (i < tiles.size() && tiles[i]) {
+            ready_order.push_back(graphids[i]);
+            ready.emplace(graphids[i],
+                          std::make_pair(std::move(tiles[i]), std::prev(ready_order.end())));
+          }
+        }
+      }
+      ready_cond.notify_all();
+    }
+  }
+
+  GraphReader& reader;
+  const size_t max_tiles;
+  bool stop;
+  std::mutex mutex;
+  std::condition_variable work_cond;
+  std::condition_variable ready_cond;
+  std::deque<GraphId> queue;
+  std::unordered_set<GraphId> queued;
+  std::unordered_set<GraphId> loading;
+  // the loaded tiles and where they are in the order they were loaded in
+  std::unordered_map<GraphId, std::pair<graph_tile_ptr, std::list<GraphId>::iterator>> ready;
+  std::list<GraphId> ready_order;
+  std::vector<std::thread> threads;
+};
+
 // Constructor using separate tile files
 GraphReader::GraphReader(const boost::property_tree::ptree& pt,
                          std::unique_ptr<tile_getter_t>&& tile_getter)
     : tile_extract_(get_extract_instance(pt)), tile_dir_(pt.get<std::string>("tile_dir", "")),
+      use_tile_mmap_(pt.get<bool>("use_tile_mmap", false)),
+      advise_tile_sections_(pt.get<bool>("advise_tile_sections", false)),
       tile_getter_(std::move(tile_getter)),
       max_concurrent_users_(pt.get<size_t>("max_concurrent_reader_users", 1)),
       tile_url_(pt.get<std::string>("tile_url", "")), cache_(TileCacheFactory::createTileCache(pt)) {
 
-  // Make a tile fetcher if we havent passed one in from somewhere else
+  // Background loading of tiles only makes sense when they dont come from an extract
+  auto prefetch_threads = tile_extract_->tiles.empty() ? pt.get<size_t>("prefetch_threads", 0) : 0;
+
+  // Make a tile fetcher if we havent passed one in from somewhere else, the background threads
+  // need their own connections so they dont hold up the search
   if (!tile_getter_ && !tile_url_.empty()) {
-    tile_getter_ = std::make_unique<curl_tile_getter_t>(max_concurrent_users_,
+    tile_getter_ = std::make_unique<curl_tile_getter_t>(max_concurrent_users_ + prefetch_threads,
                                                         pt.get<std::string>("user_agent", ""),
                                                         pt.get<bool>("tile_url_gz", false));
   }
@@ -455,12 +1210,21 @@ GraphReader::GraphReader(const boost::property_tree::ptree& pt,
                                                            : GetTileSet());
   }
 
+  // Start the threads that load tiles in the background
+  if (prefetch_threads > 0) {
+    prefetcher_.reset(new tile_prefetcher_t(*this, prefetch_threads,
+                                            pt.get<size_t>("prefetch_max_tiles",
+                                                           DEFAULT_PREFETCH_MAX_TILES)));
+  }
+
   // Fill shortcut recovery cache if requested or by default in memmap mode
   if (pt.get<bool>("shortcut_caching", false)) {
     shortcut_recovery_t::get_instance(this);
   }
 }
 
+GraphReader::~GraphReader() = default;
+
 // Method to test if tile exists
 bool GraphReader::DoesTileExist(const GraphId& graphid) const {
   if (!graphid.Is_Valid() || graphid.level() > TileHierarchy::get_max_level()) {
@@ -507,11 +1271,22 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
 
   // Check if the level/tileid combination is in the cache
   auto base = graphid.Tile_Base();
+  auto& level_stats = cache_stats_.levels[base.level()];
   if (const auto& cached = cache_->Get(base)) {
     // LOG_DEBUG("Memory cache hit " + GraphTile::FileSuffix(base));
+    ++level_stats.hits;
     return cached;
   }
 
+  // Keep track of the miss and how long it takes us to deal with it
+  ++level_stats.misses;
+  const auto load_start = std::chrono::steady_clock::now();
+  auto record_load_time = make_finally([&level_stats, load_start]() {
+    level_stats.load_micros += std::chrono::duration_cast<std::chrono::microseconds>(
+                                   std::chrono::steady_clock::now() - load_start)
+                                   .count();
+  });
+
   // Try getting it from the memmapped tar extract
   if (!tile_extract_->tiles.empty()) {
     // Do we have this tile
@@ -520,20 +1295,34 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
       // LOG_DEBUG("Memory map cache miss " + GraphTile::FileSuffix(base));
       return nullptr;
     }
-    auto memory = std::make_unique<TarballGraphMemory>(tile_extract_->archive, t->second);
-
     auto traffic_ptr = tile_extract_->traffic_tiles.find(base);
     auto traffic_memory = traffic_ptr != tile_extract_->traffic_tiles.end()
                               ? std::make_unique<TarballGraphMemory>(tile_extract_->traffic_archive,
                                                                      traffic_ptr->second)
                               : nullptr;
 
+    // Tiles can be individually gzipped in the extract, those we inflate into their own memory
+    if (GraphTile::IsCompressed(t->second.first, t->second.second)) {
+      auto tile = GraphTile::DecompressTile(base, t->second.first, t->second.second,
+                                            std::move(traffic_memory));
+      if (!tile) {
+        return nullptr;
+      }
+      // Keep a copy in the cache and return it
+      const size_t size = tile->header()->end_offset();
+      return cache_->Put(base, std::move(tile), size);
+    }
+
     // This initializes the tile from mmap
+    auto memory = std::make_unique<TarballGraphMemory>(tile_extract_->archive, t->second);
     auto tile = GraphTile::Create(base, std::move(memory), std::move(traffic_memory));
     if (!tile) {
       // LOG_DEBUG("Memory map cache miss " + GraphTile::FileSuffix(base));
       return nullptr;
     }
+    if (advise_tile_sections_) {
+      tile->AdviseMemory();
+    }
     // LOG_DEBUG("Memory map cache hit " + GraphTile::FileSuffix(base));
 
     // Keep a copy in the cache and return it
@@ -541,6 +1330,33 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
     return cache_->Put(base, std::move(tile), size);
   } // Try getting it from flat file
   else {
+    // It may have already been loaded in the background, if not we load it ourselves
+    graph_tile_ptr tile = prefetcher_ ? prefetcher_->take(base) : nullptr;
+    if (!tile) {
+      tile = LoadGraphTile(base);
+    }
+    if (!tile) {
+      return nullptr;
+    }
+
+    // Keep a copy in the cache and return it
+    const size_t size = tile->header()->end_offset();
+    return cache_->Put(base, std::move(tile), size);
+  }
+}
+
+// Loads a tile from disk or the tile url without touching the cache
+graph_tile_ptr GraphReader::LoadGraphTile(const GraphId& base) {
+  return LoadGraphTiles({base}).front();
+}
+
+// Loads tiles from disk or the tile url without touching the cache, downloading all of the
+// ones which arent on disk at once
+std::vector<graph_tile_ptr> GraphReader::LoadGraphTiles(const std::vector<GraphId>& bases) {
+  std::vector<graph_tile_ptr> tiles(bases.size());
+  std::vector<size_t> missing;
+  for (size_t i = 0; i < bases.size(); ++i) {
+    const auto& base = bases[i];
     auto traffic_ptr = tile_extract_->traffic_tiles.find(base);
     auto traffic_memory = traffic_ptr != tile_extract_->traffic_tiles.end()
                               ? std::make_unique<TarballGraphMemory>(tile_extract_->traffic_archive,
@@ -548,36 +1364,140 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
                               : nullptr;
 
     // Try to get it from disk and if we cant..
-    graph_tile_ptr tile = GraphTile::Create(tile_dir_, base, std::move(traffic_memory));
+    graph_tile_ptr tile =
+        GraphTile::Create(tile_dir_, base, std::move(traffic_memory), use_tile_mmap_);
     if (!tile || !tile->header()) {
       if (!tile_getter_) {
-        return nullptr;
-      }
-
-      {
-        std::lock_guard<std::mutex> lock(_404s_lock);
-        if (_404s.find(base) != _404s.end()) {
-          // LOG_DEBUG("Url cache miss " + GraphTile::FileSuffix(base));
-          return nullptr;
-        }
+        continue;
       }
 
-      // Get it from the url and cache it to disk if you can
-      tile = GraphTile::CacheTileURL(tile_url_, base, tile_getter_.get(), tile_dir_);
-      if (!tile) {
-        std::lock_guard<std::mutex> lock(_404s_lock);
-        _404s.insert(base);
+      std::lock_guard<std::mutex> lock(_404s_lock);
+      if (_404s.find(base) != _404s.end()) {
         // LOG_DEBUG("Url cache miss " + GraphTile::FileSuffix(base));
-        return nullptr;
+        continue;
       }
-      // LOG_DEBUG("Url cache hit " + GraphTile::FileSuffix(base));
+      missing.push_back(i);
     } else {
       // LOG_DEBUG("Disk cache hit " + GraphTile::FileSuffix(base));
+      if (use_tile_mmap_ && advise_tile_sections_) {
+        tile->AdviseMemory();
+      }
+      tiles[i] = std::move(tile);
     }
+  }
+  if (missing.empty()) {
+    return tiles;
+  }
 
-    // Keep a copy in the cache and return it
-    const size_t size = tile->header()->end_offset();
-    return cache_->Put(base, std::move(tile), size);
+  // Get them from the url and cache them to disk if you can
+  std::vector<GraphId> remote;
+  remote.reserve(missing.size());
+  for (auto i : missing) {
+    remote.push_back(bases[i]);
+  }
+  std::vector<graph_tile_ptr> fetched;
+  if (remote.size() == 1) {
+    fetched.push_back(
+        GraphTile::CacheTileURL(tile_url_, remote.front(), tile_getter_.get(), tile_dir_));
+  } else {
+    fetched = GraphTile::CacheTileURLs(tile_url_, remote, tile_getter_.get(), tile_dir_);
+  }
+  for (size_t j = 0; j < missing.size(); ++j) {
+    if (!fetched[j]) {
+      std::lock_guard<std::mutex> lock(_404s_lock);
+      _404s.insert(remote[j]);
+      // LOG_DEBUG("Url cache miss " + GraphTile::FileSuffix(remote[j]));
+      continue;
+    }
+    // LOG_DEBUG("Url cache hit " + GraphTile::FileSuffix(remote[j]));
+    tiles[missing[j]] = std::move(fetched[j]);
+  }
+  return tiles;
+}
+
+// Hint that we will soon need these tiles
+void GraphReader::Prefetch(const std::vector<GraphId>& graphids) {
+  if (!prefetcher_) {
+    return;
+  }
+  std::vector<GraphId> missing;
+  missing.reserve(graphids.size());
+  for (const auto& graphid : graphids) {
+    if (graphid.Is_Valid() && graphid.level() <= TileHierarchy::get_max_level() &&
+        !cache_->Contains(graphid.Tile_Base())) {
+      missing.push_back(graphid.Tile_Base());
+    }
+  }
+  prefetcher_->enqueue(missing);
+}
+
+// Hint that we will soon search around these locations
+void GraphReader::PrefetchCorridor(const std::vector<midgard::PointLL>& locations) {
+  if (!prefetcher_ || locations.empty()) {
+    return;
+  }
+
+  // pad the box around the locations a bit as the search wanders a bit outside of it
+  AABB2<PointLL> bbox(locations);
+  auto pad = std::max(bbox.Width(), bbox.Height()) * kPrefetchPaddingFactor;
+  bbox = AABB2<PointLL>(bbox.minx() - pad, bbox.miny() - pad, bbox.maxx() + pad,
+                        bbox.maxy() + pad);
+
+  std::vector<GraphId> graphids;
+  for (const auto& level : TileHierarchy::levels()) {
+    auto tile_ids = level.tiles.TileList(bbox);
+    // too many on this level, just take the tiles right around the locations
+    if (tile_ids.size() > kMaxPrefetchTilesPerLevel) {
+      tile_ids.clear();
+      auto size = level.tiles.TileSize();
+      for (const auto& location : locations) {
+        auto around = level.tiles.TileList(AABB2<PointLL>(location.lng() - size,
+                                                          location.lat() - size,
+                                                          location.lng() + size,
+                                                          location.lat() + size));
+        tile_ids.insert(tile_ids.end(), around.begin(), around.end());
+      }
+    }
+    for (auto tile_id : tile_ids) {
+      graphids.emplace_back(tile_id, level.level, 0);
+    }
+  }
+  Prefetch(graphids);
+}
+
+TileCacheStats GraphReader::GetCacheStats() const {
+  auto stats = cache_->Stats();
+  for (size_t i = 0; i < stats.levels.size(); ++i) {
+    stats.levels[i].hits = cache_stats_.levels[i].hits;
+    stats.levels[i].misses = cache_stats_.levels[i].misses;
+    stats.levels[i].load_micros = cache_stats_.levels[i].load_micros;
+  }
+  return stats;
+}
+
+void GraphReader::Clear() {
+  cache_->Clear();
+  if (prefetcher_) {
+    prefetcher_->clear();
+  }
+}
+
+void GraphReader::Trim() {
+  cache_->Trim();
+  // whatever was loaded ahead for the last search and not used by now wont be used anymore, it
+  // also isnt part of the cache size so it has to go with the trimming
+  if (prefetcher_) {
+    prefetcher_->clear();
+  }
+}
+
+bool GraphReader::IsPrefetched(const GraphId& graphid) const {
+  return prefetcher_ && prefetcher_->is_ready(graphid.Tile_Base());
+}
+
+void GraphReader::WaitForPrefetch() const {
+  if (prefetcher_) {
+    prefetcher_->wait();
   }
 }
 
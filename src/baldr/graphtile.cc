@@ -7,6 +7,7 @@
 #include "filesystem.h"
 #include "midgard/aabb2.h"
 #include "midgard/pointll.h"
+#include "midgard/sequence.h"
 #include "midgard/tiles.h"
 
 #include <boost/algorithm/string.hpp>
@@ -29,6 +30,7 @@ using namespace valhalla::midgard;
 namespace {
 const AABB2<PointLL> world_box(PointLL(-180, -90), PointLL(180, 90));
 constexpr float COMPRESSION_HINT = 3.5f;
+constexpr size_t kGzipMinSize = 18; // 10 byte header and 8 byte trailer
 
 std::string MakeSingleTileUrl(const std::string& tile_url, const valhalla::baldr::GraphId& graphid) {
   auto id_pos = tile_url.find(valhalla::baldr::GraphTile::kTilePathPattern);
@@ -47,6 +49,20 @@ std::string GenerateTmpSuffix() {
   return ss.str();
 }
 
+#ifndef _WIN32
+// posix_madvise wants page aligned ranges, rounding inwards leaves the neighbouring pages alone
+void advise_pages(const char* begin, const char* end, int advice, bool inwards) {
+  static const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+  auto first = reinterpret_cast<uintptr_t>(begin);
+  auto last = reinterpret_cast<uintptr_t>(end);
+  first = inwards ? (first + page_size - 1) & ~(page_size - 1) : first & ~(page_size - 1);
+  last = inwards ? last & ~(page_size - 1) : last;
+  if (first < last) {
+    posix_madvise(reinterpret_cast<void*>(first), last - first, advice);
+  }
+}
+#endif
+
 } // namespace
 
 namespace valhalla {
@@ -63,29 +79,60 @@ private:
   const std::vector<char> memory_;
 };
 
+// Read-only mapping of an uncompressed tile file. Because the mapping is shared every
+// process which maps the same file will share the same physical pages of the page cache
+class MmapGraphMemory final : public GraphMemory {
+public:
+  MmapGraphMemory(const std::string& file_location, size_t file_size) {
+    memmap_.map_readonly(file_location, file_size);
+    data = memmap_.get();
+    size = memmap_.size();
+  }
+
+private:
+  midgard::mem_map<char> memmap_;
+};
+
 graph_tile_ptr GraphTile::DecompressTile(const GraphId& graphid,
                                          const std::vector<char>& compressed) {
+  return DecompressTile(graphid, compressed.data(), compressed.size());
+}
+
+graph_tile_ptr GraphTile::DecompressTile(const GraphId& graphid,
+                                         const char* compressed,
+                                         size_t size,
+                                         std::unique_ptr<const GraphMemory>&& traffic_memory) {
   // for setting where to read compressed data from
-  auto src_func = [&compressed](z_stream& s) -> void {
-    s.next_in =
-        const_cast<Byte*>(static_cast<const Byte*>(static_cast<const void*>(compressed.data())));
-    s.avail_in = static_cast<unsigned int>(compressed.size());
+  auto src_func = [compressed, size](z_stream& s) -> void {
+    s.next_in = const_cast<Byte*>(static_cast<const Byte*>(static_cast<const void*>(compressed)));
+    s.avail_in = static_cast<unsigned int>(size);
   };
 
+  // gzip streams end with the uncompressed size so we can get the buffer right the first time,
+  // the extra byte keeps the buffer from filling up so we know we are done without growing it
+  size_t hint = size * COMPRESSION_HINT;
+  if (IsCompressed(compressed, size)) {
+    uint32_t uncompressed_size;
+    std::memcpy(&uncompressed_size, compressed + size - sizeof(uncompressed_size),
+                sizeof(uncompressed_size));
+    if (uncompressed_size > 0) {
+      hint = static_cast<size_t>(uncompressed_size) + 1;
+    }
+  }
+
   // for setting where to write the uncompressed data to
   std::vector<char> data;
-  auto dst_func = [&data, &compressed](z_stream& s) -> int {
+  auto dst_func = [&data, &hint](z_stream& s) -> int {
     // if the whole buffer wasn't used we are done
     auto size = data.size();
     if (s.total_out < size)
       data.resize(s.total_out);
     // we need more space
     else {
-      // assume we need 3.5x the space
-      data.resize(size + (compressed.size() * COMPRESSION_HINT));
+      data.resize(size + hint);
       // set the pointer to the next spot
       s.next_out = static_cast<Byte*>(static_cast<void*>(data.data() + size));
-      s.avail_out = compressed.size() * COMPRESSION_HINT;
+      s.avail_out = hint;
     }
     return Z_NO_FLUSH;
   };
@@ -96,23 +143,43 @@ graph_tile_ptr GraphTile::DecompressTile(const GraphId& graphid,
     return nullptr;
   }
 
-  return graph_tile_ptr{
-      new GraphTile(graphid, std::make_unique<const VectorGraphMemory>(std::move(data)))};
+  return graph_tile_ptr{new GraphTile(graphid,
+                                      std::make_unique<const VectorGraphMemory>(std::move(data)),
+                                      std::move(traffic_memory))};
+}
+
+bool GraphTile::IsCompressed(const char* data, size_t size) {
+  // a raw tile starts with its graph id whose level bits would be 7 for these two bytes
+  return size > kGzipMinSize && static_cast<uint8_t>(data[0]) == 0x1f &&
+         static_cast<uint8_t>(data[1]) == 0x8b;
 }
 
 // Constructor given a filename. Reads the graph data into memory.
 graph_tile_ptr GraphTile::Create(const std::string& tile_dir,
                                  const GraphId& graphid,
-                                 std::unique_ptr<const GraphMemory>&& traffic_memory) {
+                                 std::unique_ptr<const GraphMemory>&& traffic_memory,
+                                 bool mmap_tile) {
 
   // Don't bother with invalid ids
   if (!graphid.Is_Valid() || graphid.level() > TileHierarchy::get_max_level() || tile_dir.empty()) {
     return nullptr;
   }
 
-  // Open to the end of the file so we can immediately get size
   const std::string file_location =
       tile_dir + filesystem::path::preferred_separator + FileSuffix(graphid.Tile_Base());
+
+  // Map the file rather than copying it into private memory
+  if (mmap_tile) {
+    struct stat s;
+    if (stat(file_location.c_str(), &s) == 0 && s.st_size > 0) {
+      return graph_tile_ptr{new GraphTile(graphid,
+                                          std::make_unique<const MmapGraphMemory>(file_location,
+                                                                                  s.st_size),
+                                          std::move(traffic_memory))};
+    }
+  }
+
+  // Open to the end of the file so we can immediately get size
   std::ifstream file(file_location, std::ios::in | std::ios::binary | std::ios::ate);
   if (file.is_open()) {
     // Read binary file into memory. TODO - protect against failure to allocate memory
@@ -205,6 +272,35 @@ void GraphTile::SaveTileToFile(const std::vector<char>& tile_data, const std::st
     filesystem::remove(tmp_location);
 }
 
+namespace {
+
+// turns a downloaded tile into a graph tile, caching it on disk first if we can
+graph_tile_ptr TileFromResponse(const GraphId& graphid,
+                                tile_getter_t::response_t& result,
+                                bool gzipped,
+                                const std::string& cache_location) {
+  if (result.status_ != tile_getter_t::status_code_t::SUCCESS) {
+    return nullptr;
+  }
+  // try to cache it on disk so we dont have to keep fetching it from url
+  if (!cache_location.empty()) {
+    auto suffix = GraphTile::FileSuffix(graphid.Tile_Base(),
+                                        (gzipped ? valhalla::baldr::SUFFIX_COMPRESSED
+                                                 : valhalla::baldr::SUFFIX_NON_COMPRESSED));
+    auto disk_location = cache_location + filesystem::path::preferred_separator + suffix;
+    GraphTile::SaveTileToFile(result.bytes_, disk_location);
+  }
+
+  // turn the memory into a tile
+  if (gzipped) {
+    return GraphTile::DecompressTile(graphid, result.bytes_.data(), result.bytes_.size());
+  }
+
+  return GraphTile::Create(graphid, std::move(result.bytes_));
+}
+
+} // namespace
+
 graph_tile_ptr GraphTile::CacheTileURL(const std::string& tile_url,
                                        const GraphId& graphid,
                                        tile_getter_t* tile_getter,
@@ -216,25 +312,33 @@ graph_tile_ptr GraphTile::CacheTileURL(const std::string& tile_url,
 
   auto uri = MakeSingleTileUrl(tile_url, graphid);
   auto result = tile_getter->get(uri);
-  if (result.status_ != tile_getter_t::status_code_t::SUCCESS) {
-    return nullptr;
+  return TileFromResponse(graphid, result, tile_getter->gzipped(), cache_location);
+}
+
+std::vector<graph_tile_ptr> GraphTile::CacheTileURLs(const std::string& tile_url,
+                                                     const std::vector<GraphId>& graphids,
+                                                     tile_getter_t* tile_getter,
+                                                     const std::string& cache_location) {
+  std::vector<graph_tile_ptr> tiles(graphids.size());
+  std::vector<size_t> indices;
+  std::vector<std::string> uris;
+  // Don't bother with invalid ids
+  for (size_t i = 0; i < graphids.size(); ++i) {
+    if (graphids[i].Is_Valid() && graphids[i].level() <= TileHierarchy::get_max_level()) {
+      indices.push_back(i);
+      uris.push_back(MakeSingleTileUrl(tile_url, graphids[i]));
+    }
   }
-  // try to cache it on disk so we dont have to keep fetching it from url
-  if (!cache_location.empty()) {
-    auto suffix = FileSuffix(graphid.Tile_Base(),
-                             (tile_getter->gzipped() ? valhalla::baldr::SUFFIX_COMPRESSED
-                                                     : valhalla::baldr::SUFFIX_NON_COMPRESSED));
-    auto disk_location = cache_location + filesystem::path::preferred_separator + suffix;
-    SaveTileToFile(result.bytes_, disk_location);
+  if (uris.empty()) {
+    return tiles;
   }
 
-  // turn the memory into a tile
-  if (tile_getter->gzipped()) {
-    return DecompressTile(graphid, result.bytes_);
+  auto results = tile_getter->get_many(uris);
+  for (size_t j = 0; j < indices.size(); ++j) {
+    auto i = indices[j];
+    tiles[i] = TileFromResponse(graphids[i], results[j], tile_getter->gzipped(), cache_location);
   }
-
-  return graph_tile_ptr{
-      new GraphTile(graphid, std::make_unique<const VectorGraphMemory>(std::move(result.bytes_)))};
+  return tiles;
 }
 
 GraphTile::~GraphTile() = default;
@@ -367,6 +471,27 @@ void GraphTile::Initialize(const GraphId& graphid) {
   }
 }
 
+void GraphTile::AdviseMemory() const {
+#ifndef _WIN32
+  const char* begin = memory_->data;
+  const char* end = begin + memory_->size;
+  // the access restrictions directly follow the directed edges and are checked while expanding
+  const char* hot_end =
+      reinterpret_cast<const char*>(access_restrictions_ + header_->access_restriction_count());
+  // so are the complex restrictions which sit between the admins and the edge info
+  const char* restrictions_begin = begin + header_->complex_restriction_forward_offset();
+  const char* restrictions_end = begin + header_->edgeinfo_offset();
+  const char* cold_end = header_->predictedspeeds_count() > 0
+                             ? begin + header_->predictedspeeds_offset()
+                             : end;
+  advise_pages(begin, hot_end, POSIX_MADV_WILLNEED, false);
+  advise_pages(hot_end, restrictions_begin, POSIX_MADV_RANDOM, true);
+  advise_pages(restrictions_begin, restrictions_end, POSIX_MADV_WILLNEED, false);
+  advise_pages(restrictions_end, cold_end, POSIX_MADV_RANDOM, true);
+  advise_pages(cold_end, end, POSIX_MADV_WILLNEED, false);
+#endif
+}
+
 // For transit tiles we need to save off the pair<tileid,lineid> lookup via
 // onestop_ids.  This will be used for including or excluding transit lines
 // for transit routes.  We save 2 maps because operators contain all of their
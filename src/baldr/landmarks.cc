@@ -0,0 +1,184 @@
+#include "baldr/landmarks.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+
+constexpr char kLandmarkMagic[8] = "vhlmk";
+constexpr uint32_t kLandmarkVersion = 2;
+
+struct landmark_header_t {
+  char magic[8];
+  uint32_t version;
+  uint32_t landmark_count;
+  uint64_t tile_count;
+  uint64_t node_count;
+  uint64_t options_size;
+};
+static_assert(sizeof(landmark_header_t) == 40, "Unexpected landmark header size");
+
+struct tile_offset_t {
+  uint64_t tile;
+  uint32_t offset;
+  uint32_t node_count;
+};
+static_assert(sizeof(tile_offset_t) == 16, "Unexpected landmark tile size");
+
+template <typename T> void read_array(std::ifstream& file, std::vector<T>& values, uint64_t count) {
+  values.resize(count);
+  file.read(reinterpret_cast<char*>(values.data()), count * sizeof(T));
+}
+
+template <typename T> void write_array(std::ofstream& file, const std::vector<T>& values) {
+  file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+LandmarkDistances::LandmarkDistances(std::vector<GraphId>&& landmarks,
+                                     std::vector<tile_t>&& tiles,
+                                     std::vector<float>&& distances,
+                                     std::string&& options)
+    : landmarks_(std::move(landmarks)), tiles_(std::move(tiles)), distances_(std::move(distances)),
+      options_(std::move(options)) {
+  if (landmarks_.empty() || distances_.size() % (2 * landmarks_.size()) != 0) {
+    throw std::runtime_error("Landmark distances do not match the landmarks");
+  }
+  const auto node_count = distances_.size() / (2 * landmarks_.size());
+  for (size_t i = 0; i < tiles_.size(); ++i) {
+    if (static_cast<uint64_t>(tiles_[i].offset) + tiles_[i].node_count > node_count ||
+        (i > 0 && !(tiles_[i - 1].id < tiles_[i].id))) {
+      throw std::runtime_error("Landmark tiles are not sorted or out of range");
+    }
+  }
+}
+
+std::shared_ptr<const LandmarkDistances> LandmarkDistances::Load(const std::string& file) {
+  std::ifstream in(file, std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("Could not open landmarks " + file);
+  }
+
+  landmark_header_t header{};
+  in.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!in || memcmp(header.magic, kLandmarkMagic, sizeof(kLandmarkMagic)) != 0 ||
+      header.version != kLandmarkVersion) {
+    throw std::runtime_error("Not a landmark file or unsupported version: " + file);
+  }
+
+  std::vector<uint64_t> landmark_ids;
+  std::vector<tile_offset_t> tiles;
+  std::vector<float> distances;
+  std::string options(header.options_size, '\0');
+  read_array(in, landmark_ids, header.landmark_count);
+  read_array(in, tiles, header.tile_count);
+  read_array(in, distances, header.node_count * 2 * header.landmark_count);
+  in.read(&options[0], options.size());
+  if (!in) {
+    throw std::runtime_error("Landmark file is truncated: " + file);
+  }
+
+  std::vector<GraphId> landmarks;
+  landmarks.reserve(landmark_ids.size());
+  for (auto id : landmark_ids) {
+    landmarks.emplace_back(id);
+  }
+  std::vector<tile_t> tile_offsets;
+  tile_offsets.reserve(tiles.size());
+  for (const auto& tile : tiles) {
+    tile_offsets.push_back({GraphId(tile.tile), tile.offset, tile.node_count});
+  }
+
+  LOG_INFO("Loaded " + std::to_string(header.landmark_count) + " landmarks for " +
+           std::to_string(header.node_count) + " nodes from " + file);
+  return std::make_shared<const LandmarkDistances>(std::move(landmarks), std::move(tile_offsets),
+                                                   std::move(distances), std::move(options));
+}
+
+std::string LandmarkDistances::FileName(const std::string& dir, const std::string& costing) {
+  return dir + filesystem::path::preferred_separator + costing + ".landmarks";
+}
+
+std::shared_ptr<const LandmarkDistances> LandmarkDistances::Get(const std::string& dir,
+                                                                const std::string& costing) {
+  // everyone in the process shares the distances, including knowing that there are none
+  static std::mutex mutex;
+  static std::map<std::string, std::shared_ptr<const LandmarkDistances>> cache;
+  const auto file = FileName(dir, costing);
+  std::lock_guard<std::mutex> lock(mutex);
+  auto cached = cache.find(file);
+  if (cached != cache.end()) {
+    return cached->second;
+  }
+
+  std::shared_ptr<const LandmarkDistances> distances;
+  if (filesystem::exists(file)) {
+    try {
+      distances = Load(file);
+    } catch (const std::exception& e) {
+      LOG_ERROR("Not using landmarks for " + costing + ": " + e.what());
+    }
+  }
+  return cache[file] = distances;
+}
+
+void LandmarkDistances::Save(const std::string& file) const {
+  landmark_header_t header{};
+  memcpy(header.magic, kLandmarkMagic, sizeof(kLandmarkMagic));
+  header.version = kLandmarkVersion;
+  header.landmark_count = landmark_count();
+  header.tile_count = tiles_.size();
+  header.node_count = distances_.size() / (2 * landmarks_.size());
+  header.options_size = options_.size();
+
+  std::vector<uint64_t> landmark_ids;
+  for (const auto& landmark : landmarks_) {
+    landmark_ids.push_back(landmark.value);
+  }
+  std::vector<tile_offset_t> tiles;
+  tiles.reserve(tiles_.size());
+  for (const auto& tile : tiles_) {
+    tiles.push_back({tile.id.value, tile.offset, tile.node_count});
+  }
+
+  // write to the side and move it into place so readers never see half of a file
+  const std::string temp_file = file + ".tmp";
+  {
+    std::ofstream out(temp_file, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_array(out, landmark_ids);
+    write_array(out, tiles);
+    write_array(out, distances_);
+    out.write(options_.data(), options_.size());
+    if (!out) {
+      throw std::runtime_error("Could not write landmarks " + temp_file);
+    }
+  }
+  if (std::rename(temp_file.c_str(), file.c_str())) {
+    std::remove(temp_file.c_str());
+    throw std::runtime_error("Could not move landmarks into place at " + file);
+  }
+}
+
+uint32_t LandmarkDistances::tile_offset(const GraphId& tile, const uint32_t node_count) const {
+  auto found = std::lower_bound(tiles_.begin(), tiles_.end(), tile,
+                                [](const tile_t& tile, const GraphId& id) { return tile.id < id; });
+  // a tile which was rebuilt since has different nodes than the distances were computed for
+  return found != tiles_.end() && found->id == tile && found->node_count == node_count
+             ? found->offset
+             : kInvalidLandmarkIndex;
+}
+
+} // namespace baldr
+} // namespace valhalla
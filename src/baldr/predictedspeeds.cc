@@ -1,5 +1,7 @@
 #include "baldr/predictedspeeds.h"
 
+#include <cstdlib>
+
 namespace valhalla {
 namespace baldr {
 
@@ -85,6 +87,15 @@ float decompress_speed_bucket(const int16_t* coefficients, uint32_t bucket_idx)
   return speed * kSpeedNormalization;
 }
 
+float max_speed_bucket(const int16_t* coefficients) {
+  float speed = std::abs(*coefficients) * k1OverSqrt2;
+  const auto* coef_end = coefficients + kCoefficientCount;
+  for (++coefficients; coefficients < coef_end; ++coefficients) {
+    speed += std::abs(*coefficients);
+  }
+  return speed * kSpeedNormalization;
+}
+
 std::string encode_compressed_speeds(const int16_t* coefficients) {
   std::string result;
   result.reserve(kCoefficientCount * sizeof(uint16_t) / sizeof(char));
@@ -93,6 +93,9 @@ struct simplified_actor_t : public valhalla::tyr::actor_t {
   std::string centroid(const std::string& request_str) {
     return valhalla::tyr::actor_t::centroid(request_str, nullptr, nullptr);
   };
+  std::string batch_route(const std::string& request_str) {
+    return valhalla::tyr::actor_t::batch_route(request_str, nullptr, nullptr);
+  };
   std::string status(const std::string& request_str) {
     return valhalla::tyr::actor_t::status(request_str, nullptr, nullptr);
   }
@@ -127,6 +130,9 @@ PYBIND11_MODULE(python_valhalla, m) {
       .def(
           "Centroid", &simplified_actor_t::centroid,
           "Returns routes from all the input locations to the minimum cost meeting point of those paths.")
+      .def(
+          "BatchRoute", &simplified_actor_t::batch_route,
+          "Calculates a route for each pair of sources and targets, sharing the work of sources which are the same.")
       .def("Status", &simplified_actor_t::status,
            "Returns nothing or optionally details about Valhalla's configuration.");
 }
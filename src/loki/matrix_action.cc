@@ -40,6 +40,22 @@ void check_distance(const google::protobuf::RepeatedPtrField<valhalla::Location>
     }
   }
 }
+
+void check_pair_distance(const google::protobuf::RepeatedPtrField<valhalla::Location>& sources,
+                         const google::protobuf::RepeatedPtrField<valhalla::Location>& targets,
+                         float matrix_max_distance,
+                         float& max_location_distance) {
+  // only the sources and targets at the same index are routed between
+  for (int i = 0; i < sources.size(); ++i) {
+    auto path_distance = to_ll(sources.Get(i)).Distance(to_ll(targets.Get(i)));
+    if (path_distance >= max_location_distance) {
+      max_location_distance = path_distance;
+    }
+    if (path_distance > matrix_max_distance) {
+      throw valhalla_exception_t{154};
+    };
+  }
+}
 } // namespace
 
 namespace valhalla {
@@ -48,7 +64,8 @@ namespace loki {
 void loki_worker_t::init_matrix(Api& request) {
   // we require sources and targets
   auto& options = *request.mutable_options();
-  if (options.action() == Options::sources_to_targets) {
+  if (options.action() == Options::sources_to_targets ||
+      options.action() == Options::batch_route) {
     parse_locations(options.mutable_sources(), valhalla_exception_t{112});
     parse_locations(options.mutable_targets(), valhalla_exception_t{112});
   } // optimized route uses locations but needs to do a matrix
@@ -77,6 +94,11 @@ void loki_worker_t::init_matrix(Api& request) {
     t.clear_heading();
   }
 
+  // a batch of routes pairs each source with the target at the same index
+  if (options.action() == Options::batch_route && options.sources_size() != options.targets_size()) {
+    throw valhalla_exception_t{128};
+  }
+
   // no locations!
   options.clear_locations();
 
@@ -96,16 +118,27 @@ void loki_worker_t::matrix(Api& request) {
     throw valhalla_exception_t{140, Options_Action_Enum_Name(options.action())};
   };
 
-  // check that location size does not exceed max.
+  // check that location size does not exceed max. a batch of routes may have as many pairs as the
+  // largest matrix, its distinct sources are what costs the most
   auto max = max_matrix_locations.find(costing_name)->second;
-  if (options.sources_size() > max || options.targets_size() > max) {
+  if (options.action() == Options::batch_route) {
+    const auto max_pairs = static_cast<size_t>(max * max);
+    if (static_cast<size_t>(options.sources_size()) > max_pairs) {
+      throw valhalla_exception_t{150, std::to_string(max_pairs)};
+    }
+  } else if (options.sources_size() > max || options.targets_size() > max) {
     throw valhalla_exception_t{150, std::to_string(max)};
   };
 
   // check the distances
   auto max_location_distance = std::numeric_limits<float>::min();
-  check_distance(options.sources(), options.targets(), max_matrix_distance.find(costing_name)->second,
-                 max_location_distance);
+  if (options.action() == Options::batch_route) {
+    check_pair_distance(options.sources(), options.targets(),
+                        max_matrix_distance.find(costing_name)->second, max_location_distance);
+  } else {
+    check_distance(options.sources(), options.targets(),
+                   max_matrix_distance.find(costing_name)->second, max_location_distance);
+  }
 
   // correlate the various locations to the underlying graph
   auto sources_targets = PathLocation::fromPBF(options.sources());
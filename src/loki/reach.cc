@@ -226,10 +226,15 @@ Reach::ShouldExpand(baldr::GraphReader&, const sif::EdgeLabel&, const thor::Expa
 }
 
 // tell the expansion how many labels to expect and how many buckets to use
-void Reach::GetExpansionHints(uint32_t& bucket_count, uint32_t& edge_label_reservation) const {
+void Reach::GetExpansionHints(uint32_t& bucket_count,
+                              uint32_t& edge_label_reservation,
+                              thor::QueueType& queue_type) const {
   // TODO: tweak these for performance
   bucket_count = max_reach_ * 50;
   edge_label_reservation = max_reach_ * 10;
+  // the expansions are tiny and run for every candidate edge, unlike the buckets of the double
+  // bucket queue the radix queue has nothing to sweep when it is cleared between them
+  queue_type = thor::QueueType::kRadix;
 }
 
 void Reach::Clear() {
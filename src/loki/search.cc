@@ -251,6 +251,19 @@ struct bin_handler_t {
       : reader(reader), costing(costing) {
     // get the unique set of input locations and the max reachability of them all
     std::unordered_set<Location> uniq_locations(locations.begin(), locations.end());
+    // ask for the tiles within the radius of all the locations at once so that the ones which
+    // arent loaded yet can be fetched together in the background rather than one at a time
+    if (reader.PrefetchEnabled()) {
+      const auto& local_level = TileHierarchy::levels().back();
+      std::vector<GraphId> tile_ids;
+      for (const auto& loc : uniq_locations) {
+        auto bbox = ExpandMeters(loc.latlng_, static_cast<float>(loc.radius_));
+        for (auto tile_id : local_level.tiles.TileList(bbox)) {
+          tile_ids.emplace_back(tile_id, local_level.level, 0);
+        }
+      }
+      reader.Prefetch(tile_ids);
+    }
     pps.reserve(uniq_locations.size());
     max_reach_limit = 0;
     for (const auto& loc : uniq_locations) {
@@ -41,6 +41,24 @@ void loki_worker_t::status(Api& request) const {
   status->set_has_live_traffic(reader->HasLiveTraffic());
   status->set_version(VALHALLA_VERSION);
 
+  // how the tile cache is doing on the levels we have used so far
+  auto cache_stats = reader->GetCacheStats();
+  for (size_t level = 0; level < cache_stats.levels.size(); ++level) {
+    const auto& stats = cache_stats.levels[level];
+    if (stats.hits == 0 && stats.misses == 0 && stats.inserts == 0) {
+      continue;
+    }
+    auto* tile_cache = status->add_tile_cache();
+    tile_cache->set_level(level);
+    tile_cache->set_hits(stats.hits);
+    tile_cache->set_misses(stats.misses);
+    tile_cache->set_inserts(stats.inserts);
+    tile_cache->set_evictions(stats.evictions);
+    tile_cache->set_tiles(stats.tiles);
+    tile_cache->set_bytes(stats.bytes);
+    tile_cache->set_load_micros(stats.load_micros);
+  }
+
 #ifdef HAVE_HTTP
   // if we are in the process of shutting down we signal that here
   // should react by draining traffic (though they are likely doing this as they are usually the ones
@@ -249,6 +249,7 @@ loki_worker_t::loki_worker_t(const boost::property_tree::ptree& config,
 }
 
 void loki_worker_t::cleanup() {
+  enqueue_cache_statistics(*reader);
   service_worker_t::cleanup();
   if (reader->OverCommitted()) {
     reader->Trim();
@@ -299,6 +300,7 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
         break;
       case Options::sources_to_targets:
       case Options::optimized_route:
+      case Options::batch_route:
         matrix(request);
         result.messages.emplace_back(request.SerializeAsString());
         break;
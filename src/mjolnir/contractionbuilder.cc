@@ -0,0 +1,342 @@
+#include "mjolnir/contractionbuilder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "baldr/contraction.h"
+#include "baldr/graphconstants.h"
+#include "baldr/graphid.h"
+#include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "midgard/pointll.h"
+
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// Cells of the dissection with at most this many nodes are not split any further
+constexpr size_t kMaxCellSize = 64;
+
+struct graph_edge_t {
+  GraphId edgeid;
+  uint32_t from;
+  uint32_t to;
+};
+
+// Union find over the graph nodes, used to merge the copies of a node on each level
+uint32_t find_root(std::vector<uint32_t>& roots, uint32_t node) {
+  while (roots[node] != node) {
+    roots[node] = roots[roots[node]];
+    node = roots[node];
+  }
+  return node;
+}
+
+// Orders the nodes by recursive coordinate bisection. Each cell is split in half along the longer
+// side of its bounding box and the smaller of the two boundaries between the halves becomes the
+// separator which is ranked above both halves. Road networks have small separators so this keeps
+// the number of shortcuts created by the contraction low.
+std::vector<uint32_t> dissect(const std::vector<PointLL>& coords,
+                              const std::vector<uint32_t>& first_neighbour,
+                              const std::vector<uint32_t>& neighbours) {
+  const uint32_t node_count = static_cast<uint32_t>(coords.size());
+  std::vector<uint32_t> order;
+  order.reserve(node_count);
+
+  struct cell_t {
+    std::vector<uint32_t> nodes;
+    bool separator;
+  };
+  std::vector<cell_t> cells;
+  cells.push_back({std::vector<uint32_t>(node_count), false});
+  std::iota(cells.back().nodes.begin(), cells.back().nodes.end(), 0);
+
+  // which half of the current split a node is in
+  std::vector<uint32_t> side(node_count, 0);
+  uint32_t stamp = 0;
+  while (!cells.empty()) {
+    auto cell = std::move(cells.back());
+    cells.pop_back();
+
+    // small cells and separators are ranked as they are, the least connected first
+    if (cell.separator || cell.nodes.size() <= kMaxCellSize) {
+      if (!cell.separator) {
+        std::stable_sort(cell.nodes.begin(), cell.nodes.end(),
+                         [&first_neighbour](uint32_t a, uint32_t b) {
+                           return first_neighbour[a + 1] - first_neighbour[a] <
+                                  first_neighbour[b + 1] - first_neighbour[b];
+                         });
+      }
+      order.insert(order.end(), cell.nodes.begin(), cell.nodes.end());
+      continue;
+    }
+
+    // split along the longer side of the bounding box
+    double minx = coords[cell.nodes.front()].lng(), maxx = minx;
+    double miny = coords[cell.nodes.front()].lat(), maxy = miny;
+    for (auto node : cell.nodes) {
+      minx = std::min(minx, coords[node].lng());
+      maxx = std::max(maxx, coords[node].lng());
+      miny = std::min(miny, coords[node].lat());
+      maxy = std::max(maxy, coords[node].lat());
+    }
+    const bool split_x = maxx - minx >= maxy - miny;
+    auto middle = cell.nodes.begin() + cell.nodes.size() / 2;
+    std::nth_element(cell.nodes.begin(), middle, cell.nodes.end(),
+                     [&coords, split_x](uint32_t a, uint32_t b) {
+                       return split_x ? coords[a].lng() < coords[b].lng()
+                                      : coords[a].lat() < coords[b].lat();
+                     });
+    std::vector<uint32_t> first(cell.nodes.begin(), middle), second(middle, cell.nodes.end());
+    cell.nodes.clear();
+    cell.nodes.shrink_to_fit();
+
+    // find the nodes of each half which have a neighbour in the other half
+    const uint32_t first_side = ++stamp, second_side = ++stamp;
+    for (auto node : first) {
+      side[node] = first_side;
+    }
+    for (auto node : second) {
+      side[node] = second_side;
+    }
+    auto boundary = [&](std::vector<uint32_t>& half, uint32_t other_side) {
+      std::vector<uint32_t> separator;
+      auto end = std::stable_partition(half.begin(), half.end(), [&](uint32_t node) {
+        for (auto n = first_neighbour[node]; n < first_neighbour[node + 1]; ++n) {
+          if (side[neighbours[n]] == other_side) {
+            return false;
+          }
+        }
+        return true;
+      });
+      separator.assign(end, half.end());
+      return std::make_pair(end, separator);
+    };
+    auto first_boundary = boundary(first, second_side);
+    auto second_boundary = boundary(second, first_side);
+
+    // keep the smaller boundary as the separator and leave the other half whole
+    std::vector<uint32_t> separator;
+    if (first_boundary.second.size() <= second_boundary.second.size()) {
+      separator = std::move(first_boundary.second);
+      first.erase(first_boundary.first, first.end());
+    } else {
+      separator = std::move(second_boundary.second);
+      second.erase(second_boundary.first, second.end());
+    }
+
+    // the halves are ranked first and the separator above both of them
+    cells.push_back({std::move(separator), true});
+    cells.push_back({std::move(second), false});
+    cells.push_back({std::move(first), false});
+  }
+  return order;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+void ContractionBuilder::Build(const boost::property_tree::ptree& pt) {
+  auto file = pt.get<std::string>("mjolnir.contraction_hierarchy", "");
+  if (file.empty()) {
+    LOG_INFO("No contraction hierarchy configured, skipping it");
+    return;
+  }
+  LOG_INFO("Building contraction hierarchy...");
+
+  // the nodes of each tile get a contiguous range of indices
+  GraphReader reader(pt.get_child("mjolnir"));
+  const auto max_level = TileHierarchy::levels().back().level;
+  std::vector<GraphId> tile_ids;
+  for (const auto& tile_id : reader.GetTileSet()) {
+    if (tile_id.level() <= max_level) {
+      tile_ids.push_back(tile_id);
+    }
+  }
+  std::sort(tile_ids.begin(), tile_ids.end());
+  std::unordered_map<GraphId, uint32_t> tile_offsets;
+  uint64_t graph_node_count = 0;
+  for (const auto& tile_id : tile_ids) {
+    auto tile = reader.GetGraphTile(tile_id);
+    tile_offsets.emplace(tile_id, static_cast<uint32_t>(graph_node_count));
+    graph_node_count += tile->header()->nodecount();
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  if (graph_node_count >= kInvalidContractionIndex) {
+    throw std::runtime_error("Too many nodes for a contraction hierarchy");
+  }
+  auto node_index = [&tile_offsets](const GraphId& node) {
+    auto found = tile_offsets.find(node.Tile_Base());
+    return found == tile_offsets.end() ? kInvalidContractionIndex : found->second + node.id();
+  };
+
+  // gather the edges and merge the nodes which are connected by transitions
+  std::vector<PointLL> node_coords(graph_node_count);
+  std::vector<uint32_t> roots(graph_node_count);
+  std::iota(roots.begin(), roots.end(), 0);
+  std::vector<graph_edge_t> edges;
+  for (const auto& tile_id : tile_ids) {
+    auto tile = reader.GetGraphTile(tile_id);
+    const uint32_t offset = tile_offsets[tile_id];
+    for (uint32_t i = 0; i < tile->header()->nodecount(); ++i) {
+      const NodeInfo* node = tile->node(i);
+      node_coords[offset + i] = node->latlng(tile->header()->base_ll());
+
+      for (uint32_t j = 0; j < node->transition_count(); ++j) {
+        auto other = node_index(tile->transition(node->transition_index() + j)->endnode());
+        if (other != kInvalidContractionIndex) {
+          roots[find_root(roots, offset + i)] = find_root(roots, other);
+        }
+      }
+
+      GraphId edgeid(tile_id.tileid(), tile_id.level(), node->edge_index());
+      for (uint32_t j = 0; j < node->edge_count(); ++j, ++edgeid) {
+        const DirectedEdge* edge = tile->directededge(edgeid);
+        if (edge->is_shortcut() || edge->IsTransitLine()) {
+          continue;
+        }
+        auto to = node_index(edge->endnode());
+        if (to != kInvalidContractionIndex) {
+          edges.push_back({edgeid, offset + i, to});
+        }
+      }
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+
+  // number the merged nodes densely
+  std::vector<uint32_t> merged(graph_node_count, kInvalidContractionIndex);
+  std::vector<PointLL> coords;
+  for (uint32_t i = 0; i < graph_node_count; ++i) {
+    auto root = find_root(roots, i);
+    if (merged[root] == kInvalidContractionIndex) {
+      merged[root] = static_cast<uint32_t>(coords.size());
+      coords.push_back(node_coords[root]);
+    }
+    merged[i] = merged[root];
+  }
+  roots.clear();
+  roots.shrink_to_fit();
+  node_coords.clear();
+  node_coords.shrink_to_fit();
+  const uint32_t node_count = static_cast<uint32_t>(coords.size());
+
+  // undirected adjacency of the merged nodes
+  std::vector<std::pair<uint32_t, uint32_t>> links;
+  links.reserve(edges.size() * 2);
+  for (auto& edge : edges) {
+    edge.from = merged[edge.from];
+    edge.to = merged[edge.to];
+    if (edge.from != edge.to) {
+      links.emplace_back(edge.from, edge.to);
+      links.emplace_back(edge.to, edge.from);
+    }
+  }
+  std::sort(links.begin(), links.end());
+  links.erase(std::unique(links.begin(), links.end()), links.end());
+  std::vector<uint32_t> first_neighbour(node_count + 1, 0), neighbours;
+  neighbours.reserve(links.size());
+  for (const auto& link : links) {
+    ++first_neighbour[link.first + 1];
+    neighbours.push_back(link.second);
+  }
+  std::partial_sum(first_neighbour.begin(), first_neighbour.end(), first_neighbour.begin());
+
+  // rank the nodes
+  auto order = dissect(coords, first_neighbour, neighbours);
+  std::vector<uint32_t> ranks(node_count);
+  for (uint32_t rank = 0; rank < node_count; ++rank) {
+    ranks[order[rank]] = rank;
+  }
+  order.clear();
+  order.shrink_to_fit();
+
+  // contract in rank order, the upward neighbours of a node form a clique once its removed which
+  // we add by merging them into the lowest of them, its parent in the elimination tree
+  std::vector<std::vector<uint32_t>> upward(node_count);
+  for (const auto& link : links) {
+    auto from = ranks[link.first], to = ranks[link.second];
+    if (from < to) {
+      upward[from].push_back(to);
+    }
+  }
+  links.clear();
+  links.shrink_to_fit();
+  std::vector<uint32_t> first_arcs(node_count + 1, 0), arc_heads;
+  for (uint32_t rank = 0; rank < node_count; ++rank) {
+    auto& heads = upward[rank];
+    std::sort(heads.begin(), heads.end());
+    heads.erase(std::unique(heads.begin(), heads.end()), heads.end());
+    if (heads.size() > 1) {
+      auto& parent = upward[heads.front()];
+      parent.insert(parent.end(), heads.begin() + 1, heads.end());
+    }
+    if (arc_heads.size() + heads.size() >= kInvalidContractionIndex) {
+      throw std::runtime_error("Too many arcs for a contraction hierarchy");
+    }
+    arc_heads.insert(arc_heads.end(), heads.begin(), heads.end());
+    first_arcs[rank + 1] = static_cast<uint32_t>(arc_heads.size());
+    std::vector<uint32_t>().swap(heads);
+  }
+
+  // map the edges onto the arcs between their nodes
+  auto find_arc = [&first_arcs, &arc_heads](uint32_t lower, uint32_t higher) {
+    auto begin = arc_heads.begin() + first_arcs[lower];
+    auto end = arc_heads.begin() + first_arcs[lower + 1];
+    return static_cast<uint32_t>(std::lower_bound(begin, end, higher) - arc_heads.begin());
+  };
+  std::vector<ContractionHierarchy::input_edge_t> input_edges;
+  input_edges.reserve(edges.size());
+  for (const auto& edge : edges) {
+    auto from = ranks[edge.from], to = ranks[edge.to];
+    if (from != to) {
+      input_edges.push_back({edge.edgeid, find_arc(std::min(from, to), std::max(from, to)),
+                             from < to ? 1u : 0u});
+    }
+  }
+  std::sort(input_edges.begin(), input_edges.end(),
+            [](const ContractionHierarchy::input_edge_t& a,
+               const ContractionHierarchy::input_edge_t& b) { return a.edgeid < b.edgeid; });
+
+  // every graph node gets the rank of the node it was merged into
+  std::vector<std::pair<GraphId, uint32_t>> node_ranks;
+  node_ranks.reserve(graph_node_count);
+  for (const auto& tile_id : tile_ids) {
+    const uint32_t offset = tile_offsets[tile_id];
+    auto tile = reader.GetGraphTile(tile_id);
+    for (uint32_t i = 0; i < tile->header()->nodecount(); ++i) {
+      node_ranks.emplace_back(GraphId(tile_id.tileid(), tile_id.level(), i),
+                              ranks[merged[offset + i]]);
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+
+  std::sort(node_ranks.begin(), node_ranks.end());
+
+  LOG_INFO("Contracted " + std::to_string(node_count) + " nodes with " +
+           std::to_string(input_edges.size()) + " edges into " +
+           std::to_string(arc_heads.size()) + " arcs");
+  ContractionHierarchy hierarchy(std::move(node_ranks), std::move(first_arcs),
+                                 std::move(arc_heads), std::move(input_edges));
+  hierarchy.Save(file);
+  LOG_INFO("Finished writing contraction hierarchy to " + file);
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -0,0 +1,355 @@
+#include "mjolnir/landmarkbuilder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "baldr/graphconstants.h"
+#include "baldr/graphid.h"
+#include "baldr/graphreader.h"
+#include "baldr/landmarks.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/tilehierarchy.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "midgard/threads.h"
+#include "proto_conversions.h"
+#include "sif/costfactory.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+using namespace valhalla::mjolnir;
+using valhalla::midgard::run_threads;
+
+namespace {
+
+// Connected regions with fewer nodes than this, islands and parking lots, get no landmarks
+constexpr size_t kMinRegionNodes = 1000;
+
+constexpr uint32_t kInvalidNode = std::numeric_limits<uint32_t>::max();
+
+// The graph of one costing in both directions, the nodes of each tile are numbered contiguously
+struct landmark_graph_t {
+  std::vector<uint32_t> first_forward, forward_heads;
+  std::vector<float> forward_costs;
+  std::vector<uint32_t> first_reverse, reverse_heads;
+  std::vector<float> reverse_costs;
+
+  uint32_t node_count() const {
+    return static_cast<uint32_t>(first_forward.size() - 1);
+  }
+};
+
+struct graph_edge_t {
+  uint32_t from;
+  uint32_t to;
+  float cost;
+};
+
+// Union find over the graph nodes, used to find the weakly connected regions
+uint32_t find_root(std::vector<uint32_t>& roots, uint32_t node) {
+  while (roots[node] != node) {
+    roots[node] = roots[roots[node]];
+    node = roots[node];
+  }
+  return node;
+}
+
+// Builds the adjacency of one direction from the edges
+void make_adjacency(const std::vector<graph_edge_t>& edges,
+                    uint32_t node_count,
+                    bool forward,
+                    std::vector<uint32_t>& first,
+                    std::vector<uint32_t>& heads,
+                    std::vector<float>& costs) {
+  first.assign(node_count + 1, 0);
+  for (const auto& edge : edges) {
+    ++first[(forward ? edge.from : edge.to) + 1];
+  }
+  std::partial_sum(first.begin(), first.end(), first.begin());
+  heads.resize(edges.size());
+  costs.resize(edges.size());
+  std::vector<uint32_t> next(first.begin(), first.end() - 1);
+  for (const auto& edge : edges) {
+    auto slot = next[forward ? edge.from : edge.to]++;
+    heads[slot] = forward ? edge.to : edge.from;
+    costs[slot] = edge.cost;
+  }
+}
+
+// Computes the costs from the source to every node, or from every node to the source in reverse
+void dijkstra(const landmark_graph_t& graph,
+              uint32_t source,
+              bool forward,
+              std::vector<float>& costs) {
+  const auto& first = forward ? graph.first_forward : graph.first_reverse;
+  const auto& heads = forward ? graph.forward_heads : graph.reverse_heads;
+  const auto& edge_costs = forward ? graph.forward_costs : graph.reverse_costs;
+  costs.assign(graph.node_count(), kUnreachableLandmark);
+
+  using label_t = std::pair<float, uint32_t>;
+  std::priority_queue<label_t, std::vector<label_t>, std::greater<label_t>> queue;
+  costs[source] = 0.f;
+  queue.emplace(0.f, source);
+  while (!queue.empty()) {
+    auto label = queue.top();
+    queue.pop();
+    // stale labels of nodes which were already settled with a lower cost
+    if (label.first > costs[label.second]) {
+      continue;
+    }
+    for (auto e = first[label.second]; e < first[label.second + 1]; ++e) {
+      auto cost = label.first + edge_costs[e];
+      if (cost < costs[heads[e]]) {
+        costs[heads[e]] = cost;
+        queue.emplace(cost, heads[e]);
+      }
+    }
+  }
+}
+
+// Gathers the edges the costing can use, transitions between levels cost nothing
+landmark_graph_t make_graph(GraphReader& reader,
+                            const std::vector<GraphId>& tile_ids,
+                            const std::unordered_map<GraphId, uint32_t>& tile_offsets,
+                            uint32_t node_count,
+                            const cost_ptr_t& costing) {
+  auto node_index = [&tile_offsets](const GraphId& node) {
+    auto found = tile_offsets.find(node.Tile_Base());
+    return found == tile_offsets.end() ? kInvalidNode : found->second + node.id();
+  };
+
+  // node access is left out on purpose, the costs only have to be lower bounds
+  std::vector<graph_edge_t> edges;
+  for (const auto& tile_id : tile_ids) {
+    auto tile = reader.GetGraphTile(tile_id);
+    const uint32_t offset = tile_offsets.find(tile_id)->second;
+    for (uint32_t i = 0; i < tile->header()->nodecount(); ++i) {
+      const NodeInfo* node = tile->node(i);
+      // every transition has one going back from the other level
+      for (uint32_t j = 0; j < node->transition_count(); ++j) {
+        auto other = node_index(tile->transition(node->transition_index() + j)->endnode());
+        if (other != kInvalidNode) {
+          edges.push_back({offset + i, other, 0.f});
+        }
+      }
+
+      GraphId edgeid(tile_id.tileid(), tile_id.level(), node->edge_index());
+      for (uint32_t j = 0; j < node->edge_count(); ++j, ++edgeid) {
+        const DirectedEdge* edge = tile->directededge(edgeid);
+        if (edge->is_shortcut() || edge->IsTransitLine() ||
+            !costing->Allowed(edge, tile, kDisallowShortcut)) {
+          continue;
+        }
+        auto to = node_index(edge->endnode());
+        if (to != kInvalidNode) {
+          uint8_t flow_sources;
+          auto cost = costing->EdgeCost(edge, tile, kInvalidSecondsOfWeek, flow_sources);
+          edges.push_back({offset + i, to, cost.cost});
+        }
+      }
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+
+  landmark_graph_t graph;
+  make_adjacency(edges, node_count, true, graph.first_forward, graph.forward_heads,
+                 graph.forward_costs);
+  make_adjacency(edges, node_count, false, graph.first_reverse, graph.reverse_heads,
+                 graph.reverse_costs);
+  return graph;
+}
+
+// Spreads the landmarks over the largest weakly connected regions of the graph, each gets at least
+// one and the rest go to whichever region has the most nodes per landmark. Within a region they
+// are picked by farthest selection: the node farthest from a start node, then over and over the
+// node whose cost from the closest landmark picked so far is the highest.
+std::vector<uint32_t> select_landmarks(const landmark_graph_t& graph, uint32_t landmark_count) {
+  const auto node_count = graph.node_count();
+  std::vector<uint32_t> roots(node_count);
+  std::iota(roots.begin(), roots.end(), 0);
+  for (uint32_t node = 0; node < node_count; ++node) {
+    for (auto e = graph.first_forward[node]; e < graph.first_forward[node + 1]; ++e) {
+      roots[find_root(roots, node)] = find_root(roots, graph.forward_heads[e]);
+    }
+  }
+  std::unordered_map<uint32_t, std::vector<uint32_t>> by_root;
+  for (uint32_t node = 0; node < node_count; ++node) {
+    by_root[find_root(roots, node)].push_back(node);
+  }
+  std::vector<std::vector<uint32_t>> regions;
+  for (auto& region : by_root) {
+    if (region.second.size() >= kMinRegionNodes) {
+      regions.push_back(std::move(region.second));
+    }
+  }
+  by_root.clear();
+  std::sort(regions.begin(), regions.end(),
+            [](const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+              return a.size() != b.size() ? a.size() > b.size() : a.front() < b.front();
+            });
+  if (regions.size() > landmark_count) {
+    regions.resize(landmark_count);
+  }
+
+  std::vector<uint32_t> counts(regions.size(), regions.empty() ? 0 : 1);
+  for (auto assigned = static_cast<uint32_t>(regions.size()); assigned < landmark_count;
+       ++assigned) {
+    size_t best = 0;
+    for (size_t i = 1; i < regions.size(); ++i) {
+      if (regions[i].size() * counts[best] > regions[best].size() * counts[i]) {
+        best = i;
+      }
+    }
+    ++counts[best];
+  }
+
+  std::vector<uint32_t> landmarks;
+  std::vector<float> costs;
+  for (size_t i = 0; i < regions.size(); ++i) {
+    const auto& region = regions[i];
+    std::vector<float> closest(region.size(), kUnreachableLandmark);
+    auto source = region.front();
+    for (uint32_t picked = 0;; ++picked) {
+      dijkstra(graph, source, true, costs);
+      // the farthest node, skipping those which the landmarks cant reach. the start node isnt a
+      // landmark so its costs are only used to find the first one
+      float farthest = -1.f;
+      uint32_t next = kInvalidNode;
+      for (size_t j = 0; j < region.size(); ++j) {
+        closest[j] = picked <= 1 ? costs[region[j]] : std::min(closest[j], costs[region[j]]);
+        if (closest[j] != kUnreachableLandmark && closest[j] > farthest &&
+            std::find(landmarks.begin(), landmarks.end(), region[j]) == landmarks.end()) {
+          farthest = closest[j];
+          next = region[j];
+        }
+      }
+      if (next == kInvalidNode) {
+        break;
+      }
+      landmarks.push_back(next);
+      source = next;
+      if (picked + 1 == counts[i]) {
+        break;
+      }
+    }
+  }
+  return landmarks;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+void LandmarkBuilder::Build(const boost::property_tree::ptree& pt) {
+  auto dir = pt.get<std::string>("mjolnir.landmark_dir", "");
+  if (dir.empty()) {
+    LOG_INFO("No landmark directory configured, skipping landmarks");
+    return;
+  }
+  LOG_INFO("Building landmarks...");
+  filesystem::create_directories(dir);
+  const auto landmark_count = std::max(pt.get<uint32_t>("mjolnir.landmark_count", 8), 1u);
+  const auto concurrency =
+      std::max(pt.get<uint32_t>("mjolnir.concurrency", std::thread::hardware_concurrency()), 1u);
+
+  // the nodes of each tile get a contiguous range of indices
+  GraphReader reader(pt.get_child("mjolnir"));
+  const auto max_level = TileHierarchy::levels().back().level;
+  std::vector<GraphId> tile_ids;
+  for (const auto& tile_id : reader.GetTileSet()) {
+    if (tile_id.level() <= max_level) {
+      tile_ids.push_back(tile_id);
+    }
+  }
+  std::sort(tile_ids.begin(), tile_ids.end());
+  std::unordered_map<GraphId, uint32_t> tile_offsets;
+  std::vector<LandmarkDistances::tile_t> sorted_offsets;
+  uint64_t node_count = 0;
+  for (const auto& tile_id : tile_ids) {
+    auto tile = reader.GetGraphTile(tile_id);
+    tile_offsets.emplace(tile_id, static_cast<uint32_t>(node_count));
+    sorted_offsets.push_back(
+        {tile_id, static_cast<uint32_t>(node_count), tile->header()->nodecount()});
+    node_count += tile->header()->nodecount();
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  if (node_count >= kInvalidNode) {
+    throw std::runtime_error("Too many nodes for landmarks");
+  }
+
+  for (const auto& costing_name :
+       pt.get_child("mjolnir.landmark_costings", boost::property_tree::ptree())) {
+    const auto name = costing_name.second.get_value<std::string>();
+    Costing costing_type;
+    if (!Costing_Enum_Parse(name, &costing_type)) {
+      LOG_WARN("Skipping landmarks for unknown costing " + name);
+      continue;
+    }
+
+    // the distances are only used by requests which dont change the default costing options
+    rapidjson::Document doc;
+    doc.SetObject();
+    CostingOptions options;
+    ParseCostingOptions(doc, "/costing_options/" + name, &options, costing_type);
+    auto costing = CostFactory().Create(options);
+    auto graph = make_graph(reader, tile_ids, tile_offsets, static_cast<uint32_t>(node_count),
+                            costing);
+    auto landmarks = select_landmarks(graph, landmark_count);
+    if (landmarks.empty()) {
+      LOG_WARN("No region is big enough for landmarks for " + name);
+      continue;
+    }
+
+    // a dijkstra from and one to each landmark, spread over the threads
+    const size_t columns = landmarks.size() * 2;
+    std::vector<float> distances(node_count * columns);
+    std::atomic<size_t> next(0);
+    run_threads(std::min<uint32_t>(concurrency, columns), [&](uint32_t) {
+      std::vector<float> costs;
+      for (auto column = next++; column < columns; column = next++) {
+        const bool from = column < landmarks.size();
+        dijkstra(graph, landmarks[from ? column : column - landmarks.size()], from, costs);
+        for (size_t node = 0; node < node_count; ++node) {
+          distances[node * columns + column] = costs[node];
+        }
+      }
+    });
+
+    std::vector<GraphId> landmark_ids;
+    for (auto landmark : landmarks) {
+      auto tile = std::upper_bound(sorted_offsets.begin(), sorted_offsets.end(), landmark,
+                                   [](uint32_t index, const LandmarkDistances::tile_t& tile) {
+                                     return index < tile.offset;
+                                   }) -
+                  1;
+      landmark_ids.emplace_back(tile->id.tileid(), tile->id.level(), landmark - tile->offset);
+    }
+
+    auto file = LandmarkDistances::FileName(dir, name);
+    auto tiles = sorted_offsets;
+    LandmarkDistances(std::move(landmark_ids), std::move(tiles), std::move(distances),
+                      options.SerializeAsString())
+        .Save(file);
+    LOG_INFO("Finished writing " + std::to_string(landmarks.size()) + " landmarks for " + name +
+             " to " + file);
+  }
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -7,12 +7,14 @@
 #include "midgard/point2.h"
 #include "midgard/polyline2.h"
 #include "mjolnir/bssbuilder.h"
+#include "mjolnir/contractionbuilder.h"
 #include "mjolnir/elevationbuilder.h"
 #include "mjolnir/graphbuilder.h"
 #include "mjolnir/graphenhancer.h"
 #include "mjolnir/graphfilter.h"
 #include "mjolnir/graphvalidator.h"
 #include "mjolnir/hierarchybuilder.h"
+#include "mjolnir/landmarkbuilder.h"
 #include "mjolnir/osmpbfparser.h"
 #include "mjolnir/pbfgraphparser.h"
 #include "mjolnir/restrictionbuilder.h"
@@ -381,6 +383,16 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
     GraphValidator::Validate(config);
   }
 
+  // Contract the finished graph so thor can use it for hierarchy queries
+  if (start_stage <= BuildStage::kContraction && BuildStage::kContraction <= end_stage) {
+    ContractionBuilder::Build(config);
+  }
+
+  // Precompute the landmark costs for the ALT heuristic of the path algorithms
+  if (start_stage <= BuildStage::kLandmarks && BuildStage::kLandmarks <= end_stage) {
+    LandmarkBuilder::Build(config);
+  }
+
   // Cleanup bin files
   if (start_stage <= BuildStage::kCleanup && BuildStage::kCleanup <= end_stage) {
     LOG_INFO("Cleaning up temporary *.bin files within " + tile_dir);
@@ -42,14 +42,9 @@ AStarBSSAlgorithm::~AStarBSSAlgorithm() {
 
 // Clear the temporary information generated during path construction.
 void AStarBSSAlgorithm::Clear() {
-  // Reduce edge labels capacity if it's more than limit
-  if (edgelabels_.size() > max_reserved_labels_count_) {
-    edgelabels_.resize(max_reserved_labels_count_);
-    edgelabels_.shrink_to_fit();
-  }
-  // Clear the edge labels and destination list. Reset the adjacency list
+  // Hand the edge labels back to the arena, clear the destination list. Reset the adjacency list
   // and clear edge status.
-  edgelabels_.clear();
+  label_arena_->Release(edgelabels_);
   destinations_.clear();
   adjacencylist_.clear();
   pedestrian_edgestatus_.clear();
@@ -82,7 +77,7 @@ void AStarBSSAlgorithm::Init(const midgard::PointLL& origll, const midgard::Poin
   // Reserve size for edge labels - do this here rather than in constructor so
   // to limit how much extra memory is used for persistent objects.
   // TODO - reserve based on estimate based on distance and route type.
-  edgelabels_.reserve(std::min(kInitialEdgeLabelCount, max_reserved_labels_count_));
+  label_arena_->Acquire(edgelabels_, std::min(kInitialEdgeLabelCount, max_reserved_labels_count_));
 
   // Construct adjacency list, clear edge status.
   // Set bucket size and cost range based on DynamicCost.
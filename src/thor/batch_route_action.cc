@@ -0,0 +1,105 @@
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "midgard/logging.h"
+#include "proto_conversions.h"
+#include "thor/worker.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+using namespace valhalla::thor;
+
+namespace {
+
+// Sources correlated to the same place on the same edges expand the same way no matter where they
+// are in the request, so this leaves out their index
+std::string correlation_key(const valhalla::Location& location) {
+  std::string key;
+  const auto append = [&key](const auto value) {
+    key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  };
+  append(location.ll().lat());
+  append(location.ll().lng());
+  for (const auto& edge : location.path_edges()) {
+    append(edge.graph_id());
+    append(edge.percent_along());
+  }
+  return key;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+void thor_worker_t::batch_route(Api& request) {
+  // time this whole method and save that statistic
+  auto _ = measure_scope_time(request);
+
+  parse_locations(request);
+  parse_filter_attributes(request);
+  auto costing = parse_costing(request);
+  auto& options = *request.mutable_options();
+
+  // Group the pairs by their source. The same input correlates to the same source so the pairs of
+  // a depot all end up in one group
+  std::vector<std::vector<int>> groups;
+  std::unordered_map<std::string, size_t> group_index;
+  for (int i = 0; i < options.sources_size(); ++i) {
+    auto inserted = group_index.emplace(correlation_key(options.sources(i)), groups.size());
+    if (inserted.second) {
+      groups.emplace_back();
+    }
+    groups[inserted.first->second].push_back(i);
+  }
+
+  // There is a route for each pair in the order of the request, the ones without a path stay empty
+  auto& routes = *request.mutable_trip()->mutable_routes();
+  for (int i = 0; i < options.sources_size(); ++i) {
+    routes.Add();
+  }
+
+  // One expansion from each source finds the paths to all the targets it is paired with
+  std::vector<const valhalla::Location*> targets;
+  for (const auto& group : groups) {
+    if (interrupt) {
+      (*interrupt)();
+    }
+
+    targets.clear();
+    for (auto i : group) {
+      targets.push_back(&options.targets(i));
+    }
+    auto paths = path_tree.FindPaths(options.sources(group.front()), targets, *reader, mode_costing,
+                                     mode, max_matrix_distance.find(costing)->second);
+
+    // serialize path information of each route into protobuf route objects
+    for (size_t j = 0; j < group.size(); ++j) {
+      const auto& path = paths[j];
+      if (path.empty()) {
+        LOG_WARN("No path found from source " + std::to_string(group[j]) + " to its target");
+        continue;
+      }
+      auto& leg = *routes.Mutable(group[j])->mutable_legs()->Add();
+      thor::TripLegBuilder::Build(options, controller, *reader, mode_costing, path.begin(),
+                                  path.end(), *options.mutable_sources(group[j]),
+                                  *options.mutable_targets(group[j]), {}, leg, {"dijkstras"},
+                                  interrupt);
+    }
+
+    // the labels go back to the arena for the next source
+    path_tree.Clear();
+  }
+
+  // there is one expansion per distinct source rather than one per pair
+  auto* stat = request.mutable_info()->mutable_statistics()->Add();
+  stat->set_key(Options_Action_Enum_Name(options.action()) + ".info." + service_name() +
+                ".expansions");
+  stat->set_value(groups.size());
+  stat->set_type(count);
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -8,6 +8,10 @@
 #include "sif/recost.h"
 #include "thor/alternates.h"
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <thread>
 
 using namespace valhalla::midgard;
 using namespace valhalla::baldr;
@@ -35,6 +39,10 @@ constexpr float kAlternativeCostExtend = 1.1f;
 // iterations in order no to drop performance too much.
 constexpr uint32_t kAlternativeIterationsDelta = 100000;
 
+// How many times the path of an arrive by route is costed again from the departure it implies,
+// the departure normally settles after the first time
+constexpr uint32_t kDepartureIterations = 3;
+
 inline float find_percent_along(const valhalla::Location& location, const GraphId& edge_id) {
   for (const auto& e : location.path_edges()) {
     if (e.graph_id() == edge_id)
@@ -43,6 +51,13 @@ inline float find_percent_along(const valhalla::Location& location, const GraphI
   throw std::logic_error("Could not find candidate edge for the location");
 }
 
+// Lowers an atomic value to the candidate if the candidate is smaller
+inline void lower_to(std::atomic<float>& value, const float candidate) {
+  float current = value.load();
+  while (candidate < current && !value.compare_exchange_weak(current, candidate)) {
+  }
+}
+
 } // namespace
 
 namespace valhalla {
@@ -52,7 +67,8 @@ namespace thor {
 BidirectionalAStar::BidirectionalAStar(const boost::property_tree::ptree& config)
     : PathAlgorithm(), max_reserved_labels_count_(config.get<uint32_t>("max_reserved_labels_count",
                                                                        kInitialEdgeLabelCountBD)),
-      extended_search_(config.get<bool>("extended_search", false)) {
+      extended_search_(config.get<bool>("extended_search", false)),
+      time_dependent_(config.get<bool>("time_dependent_bidirectional", false)) {
   cost_threshold_ = 0;
   iterations_threshold_ = 0;
   desired_paths_count_ = 1;
@@ -63,6 +79,11 @@ BidirectionalAStar::BidirectionalAStar(const boost::property_tree::ptree& config
   pruning_disabled_at_origin_ = false;
   pruning_disabled_at_destination_ = false;
   ignore_hierarchy_limits_ = false;
+  parallel_min_distance_ = config.get<float>("parallel_bidirectional_min_distance", 20000.0f);
+  parallel_max_edges_ = config.get<uint32_t>("parallel_bidirectional_max_edges", 500000);
+  parallel_ = false;
+  restrict_forward_ = false;
+  arrival_time_info_ = TimeInfo::invalid();
 }
 
 // Destructor
@@ -71,22 +92,15 @@ BidirectionalAStar::~BidirectionalAStar() {
 
 // Clear the temporary information generated during path construction.
 void BidirectionalAStar::Clear() {
-  if (edgelabels_forward_.size() > max_reserved_labels_count_) {
-    // reduce edge labels capacity
-    edgelabels_forward_.resize(max_reserved_labels_count_);
-    edgelabels_forward_.shrink_to_fit();
-  }
-  edgelabels_forward_.clear();
-  if (edgelabels_reverse_.size() > max_reserved_labels_count_) {
-    // reduce edge labels capacity
-    edgelabels_reverse_.resize(max_reserved_labels_count_);
-    edgelabels_reverse_.shrink_to_fit();
-  }
-  edgelabels_reverse_.clear();
+  // hand the edge labels back to the arena for the next request
+  label_arena_->Release(edgelabels_forward_);
+  label_arena_->Release(edgelabels_reverse_);
   adjacencylist_forward_.clear();
   adjacencylist_reverse_.clear();
   edgestatus_forward_.clear();
   edgestatus_reverse_.clear();
+  published_forward_.clear();
+  published_reverse_.clear();
 
   // Set the ferry flag to false
   has_ferry_ = false;
@@ -96,6 +110,8 @@ void BidirectionalAStar::Clear() {
   pruning_disabled_at_origin_ = false;
   pruning_disabled_at_destination_ = false;
   ignore_hierarchy_limits_ = false;
+  restrict_forward_ = false;
+  arrival_time_info_ = TimeInfo::invalid();
 }
 
 // Initialize the A* heuristic and adjacency lists for both the forward
@@ -108,8 +124,10 @@ void BidirectionalAStar::Init(const PointLL& origll, const PointLL& destll) {
 
   // Reserve size for edge labels - do this here rather than in constructor so
   // to limit how much extra memory is used for persistent objects
-  edgelabels_forward_.reserve(std::min(max_reserved_labels_count_, kInitialEdgeLabelCountBD));
-  edgelabels_reverse_.reserve(std::min(max_reserved_labels_count_, kInitialEdgeLabelCountBD));
+  label_arena_->Acquire(edgelabels_forward_,
+                        std::min(max_reserved_labels_count_, kInitialEdgeLabelCountBD));
+  label_arena_->Acquire(edgelabels_reverse_,
+                        std::min(max_reserved_labels_count_, kInitialEdgeLabelCountBD));
 
   // Construct adjacency list and initialize edge status lookup.
   // Set bucket size and cost range based on DynamicCost.
@@ -204,8 +222,17 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
     if (ignore_hierarchy_limits_ || !get_opp_edge_data())
       return false;
 
-    const auto& opp_edgestatus = FORWARD ? edgestatus_reverse_ : edgestatus_forward_;
-    const auto opp_edge_set = opp_edgestatus.Get(opp_edge_id).set();
+    // The edge status of the other direction belongs to its thread when searching in parallel,
+    // only the edges it settled can be seen then
+    EdgeSet opp_edge_set;
+    if (parallel_) {
+      const auto& opp_published = FORWARD ? published_reverse_ : published_forward_;
+      opp_edge_set =
+          opp_published.Find(opp_edge_id) ? EdgeSet::kPermanent : EdgeSet::kUnreachedOrReset;
+    } else {
+      const auto& opp_edgestatus = FORWARD ? edgestatus_reverse_ : edgestatus_forward_;
+      opp_edge_set = opp_edgestatus.Get(opp_edge_id).set();
+    }
     // Synchronize shortcuts for both directions. If this shortcut has been already
     // encountered on the opposing search we should do the same now: skip or traverse.
     if ((opp_edge_set != EdgeSet::kSkipped &&
@@ -226,6 +253,18 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
     return true; // This is an edge we _could_ have expanded, so return true
   }
 
+  // In the last phase of the time dependent search the forward search only follows the edges the
+  // reverse search reached, no path cheaper than the one it already has uses any of the others
+  if (FORWARD && restrict_forward_) {
+    if (t2 == nullptr && !get_opp_edge_data()) {
+      return false;
+    }
+    const auto opp_edge_set = edgestatus_reverse_.Get(opp_edge_id).set();
+    if (opp_edge_set == EdgeSet::kUnreachedOrReset || opp_edge_set == EdgeSet::kSkipped) {
+      return false;
+    }
+  }
+
   const baldr::DirectedEdge* opp_edge = nullptr;
 
   if (!FORWARD) {
@@ -278,6 +317,8 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
       pred.cost() + (FORWARD
                          ? costing_->EdgeCost(meta.edge, tile, time_info.second_of_week, flow_sources)
                          : costing_->EdgeCost(opp_edge, t2, time_info.second_of_week, flow_sources));
+  auto& counters = FORWARD ? counters_ : reverse_counters_;
+  counters.predicted_speeds += (flow_sources & kPredictedFlowMask) != 0;
 
   // Separate out transition cost.
   sif::Cost transition_cost =
@@ -301,6 +342,7 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
       } else {
         adjacencylist_reverse_.decrease(meta.edge_status->index(), newsortcost);
       }
+      ++counters.queue_decreases;
       lab.Update(pred_idx, newcost, newsortcost, transition_cost, restriction_idx);
     }
     // Returning true since this means we approved the edge
@@ -314,10 +356,10 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
   // Find the sort cost (with A* heuristic) using the lat,lng at the
   // end node of the directed edge.
   float dist = 0.0f;
+  const PointLL endll = t2->get_node_ll(meta.edge->endnode());
   float sortcost =
-      newcost.cost + (FORWARD
-                          ? astarheuristic_forward_.Get(t2->get_node_ll(meta.edge->endnode()), dist)
-                          : astarheuristic_reverse_.Get(t2->get_node_ll(meta.edge->endnode()), dist));
+      newcost.cost + (FORWARD ? astarheuristic_forward_.Get(endll, meta.edge->endnode(), t2, dist)
+                              : astarheuristic_reverse_.Get(endll, meta.edge->endnode(), t2, dist));
 
   // not_thru_pruning_ is only set to false on the 2nd pass in route_action.
   bool thru = not_thru_pruning_ ? (pred.not_thru_pruning() || !meta.edge->not_thru()) : false;
@@ -329,7 +371,7 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
     if (hierarchy_limits_forward_[meta.edge_id.level()].max_up_transitions != kUnlimitedTransitions) {
       // Override distance to the destination with a distance from the origin.
       // It will be used by hierarchy limits
-      dist = astarheuristic_reverse_.GetDistance(t2->get_node_ll(meta.edge->endnode()));
+      dist = astarheuristic_reverse_.GetDistance(endll);
     }
     edgelabels_forward_.emplace_back(pred_idx, meta.edge_id, opp_edge_id, meta.edge, newcost,
                                      sortcost, dist, mode_, transition_cost, thru,
@@ -343,7 +385,7 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
     if (hierarchy_limits_reverse_[meta.edge_id.level()].max_up_transitions != kUnlimitedTransitions) {
       // Override distance to the origin with a distance from the destination.
       // It will be used by hierarchy limits
-      dist = astarheuristic_forward_.GetDistance(t2->get_node_ll(meta.edge->endnode()));
+      dist = astarheuristic_forward_.GetDistance(endll);
     }
     edgelabels_reverse_.emplace_back(pred_idx, meta.edge_id, opp_edge_id, meta.edge, newcost,
                                      sortcost, dist, mode_, transition_cost, thru,
@@ -354,6 +396,7 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
                                      restriction_idx);
     adjacencylist_reverse_.add(idx);
   }
+  ++counters.queue_adds;
 
   *meta.edge_status = {EdgeSet::kTemporary, idx};
 
@@ -483,6 +526,209 @@ bool BidirectionalAStar::Expand(baldr::GraphReader& graphreader,
   return disable_uturn;
 }
 
+// The state both directions of the parallel search share
+struct BidirectionalAStar::ParallelSearch {
+  std::atomic<bool> done{false};
+  // a direction settled more edges than it could publish
+  std::atomic<bool> overflowed{false};
+  std::atomic<bool> connected{false};
+  std::atomic<float> cost_threshold{std::numeric_limits<float>::max()};
+  // the sort cost each direction last settled an edge at
+  std::atomic<float> forward_sortcost{0.0f};
+  std::atomic<float> reverse_sortcost{0.0f};
+  // the edges of each tree which met the other tree, each only used by its direction
+  std::vector<GraphId> forward_connections;
+  std::vector<GraphId> reverse_connections;
+};
+
+template <const ExpansionType expansion_direction>
+void BidirectionalAStar::ExpandInParallel(GraphReader& graphreader,
+                                          const TimeInfo& time_info,
+                                          const bool invariant,
+                                          const AStarHeuristic& opp_heuristic,
+                                          ParallelSearch& search) {
+  constexpr bool FORWARD = expansion_direction == ExpansionType::forward;
+  auto& adjacencylist = FORWARD ? adjacencylist_forward_ : adjacencylist_reverse_;
+  auto& edgelabels = FORWARD ? edgelabels_forward_ : edgelabels_reverse_;
+  auto& edgestatus = FORWARD ? edgestatus_forward_ : edgestatus_reverse_;
+  auto& hierarchy_limits = FORWARD ? hierarchy_limits_forward_ : hierarchy_limits_reverse_;
+  auto& published = FORWARD ? published_forward_ : published_reverse_;
+  const auto& opp_published = FORWARD ? published_reverse_ : published_forward_;
+  auto& sortcost = FORWARD ? search.forward_sortcost : search.reverse_sortcost;
+  const auto& opp_sortcost = FORWARD ? search.reverse_sortcost : search.forward_sortcost;
+  auto& connections = FORWARD ? search.forward_connections : search.reverse_connections;
+  const float cost_diff = FORWARD ? cost_diff_ : 0.0f;
+  // See the serial search for why an exhausted direction may let the other one keep going
+  const bool extend =
+      extended_search_ && (FORWARD ? pruning_disabled_at_destination_ : pruning_disabled_at_origin_);
+
+  int n = 0;
+  while (!search.done.load(std::memory_order_relaxed)) {
+    // Allow this process to be aborted, the interrupt is only called from the calling thread
+    if (FORWARD && interrupt && (++n % kInterruptIterationsInterval) == 0) {
+      (*interrupt)();
+    }
+
+    const uint32_t pred_idx = adjacencylist.pop();
+    if (pred_idx == kInvalidLabel) {
+      if (search.connected || !extend) {
+        search.done = true;
+      }
+      return;
+    }
+    // Copy the label since expanding can reallocate the labels
+    BDEdgeLabel pred = edgelabels[pred_idx];
+    ++(FORWARD ? counters_ : reverse_counters_).settled_edges;
+
+    // Settle the edge and let the other direction know about it
+    edgestatus.Update(pred.edgeid(), EdgeSet::kPermanent);
+    const float pred_cost =
+        pred.predecessor() == kInvalidLabel ? 0.0f : edgelabels[pred.predecessor()].cost().cost;
+    if (!published.Publish(pred.edgeid(), {pred.cost().cost, pred_cost,
+                                           pred.transition_cost().cost, true})) {
+      search.overflowed = true;
+      search.done = true;
+      return;
+    }
+    sortcost.store(pred.sortcost(), std::memory_order_relaxed);
+
+    // Terminate if the cost threshold has been exceeded.
+    if (pred.sortcost() + cost_diff > search.cost_threshold.load()) {
+      search.done = true;
+      return;
+    }
+
+    // Check if the edge connects to an edge settled by the other direction. The connection is
+    // costed like SetForwardConnection and SetReverseConnection do to tighten the threshold but
+    // it is only checked against complex restrictions once both trees are done.
+    const auto* opp = opp_published.Find(pred.opp_edgeid());
+    if (opp && pred.internal_turn() == InternalTurn::kNoTurn) {
+      connections.push_back(pred.edgeid());
+      search.connected = true;
+      if (!pred.on_complex_rest()) {
+        const float c = pred.predecessor() != kInvalidLabel
+                            ? pred_cost + opp->cost + pred.transition_cost().cost
+                            : pred.cost().cost + opp->pred_cost + opp->transition_cost;
+        lower_to(search.cost_threshold, c + kThresholdDelta);
+        if (opp->settled) {
+          continue;
+        }
+      }
+    }
+
+    // Prune path if predecessor is not a through edge or if the maximum
+    // number of upward transitions has been exceeded on this hierarchy level.
+    if ((pred.not_thru() && pred.not_thru_pruning()) ||
+        (!ignore_hierarchy_limits_ &&
+         hierarchy_limits[pred.endnode().level()].StopExpanding(pred.distance()))) {
+      continue;
+    }
+
+    // Reach-based pruning against the edge the other direction settled last
+    const float cost_threshold = search.cost_threshold.load(std::memory_order_relaxed);
+    if (cost_threshold != std::numeric_limits<float>::max() &&
+        pred.predecessor() != kInvalidLabel) {
+      const auto& pred_pred = edgelabels[pred.predecessor()];
+      const auto pred_tile = graphreader.GetGraphTile(pred_pred.endnode());
+      if (pred_tile != nullptr) {
+        float dist = 0.0f;
+        float route_lower_bound =
+            pred_pred.cost().cost + pred.transition_cost().cost +
+            opp_sortcost.load(std::memory_order_relaxed) -
+            opp_heuristic.Get(pred_tile->get_node_ll(pred_pred.endnode()), pred_pred.endnode(),
+                              pred_tile, dist);
+        if (route_lower_bound > cost_threshold) {
+          continue;
+        }
+      }
+    }
+
+    // The reverse direction needs the opposing predecessor directed edge
+    const DirectedEdge* opp_pred_edge = nullptr;
+    if (!FORWARD) {
+      const auto pred_tile = graphreader.GetGraphTile(pred.opp_edgeid());
+      if (pred_tile == nullptr) {
+        continue;
+      }
+      opp_pred_edge = pred_tile->directededge(pred.opp_edgeid());
+    }
+    Expand<expansion_direction>(graphreader, pred.endnode(), pred, pred_idx, opp_pred_edge,
+                                time_info, invariant);
+  }
+}
+
+bool BidirectionalAStar::SearchInParallel(GraphReader& graphreader,
+                                          const TimeInfo& forward_time_info,
+                                          const TimeInfo& reverse_time_info,
+                                          const bool invariant) {
+  published_forward_.Reserve(parallel_max_edges_);
+  published_reverse_.Reserve(parallel_max_edges_);
+  published_forward_.clear();
+  published_reverse_.clear();
+
+  // The edges the searches start on can be met before they are settled, like the temporary
+  // labels without a predecessor in the serial search
+  for (const auto& label : edgelabels_forward_) {
+    if (!published_forward_.Publish(label.edgeid(), {label.cost().cost, 0.0f,
+                                                      label.transition_cost().cost, false})) {
+      return false;
+    }
+  }
+  for (const auto& label : edgelabels_reverse_) {
+    if (!published_reverse_.Publish(label.edgeid(), {label.cost().cost, 0.0f,
+                                                      label.transition_cost().cost, false})) {
+      return false;
+    }
+  }
+
+  // Each thread looks up the landmarks of the other heuristic with its own copy since the
+  // heuristics remember the last tile they looked at
+  const AStarHeuristic forward_heuristic = astarheuristic_forward_;
+  const AStarHeuristic reverse_heuristic = astarheuristic_reverse_;
+  ParallelSearch search;
+  parallel_ = true;
+
+  // Graph readers are not thread safe so the reverse direction gets its own
+  std::exception_ptr reverse_error;
+  std::thread reverse([&]() {
+    try {
+      ExpandInParallel<ExpansionType::reverse>(*reverse_reader_, reverse_time_info, invariant,
+                                               forward_heuristic, search);
+    } catch (...) {
+      reverse_error = std::current_exception();
+      search.done = true;
+    }
+  });
+  std::exception_ptr forward_error;
+  try {
+    ExpandInParallel<ExpansionType::forward>(graphreader, forward_time_info, invariant,
+                                             reverse_heuristic, search);
+  } catch (...) {
+    forward_error = std::current_exception();
+    search.done = true;
+  }
+  reverse.join();
+  parallel_ = false;
+  if (forward_error) {
+    std::rethrow_exception(forward_error);
+  }
+  if (reverse_error) {
+    std::rethrow_exception(reverse_error);
+  }
+  if (search.overflowed) {
+    return false;
+  }
+
+  // Now that the trees are done the connections can be checked and costed as usual
+  for (const auto& edgeid : search.forward_connections) {
+    SetForwardConnection(graphreader, edgelabels_forward_[edgestatus_forward_.Get(edgeid).index()]);
+  }
+  for (const auto& edgeid : search.reverse_connections) {
+    SetReverseConnection(graphreader, edgelabels_reverse_[edgestatus_reverse_.Get(edgeid).index()]);
+  }
+  return true;
+}
+
 // Calculate best path using bi-directional A*. No hierarchies or time
 // dependencies are used. Suitable for pedestrian routes (and bicycle?).
 std::vector<std::vector<PathInfo>>
@@ -507,6 +753,21 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
   PointLL destination_new(destination.path_edges(0).ll().lng(), destination.path_edges(0).ll().lat());
   Init(origin_new, destination_new);
 
+  // Tighten the heuristics with the landmarks of the costing, if there are any
+  auto landmarks = GetLandmarks(options, origin, destination, costing_, graphreader);
+  const auto init_landmarks = [&]() {
+    if (landmarks) {
+      astarheuristic_forward_.InitLandmarks(landmarks, GetLocationNodes(destination, graphreader),
+                                            true);
+      astarheuristic_reverse_.InitLandmarks(landmarks, GetLocationNodes(origin, graphreader),
+                                            false);
+    }
+  };
+  init_landmarks();
+
+  // Start loading the tiles between the locations while we get going
+  graphreader.PrefetchCorridor({origin_new, destination_new});
+
   // Get time information for forward and backward searches
   bool invariant = options.has_date_time_type() && options.date_time_type() == Options::invariant;
   auto forward_time_info = TimeInfo::make(origin, graphreader, &tz_cache_);
@@ -524,6 +785,16 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
   //    reverse_time_info = TimeInfo::make(d, graphreader, &tz_cache_);
   //  }
 
+  // In the time dependent mode the reverse search of a depart at route has no time to track and
+  // uses lower bounds of the costs instead, an arrive by route is costed from its departure
+  const bool time_dependent = time_dependent_ && !invariant && desired_paths_count_ == 1;
+  if (time_dependent && forward_time_info.valid) {
+    reverse_time_info = TimeInfo::invalid();
+    reverse_time_info.second_of_week = kFastestSecondOfWeek;
+  } else if (time_dependent && reverse_time_info.valid) {
+    arrival_time_info_ = reverse_time_info;
+  }
+
   // Set origin and destination locations - seeds the adj. lists
   // Note: because we can correlate to more than one place for a given
   // PathLocation using edges.front here means we are only setting the
@@ -536,6 +807,38 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
   if (!ignore_hierarchy_limits_)
     ModifyHierarchyLimits();
 
+  if (time_dependent && forward_time_info.valid) {
+    return SearchTimeDependent(graphreader, origin, destination, forward_time_info);
+  }
+
+  // Long routes without time dependence or alternates can expand both directions at once
+  if (reverse_reader_ && desired_paths_count_ == 1 && !expansion_callback_ &&
+      !forward_time_info.valid && !reverse_time_info.valid &&
+      origin_new.Distance(destination_new) >= parallel_min_distance_) {
+    if (SearchInParallel(graphreader, forward_time_info, reverse_time_info, invariant)) {
+      ++counters_.parallel_searches;
+      if (!best_connections_.empty()) {
+        return FormPath(graphreader, options, origin, destination, forward_time_info, invariant);
+      }
+      LOG_ERROR("Bi-directional route failure - parallel search exhausted: n = " +
+                std::to_string(edgelabels_forward_.size()) + "," +
+                std::to_string(edgelabels_reverse_.size()));
+      return {};
+    }
+
+    // Start over serially if the settled edges did not fit
+    LOG_WARN("Parallel bidirectional search exceeded " + std::to_string(parallel_max_edges_) +
+             " settled edges, searching again serially");
+    edgelabels_forward_.clear();
+    edgelabels_reverse_.clear();
+    Init(origin_new, destination_new);
+    init_landmarks();
+    SetOrigin(graphreader, origin, forward_time_info);
+    SetDestination(graphreader, destination, reverse_time_info);
+    if (!ignore_hierarchy_limits_)
+      ModifyHierarchyLimits();
+  }
+
   // Find shortest path. Switch between a forward direction and a reverse
   // direction search based on the current costs. Alternating like this
   // prevents one tree from expanding much more quickly (if in a sparser
@@ -562,6 +865,7 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
       forward_pred_idx = adjacencylist_forward_.pop();
       if (forward_pred_idx != kInvalidLabel) {
         fwd_pred = edgelabels_forward_[forward_pred_idx];
+        ++counters_.settled_edges;
 
         // Forward path to this edge can't be improved, so we can settle it right now.
         edgestatus_forward_.Update(fwd_pred.edgeid(), EdgeSet::kPermanent);
@@ -612,6 +916,7 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
       reverse_pred_idx = adjacencylist_reverse_.pop();
       if (reverse_pred_idx != kInvalidLabel) {
         rev_pred = edgelabels_reverse_[reverse_pred_idx];
+        ++reverse_counters_.settled_edges;
 
         // Reverse path to this edge can't be improved, so we can settle it right now.
         edgestatus_reverse_.Update(rev_pred.edgeid(), EdgeSet::kPermanent);
@@ -721,9 +1026,12 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
         const auto pred_tile = graphreader.GetGraphTile(fwd_pred_pred.endnode());
         if (pred_tile != nullptr) {
           // Estimate lower bound cost for the shortest path that goes through the current edge.
+          // The heuristic has to be the same one the sort costs were computed with.
+          float dist = 0.0f;
           float route_lower_bound =
               fwd_pred_pred.cost().cost + fwd_pred.transition_cost().cost + rev_pred.sortcost() -
-              astarheuristic_reverse_.Get(pred_tile->get_node_ll(fwd_pred_pred.endnode()));
+              astarheuristic_reverse_.Get(pred_tile->get_node_ll(fwd_pred_pred.endnode()),
+                                          fwd_pred_pred.endnode(), pred_tile, dist);
           // Prune this edge if estimated lower bound cost exceeds the cost threshold.
           if (route_lower_bound > cost_threshold_) {
             continue;
@@ -760,9 +1068,12 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
         const auto pred_tile = graphreader.GetGraphTile(rev_pred_pred.endnode());
         if (pred_tile != nullptr) {
           // Estimate lower bound cost for the shortest path that goes through the current edge.
+          // The heuristic has to be the same one the sort costs were computed with.
+          float dist = 0.0f;
           float route_lower_bound =
               rev_pred_pred.cost().cost + rev_pred.transition_cost().cost + fwd_pred.sortcost() -
-              astarheuristic_forward_.Get(pred_tile->get_node_ll(rev_pred_pred.endnode()));
+              astarheuristic_forward_.Get(pred_tile->get_node_ll(rev_pred_pred.endnode()),
+                                          rev_pred_pred.endnode(), pred_tile, dist);
           // Prune this edge if estimated lower bound cost exceeds the cost threshold.
           if (route_lower_bound > cost_threshold_) {
             continue;
@@ -786,6 +1097,206 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
   return {}; // If we are here the route failed
 }
 
+// The time dependent search of a depart at route, see the header for its phases.
+std::vector<std::vector<PathInfo>>
+BidirectionalAStar::SearchTimeDependent(GraphReader& graphreader,
+                                        const valhalla::Location& origin,
+                                        const valhalla::Location& destination,
+                                        const TimeInfo& time_info) {
+  // The reverse search uses the fastest speed of each edge
+  TimeInfo lower_bound_time_info = TimeInfo::invalid();
+  lower_bound_time_info.second_of_week = kFastestSecondOfWeek;
+
+  // The cheapest path found so far costed at the departure time, its cost is the upper bound
+  std::vector<PathInfo> best_path;
+  float upper_bound = std::numeric_limits<float>::max();
+  const auto cost_connection = [&](const CandidateConnection& connection) {
+    std::vector<PathInfo> path;
+    if (FormConnectionPath(graphreader, connection, origin, destination, time_info, false, path) &&
+        !path.empty() && path.back().elapsed_cost.cost < upper_bound) {
+      upper_bound = path.back().elapsed_cost.cost;
+      best_path = std::move(path);
+    }
+  };
+
+  // Expanding is the same in all phases, apart from the forward search only following the edges
+  // the reverse search reached in the last phase
+  const auto expand_forward = [&](BDEdgeLabel& pred, const uint32_t pred_idx) {
+    if (expansion_callback_) {
+      expansion_callback_(graphreader, "bidirectional_astar", pred.edgeid(), "s", false);
+    }
+    if ((pred.not_thru() && pred.not_thru_pruning()) ||
+        (!ignore_hierarchy_limits_ &&
+         hierarchy_limits_forward_[pred.endnode().level()].StopExpanding(pred.distance()))) {
+      return;
+    }
+    Expand<ExpansionType::forward>(graphreader, pred.endnode(), pred, pred_idx, nullptr, time_info,
+                                   false);
+  };
+  const auto expand_reverse = [&](BDEdgeLabel& pred, const uint32_t pred_idx) {
+    if (expansion_callback_) {
+      expansion_callback_(graphreader, "bidirectional_astar", pred.opp_edgeid(), "s", false);
+    }
+    if ((pred.not_thru() && pred.not_thru_pruning()) ||
+        (!ignore_hierarchy_limits_ &&
+         hierarchy_limits_reverse_[pred.endnode().level()].StopExpanding(pred.distance()))) {
+      return;
+    }
+    const auto pred_tile = graphreader.GetGraphTile(pred.opp_edgeid());
+    if (pred_tile == nullptr) {
+      return;
+    }
+    Expand<ExpansionType::reverse>(graphreader, pred.endnode(), pred, pred_idx,
+                                   pred_tile->directededge(pred.opp_edgeid()),
+                                   lower_bound_time_info, false);
+  };
+
+  // Whether the edge is the destination, it is reached by the reverse search without a predecessor
+  const auto is_destination = [&](const BDEdgeLabel& pred) {
+    const auto opp_status = edgestatus_reverse_.Get(pred.opp_edgeid());
+    return (opp_status.set() == EdgeSet::kPermanent || opp_status.set() == EdgeSet::kTemporary) &&
+           edgelabels_reverse_[opp_status.index()].predecessor() == kInvalidLabel;
+  };
+
+  // 1. Both directions until they meet, the one with the lower sort cost goes next. Like in the
+  // serial search a label which has been taken off its list waits there while the other
+  // direction goes on.
+  int n = 0;
+  uint32_t forward_pred_idx = kInvalidLabel, reverse_pred_idx = kInvalidLabel;
+  BDEdgeLabel fwd_pred, rev_pred;
+  bool forward_pending = false, reverse_pending = false;
+  while (best_connections_.empty()) {
+    if (interrupt && (++n % kInterruptIterationsInterval) == 0) {
+      (*interrupt)();
+    }
+
+    if (!forward_pending) {
+      forward_pred_idx = adjacencylist_forward_.pop();
+      if (forward_pred_idx == kInvalidLabel) {
+        LOG_ERROR("Forward search exhausted: n = " + std::to_string(edgelabels_forward_.size()) +
+                  "," + std::to_string(edgelabels_reverse_.size()));
+        return {};
+      }
+      fwd_pred = edgelabels_forward_[forward_pred_idx];
+      ++counters_.settled_edges;
+      edgestatus_forward_.Update(fwd_pred.edgeid(), EdgeSet::kPermanent);
+      forward_pending = true;
+
+      // The edge where they meet stays pending, at the departure time the best path may go on
+      // from it another way than the reverse tree does
+      const auto opp_status = edgestatus_reverse_.Get(fwd_pred.opp_edgeid());
+      if ((opp_status.set() == EdgeSet::kPermanent || is_destination(fwd_pred)) &&
+          SetForwardConnection(graphreader, fwd_pred)) {
+        break;
+      }
+    }
+    if (!reverse_pending) {
+      reverse_pred_idx = adjacencylist_reverse_.pop();
+      if (reverse_pred_idx == kInvalidLabel) {
+        LOG_ERROR("Reverse search exhausted: n = " + std::to_string(edgelabels_reverse_.size()) +
+                  "," + std::to_string(edgelabels_forward_.size()));
+        return {};
+      }
+      rev_pred = edgelabels_reverse_[reverse_pred_idx];
+      ++reverse_counters_.settled_edges;
+      edgestatus_reverse_.Update(rev_pred.edgeid(), EdgeSet::kPermanent);
+      reverse_pending = true;
+
+      const auto opp_status = edgestatus_forward_.Get(rev_pred.opp_edgeid());
+      if ((opp_status.set() == EdgeSet::kPermanent ||
+           (opp_status.set() == EdgeSet::kTemporary &&
+            edgelabels_forward_[opp_status.index()].predecessor() == kInvalidLabel)) &&
+          SetReverseConnection(graphreader, rev_pred)) {
+        break;
+      }
+    }
+
+    if (fwd_pred.sortcost() + cost_diff_ < rev_pred.sortcost()) {
+      forward_pending = false;
+      expand_forward(fwd_pred, forward_pred_idx);
+    } else {
+      reverse_pending = false;
+      expand_reverse(rev_pred, reverse_pred_idx);
+    }
+  }
+
+  // The connections are costed at the departure time, the cheapest is the upper bound
+  for (const auto& connection : best_connections_) {
+    cost_connection(connection);
+  }
+  if (best_path.empty()) {
+    LOG_ERROR("Bi-directional time dependent search failed to cost the connections");
+    return {};
+  }
+
+  // 2. The reverse search until its sort cost, a lower bound of the paths through its edges,
+  // passes the upper bound
+  if (reverse_pending) {
+    expand_reverse(rev_pred, reverse_pred_idx);
+  }
+  while (true) {
+    if (interrupt && (++n % kInterruptIterationsInterval) == 0) {
+      (*interrupt)();
+    }
+    reverse_pred_idx = adjacencylist_reverse_.pop();
+    if (reverse_pred_idx == kInvalidLabel) {
+      break;
+    }
+    rev_pred = edgelabels_reverse_[reverse_pred_idx];
+    ++reverse_counters_.settled_edges;
+    edgestatus_reverse_.Update(rev_pred.edgeid(), EdgeSet::kPermanent);
+    if (rev_pred.sortcost() > upper_bound) {
+      break;
+    }
+    expand_reverse(rev_pred, reverse_pred_idx);
+  }
+
+  // 3. The forward search along the edges the reverse search reached until the destination
+  restrict_forward_ = true;
+  if (forward_pending) {
+    expand_forward(fwd_pred, forward_pred_idx);
+  }
+  while (true) {
+    if (interrupt && (++n % kInterruptIterationsInterval) == 0) {
+      (*interrupt)();
+    }
+    forward_pred_idx = adjacencylist_forward_.pop();
+    if (forward_pred_idx == kInvalidLabel) {
+      break;
+    }
+    fwd_pred = edgelabels_forward_[forward_pred_idx];
+    ++counters_.settled_edges;
+    edgestatus_forward_.Update(fwd_pred.edgeid(), EdgeSet::kPermanent);
+
+    // The paths which only use the forward tree are costed like the connections. The labels of
+    // the destination edges cost the whole edge so each one is costed up to the destination
+    // rather than taking the first as the route
+    if (is_destination(fwd_pred)) {
+      cost_connection({fwd_pred.edgeid(), fwd_pred.opp_edgeid(), fwd_pred.cost().cost});
+      continue;
+    }
+    if (fwd_pred.sortcost() > upper_bound) {
+      break;
+    }
+    expand_forward(fwd_pred, forward_pred_idx);
+  }
+  restrict_forward_ = false;
+
+  // The destination edges still on the adjacency list can be cheaper up to the destination than
+  // their sort cost says
+  for (const auto& edge : destination.path_edges()) {
+    const auto status = edgestatus_forward_.Get(GraphId(edge.graph_id()));
+    if (status.set() == EdgeSet::kTemporary && is_destination(edgelabels_forward_[status.index()])) {
+      const auto& label = edgelabels_forward_[status.index()];
+      cost_connection({label.edgeid(), label.opp_edgeid(), label.cost().cost});
+    }
+  }
+
+  std::vector<std::vector<PathInfo>> paths;
+  paths.emplace_back(std::move(best_path));
+  return paths;
+}
+
 // The edge on the forward search connects to a reached edge on the reverse
 // search tree. Check if this is the best connection so far and set the
 // search threshold.
@@ -977,8 +1488,10 @@ void BidirectionalAStar::SetOrigin(GraphReader& graphreader,
     // We assume the slowest speed you could travel to cover that distance to start/end the route
     // TODO: assumes 1m/s which is a maximum penalty this could vary per costing model
     cost.cost += edge.distance();
-    float dist = astarheuristic_forward_.GetDistance(nodeinfo->latlng(endtile->header()->base_ll()));
-    float sortcost = cost.cost + astarheuristic_forward_.Get(dist);
+    float dist = 0.0f;
+    float sortcost =
+        cost.cost + astarheuristic_forward_.Get(nodeinfo->latlng(endtile->header()->base_ll()),
+                                                directededge->endnode(), endtile, dist);
 
     // Add EdgeLabel to the adjacency list. Set the predecessor edge index
     // to invalid to indicate the origin of the path.
@@ -1068,8 +1581,10 @@ void BidirectionalAStar::SetDestination(GraphReader& graphreader,
     // We assume the slowest speed you could travel to cover that distance to start/end the route
     // TODO: assumes 1m/s which is a maximum penalty this could vary per costing model
     cost.cost += edge.distance();
-    float dist = astarheuristic_reverse_.GetDistance(tile->get_node_ll(opp_dir_edge->endnode()));
-    float sortcost = cost.cost + astarheuristic_reverse_.Get(dist);
+    float dist = 0.0f;
+    float sortcost =
+        cost.cost + astarheuristic_reverse_.Get(tile->get_node_ll(opp_dir_edge->endnode()),
+                                                opp_dir_edge->endnode(), tile, dist);
 
     // Add EdgeLabel to the adjacency list. Set the predecessor edge index
     // to invalid to indicate the origin of the path. Make sure the opposing
@@ -1158,127 +1673,165 @@ std::vector<std::vector<PathInfo>> BidirectionalAStar::FormPath(GraphReader& gra
   for (auto best_connection = best_connections_.cbegin();
        paths.size() < desired_paths_count_ && best_connection != best_connections_.cend();
        ++best_connection) {
-    // Get the indexes where the connection occurs.
-    uint32_t idx1 = edgestatus_forward_.Get(best_connection->edgeid).index();
-    uint32_t idx2 = edgestatus_reverse_.Get(best_connection->opp_edgeid).index();
-
-    // Metrics (TODO - more accurate cost)
-    uint32_t pathcost = edgelabels_forward_[idx1].cost().cost + edgelabels_reverse_[idx2].cost().cost;
-    LOG_DEBUG("path_cost::" + std::to_string(pathcost));
-    LOG_DEBUG("FormPath path_iterations::" + std::to_string(edgelabels_forward_.size()) + "," +
-              std::to_string(edgelabels_reverse_.size()));
-
-    // set of edges recovered from shortcuts (excluding shortcut's start edges)
-    std::unordered_set<GraphId> recovered_inner_edges;
-
-    // A place to keep the path
-    std::vector<GraphId> path_edges;
-    path_edges.reserve(static_cast<size_t>(paths.empty() ? 0.f : paths.back().size() * 1.2f));
-
-    // Work backwards on the forward path
-    graph_tile_ptr tile;
-    for (auto edgelabel_index = idx1; edgelabel_index != kInvalidLabel;
-         edgelabel_index = edgelabels_forward_[edgelabel_index].predecessor()) {
-      const BDEdgeLabel& edgelabel = edgelabels_forward_[edgelabel_index];
-
-      const DirectedEdge* edge = graphreader.directededge(edgelabel.edgeid(), tile);
-      if (edge == nullptr) {
-        throw tile_gone_error_t("BidirectionalAStar::FormPath failed", edgelabel.edgeid());
-      }
+    std::vector<PathInfo> path;
+    if (!FormConnectionPath(graphreader, *best_connection, origin, dest, time_info, invariant,
+                            path)) {
+      continue;
+    }
 
-      if (edge->is_shortcut()) {
-        auto superseded = graphreader.RecoverShortcut(edgelabel.edgeid());
-        recovered_inner_edges.insert(superseded.begin() + 1, superseded.end());
-        std::move(superseded.rbegin(), superseded.rend(), std::back_inserter(path_edges));
-      } else
-        path_edges.push_back(edgelabel.edgeid());
+    // For the first path just add it for subsequent paths only add if it passes viability tests
+    if (paths.empty() || (validate_alternate_by_sharing(shared_edgeids, paths, path, max_sharing) &&
+                          validate_alternate_by_stretch(paths.front(), path) &&
+                          validate_alternate_by_local_optimality(path))) {
+      paths.emplace_back(std::move(path));
+    }
+  }
+  // give back the paths
+  return paths;
+}
 
-      // Check if this is a ferry
-      if (edgelabel.use() == Use::kFerry) {
-        has_ferry_ = true;
-      }
+// Form the path through one connection of the trees and cost it from the origin.
+bool BidirectionalAStar::FormConnectionPath(GraphReader& graphreader,
+                                            const CandidateConnection& connection,
+                                            const valhalla::Location& origin,
+                                            const valhalla::Location& dest,
+                                            const baldr::TimeInfo& time_info,
+                                            const bool invariant,
+                                            std::vector<PathInfo>& path) {
+  // Get the indexes where the connection occurs.
+  uint32_t idx1 = edgestatus_forward_.Get(connection.edgeid).index();
+  uint32_t idx2 = edgestatus_reverse_.Get(connection.opp_edgeid).index();
+
+  // Metrics (TODO - more accurate cost)
+  uint32_t pathcost = edgelabels_forward_[idx1].cost().cost + edgelabels_reverse_[idx2].cost().cost;
+  LOG_DEBUG("path_cost::" + std::to_string(pathcost));
+  LOG_DEBUG("FormPath path_iterations::" + std::to_string(edgelabels_forward_.size()) + "," +
+            std::to_string(edgelabels_reverse_.size()));
+
+  // set of edges recovered from shortcuts (excluding shortcut's start edges)
+  std::unordered_set<GraphId> recovered_inner_edges;
+
+  // A place to keep the path
+  std::vector<GraphId> path_edges;
+
+  // Work backwards on the forward path
+  graph_tile_ptr tile;
+  for (auto edgelabel_index = idx1; edgelabel_index != kInvalidLabel;
+       edgelabel_index = edgelabels_forward_[edgelabel_index].predecessor()) {
+    const BDEdgeLabel& edgelabel = edgelabels_forward_[edgelabel_index];
+
+    const DirectedEdge* edge = graphreader.directededge(edgelabel.edgeid(), tile);
+    if (edge == nullptr) {
+      throw tile_gone_error_t("BidirectionalAStar::FormPath failed", edgelabel.edgeid());
     }
 
-    // Reverse the list
-    std::reverse(path_edges.begin(), path_edges.end());
-
-    // Append the reverse path from the destination - use opposing edges
-    // The first edge on the reverse path is the same as the last on the forward
-    // path, so get the predecessor.
-    for (auto edgelabel_index = edgelabels_reverse_[idx2].predecessor();
-         edgelabel_index != kInvalidLabel;
-         edgelabel_index = edgelabels_reverse_[edgelabel_index].predecessor()) {
-      const BDEdgeLabel& edgelabel = edgelabels_reverse_[edgelabel_index];
-      const DirectedEdge* opp_edge = nullptr;
-      GraphId opp_edge_id = graphreader.GetOpposingEdgeId(edgelabel.edgeid(), opp_edge, tile);
-      if (opp_edge == nullptr) {
-        throw tile_gone_error_t("BidirectionalAStar::FormPath failed", edgelabel.edgeid());
-      }
+    if (edge->is_shortcut()) {
+      auto superseded = graphreader.RecoverShortcut(edgelabel.edgeid());
+      recovered_inner_edges.insert(superseded.begin() + 1, superseded.end());
+      std::move(superseded.rbegin(), superseded.rend(), std::back_inserter(path_edges));
+    } else
+      path_edges.push_back(edgelabel.edgeid());
 
-      if (opp_edge->is_shortcut()) {
-        auto superseded = graphreader.RecoverShortcut(opp_edge_id);
-        recovered_inner_edges.insert(superseded.begin() + 1, superseded.end());
-        std::move(superseded.begin(), superseded.end(), std::back_inserter(path_edges));
-      } else
-        path_edges.emplace_back(std::move(opp_edge_id));
+    // Check if this is a ferry
+    if (edgelabel.use() == Use::kFerry) {
+      has_ferry_ = true;
+    }
+  }
 
-      // Check if this is a ferry
-      if (edgelabel.use() == Use::kFerry) {
-        has_ferry_ = true;
-      }
+  // Reverse the list
+  std::reverse(path_edges.begin(), path_edges.end());
+
+  // Append the reverse path from the destination - use opposing edges
+  // The first edge on the reverse path is the same as the last on the forward
+  // path, so get the predecessor.
+  for (auto edgelabel_index = edgelabels_reverse_[idx2].predecessor();
+       edgelabel_index != kInvalidLabel;
+       edgelabel_index = edgelabels_reverse_[edgelabel_index].predecessor()) {
+    const BDEdgeLabel& edgelabel = edgelabels_reverse_[edgelabel_index];
+    const DirectedEdge* opp_edge = nullptr;
+    GraphId opp_edge_id = graphreader.GetOpposingEdgeId(edgelabel.edgeid(), opp_edge, tile);
+    if (opp_edge == nullptr) {
+      throw tile_gone_error_t("BidirectionalAStar::FormPath failed", edgelabel.edgeid());
     }
 
-    // bidirectional a* has a bug where it fails trivial routes in which you are on a one way edge and
-    // the origin is near the end of the edge and the destination is near the beginning, in other
-    // words a route that looks trivial but actually needs to go around the block to complete
-    if (path_edges.size() == 1)
-      LOG_WARN("Trivial route with bidirectional A* should not be allowed");
+    if (opp_edge->is_shortcut()) {
+      auto superseded = graphreader.RecoverShortcut(opp_edge_id);
+      recovered_inner_edges.insert(superseded.begin() + 1, superseded.end());
+      std::move(superseded.begin(), superseded.end(), std::back_inserter(path_edges));
+    } else
+      path_edges.emplace_back(std::move(opp_edge_id));
 
-    // once we recovered the whole path we should construct list of PathInfo objects
-    std::vector<PathInfo> path;
-    path.reserve(path_edges.size());
+    // Check if this is a ferry
+    if (edgelabel.use() == Use::kFerry) {
+      has_ferry_ = true;
+    }
+  }
 
-    auto edge_itr = path_edges.begin();
-    const auto edge_cb = [&edge_itr, &path_edges]() {
-      return (edge_itr == path_edges.end()) ? GraphId{} : (*edge_itr++);
-    };
+  // bidirectional a* has a bug where it fails trivial routes in which you are on a one way edge and
+  // the origin is near the end of the edge and the destination is near the beginning, in other
+  // words a route that looks trivial but actually needs to go around the block to complete
+  if (path_edges.size() == 1)
+    LOG_WARN("Trivial route with bidirectional A* should not be allowed");
 
-    const auto label_cb = [&path, &recovered_inner_edges](const EdgeLabel& label) {
-      path.emplace_back(label.mode(), label.cost(), label.edgeid(), 0, label.path_distance(),
-                        label.restriction_idx(), label.transition_cost(),
-                        recovered_inner_edges.count(label.edgeid()));
-    };
+  // once we recovered the whole path we should construct list of PathInfo objects
+  path.clear();
+  path.reserve(path_edges.size());
 
-    float source_pct;
-    try {
-      source_pct = find_percent_along(origin, path_edges.front());
-    } catch (...) { throw std::logic_error("Could not find candidate edge used for origin label"); }
+  auto edge_itr = path_edges.begin();
+  const auto edge_cb = [&edge_itr, &path_edges]() {
+    return (edge_itr == path_edges.end()) ? GraphId{} : (*edge_itr++);
+  };
 
-    float target_pct;
-    try {
-      target_pct = find_percent_along(dest, path_edges.back());
-    } catch (...) {
-      throw std::logic_error("Could not find candidate edge used for destination label");
-    }
+  const auto label_cb = [&path, &recovered_inner_edges](const EdgeLabel& label) {
+    path.emplace_back(label.mode(), label.cost(), label.edgeid(), 0, label.path_distance(),
+                      label.restriction_idx(), label.transition_cost(),
+                      recovered_inner_edges.count(label.edgeid()));
+  };
 
-    // recost edges in final path; ignore access restrictions
-    try {
-      sif::recost_forward(graphreader, *costing_, edge_cb, label_cb, source_pct, target_pct,
-                          time_info, invariant, true);
-    } catch (const std::exception& e) {
-      LOG_ERROR(std::string("Bi-directional astar failed to recost final path: ") + e.what());
-      continue;
-    }
+  float source_pct;
+  try {
+    source_pct = find_percent_along(origin, path_edges.front());
+  } catch (...) { throw std::logic_error("Could not find candidate edge used for origin label"); }
 
-    // For the first path just add it for subsequent paths only add if it passes viability tests
-    if (paths.empty() || (validate_alternate_by_sharing(shared_edgeids, paths, path, max_sharing) &&
-                          validate_alternate_by_stretch(paths.front(), path) &&
-                          validate_alternate_by_local_optimality(path))) {
-      paths.emplace_back(std::move(path));
+  float target_pct;
+  try {
+    target_pct = find_percent_along(dest, path_edges.back());
+  } catch (...) {
+    throw std::logic_error("Could not find candidate edge used for destination label");
+  }
+
+  // recost edges in final path; ignore access restrictions
+  const auto recost = [&](const TimeInfo& start_time_info) {
+    path.clear();
+    edge_itr = path_edges.begin();
+    sif::recost_forward(graphreader, *costing_, edge_cb, label_cb, source_pct, target_pct,
+                        start_time_info, invariant, true);
+  };
+  try {
+    recost(time_info);
+
+    // An arrive by route has no time at the origin. Its time at the destination is taken back
+    // by the duration of the path to depart from and the path is costed again, since the
+    // duration changes with the departure this repeats until it settles
+    if (!time_info.valid && arrival_time_info_.valid && !invariant) {
+      const auto* first_edge = graphreader.directededge(path_edges.front(), tile);
+      int timezone_index = first_edge ? graphreader.GetTimezone(first_edge->endnode(), tile) : 0;
+      if (timezone_index == 0) {
+        timezone_index = arrival_time_info_.timezone_index;
+      }
+      for (uint32_t i = 0; i < kDepartureIterations; ++i) {
+        const float secs = path.back().elapsed_cost.secs;
+        recost(arrival_time_info_.reverse(secs, timezone_index));
+        if (std::abs(path.back().elapsed_cost.secs - secs) < 1.0f) {
+          break;
+        }
+      }
     }
+  } catch (const std::exception& e) {
+    LOG_ERROR(std::string("Bi-directional astar failed to recost final path: ") + e.what());
+    return false;
   }
-  // give back the paths
-  return paths;
+  return true;
 }
 
 void BidirectionalAStar::ModifyHierarchyLimits() {
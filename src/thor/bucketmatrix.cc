@@ -0,0 +1,178 @@
+#include "thor/bucketmatrix.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace valhalla {
+namespace thor {
+
+BucketMatrix::BucketMatrix(const boost::property_tree::ptree& config) : ContractionQuery(config) {
+}
+
+void BucketMatrix::Clear() {
+  for (const auto& entry : buckets_) {
+    first_entry_[entry.first] = kInvalidContractionIndex;
+  }
+  buckets_.clear();
+  ContractionQuery::Clear();
+}
+
+void BucketMatrix::Accumulate(const std::vector<seed_t>& seeds, bool forward) {
+  const auto& hierarchy = metric_->hierarchy();
+  const auto& weights = forward ? forward_weights_ : reverse_weights_;
+  const auto& arcs = forward ? forward_arcs_ : reverse_arcs_;
+
+  // the search sorted its nodes by rank so the tail of the arc a node was reached over, which is
+  // lower, is always done before the node
+  for (auto rank : forward ? forward_nodes_ : reverse_nodes_) {
+    if (weights[rank] == kUnreachableWeight) {
+      continue;
+    }
+    const auto arc = arcs[rank];
+    if (arc & kSeedArc) {
+      secs_[rank] = seeds[arc & ~kSeedArc].secs;
+      lengths_[rank] = seeds[arc & ~kSeedArc].length;
+      continue;
+    }
+    const auto tail = hierarchy.tail(arc);
+    secs_[rank] = secs_[tail] + (forward ? metric_->up_secs(arc) : metric_->down_secs(arc));
+    lengths_[rank] = lengths_[tail] + (forward ? metric_->up_length(arc) : metric_->down_length(arc));
+  }
+}
+
+void BucketMatrix::SetTrivialPairs(
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& source_location_list,
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& target_location_list,
+    GraphReader& graphreader,
+    std::vector<float>& weights,
+    std::vector<TimeDistance>& time_distances) const {
+  // the candidate edges of the targets
+  std::unordered_map<uint64_t, std::vector<std::pair<uint32_t, const valhalla::Location::PathEdge*>>>
+      target_edges;
+  for (int t = 0; t < target_location_list.size(); ++t) {
+    for (const auto& edge : target_location_list.Get(t).path_edges()) {
+      target_edges[edge.graph_id()].emplace_back(t, &edge);
+    }
+  }
+
+  graph_tile_ptr tile;
+  for (int s = 0; s < source_location_list.size(); ++s) {
+    for (const auto& edge : source_location_list.Get(s).path_edges()) {
+      auto found = target_edges.find(edge.graph_id());
+      if (found == target_edges.end()) {
+        continue;
+      }
+      const DirectedEdge* directededge = graphreader.directededge(GraphId(edge.graph_id()), tile);
+      if (directededge == nullptr) {
+        continue;
+      }
+      uint8_t flow_sources;
+      const auto cost = costing_->EdgeCost(directededge, tile, kInvalidSecondsOfWeek, flow_sources);
+      for (const auto& target : found->second) {
+        const auto fraction = target.second->percent_along() - edge.percent_along();
+        if (fraction < 0.f) {
+          continue;
+        }
+        // penalized for the distance from the inputs the same way as the seeds
+        const auto idx = s * target_location_list.size() + target.first;
+        const auto weight = cost.cost * fraction + edge.distance() + target.second->distance();
+        if (weight < weights[idx]) {
+          weights[idx] = weight;
+          time_distances[idx] = TimeDistance(std::round(cost.secs * fraction),
+                                             std::round(directededge->length() * fraction));
+        }
+      }
+    }
+  }
+}
+
+std::vector<TimeDistance> BucketMatrix::SourceToTarget(
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& source_location_list,
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& target_location_list,
+    GraphReader& graphreader,
+    const sif::mode_costing_t& mode_costing,
+    const sif::TravelMode mode,
+    const Options& options) {
+  // Everything is unreachable until a meeting node says otherwise
+  const auto target_count = target_location_list.size();
+  std::vector<TimeDistance> time_distances(source_location_list.size() * target_count,
+                                           TimeDistance(kMaxCost, kMaxCost));
+  auto metric = metrics_.find(static_cast<int>(options.costing()));
+  if (metric == metrics_.end()) {
+    return time_distances;
+  }
+  metric_ = metric->second->get();
+  costing_ = mode_costing[static_cast<uint32_t>(mode)];
+
+  const auto& hierarchy = metric_->hierarchy();
+  if (first_entry_.size() != hierarchy.node_count()) {
+    secs_.assign(hierarchy.node_count(), 0.f);
+    lengths_.assign(hierarchy.node_count(), 0.f);
+    first_entry_.assign(hierarchy.node_count(), kInvalidContractionIndex);
+  }
+
+  std::vector<float> weights(time_distances.size(), kUnreachableWeight);
+  SetTrivialPairs(source_location_list, target_location_list, graphreader, weights, time_distances);
+
+  // Fill the buckets with the search from each target, going up from the target is going down
+  // the arcs in the graph
+  std::vector<seed_t> seeds;
+  for (int t = 0; t < target_count; ++t) {
+    seeds.clear();
+    if (!Seed(target_location_list.Get(t), graphreader, false, seeds)) {
+      continue;
+    }
+    Search(seeds, false);
+    Accumulate(seeds, false);
+    for (auto rank : reverse_nodes_) {
+      if (reverse_weights_[rank] != kUnreachableWeight) {
+        buckets_.push_back({rank, {static_cast<uint32_t>(t), reverse_weights_[rank], secs_[rank],
+                                   lengths_[rank]}});
+      }
+    }
+    Reset(false);
+  }
+  std::sort(buckets_.begin(), buckets_.end(),
+            [](const std::pair<uint32_t, bucket_entry_t>& a,
+               const std::pair<uint32_t, bucket_entry_t>& b) { return a.first < b.first; });
+  for (uint32_t i = buckets_.size(); i > 0; --i) {
+    first_entry_[buckets_[i - 1].first] = i - 1;
+  }
+
+  // The search from each source scans the buckets of the nodes it reaches, every entry is a way
+  // to a target over that node
+  for (int s = 0; s < source_location_list.size(); ++s) {
+    seeds.clear();
+    if (!Seed(source_location_list.Get(s), graphreader, true, seeds)) {
+      continue;
+    }
+    Search(seeds, true);
+    Accumulate(seeds, true);
+    const auto row = s * target_count;
+    for (auto rank : forward_nodes_) {
+      const auto weight = forward_weights_[rank];
+      if (weight == kUnreachableWeight) {
+        continue;
+      }
+      for (auto i = first_entry_[rank]; i < buckets_.size() && buckets_[i].first == rank; ++i) {
+        const auto& entry = buckets_[i].second;
+        const auto idx = row + entry.target;
+        if (weight + entry.weight < weights[idx]) {
+          weights[idx] = weight + entry.weight;
+          time_distances[idx] = TimeDistance(std::round(secs_[rank] + entry.secs),
+                                             std::round(lengths_[rank] + entry.length));
+        }
+      }
+    }
+    Reset(true);
+  }
+
+  return time_distances;
+}
+
+} // namespace thor
+} // namespace valhalla
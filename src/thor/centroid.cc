@@ -162,10 +162,13 @@ thor::ExpansionRecommendation Centroid::ShouldExpand(baldr::GraphReader& reader,
 }
 
 // tell the expansion how many labels to expect and how many buckets to use
-void Centroid::GetExpansionHints(uint32_t& bucket_count, uint32_t& edge_label_reservation) const {
+void Centroid::GetExpansionHints(uint32_t& bucket_count,
+                                 uint32_t& edge_label_reservation,
+                                 QueueType& queue_type) const {
   // TODO: come up with a heuristic based on the expansion we expect to have to do (input locations)
   bucket_count = 20000;
   edge_label_reservation = 500000;
+  queue_type = QueueType::kDoubleBucket;
 }
 
 // deallocate and prepare for next request
@@ -0,0 +1,299 @@
+#include "thor/contraction_metric.h"
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "midgard/logging.h"
+#include "midgard/threads.h"
+#include "sif/costfactory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <utility>
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+using valhalla::midgard::run_threads;
+
+namespace {
+
+// Levels of the elimination tree with fewer nodes than this are customized on one thread
+constexpr uint32_t kMinParallelLevelNodes = 4096;
+
+// Number of nodes a thread takes at a time while customizing a level
+constexpr uint32_t kLevelNodesPerTask = 256;
+
+// lowers the weight of an arc direction if the new one is better, its time and length go along
+inline void relax(float& weight,
+                  uint32_t& via,
+                  float& secs,
+                  float& length,
+                  const float candidate,
+                  const uint32_t candidate_via,
+                  const float candidate_secs,
+                  const float candidate_length) {
+  if (candidate < weight) {
+    weight = candidate;
+    via = candidate_via;
+    secs = candidate_secs;
+    length = candidate_length;
+  }
+}
+
+using valhalla::thor::ContractionMetric;
+using valhalla::thor::ContractionMetricSlot;
+
+// Everyone in the process shares the hierarchies and the current metrics of their costings. If
+// configured, a thread customizes the metrics again every so often to pick up live traffic.
+class metric_registry_t {
+public:
+  struct entry_t {
+    std::shared_ptr<ContractionMetricSlot> slot;
+    std::shared_ptr<const ContractionHierarchy> hierarchy;
+    CostingOptions options;
+    boost::property_tree::ptree config;
+    uint32_t concurrency;
+  };
+
+  ~metric_registry_t() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    wake.notify_all();
+    if (refresher.joinable()) {
+      refresher.join();
+    }
+  }
+
+  static std::shared_ptr<const ContractionMetric> customize(const entry_t& entry) {
+    auto start = std::chrono::steady_clock::now();
+    auto metric = std::make_shared<ContractionMetric>(entry.hierarchy, entry.options);
+    metric->Customize(entry.config, entry.concurrency);
+    auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+    LOG_INFO("Customized contraction hierarchy for " + Costing_Enum_Name(entry.options.costing()) +
+             " in " + std::to_string(millis) + "ms");
+    return metric;
+  }
+
+  void refresh(std::chrono::seconds interval) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!wake.wait_for(lock, interval, [this]() { return stop; })) {
+      // customize outside of the lock so new metrics can still be gotten in the meantime
+      auto current = entries;
+      lock.unlock();
+      for (const auto& entry : current) {
+        try {
+          entry.second.slot->set(customize(entry.second));
+        } catch (const std::exception& e) {
+          LOG_ERROR("Keeping the previous contraction hierarchy metric for " +
+                    Costing_Enum_Name(entry.second.options.costing()) + ": " + e.what());
+        }
+      }
+      lock.lock();
+    }
+  }
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool stop = false;
+  std::map<std::string, std::shared_ptr<const ContractionHierarchy>> hierarchies;
+  std::map<std::pair<std::string, int>, entry_t> entries;
+  std::thread refresher;
+};
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+ContractionMetric::ContractionMetric(
+    const std::shared_ptr<const baldr::ContractionHierarchy>& hierarchy,
+    const CostingOptions& options)
+    : hierarchy_(hierarchy), options_(options), serialized_options_(options.SerializeAsString()) {
+}
+
+void ContractionMetric::WeighInputEdges(const boost::property_tree::ptree& config,
+                                        const std::vector<uint32_t>& by_tile,
+                                        size_t begin,
+                                        size_t end,
+                                        std::vector<Cost>& edge_costs,
+                                        std::vector<float>& edge_lengths) const {
+  GraphReader reader(config);
+  auto costing = CostFactory().Create(options_);
+  const auto& input_edges = hierarchy_->input_edges();
+  graph_tile_ptr tile, end_tile;
+  for (auto i = begin; i < end; ++i) {
+    const auto& input_edge = input_edges[by_tile[i]];
+    const DirectedEdge* edge = reader.directededge(input_edge.edgeid, tile);
+    // destination only edges are left out like on the first pass of bidirectional a*
+    if (edge == nullptr || edge->destonly() || !costing->Allowed(edge, tile, kDisallowShortcut)) {
+      continue;
+    }
+    const NodeInfo* node = reader.nodeinfo(edge->endnode(), end_tile);
+    if (node == nullptr || !costing->Allowed(node)) {
+      continue;
+    }
+    uint8_t flow_sources;
+    edge_costs[by_tile[i]] = costing->EdgeCost(edge, tile, kInvalidSecondsOfWeek, flow_sources);
+    edge_lengths[by_tile[i]] = edge->length();
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+}
+
+void ContractionMetric::CustomizeNode(const uint32_t w) {
+  const auto& hierarchy = *hierarchy_;
+  const auto last = hierarchy.last_arc(w);
+  // every lower neighbour x of w is the middle of the lower triangles (x, w, u) of the arcs from
+  // w to the upward neighbours u which x shares with w. the arcs of x are final at this point
+  // because x is a descendant of w in the elimination tree
+  for (auto d = hierarchy.first_down_arc(w); d < hierarchy.last_down_arc(w); ++d) {
+    const auto xw = hierarchy.down_arc(d);
+    const auto x = hierarchy.tail(xw);
+    // the heads of the arcs of x and w are both sorted so we can walk them side by side
+    auto wu = hierarchy.first_arc(w);
+    for (auto xu = xw + 1; xu < hierarchy.last_arc(x) && wu < last; ++xu) {
+      const auto u = hierarchy.head(xu);
+      while (wu < last && hierarchy.head(wu) < u) {
+        ++wu;
+      }
+      // the hierarchy is chordal so the arc is always there
+      if (wu == last || hierarchy.head(wu) != u) {
+        continue;
+      }
+      // w -> x -> u goes down (x, w) and up (x, u), u -> x -> w the other way around
+      relax(up_weights_[wu], up_via_[wu], up_secs_[wu], up_lengths_[wu],
+            down_weights_[xw] + up_weights_[xu], x, down_secs_[xw] + up_secs_[xu],
+            down_lengths_[xw] + up_lengths_[xu]);
+      relax(down_weights_[wu], down_via_[wu], down_secs_[wu], down_lengths_[wu],
+            down_weights_[xu] + up_weights_[xw], x, down_secs_[xu] + up_secs_[xw],
+            down_lengths_[xu] + up_lengths_[xw]);
+    }
+  }
+}
+
+void ContractionMetric::Customize(const boost::property_tree::ptree& config, uint32_t concurrency) {
+  concurrency = std::max(concurrency, 1u);
+  const auto& hierarchy = *hierarchy_;
+  const auto arcs = hierarchy.arc_count();
+  up_weights_.assign(arcs, kUnreachableWeight);
+  down_weights_.assign(arcs, kUnreachableWeight);
+  up_via_.assign(arcs, kInvalidContractionIndex);
+  down_via_.assign(arcs, kInvalidContractionIndex);
+  up_secs_.assign(arcs, 0.f);
+  down_secs_.assign(arcs, 0.f);
+  up_lengths_.assign(arcs, 0.f);
+  down_lengths_.assign(arcs, 0.f);
+
+  // weight the input edges a tile at a time so that each tile is only fetched once
+  const auto& input_edges = hierarchy.input_edges();
+  std::vector<uint32_t> by_tile(input_edges.size());
+  std::iota(by_tile.begin(), by_tile.end(), 0);
+  std::sort(by_tile.begin(), by_tile.end(), [&input_edges](uint32_t a, uint32_t b) {
+    const auto& ea = input_edges[a].edgeid;
+    const auto& eb = input_edges[b].edgeid;
+    return ea.Tile_Base() == eb.Tile_Base() ? ea.id() < eb.id() : ea.Tile_Base() < eb.Tile_Base();
+  });
+
+  // each thread gets a run of whole tiles
+  std::vector<size_t> bounds{0};
+  for (uint32_t i = 1; i < concurrency; ++i) {
+    auto bound = std::max(bounds.back(), by_tile.size() * i / concurrency);
+    while (bound > 0 && bound < by_tile.size() &&
+           input_edges[by_tile[bound]].edgeid.Tile_Base() ==
+               input_edges[by_tile[bound - 1]].edgeid.Tile_Base()) {
+      ++bound;
+    }
+    bounds.push_back(bound);
+  }
+  bounds.push_back(by_tile.size());
+  std::vector<Cost> edge_costs(input_edges.size(), Cost(kUnreachableWeight, 0.f));
+  std::vector<float> edge_lengths(input_edges.size(), 0.f);
+  run_threads(concurrency, [&](uint32_t i) {
+    WeighInputEdges(config, by_tile, bounds[i], bounds[i + 1], edge_costs, edge_lengths);
+  });
+
+  // parallel edges share an arc so the arcs are weighted on one thread
+  for (uint32_t i = 0; i < input_edges.size(); ++i) {
+    const auto arc = input_edges[i].arc;
+    if (input_edges[i].upward) {
+      relax(up_weights_[arc], up_via_[arc], up_secs_[arc], up_lengths_[arc], edge_costs[i].cost,
+            i | kInputEdge, edge_costs[i].secs, edge_lengths[i]);
+    } else {
+      relax(down_weights_[arc], down_via_[arc], down_secs_[arc], down_lengths_[arc],
+            edge_costs[i].cost, i | kInputEdge, edge_costs[i].secs, edge_lengths[i]);
+    }
+  }
+
+  // a node only writes its own upward arcs and reads those of its descendants, so the nodes of a
+  // level of the elimination tree can be customized in parallel once the levels below are done
+  for (uint32_t level = 0; level < hierarchy.level_count(); ++level) {
+    const auto first = hierarchy.first_level_node(level);
+    const auto last = hierarchy.last_level_node(level);
+    if (concurrency == 1 || last - first < kMinParallelLevelNodes) {
+      for (auto i = first; i < last; ++i) {
+        CustomizeNode(hierarchy.level_node(i));
+      }
+      continue;
+    }
+    std::atomic<uint32_t> next(first);
+    run_threads(concurrency, [&](uint32_t) {
+      for (auto begin = next.fetch_add(kLevelNodesPerTask); begin < last;
+           begin = next.fetch_add(kLevelNodesPerTask)) {
+        for (auto i = begin; i < std::min(begin + kLevelNodesPerTask, last); ++i) {
+          CustomizeNode(hierarchy.level_node(i));
+        }
+      }
+    });
+  }
+}
+
+std::shared_ptr<const ContractionMetricSlot>
+ContractionMetric::Get(const boost::property_tree::ptree& config, Costing costing) {
+  static metric_registry_t registry;
+  std::lock_guard<std::mutex> lock(registry.mutex);
+
+  const auto file = config.get<std::string>("mjolnir.contraction_hierarchy", "");
+  auto entry = registry.entries.find({file, static_cast<int>(costing)});
+  if (entry != registry.entries.end()) {
+    return entry->second.slot;
+  }
+  auto& hierarchy = registry.hierarchies[file];
+  if (!hierarchy) {
+    hierarchy = ContractionHierarchy::Load(file);
+  }
+
+  // the metric is only used for requests which dont change the default costing options
+  rapidjson::Document doc;
+  doc.SetObject();
+  metric_registry_t::entry_t customizable{std::make_shared<ContractionMetricSlot>(), hierarchy,
+                                          CostingOptions{}, config.get_child("mjolnir"),
+                                          config.get<uint32_t>("thor.contraction_customize_threads",
+                                                               std::thread::hardware_concurrency())};
+  ParseCostingOptions(doc, "/costing_options/" + Costing_Enum_Name(costing),
+                      &customizable.options, costing);
+  customizable.slot->set(metric_registry_t::customize(customizable));
+
+  // the first one to ask starts refreshing the metrics, if they want it
+  auto interval = config.get<uint32_t>("thor.contraction_customize_interval", 0);
+  if (interval > 0 && !registry.refresher.joinable()) {
+    registry.refresher = std::thread(&metric_registry_t::refresh, &registry,
+                                     std::chrono::seconds(interval));
+  }
+
+  return registry.entries.emplace(std::make_pair(file, static_cast<int>(costing)), customizable)
+      .first->second.slot;
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -0,0 +1,310 @@
+#include "thor/contraction_query.h"
+#include "midgard/logging.h"
+#include "proto_conversions.h"
+#include "sif/recost.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <tuple>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+// Bits of visited_ for each side of the search
+constexpr uint8_t kForward = 1;
+constexpr uint8_t kReverse = 2;
+
+// Number of ranks to scan between checks for an interrupt
+constexpr uint32_t kInterruptNodesInterval = 1000;
+
+inline float find_percent_along(const valhalla::Location& location, const GraphId& edge_id) {
+  for (const auto& e : location.path_edges()) {
+    if (e.graph_id() == edge_id)
+      return e.percent_along();
+  }
+  throw std::logic_error("Could not find candidate edge for the location");
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+ContractionQuery::ContractionQuery(const boost::property_tree::ptree& config) : PathAlgorithm() {
+  auto costings = config.get_child_optional("contraction_costings");
+  if (costings) {
+    for (const auto& costing : *costings) {
+      costings_.push_back(costing.second.get_value<std::string>());
+    }
+  }
+}
+
+void ContractionQuery::Customize(const boost::property_tree::ptree& config) {
+  metrics_.clear();
+  if (config.get<std::string>("mjolnir.contraction_hierarchy", "").empty()) {
+    return;
+  }
+  for (const auto& name : costings_) {
+    Costing costing;
+    if (!Costing_Enum_Parse(name, &costing)) {
+      LOG_WARN("Ignoring unknown contraction hierarchy costing " + name);
+      continue;
+    }
+    // a hierarchy that isnt there shouldnt take the service down, it just wont be used
+    try {
+      metrics_[static_cast<int>(costing)] = ContractionMetric::Get(config, costing);
+    } catch (const std::exception& e) {
+      LOG_ERROR("Contraction hierarchy queries are disabled: " + std::string(e.what()));
+      metrics_.clear();
+      return;
+    }
+  }
+
+  // all metrics share the hierarchy
+  if (!metrics_.empty()) {
+    const auto nodes = metrics_.begin()->second->get()->hierarchy().node_count();
+    forward_weights_.assign(nodes, kUnreachableWeight);
+    reverse_weights_.assign(nodes, kUnreachableWeight);
+    forward_arcs_.assign(nodes, kInvalidContractionIndex);
+    reverse_arcs_.assign(nodes, kInvalidContractionIndex);
+    visited_.assign(nodes, 0);
+  }
+}
+
+bool ContractionQuery::Supports(const Options& options) const {
+  auto metric = metrics_.find(static_cast<int>(options.costing()));
+  return metric != metrics_.end() &&
+         metric->second->get()->Matches(
+             options.costing_options(static_cast<int>(options.costing())));
+}
+
+void ContractionQuery::Clear() {
+  Reset(true);
+  Reset(false);
+  metric_.reset();
+  costing_.reset();
+}
+
+void ContractionQuery::Reset(bool forward) {
+  auto& weights = forward ? forward_weights_ : reverse_weights_;
+  auto& arcs = forward ? forward_arcs_ : reverse_arcs_;
+  auto& nodes = forward ? forward_nodes_ : reverse_nodes_;
+  const uint8_t side = forward ? kForward : kReverse;
+
+  // only reset what the last search touched
+  for (auto rank : nodes) {
+    weights[rank] = kUnreachableWeight;
+    arcs[rank] = kInvalidContractionIndex;
+    visited_[rank] &= ~side;
+  }
+  nodes.clear();
+}
+
+bool ContractionQuery::Seed(const valhalla::Location& location,
+                            GraphReader& graphreader,
+                            bool forward,
+                            std::vector<seed_t>& seeds) {
+  // Only skip edges which are at the node if we have other options, like bidirectional a*
+  bool has_other_edges = std::any_of(location.path_edges().begin(), location.path_edges().end(),
+                                     [forward](const valhalla::Location::PathEdge& e) {
+                                       return forward ? !e.end_node() : !e.begin_node();
+                                     });
+
+  const auto& hierarchy = metric_->hierarchy();
+  for (const auto& edge : location.path_edges()) {
+    if (has_other_edges && (forward ? edge.end_node() : edge.begin_node())) {
+      continue;
+    }
+
+    GraphId edgeid(edge.graph_id());
+    if (forward ? costing_->AvoidAsOriginEdge(edgeid, edge.percent_along())
+                : costing_->AvoidAsDestinationEdge(edgeid, edge.percent_along())) {
+      continue;
+    }
+
+    graph_tile_ptr tile;
+    const DirectedEdge* directededge = graphreader.directededge(edgeid, tile);
+    if (directededge == nullptr) {
+      continue;
+    }
+
+    // the origin continues from the end of its edge and the destination is reached from the start
+    GraphId node = forward ? directededge->endnode() : graphreader.edge_startnode(edgeid);
+    const auto rank = node.Is_Valid() ? hierarchy.rank(node) : kInvalidContractionIndex;
+    if (rank == kInvalidContractionIndex) {
+      continue;
+    }
+
+    // the same penalty for the distance from the input as bidirectional a*
+    uint8_t flow_sources;
+    Cost cost = costing_->EdgeCost(directededge, tile, kInvalidSecondsOfWeek, flow_sources) *
+                (forward ? 1.0f - edge.percent_along() : edge.percent_along());
+    cost.cost += edge.distance();
+    const float length = directededge->length() *
+                         (forward ? 1.0f - edge.percent_along() : edge.percent_along());
+    seeds.push_back({rank, edgeid, edge.percent_along(), cost.cost, cost.secs, length});
+  }
+  return !seeds.empty();
+}
+
+void ContractionQuery::Search(const std::vector<seed_t>& seeds, bool forward) {
+  const auto& hierarchy = metric_->hierarchy();
+  auto& weights = forward ? forward_weights_ : reverse_weights_;
+  auto& arcs = forward ? forward_arcs_ : reverse_arcs_;
+  auto& nodes = forward ? forward_nodes_ : reverse_nodes_;
+  const uint8_t side = forward ? kForward : kReverse;
+
+  // the search space is every ancestor of the seeds in the elimination tree
+  for (uint32_t i = 0; i < seeds.size(); ++i) {
+    const auto& seed = seeds[i];
+    if (seed.weight < weights[seed.rank]) {
+      weights[seed.rank] = seed.weight;
+      arcs[seed.rank] = kSeedArc | i;
+    }
+    for (auto rank = seed.rank; rank != kInvalidContractionIndex && !(visited_[rank] & side);
+         rank = hierarchy.parent(rank)) {
+      visited_[rank] |= side;
+      nodes.push_back(rank);
+    }
+  }
+
+  // the upward arcs of a node only lead to its ancestors so scanning in rank order settles
+  // every node before it is scanned
+  std::sort(nodes.begin(), nodes.end());
+  uint32_t n = 0;
+  for (auto rank : nodes) {
+    if (interrupt && (++n % kInterruptNodesInterval) == 0) {
+      (*interrupt)();
+    }
+    const auto weight = weights[rank];
+    if (weight == kUnreachableWeight) {
+      continue;
+    }
+    for (auto arc = hierarchy.first_arc(rank); arc < hierarchy.last_arc(rank); ++arc) {
+      const auto head = hierarchy.head(arc);
+      // going up from the destination is going down the arc in the graph
+      const auto candidate = weight + (forward ? metric_->up_weight(arc) : metric_->down_weight(arc));
+      if (candidate < weights[head]) {
+        weights[head] = candidate;
+        arcs[head] = arc;
+      }
+    }
+  }
+}
+
+void ContractionQuery::Unpack(uint32_t arc, bool upward, std::vector<GraphId>& edges) const {
+  const auto& hierarchy = metric_->hierarchy();
+  std::vector<std::pair<uint32_t, bool>> stack{{arc, upward}};
+  while (!stack.empty()) {
+    std::tie(arc, upward) = stack.back();
+    stack.pop_back();
+    const auto via = upward ? metric_->up_via(arc) : metric_->down_via(arc);
+    if (via == kInvalidContractionIndex) {
+      throw std::logic_error("Contraction hierarchy path uses an arc without weight");
+    }
+    if (via & ContractionMetric::kInputEdge) {
+      edges.push_back(hierarchy.input_edges()[via & ~ContractionMetric::kInputEdge].edgeid);
+      continue;
+    }
+    // a shortcut over the middle node, up is down to the middle then up to the head and down is
+    // the other way around. the stack is last in first out so the second half goes on first
+    const auto lower_arc = hierarchy.find_arc(via, hierarchy.tail(arc));
+    const auto higher_arc = hierarchy.find_arc(via, hierarchy.head(arc));
+    if (upward) {
+      stack.emplace_back(higher_arc, true);
+      stack.emplace_back(lower_arc, false);
+    } else {
+      stack.emplace_back(lower_arc, true);
+      stack.emplace_back(higher_arc, false);
+    }
+  }
+}
+
+std::vector<std::vector<PathInfo>>
+ContractionQuery::GetBestPath(valhalla::Location& origin,
+                              valhalla::Location& dest,
+                              GraphReader& graphreader,
+                              const sif::mode_costing_t& mode_costing,
+                              const sif::TravelMode mode,
+                              const Options& options) {
+  // only requests the metric was customized for
+  auto metric = metrics_.find(static_cast<int>(options.costing()));
+  if (metric == metrics_.end()) {
+    return {};
+  }
+  metric_ = metric->second->get();
+  costing_ = mode_costing[static_cast<uint32_t>(mode)];
+
+  std::vector<seed_t> origins, destinations;
+  if (!Seed(origin, graphreader, true, origins) || !Seed(dest, graphreader, false, destinations)) {
+    return {};
+  }
+  Search(origins, true);
+  Search(destinations, false);
+
+  // the shortest path goes through the best node both searches have reached
+  uint32_t meet = kInvalidContractionIndex;
+  float best = kUnreachableWeight;
+  for (auto rank : forward_nodes_) {
+    if ((visited_[rank] & kReverse) && forward_weights_[rank] + reverse_weights_[rank] < best) {
+      best = forward_weights_[rank] + reverse_weights_[rank];
+      meet = rank;
+    }
+  }
+  if (meet == kInvalidContractionIndex) {
+    return {};
+  }
+
+  // walk the arcs down to the origin, unpack them upward and then down to the destination
+  const auto& hierarchy = metric_->hierarchy();
+  std::vector<uint32_t> up_arcs;
+  auto rank = meet;
+  for (; !(forward_arcs_[rank] & kSeedArc); rank = hierarchy.tail(forward_arcs_[rank])) {
+    up_arcs.push_back(forward_arcs_[rank]);
+  }
+  std::vector<GraphId> path_edges{origins[forward_arcs_[rank] & ~kSeedArc].edgeid};
+  for (auto arc = up_arcs.rbegin(); arc != up_arcs.rend(); ++arc) {
+    Unpack(*arc, true, path_edges);
+  }
+  for (rank = meet; !(reverse_arcs_[rank] & kSeedArc); rank = hierarchy.tail(reverse_arcs_[rank])) {
+    Unpack(reverse_arcs_[rank], false, path_edges);
+  }
+  path_edges.push_back(destinations[reverse_arcs_[rank] & ~kSeedArc].edgeid);
+
+  // the metric knows nothing about complex restrictions so leave those paths to the caller
+  graph_tile_ptr tile;
+  for (const auto& edgeid : path_edges) {
+    const DirectedEdge* edge = graphreader.directededge(edgeid, tile);
+    if (edge == nullptr || (edge->start_restriction() & costing_->access_mode()) ||
+        (edge->end_restriction() & costing_->access_mode())) {
+      return {};
+    }
+  }
+
+  // recost the path with turns, if a turn isnt allowed the path isnt either
+  std::vector<PathInfo> path;
+  auto edge_itr = path_edges.begin();
+  const auto edge_cb = [&edge_itr, &path_edges]() {
+    return (edge_itr == path_edges.end()) ? GraphId{} : (*(edge_itr++));
+  };
+  const auto label_cb = [&path](const EdgeLabel& label) {
+    path.emplace_back(label.mode(), label.cost(), label.edgeid(), 0, label.path_distance(),
+                      label.restriction_idx(), label.transition_cost());
+  };
+  try {
+    sif::recost_forward(graphreader, *costing_, edge_cb, label_cb,
+                        find_percent_along(origin, path_edges.front()),
+                        find_percent_along(dest, path_edges.back()), TimeInfo::invalid(), false,
+                        false);
+  } catch (const std::exception& e) {
+    LOG_DEBUG("Contraction hierarchy path was rejected: " + std::string(e.what()));
+    return {};
+  }
+
+  return {std::move(path)};
+}
+
+} // namespace thor
+} // namespace valhalla
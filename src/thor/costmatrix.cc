@@ -1,8 +1,13 @@
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
 #include <vector>
 
 #include "midgard/logging.h"
+#include "midgard/threads.h"
 #include "thor/costmatrix.h"
 #include "worker.h"
 
@@ -10,11 +15,17 @@
 
 using namespace valhalla::baldr;
 using namespace valhalla::sif;
+using valhalla::midgard::run_threads;
 
 namespace {
 
 constexpr uint32_t kMaxMatrixIterations = 2000000;
 
+// Number of times each search expands in a parallel iteration, the threads meet between them so
+// they should be long enough to be worth it and short enough for the connections found to stop
+// the searches in time
+constexpr uint32_t kParallelIterations = 64;
+
 // Find a threshold to continue the search - should be based on
 // the max edge cost in the adjacency set?
 int GetThreshold(const TravelMode mode, const int n) {
@@ -26,6 +37,34 @@ bool equals(const valhalla::LatLng& a, const valhalla::LatLng& b) {
          (!a.has_lat() || a.lat() == b.lat()) && (!a.has_lng() || a.lng() == b.lng());
 }
 
+// Makes the threads of a parallel search wait for each other. The last one to get there runs the
+// step which has to see the work of all of them before they go on.
+class barrier_t {
+public:
+  explicit barrier_t(const uint32_t count) : count_(count), arrived_(0), generation_(0) {
+  }
+
+  template <typename step_t> void arrive_and_wait(const step_t& step) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const auto generation = generation_;
+    if (++arrived_ == count_) {
+      step();
+      arrived_ = 0;
+      ++generation_;
+      released_.notify_all();
+      return;
+    }
+    released_.wait(lock, [this, generation]() { return generation != generation_; });
+  }
+
+private:
+  const uint32_t count_;
+  uint32_t arrived_;
+  uint64_t generation_;
+  std::mutex mutex_;
+  std::condition_variable released_;
+};
+
 } // namespace
 
 namespace valhalla {
@@ -92,7 +131,8 @@ std::vector<TimeDistance> CostMatrix::SourceToTarget(
     GraphReader& graphreader,
     const sif::mode_costing_t& mode_costing,
     const TravelMode mode,
-    const float max_matrix_distance) {
+    const float max_matrix_distance,
+    const MatrixRowCallback& row_callback) {
   // Set the mode and costing
   mode_ = mode;
   costing_ = mode_costing[static_cast<uint32_t>(mode_)];
@@ -100,6 +140,19 @@ std::vector<TimeDistance> CostMatrix::SourceToTarget(
 
   current_cost_threshold_ = GetCostThreshold(max_matrix_distance);
 
+  // Start loading the tiles around the locations while we get going
+  if (graphreader.PrefetchEnabled()) {
+    std::vector<midgard::PointLL> lls;
+    lls.reserve(source_location_list.size() + target_location_list.size());
+    for (const auto& location : source_location_list) {
+      lls.emplace_back(location.ll().lng(), location.ll().lat());
+    }
+    for (const auto& location : target_location_list) {
+      lls.emplace_back(location.ll().lng(), location.ll().lat());
+    }
+    graphreader.PrefetchCorridor(lls);
+  }
+
   // Set the source and target locations
   Clear();
   SetSources(graphreader, source_location_list);
@@ -109,12 +162,20 @@ std::vector<TimeDistance> CostMatrix::SourceToTarget(
   // same get set to 0 time, distance and are not added to the remaining
   // location set.
   Initialize(source_location_list, target_location_list);
+  row_callback_ = row_callback;
+  row_sent_.assign(source_count_, false);
 
   // Perform backward search from all target locations. Perform forward
   // search from all source locations. Connections between the 2 search
   // spaces is checked during the forward search.
-  int n = 0;
+  uint32_t n = 0;
   while (true) {
+    // With more than one thread the searches run on all of them until they are done
+    if (!readers_.empty()) {
+      ParallelSearch(graphreader);
+      break;
+    }
+
     // Iterate all target locations in a backwards search
     for (uint32_t i = 0; i < target_count_; i++) {
       if (target_status_[i].threshold > 0) {
@@ -139,6 +200,7 @@ std::vector<TimeDistance> CostMatrix::SourceToTarget(
           if (remaining_sources_ > 0) {
             remaining_sources_--;
           }
+          SendRow(i);
         }
       }
     }
@@ -157,6 +219,15 @@ std::vector<TimeDistance> CostMatrix::SourceToTarget(
     n++;
   }
 
+  // The rows which did not go yet are those of the sources still searching when the targets ran out
+  if (row_callback_) {
+    for (uint32_t i = 0; i < source_count_; i++) {
+      SendRow(i);
+    }
+    row_callback_ = nullptr;
+    return {};
+  }
+
   // Form the time, distance matrix from the destinations list
   uint32_t idx = 0;
   std::vector<TimeDistance> td;
@@ -167,6 +238,141 @@ std::vector<TimeDistance> CostMatrix::SourceToTarget(
   return td;
 }
 
+void CostMatrix::ParallelSearch(GraphReader& graphreader) {
+  // the first thread reads the tiles with the reader of the calling thread
+  std::vector<GraphReader*> readers{&graphreader};
+  for (const auto& reader : readers_) {
+    readers.push_back(reader.get());
+  }
+  std::vector<pending_t> pending(readers.size());
+
+  // A failure stops the search at the next barrier, the threads waiting there would never be
+  // released if the failing one left
+  std::vector<std::exception_ptr> failures(readers.size());
+  const auto guard = [&failures](const uint32_t thread, const auto& function) {
+    try {
+      function();
+    } catch (...) {
+      if (!failures[thread]) {
+        failures[thread] = std::current_exception();
+      }
+    }
+  };
+  const auto failed = [&failures]() {
+    return std::any_of(failures.begin(), failures.end(),
+                       [](const std::exception_ptr& f) { return static_cast<bool>(f); });
+  };
+
+  // The threads are started once and meet at the barrier after each half of an iteration, where
+  // the last one to get there applies what they all left
+  barrier_t barrier(readers.size());
+  std::atomic<uint32_t> next(0);
+  uint32_t n = 0;
+  bool done = false;
+  run_threads(readers.size(), [&](uint32_t thread) {
+    while (true) {
+      // The backward searches go first. What they reach is only handed to the forward searches
+      // once they are all done so the forward searches can look it up without locks
+      guard(thread, [&]() {
+        for (auto target = next++; target < target_count_; target = next++) {
+          auto& status = target_status_[target];
+          for (uint32_t i = 0; i < kParallelIterations && status.threshold > 0; ++i) {
+            status.threshold--;
+            BackwardSearch(target, *readers[thread], &pending[thread]);
+            if (status.threshold == 0) {
+              status.threshold = -1;
+              pending[thread].finished++;
+            }
+          }
+        }
+      });
+      barrier.arrive_and_wait([&]() {
+        guard(thread, [&]() { ApplyPending(pending, remaining_targets_); });
+        next = 0;
+        done = failed();
+      });
+      if (done) {
+        return;
+      }
+
+      // The forward searches only write the connections of their own source
+      guard(thread, [&]() {
+        for (auto source = next++; source < source_count_; source = next++) {
+          auto& status = source_status_[source];
+          for (uint32_t i = 0; i < kParallelIterations && status.threshold > 0; ++i) {
+            status.threshold--;
+            ForwardSearch(source, n + i, *readers[thread], &pending[thread]);
+            if (status.threshold == 0) {
+              status.threshold = -1;
+              pending[thread].finished++;
+            }
+          }
+        }
+      });
+      barrier.arrive_and_wait([&]() {
+        guard(thread, [&]() {
+          ApplyPending(pending, remaining_sources_);
+
+          // the rows of the sources which are done go while the other threads wait
+          if (row_callback_) {
+            for (uint32_t i = 0; i < source_count_; i++) {
+              if (source_status_[i].threshold < 0) {
+                SendRow(i);
+              }
+            }
+          }
+
+          n += kParallelIterations;
+          if ((remaining_sources_ > 0 || remaining_targets_ > 0) && n >= kMaxMatrixIterations) {
+            throw valhalla_exception_t{430};
+          }
+        });
+        next = 0;
+        done = failed() || (remaining_sources_ == 0 && remaining_targets_ == 0);
+      });
+      if (done) {
+        return;
+      }
+    }
+  });
+
+  for (const auto& failure : failures) {
+    if (failure) {
+      std::rethrow_exception(failure);
+    }
+  }
+}
+
+void CostMatrix::ApplyPending(std::vector<pending_t>& pending, uint32_t& remaining) {
+  for (auto& thread : pending) {
+    for (const auto& reached : thread.reached) {
+      (*targets_)[reached.first].push_back(reached.second);
+    }
+    for (const auto& connection : thread.connections) {
+      UpdateStatus(connection.first, connection.second);
+    }
+    remaining -= std::min(remaining, thread.finished);
+    thread.reached.clear();
+    thread.connections.clear();
+    thread.finished = 0;
+  }
+}
+
+void CostMatrix::SendRow(const uint32_t source) {
+  if (!row_callback_ || row_sent_[source]) {
+    return;
+  }
+  row_sent_[source] = true;
+
+  std::vector<TimeDistance> row;
+  row.reserve(target_count_);
+  for (uint32_t i = source * target_count_; i < (source + 1) * target_count_; i++) {
+    const auto& connection = best_connection_[i];
+    row.emplace_back(std::round(connection.cost.secs), std::round(connection.distance));
+  }
+  row_callback_(source, row);
+}
+
 // Initialize all time distance to "not found". Any locations that
 // are the same get set to 0 time, distance and do not add to the
 // remaining locations set.
@@ -217,7 +423,10 @@ void CostMatrix::Initialize(
 }
 
 // Iterate the forward search from the source/origin location.
-void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphReader& graphreader) {
+void CostMatrix::ForwardSearch(const uint32_t index,
+                               const uint32_t n,
+                               GraphReader& graphreader,
+                               pending_t* pending) {
   // Get the next edge from the adjacency list for this source location
   auto& adj = source_adjacency_[index];
   auto& edgelabels = source_edgelabel_[index];
@@ -226,7 +435,7 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
     // Forward search is exhausted - mark this and update so we don't
     // extend searches more than we need to
     for (uint32_t target = 0; target < target_count_; target++) {
-      UpdateStatus(index, target);
+      UpdateStatus(index, target, pending);
     }
     source_status_[index].threshold = 0;
     return;
@@ -244,7 +453,7 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
   edgestate.Update(pred.edgeid(), EdgeSet::kPermanent);
 
   // Check for connections to backwards search.
-  CheckForwardConnections(index, pred, n);
+  CheckForwardConnections(index, pred, n, pending);
 
   // Prune path if predecessor is not a through edge
   if (pred.not_thru() && pred.not_thru_pruning()) {
@@ -375,7 +584,8 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
 // on the reverse search trees.
 void CostMatrix::CheckForwardConnections(const uint32_t source,
                                          const BDEdgeLabel& pred,
-                                         const uint32_t n) {
+                                         const uint32_t n,
+                                         pending_t* pending) {
 
   // Disallow connections that are part of an uturn on an internal edge
   if (pred.internal_turn() != InternalTurn::kNoTurn) {
@@ -412,8 +622,9 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
     const auto& edgestate = target_edgestatus_[target];
 
     // If this edge has been reached then a shortest path has been found
-    // to the end node of this directed edge.
-    EdgeStatusInfo oppedgestatus = edgestate.Get(oppedge);
+    // to the end node of this directed edge. Other threads may be looking
+    // at the same target so leave its lookup cache alone
+    EdgeStatusInfo oppedgestatus = edgestate.Peek(oppedge);
     if (oppedgestatus.set() != EdgeSet::kUnreachedOrReset) {
       const auto& edgelabels = target_edgelabel_[target];
       uint32_t predidx = edgelabels[oppedgestatus.index()].predecessor();
@@ -434,7 +645,7 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
 
         // Update status and update threshold if this is the last location
         // to find for this source or target
-        UpdateStatus(source, target);
+        UpdateStatus(source, target, pending);
       } else {
         float oppcost = (predidx == kInvalidLabel) ? 0 : edgelabels[predidx].cost().cost;
         float c = pred.cost().cost + oppcost + opp_el.transition_cost().cost;
@@ -456,7 +667,7 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
 
           // Update status and update threshold if this is the last location
           // to find for this source or target
-          UpdateStatus(source, target);
+          UpdateStatus(source, target, pending);
         }
       }
     }
@@ -464,7 +675,13 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
 }
 
 // Update status when a connection is found.
-void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target) {
+void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target, pending_t* pending) {
+  // the statuses are shared by the threads so they are updated once they are done
+  if (pending != nullptr) {
+    pending->connections.emplace_back(source, target);
+    return;
+  }
+
   // Remove the target from the source status
   auto& s = source_status_[source].remaining_locations;
   auto it = s.find(target);
@@ -493,7 +710,7 @@ void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target) {
 }
 
 // Expand the backwards search trees.
-void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader) {
+void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader, pending_t* pending) {
   // Get the next edge from the adjacency list for this target location
   auto& adj = target_adjacency_[index];
   auto& edgelabels = target_edgelabel_[index];
@@ -502,7 +719,7 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
     // Backward search is exhausted - mark this and update so we don't
     // extend searches more than we need to
     for (uint32_t source = 0; source < source_count_; source++) {
-      UpdateStatus(source, index);
+      UpdateStatus(source, index, pending);
     }
     target_status_[index].threshold = 0;
     return;
@@ -621,8 +838,13 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
                               restriction_idx);
       adj->add(idx);
 
-      // Add to the list of targets that have reached this edge
-      (*targets_)[edgeid].push_back(index);
+      // Add to the list of targets that have reached this edge, the forward searches may be
+      // looking it up on other threads so that waits until they are done
+      if (pending != nullptr) {
+        pending->reached.emplace_back(edgeid, index);
+      } else {
+        (*targets_)[edgeid].push_back(index);
+      }
     }
 
     // Handle transitions - expand from the end node of the transition
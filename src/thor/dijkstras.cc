@@ -46,24 +46,15 @@ Dijkstras::Dijkstras(const boost::property_tree::ptree& config)
     : mode_(TravelMode::kDrive), access_mode_(kAutoAccess),
       max_reserved_labels_count_(
           config.get<uint32_t>("max_reserved_labels_count", kInitialEdgeLabelCount)),
-      multipath_(false) {
+      label_arena_(std::make_shared<LabelArena>(config)), multipath_(false) {
 }
 
 // Clear the temporary information generated during path construction.
 void Dijkstras::Clear() {
   // Clear the edge labels, edge status flags, and adjacency list
   // TODO - clear only the edge label set that was used?
-  if (bdedgelabels_.size() > max_reserved_labels_count_) {
-    bdedgelabels_.resize(max_reserved_labels_count_);
-    bdedgelabels_.shrink_to_fit();
-  }
-  bdedgelabels_.clear();
-
-  if (mmedgelabels_.size() > max_reserved_labels_count_) {
-    mmedgelabels_.resize(max_reserved_labels_count_);
-    mmedgelabels_.shrink_to_fit();
-  }
-  mmedgelabels_.clear();
+  label_arena_->Release(bdedgelabels_);
+  label_arena_->Release(mmedgelabels_);
 
   adjacencylist_.clear();
   mmadjacencylist_.clear();
@@ -74,25 +65,26 @@ void Dijkstras::Clear() {
 // edgelabels
 template <typename label_container_t>
 void Dijkstras::Initialize(label_container_t& labels,
-                           baldr::DoubleBucketQueue<typename label_container_t::value_type>& queue,
+                           ExpansionQueue<typename label_container_t::value_type>& queue,
                            const uint32_t bucket_size) {
   // Set aside some space for edge labels
   uint32_t edge_label_reservation;
   uint32_t bucket_count;
-  GetExpansionHints(bucket_count, edge_label_reservation);
-  labels.reserve(std::min(max_reserved_labels_count_, edge_label_reservation));
+  QueueType queue_type = QueueType::kDoubleBucket;
+  GetExpansionHints(bucket_count, edge_label_reservation, queue_type);
+  label_arena_->Acquire(labels, std::min(max_reserved_labels_count_, edge_label_reservation));
 
   // Set up lambda to get sort costs
   float range = bucket_count * bucket_size;
-  queue.reuse(0.0f, range, bucket_size, &labels);
+  queue.reuse(queue_type, 0.0f, range, bucket_size, &labels);
 }
 template void
 Dijkstras::Initialize<decltype(Dijkstras::bdedgelabels_)>(decltype(Dijkstras::bdedgelabels_)&,
-                                                          baldr::DoubleBucketQueue<sif::BDEdgeLabel>&,
+                                                          ExpansionQueue<sif::BDEdgeLabel>&,
                                                           const uint32_t);
 template void
 Dijkstras::Initialize<decltype(Dijkstras::mmedgelabels_)>(decltype(Dijkstras::mmedgelabels_)&,
-                                                          baldr::DoubleBucketQueue<sif::MMEdgeLabel>&,
+                                                          ExpansionQueue<sif::MMEdgeLabel>&,
                                                           const uint32_t);
 
 // Initializes the time of the expansion if there is one
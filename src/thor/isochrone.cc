@@ -331,9 +331,13 @@ ExpansionRecommendation Isochrone::ShouldExpand(baldr::GraphReader& /*graphreade
   return ExpansionRecommendation::continue_expansion;
 };
 
-void Isochrone::GetExpansionHints(uint32_t& bucket_count, uint32_t& edge_label_reservation) const {
+void Isochrone::GetExpansionHints(uint32_t& bucket_count,
+                                  uint32_t& edge_label_reservation,
+                                  QueueType& queue_type) const {
   bucket_count = 20000;
   edge_label_reservation = kInitialEdgeLabelCount;
+  // large isochrones go far beyond the bucket range and keep emptying the overflow bucket
+  queue_type = QueueType::kRadix;
 }
 
 } // namespace thor
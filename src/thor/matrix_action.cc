@@ -1,6 +1,7 @@
 #include "sif/autocost.h"
 #include "sif/bicyclecost.h"
 #include "sif/pedestriancost.h"
+#include "thor/bucketmatrix.h"
 #include "thor/costmatrix.h"
 #include "thor/timedistancebssmatrix.h"
 #include "thor/timedistancematrix.h"
@@ -38,25 +39,45 @@ std::string thor_worker_t::matrix(Api& request) {
     distance_scale = kMilePerMeter;
   }
 
-  json::MapPtr json;
+  // The rows of a format which has them are serialized as the algorithms are done with each one
+  // rather than holding on to the whole matrix until the end. The output itself is still buffered
+  // since the response goes back in one piece
+  std::string rows;
+  MatrixRowCallback row_callback;
+  if (options.format() == Options::ndjson || options.format() == Options::binary) {
+    rows = tyr::serializeMatrixHeader(request);
+    row_callback = [&](const uint32_t source_index, const std::vector<TimeDistance>& row) {
+      tyr::serializeMatrixRow(request, source_index, row, distance_scale, rows);
+    };
+  }
+  auto serialize = [&](const std::vector<TimeDistance>& time_distances) {
+    if (!row_callback) {
+      return tyr::serializeMatrix(request, time_distances, distance_scale);
+    }
+    // whatever the algorithm did not hand over a row at a time
+    tyr::serializeMatrixRows(request, time_distances, distance_scale, rows);
+    return std::move(rows);
+  };
+
   // do the real work
   std::vector<TimeDistance> time_distances;
   auto costmatrix = [&]() {
     thor::CostMatrix matrix;
+    matrix.set_readers(costmatrix_readers);
     return matrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing, mode,
-                                 max_matrix_distance.find(costing)->second);
+                                 max_matrix_distance.find(costing)->second, row_callback);
   };
   auto timedistancematrix = [&]() {
     thor::TimeDistanceMatrix matrix;
     return matrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing, mode,
-                                 max_matrix_distance.find(costing)->second);
+                                 max_matrix_distance.find(costing)->second, row_callback);
   };
   if (costing == "bikeshare") {
     thor::TimeDistanceBSSMatrix matrix;
     time_distances =
         matrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing, mode,
                               max_matrix_distance.find(costing)->second);
-    return tyr::serializeMatrix(request, time_distances, distance_scale);
+    return serialize(time_distances);
   }
   switch (source_to_target_algorithm) {
     case SELECT_OPTIMAL:
@@ -86,8 +107,18 @@ std::string thor_worker_t::matrix(Api& request) {
     case TIME_DISTANCE_MATRIX:
       time_distances = timedistancematrix();
       break;
+    case BUCKET_MATRIX:
+      // the hierarchy only has metrics for the default options of some costings
+      if (bucket_matrix.Supports(options)) {
+        bucket_matrix.set_interrupt(interrupt);
+        time_distances = bucket_matrix.SourceToTarget(options.sources(), options.targets(), *reader,
+                                                      mode_costing, mode, options);
+      } else {
+        time_distances = costmatrix();
+      }
+      break;
   }
-  return tyr::serializeMatrix(request, time_distances, distance_scale);
+  return serialize(time_distances);
 }
 } // namespace thor
 } // namespace valhalla
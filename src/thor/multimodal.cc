@@ -60,7 +60,7 @@ void MultiModalPathAlgorithm::Init(const midgard::PointLL& destll,
 
   // Reserve size for edge labels - do this here rather than in constructor so
   // to limit how much extra memory is used for persistent objects
-  edgelabels_.reserve(std::min(max_reserved_labels_count_, kInitialEdgeLabelCount));
+  label_arena_->Acquire(edgelabels_, std::min(max_reserved_labels_count_, kInitialEdgeLabelCount));
 
   // Construct adjacency list and edge status.
   // Set bucket size and cost range based on DynamicCost.
@@ -77,11 +77,7 @@ void MultiModalPathAlgorithm::Init(const midgard::PointLL& destll,
 // Clear the temporary information generated during path construction.
 void MultiModalPathAlgorithm::Clear() {
   // Clear the edge labels and destination list
-  if (edgelabels_.size() > max_reserved_labels_count_) {
-    edgelabels_.resize(max_reserved_labels_count_);
-    edgelabels_.shrink_to_fit();
-  }
-  edgelabels_.clear();
+  label_arena_->Release(edgelabels_);
   destinations_.clear();
 
   // Clear elements from the adjacency list
@@ -289,11 +289,13 @@ void thor_worker_t::route(Api& request) {
   auto& options = *request.mutable_options();
 
   // get all the legs
+  reset_search_counters();
   if (options.has_date_time_type() && options.date_time_type() == Options::arrive_by) {
     path_arrive_by(request, costing);
   } else {
     path_depart_at(request, costing);
   }
+  add_search_statistics(request);
   // log admin areas
   if (!options.do_not_track()) {
     for (const auto& route : request.trip().routes()) {
@@ -315,6 +317,7 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
            &timedep_reverse,
            &bidir_astar,
            &bss_astar,
+           &contraction_query,
        }) {
     alg->set_interrupt(interrupt);
   }
@@ -330,8 +333,10 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
   }
 
   // If the origin has date_time set use timedep_forward method if the distance
-  // between location is below some maximum distance (TBD).
-  if (origin.has_date_time() && options.date_time_type() != Options::invariant) {
+  // between location is below some maximum distance (TBD). In the time dependent
+  // mode of bidirectional a* it handles these at any distance.
+  if (!time_dependent_bidirectional && origin.has_date_time() &&
+      options.date_time_type() != Options::invariant) {
     PointLL ll1(origin.ll().lng(), origin.ll().lat());
     PointLL ll2(destination.ll().lng(), destination.ll().lat());
     if (ll1.Distance(ll2) < max_timedep_distance) {
@@ -341,7 +346,8 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
 
   // If the destination has date_time set use timedep_reverse method if the distance
   // between location is below some maximum distance (TBD).
-  if (destination.has_date_time() && options.date_time_type() != Options::invariant) {
+  if (!time_dependent_bidirectional && destination.has_date_time() &&
+      options.date_time_type() != Options::invariant) {
     PointLL ll1(origin.ll().lng(), origin.ll().lat());
     PointLL ll2(destination.ll().lng(), destination.ll().lat());
     if (ll1.Distance(ll2) < max_timedep_distance) {
@@ -364,6 +370,12 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
     }
   }
 
+  // Without a time or alternates the customized hierarchy can answer it much faster
+  if (!origin.has_date_time() && !destination.has_date_time() && options.alternates() == 0 &&
+      contraction_query.Supports(options)) {
+    return &contraction_query;
+  }
+
   // No other special cases we land on bidirectional a*
   return &bidir_astar;
 }
@@ -379,11 +391,22 @@ std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm*
   // If bidirectional A* disable use of destination-only edges on the
   // first pass. If there is a failure, we allow them on the second pass.
   // Other path algorithms can use destination-only edges on the first pass.
-  cost->set_allow_destination_only(path_algorithm == &bidir_astar ? false : true);
+  // The contraction hierarchy leaves them out of its metric in the same way.
+  cost->set_allow_destination_only(
+      path_algorithm == &bidir_astar || path_algorithm == &contraction_query ? false : true);
 
   cost->set_pass(0);
   auto paths = path_algorithm->GetBestPath(origin, destination, *reader, mode_costing, mode, options);
 
+  // The contraction hierarchy gives up on paths its metric cannot describe, like those through
+  // complex restrictions, in which case bidirectional A* finds them
+  if (paths.empty() && path_algorithm == &contraction_query) {
+    path_algorithm->Clear();
+    path_algorithm = &bidir_astar;
+    path_algorithm->Clear();
+    paths = path_algorithm->GetBestPath(origin, destination, *reader, mode_costing, mode, options);
+  }
+
   // Check if we should run a second pass pedestrian route with different A*
   // (to look for better routes where a ferry is taken)
   bool ped_second_pass = false;
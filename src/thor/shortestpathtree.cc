@@ -0,0 +1,228 @@
+#include "thor/shortestpathtree.h"
+#include "midgard/constants.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+using namespace valhalla::sif;
+
+namespace {
+
+// whether the destination is on the edge ahead of the origin so no expansion is needed to reach it
+bool is_trivial(const GraphId& edgeid,
+                const valhalla::Location& origin,
+                const valhalla::Location& destination) {
+  for (const auto& destination_edge : destination.path_edges()) {
+    if (destination_edge.graph_id() != edgeid) {
+      continue;
+    }
+    for (const auto& origin_edge : origin.path_edges()) {
+      if (origin_edge.graph_id() == edgeid &&
+          origin_edge.percent_along() <= destination_edge.percent_along()) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+std::vector<std::vector<PathInfo>>
+ShortestPathTree::FindPaths(const valhalla::Location& origin,
+                            const std::vector<const valhalla::Location*>& destinations,
+                            baldr::GraphReader& reader,
+                            const sif::mode_costing_t& costings,
+                            const sif::TravelMode mode,
+                            const float max_matrix_distance) {
+  mode_ = mode;
+  cost_threshold_ = GetCostThreshold(max_matrix_distance);
+
+  // the expansion starts from the origin only
+  google::protobuf::RepeatedPtrField<valhalla::Location> origins;
+  origins.Add()->CopyFrom(origin);
+  origin_ = &origins.Get(0);
+  dest_locations_ = destinations;
+
+  // the destinations need the costing which the expansion only sets when it starts
+  costing_ = costings[static_cast<uint32_t>(mode)];
+  SetDestinations(reader, destinations);
+
+  // expand until all the destinations are settled
+  if (settled_count_ < destinations_.size()) {
+    Dijkstras::Compute<ExpansionType::forward>(origins, reader, costings, mode);
+  }
+
+  auto paths = FormPaths();
+  origin_ = nullptr;
+  dest_locations_.clear();
+  return paths;
+}
+
+float ShortestPathTree::GetCostThreshold(const float max_matrix_distance) const {
+  float average_speed_mph;
+  switch (mode_) {
+    case TravelMode::kBicycle:
+      average_speed_mph = 10.0f;
+      break;
+    case TravelMode::kPedestrian:
+    case TravelMode::kPublicTransit:
+      average_speed_mph = 2.0f;
+      break;
+    case TravelMode::kDrive:
+    default:
+      average_speed_mph = 35.0f;
+  }
+
+  // Convert max_matrix_distance to seconds based on the average speed
+  return max_matrix_distance / (average_speed_mph * kMPHtoMetersPerSec);
+}
+
+void ShortestPathTree::SetDestinations(baldr::GraphReader& reader,
+                                       const std::vector<const valhalla::Location*>& destinations) {
+  settled_count_ = 0;
+  destinations_.resize(destinations.size());
+  for (uint32_t idx = 0; idx < destinations.size(); ++idx) {
+    auto& dest = destinations_[idx];
+    for (const auto& edge : destinations[idx]->path_edges()) {
+      // Disallow any user avoided edges if the avoid location is behind the destination along the
+      // edge
+      GraphId edgeid(edge.graph_id());
+      if (costing_->AvoidAsDestinationEdge(edgeid, edge.percent_along())) {
+        continue;
+      }
+      graph_tile_ptr tile;
+      const auto* directededge = reader.directededge(edgeid, tile);
+      if (directededge == nullptr) {
+        continue;
+      }
+
+      // Keep the remainder of the edge beyond the destination and form a threshold from the cost
+      // of the whole edge, once the expansion is past it the destination can not get any cheaper
+      dest.dest_edges[edge.graph_id()] = 1.0f - edge.percent_along();
+      float threshold = costing_->EdgeCost(directededge, tile).cost + edge.distance();
+      dest.threshold = std::max(dest.threshold, threshold);
+      dest_edges_[edge.graph_id()].push_back(idx);
+    }
+
+    // nothing to look for if none of its edges are allowed
+    if (dest.dest_edges.empty()) {
+      dest.settled = true;
+      ++settled_count_;
+    }
+  }
+  next_threshold_ = kNoCost;
+}
+
+// this is fired when the edge in the label has been settled (shortest path found) so we check if
+// any of the destinations are on it
+ExpansionRecommendation ShortestPathTree::ShouldExpand(baldr::GraphReader& reader,
+                                                       const sif::EdgeLabel& pred,
+                                                       const ExpansionType) {
+  // Past the distance limit of matrices the destinations not found yet are out of reach
+  if (pred.cost().cost > cost_threshold_) {
+    return ExpansionRecommendation::stop_expansion;
+  }
+
+  auto found = dest_edges_.find(pred.edgeid());
+  if (found != dest_edges_.end()) {
+    graph_tile_ptr tile;
+    const auto* edge = reader.directededge(pred.edgeid(), tile);
+    const auto label = edgestatus_.Get(pred.edgeid()).index();
+    for (auto dest_idx : found->second) {
+      auto& dest = destinations_[dest_idx];
+      if (dest.settled) {
+        continue;
+      }
+
+      // Skip the destination if it is on the origin edge but behind the origin
+      auto dest_edge = dest.dest_edges.find(pred.edgeid());
+      if (dest_edge == dest.dest_edges.end() ||
+          (pred.predecessor() == kInvalidLabel &&
+           !is_trivial(pred.edgeid(), *origin_, *dest_locations_[dest_idx]))) {
+        continue;
+      }
+
+      // The label cost is to the end of the edge, take off the remainder beyond the destination
+      float remainder = dest_edge->second;
+      Cost newcost = pred.cost() - (costing_->EdgeCost(edge, tile) * remainder);
+      if (newcost.cost < dest.best_cost.cost) {
+        dest.best_cost = newcost;
+        dest.label = label;
+        next_threshold_ = std::min(next_threshold_, newcost.cost + dest.threshold);
+      }
+
+      // The destination is settled once all its edges are
+      dest.dest_edges.erase(dest_edge);
+      if (dest.dest_edges.empty()) {
+        dest.settled = true;
+        ++settled_count_;
+      }
+    }
+  }
+
+  // Settle the destinations which can not get any cheaper, this takes care of those with edges the
+  // expansion never gets to (e.g. a cul-de-sac or turn restrictions). Only look when the cost passed
+  // the lowest threshold so this does not sweep the destinations for every edge
+  if (pred.cost().cost > next_threshold_) {
+    next_threshold_ = kNoCost;
+    for (auto& dest : destinations_) {
+      if (dest.settled || dest.label == kInvalidLabel) {
+        continue;
+      }
+      if (dest.best_cost.cost + dest.threshold < pred.cost().cost) {
+        dest.settled = true;
+        ++settled_count_;
+      } else {
+        next_threshold_ = std::min(next_threshold_, dest.best_cost.cost + dest.threshold);
+      }
+    }
+  }
+
+  return settled_count_ == destinations_.size() ? ExpansionRecommendation::stop_expansion
+                                                : ExpansionRecommendation::continue_expansion;
+}
+
+// tell the expansion how many labels to expect and how many buckets to use
+void ShortestPathTree::GetExpansionHints(uint32_t& bucket_count,
+                                         uint32_t& edge_label_reservation,
+                                         QueueType& queue_type) const {
+  bucket_count = 20000;
+  edge_label_reservation = 500000;
+  queue_type = QueueType::kDoubleBucket;
+}
+
+// deallocate and prepare for next request
+void ShortestPathTree::Clear() {
+  destinations_.clear();
+  dest_edges_.clear();
+  Dijkstras::Clear();
+}
+
+// walk the edge labels back from each destination to form its path
+std::vector<std::vector<PathInfo>> ShortestPathTree::FormPaths() const {
+  std::vector<std::vector<PathInfo>> paths(destinations_.size());
+  for (size_t i = 0; i < destinations_.size(); ++i) {
+    const auto& dest = destinations_[i];
+    if (dest.label == kInvalidLabel) {
+      continue;
+    }
+
+    auto& path = paths[i];
+    for (auto l = dest.label; l != kInvalidLabel; l = bdedgelabels_[l].predecessor()) {
+      const auto& label = bdedgelabels_[l];
+      path.emplace_back(label.mode(), label.cost(), label.edgeid(), 0, label.path_distance(),
+                        label.restriction_idx(), label.transition_cost());
+    }
+    std::reverse(path.begin(), path.end());
+
+    // the path ends part way along the last edge
+    path.back().elapsed_cost = dest.best_cost;
+  }
+  return paths;
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -1,6 +1,7 @@
 #include "thor/timedistancematrix.h"
 #include "midgard/logging.h"
 #include <algorithm>
+#include <cstring>
 #include <vector>
 
 using namespace valhalla::baldr;
@@ -405,14 +406,20 @@ std::vector<TimeDistance> TimeDistanceMatrix::SourceToTarget(
     baldr::GraphReader& graphreader,
     const sif::mode_costing_t& mode_costing,
     const sif::TravelMode mode,
-    const float max_matrix_distance) {
+    const float max_matrix_distance,
+    const MatrixRowCallback& row_callback) {
   // Run a series of one to many calls and concatenate the results.
   std::vector<TimeDistance> many_to_many;
   if (source_location_list.size() <= target_location_list.size()) {
-    for (const auto& origin : source_location_list) {
-      std::vector<TimeDistance> td = OneToMany(origin, target_location_list, graphreader,
-                                               mode_costing, mode, max_matrix_distance);
-      many_to_many.insert(many_to_many.end(), td.begin(), td.end());
+    for (int i = 0; i < source_location_list.size(); ++i) {
+      std::vector<TimeDistance> td = OneToMany(source_location_list.Get(i), target_location_list,
+                                               graphreader, mode_costing, mode, max_matrix_distance);
+      // each one to many is a whole row so it can go right away
+      if (row_callback) {
+        row_callback(i, td);
+      } else {
+        many_to_many.insert(many_to_many.end(), td.begin(), td.end());
+      }
       Clear();
     }
   } else {
@@ -422,6 +429,19 @@ std::vector<TimeDistance> TimeDistanceMatrix::SourceToTarget(
       many_to_many.insert(many_to_many.end(), td.begin(), td.end());
       Clear();
     }
+
+    // each many to one is a column so no row is done before the last one
+    if (row_callback) {
+      const auto source_count = source_location_list.size();
+      std::vector<TimeDistance> row(target_location_list.size());
+      for (int i = 0; i < source_count; ++i) {
+        for (size_t j = 0; j < row.size(); ++j) {
+          row[j] = many_to_many[j * source_count + i];
+        }
+        row_callback(i, row);
+      }
+      return {};
+    }
   }
   return many_to_many;
 }
@@ -557,13 +577,13 @@ void TimeDistanceMatrix::SetDestinations(
 
       // Add a destination if this is the first allowed edge for the location
       if (!added) {
-        destinations_.emplace_back();
+        destinations_.add();
         added = true;
       }
 
       // Keep the id and the partial distance for the remainder of the edge.
-      Destination& d = destinations_.back();
-      d.dest_edges[edge.graph_id()] = (1.0f - edge.percent_along());
+      const auto d = destinations_.size() - 1;
+      destinations_.edges[d][edge.graph_id()] = (1.0f - edge.percent_along());
 
       // Form a threshold cost (the total cost to traverse the edge)
       GraphId id(static_cast<GraphId>(edge.graph_id()));
@@ -575,8 +595,8 @@ void TimeDistanceMatrix::SetDestinations(
       // We assume the slowest speed you could travel to cover that distance to start/end the route
       // TODO: assumes 1m/s which is a maximum penalty this could vary per costing model
       c += edge.distance();
-      if (c > d.threshold) {
-        d.threshold = c;
+      if (c > destinations_.thresholds[d]) {
+        destinations_.thresholds[d] = c;
       }
 
       // Mark the edge as having a destination on it and add the
@@ -603,13 +623,13 @@ void TimeDistanceMatrix::SetDestinationsManyToOne(
 
       // Add a destination if this is the first allowed edge for the location
       if (!added) {
-        destinations_.emplace_back();
+        destinations_.add();
         added = true;
       }
 
       // Keep the id and the partial distance for the remainder of the edge.
-      Destination& d = destinations_.back();
-      d.dest_edges[opp_edge_id] = edge.percent_along();
+      const auto d = destinations_.size() - 1;
+      destinations_.edges[d][opp_edge_id] = edge.percent_along();
 
       // Form a threshold cost (the total cost to traverse the edge)
       GraphId id(static_cast<GraphId>(edge.graph_id()));
@@ -621,8 +641,8 @@ void TimeDistanceMatrix::SetDestinationsManyToOne(
       // We assume the slowest speed you could travel to cover that distance to start/end the route
       // TODO: assumes 1m/s which is a maximum penalty this could vary per costing model
       c += edge.distance();
-      if (c > d.threshold) {
-        d.threshold = c;
+      if (c > destinations_.thresholds[d]) {
+        destinations_.thresholds[d] = c;
       }
 
       // Mark the edge as having a destination on it and add the
@@ -644,19 +664,18 @@ bool TimeDistanceMatrix::UpdateDestinations(
     const EdgeLabel& pred) {
   // For each destination along this edge
   for (auto dest_idx : destinations) {
-    Destination& dest = destinations_[dest_idx];
-
     // Skip if destination has already been settled. This can happen since we
     // do not remove remaining destination edges for this destination from
     // dest_edges.
-    if (dest.settled) {
+    if (destinations_.settled[dest_idx]) {
       continue;
     }
 
     // See if this edge is part of the destination
     // TODO - it should always be, but protect against not finding it
-    auto dest_edge = dest.dest_edges.find(pred.edgeid());
-    if (dest_edge == dest.dest_edges.end()) {
+    auto& dest_edges = destinations_.edges[dest_idx];
+    auto dest_edge = dest_edges.find(pred.edgeid());
+    if (dest_edge == dest_edges.end()) {
       // If the edge isn't there but the path is trivial, then that means the edge
       // was removed towards the beginning which is not an error.
       if (!IsTrivial(pred.edgeid(), origin, locations.Get(dest_idx))) {
@@ -676,60 +695,88 @@ bool TimeDistanceMatrix::UpdateDestinations(
     // Subtract the partial remaining cost and distance along the edge.
     float remainder = dest_edge->second;
     Cost newcost = pred.cost() - (costing_->EdgeCost(edge, tile) * remainder);
-    if (newcost.cost < dest.best_cost.cost) {
-      dest.best_cost = newcost;
-      dest.distance = pred.path_distance() - (edge->length() * remainder);
+    if (newcost.cost < destinations_.costs[dest_idx]) {
+      destinations_.costs[dest_idx] = newcost.cost;
+      destinations_.secs[dest_idx] = newcost.secs;
+      destinations_.distances[dest_idx] = pred.path_distance() - (edge->length() * remainder);
     }
 
     // Erase this edge from further consideration. Mark this destination as
     // settled if all edges have been found
-    dest.dest_edges.erase(dest_edge);
-    if (dest.dest_edges.empty()) {
-      dest.settled = true;
+    dest_edges.erase(dest_edge);
+    if (dest_edges.empty()) {
+      destinations_.settled[dest_idx] = 1;
       settled_count_++;
     }
   }
 
+  // Update cost threshold for early termination if at least one path has
+  // been found to each destination. The destinations settled below count
+  // towards it as well.
+  if (destinations_.unfound() == 0) {
+    current_cost_threshold_ = destinations_.max_bound();
+  }
+
   // Settle any destinations where current cost is above the destination's
   // best cost + threshold. This helps remove destinations where one edge
   // cannot be reached (e.g. on a cul-de-sac or where turn restrictions apply).
-  // Update the cost threshold if at least one path to all destinations has
-  // been found.
-  bool allfound = true;
-  float maxcost = 0.0f;
-  for (auto& d : destinations_) {
-    // Skip any settled destinations
-    if (d.settled) {
-      continue;
-    }
+  settled_count_ += destinations_.settle(pred.cost().cost);
+  return settled_count_ == destinations_.size();
+}
 
-    // Do not update cost threshold if no path to this destination
-    // has been found
-    if (d.best_cost.cost == kMaxCost) {
-      allfound = false;
-    } else {
-      // Settle any destinations above their threshold and update maxcost
-      if ((d.best_cost.cost + d.threshold) < pred.cost().cost) {
-        d.settled = true;
-        settled_count_++;
-      }
-      maxcost = std::max(maxcost, d.best_cost.cost + d.threshold);
-    }
+// The sweeps over the destinations are separate loops with arithmetic on the flags instead of
+// branches so that each of them vectorizes at -O3, which g++ confirms with -fopt-info-vec
+uint32_t TimeDistanceMatrix::Destinations::settle(const float cost) {
+  const float* cost_data = costs.data();
+  const float* threshold_data = thresholds.data();
+  uint8_t* settled_data = settled.data();
+  const size_t n = size();
+  uint32_t count = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const uint8_t settle = (settled_data[i] == 0) & (cost_data[i] != kMaxCost) &
+                           (cost_data[i] + threshold_data[i] < cost);
+    settled_data[i] |= settle;
+    count += settle;
   }
+  return count;
+}
 
-  // Update cost threshold for early termination if at least one path has
-  // been found to each destination
-  if (allfound) {
-    current_cost_threshold_ = maxcost;
+uint32_t TimeDistanceMatrix::Destinations::unfound() const {
+  const float* cost_data = costs.data();
+  const uint8_t* settled_data = settled.data();
+  const size_t n = size();
+  uint32_t count = 0;
+  for (size_t i = 0; i < n; ++i) {
+    count += (settled_data[i] == 0) & (cost_data[i] == kMaxCost);
   }
-  return settled_count_ == destinations_.size();
+  return count;
+}
+
+float TimeDistanceMatrix::Destinations::max_bound() const {
+  // A float max reduction does not vectorize without -ffast-math. Costs and thresholds are not
+  // negative so their sums order the same as their bits do as unsigned integers, which do
+  const float* cost_data = costs.data();
+  const float* threshold_data = thresholds.data();
+  const uint8_t* settled_data = settled.data();
+  const size_t n = size();
+  uint32_t max_bits = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const uint32_t open = (settled_data[i] == 0) & (cost_data[i] != kMaxCost);
+    const float bound = cost_data[i] + threshold_data[i];
+    uint32_t bits;
+    std::memcpy(&bits, &bound, sizeof(bits));
+    max_bits = std::max(max_bits, bits & (0u - open));
+  }
+  float max_bound;
+  std::memcpy(&max_bound, &max_bits, sizeof(max_bound));
+  return max_bound;
 }
 
 // Form the time, distance matrix from the destinations list
 std::vector<TimeDistance> TimeDistanceMatrix::FormTimeDistanceMatrix() {
-  std::vector<TimeDistance> td;
-  for (auto& dest : destinations_) {
-    td.emplace_back(dest.best_cost.secs, dest.distance);
+  std::vector<TimeDistance> td(destinations_.size());
+  for (size_t i = 0; i < td.size(); ++i) {
+    td[i] = TimeDistance(destinations_.secs[i], destinations_.distances[i]);
   }
   return td;
 }
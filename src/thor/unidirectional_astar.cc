@@ -39,11 +39,7 @@ template <const ExpansionType expansion_direction, const bool FORWARD>
 void UnidirectionalAStar<expansion_direction, FORWARD>::Clear() {
   // Clear the edge labels and destination list. Reset the adjacency list
   // and clear edge status.
-  if (edgelabels_.size() > max_reserved_labels_count_) {
-    edgelabels_.resize(max_reserved_labels_count_);
-    edgelabels_.shrink_to_fit();
-  }
-  edgelabels_.clear();
+  label_arena_->Release(edgelabels_);
   destinations_percent_along_.clear();
   adjacencylist_.clear();
   edgestatus_.clear();
@@ -233,6 +229,7 @@ inline bool UnidirectionalAStar<expansion_direction, FORWARD>::ExpandInner(
   auto edge_cost = FORWARD
                        ? costing_->EdgeCost(meta.edge, tile, time_info.second_of_week, flow_sources)
                        : costing_->EdgeCost(opp_edge, t2, time_info.second_of_week, flow_sources);
+  counters_.predicted_speeds += (flow_sources & kPredictedFlowMask) != 0;
 
   sif::Cost transition_cost =
       FORWARD ? costing_->TransitionCost(meta.edge, nodeinfo, pred)
@@ -280,6 +277,7 @@ inline bool UnidirectionalAStar<expansion_direction, FORWARD>::ExpandInner(
     if (newcost.cost < lab.cost().cost) {
       float newsortcost = lab.sortcost() - (lab.cost().cost - newcost.cost);
       adjacencylist_.decrease(meta.edge_status->index(), newsortcost);
+      ++counters_.queue_decreases;
       lab.Update(pred_idx, newcost, newsortcost, transition_cost, restriction_idx);
     }
     return true;
@@ -296,7 +294,8 @@ inline bool UnidirectionalAStar<expansion_direction, FORWARD>::ExpandInner(
     if (t2 == nullptr) {
       return false;
     }
-    sortcost += astarheuristic_.Get(t2->get_node_ll(meta.edge->endnode()), dist);
+    sortcost +=
+        astarheuristic_.Get(t2->get_node_ll(meta.edge->endnode()), meta.edge->endnode(), t2, dist);
   }
 
   if (FORWARD) {
@@ -325,6 +324,7 @@ inline bool UnidirectionalAStar<expansion_direction, FORWARD>::ExpandInner(
     *meta.edge_status = {EdgeSet::kTemporary, idx};
     adjacencylist_.add(idx);
   }
+  ++counters_.queue_adds;
 
   return true;
 }
@@ -412,7 +412,7 @@ std::vector<std::vector<PathInfo>> UnidirectionalAStar<expansion_direction, FORW
     GraphReader& graphreader,
     const sif::mode_costing_t& mode_costing,
     const TravelMode mode,
-    const Options& /*options*/) {
+    const Options& options) {
   // Set the mode and costing
   mode_ = mode;
   costing_ = mode_costing[static_cast<uint32_t>(mode_)];
@@ -434,6 +434,18 @@ std::vector<std::vector<PathInfo>> UnidirectionalAStar<expansion_direction, FORW
   midgard::PointLL destination_new(destination.path_edges(0).ll().lng(),
                                    destination.path_edges(0).ll().lat());
   Init(origin_new, destination_new);
+
+  // Tighten the heuristic with the landmarks of the costing, if there are any
+  auto landmarks = GetLandmarks(options, origin, destination, costing_, graphreader);
+  if (landmarks) {
+    astarheuristic_.InitLandmarks(landmarks,
+                                  GetLocationNodes(FORWARD ? destination : origin, graphreader),
+                                  FORWARD);
+  }
+
+  // Start loading the tiles between the locations while we get going
+  graphreader.PrefetchCorridor({origin_new, destination_new});
+
   float mindist = astarheuristic_.GetDistance(origin_new);
 
   auto startpoint = FORWARD ? origin : destination;
@@ -478,6 +490,7 @@ std::vector<std::vector<PathInfo>> UnidirectionalAStar<expansion_direction, FORW
       LOG_ERROR("Route failed after iterations = " + std::to_string(edgelabels_.size()));
       return {};
     }
+    ++counters_.settled_edges;
 
     // Copy the EdgeLabel for use in costing. Check if this is a destination
     // edge and potentially complete the path.
@@ -564,7 +577,7 @@ void UnidirectionalAStar<expansion_direction, FORWARD>::Init(const midgard::Poin
     astarheuristic_.Init(origll, costing_->AStarCostFactor());
     mincost = astarheuristic_.Get(destll);
   }
-  edgelabels_.reserve(std::min(max_reserved_labels_count_, kInitialEdgeLabelCount));
+  label_arena_->Acquire(edgelabels_, std::min(max_reserved_labels_count_, kInitialEdgeLabelCount));
 
   // Construct adjacency list, clear edge status.
   // Set bucket size and cost range based on DynamicCost.
@@ -662,7 +675,7 @@ void UnidirectionalAStar<expansion_direction, FORWARD>::SetOrigin(
     // able to expand from this origin edge.
     uint8_t flow_sources;
     Cost cost;
-    float dist;
+    float dist, heuristic;
     GraphId opp_edge_id;
     const DirectedEdge* opp_dir_edge;
     if (FORWARD) {
@@ -672,7 +685,8 @@ void UnidirectionalAStar<expansion_direction, FORWARD>::SetOrigin(
       }
       cost = costing_->EdgeCost(directededge, tile, seconds_of_week, flow_sources) *
              (1.0f - edge.percent_along());
-      dist = astarheuristic_.GetDistance(endtile->get_node_ll(directededge->endnode()));
+      heuristic = astarheuristic_.Get(endtile->get_node_ll(directededge->endnode()),
+                                      directededge->endnode(), endtile, dist);
     } else {
       // Get the opposing directed edge, continue if we cannot get it
       opp_edge_id = graphreader.GetOpposingEdgeId(edgeid);
@@ -682,7 +696,8 @@ void UnidirectionalAStar<expansion_direction, FORWARD>::SetOrigin(
       opp_dir_edge = graphreader.GetOpposingEdge(edgeid);
       cost = costing_->EdgeCost(directededge, tile, seconds_of_week, flow_sources) *
              edge.percent_along();
-      dist = astarheuristic_.GetDistance(tile->get_node_ll(opp_dir_edge->endnode()));
+      heuristic = astarheuristic_.Get(tile->get_node_ll(opp_dir_edge->endnode()),
+                                      opp_dir_edge->endnode(), tile, dist);
     }
 
     // We need to penalize this location based on its score (distance in meters from input)
@@ -722,6 +737,7 @@ void UnidirectionalAStar<expansion_direction, FORWARD>::SetOrigin(
             cost.cost += dest_path_edge.distance();
             cost.cost = std::max(0.0f, cost.cost);
             dist = 0.0;
+            heuristic = 0.0f;
             // Search complete if this is the forward search
             if (FORWARD)
               break;
@@ -731,7 +747,7 @@ void UnidirectionalAStar<expansion_direction, FORWARD>::SetOrigin(
     }
 
     // Compute sortcost
-    float sortcost = cost.cost + astarheuristic_.Get(dist);
+    float sortcost = cost.cost + heuristic;
 
     // Add EdgeLabel to the adjacency list (but do not set its status).
     // Set the predecessor edge index to invalid to indicate the origin
@@ -1,5 +1,6 @@
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -69,12 +70,46 @@ thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
     : service_worker_t(config), mode(valhalla::sif::TravelMode::kPedestrian),
       bidir_astar(config.get_child("thor")), bss_astar(config.get_child("thor")),
       multi_modal_astar(config.get_child("thor")), timedep_forward(config.get_child("thor")),
-      timedep_reverse(config.get_child("thor")), isochrone_gen(config.get_child("thor")),
+      timedep_reverse(config.get_child("thor")), contraction_query(config.get_child("thor")),
+      bucket_matrix(config.get_child("thor")), isochrone_gen(config.get_child("thor")),
       matcher_factory(config, graph_reader), reader(graph_reader), controller{} {
   // If we weren't provided with a graph reader make our own
   if (!reader)
     reader = matcher_factory.graphreader();
 
+  // Get the metrics of the contraction hierarchy, if one was built
+  contraction_query.Customize(config);
+  bucket_matrix.Customize(config);
+
+  // Let the a* searches tighten their heuristics with landmarks, if they were built
+  const auto landmark_dir = config.get<std::string>("mjolnir.landmark_dir", "");
+  bidir_astar.set_landmark_dir(landmark_dir);
+  timedep_forward.set_landmark_dir(landmark_dir);
+  timedep_reverse.set_landmark_dir(landmark_dir);
+
+  // Keep the edge labels of all the algorithms in one arena so the worker stays within its limit
+  label_arena = std::make_shared<LabelArena>(config.get_child("thor"));
+  bidir_astar.set_label_arena(label_arena);
+  bss_astar.set_label_arena(label_arena);
+  multi_modal_astar.set_label_arena(label_arena);
+  timedep_forward.set_label_arena(label_arena);
+  timedep_reverse.set_label_arena(label_arena);
+  isochrone_gen.set_label_arena(label_arena);
+  centroid_gen.set_label_arena(label_arena);
+  path_tree.set_label_arena(label_arena);
+
+  // Give the reverse direction of bidirectional a* its own reader so both can run at once
+  if (config.get<bool>("thor.parallel_bidirectional", false)) {
+    reverse_reader = std::make_shared<baldr::GraphReader>(config.get_child("mjolnir"));
+    bidir_astar.set_reverse_reader(reverse_reader);
+  }
+
+  // Give every additional thread of the cost matrix its own reader
+  const auto costmatrix_threads = config.get<uint32_t>("thor.costmatrix_threads", 1);
+  for (uint32_t i = 1; i < costmatrix_threads; ++i) {
+    costmatrix_readers.push_back(std::make_shared<baldr::GraphReader>(config.get_child("mjolnir")));
+  }
+
   // Select the matrix algorithm based on the conf file (defaults to
   // select_optimal if not present)
   auto conf_algorithm = config.get<std::string>("thor.source_to_target_algorithm", "select_optimal");
@@ -95,12 +130,15 @@ thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
     source_to_target_algorithm = TIME_DISTANCE_MATRIX;
   } else if (conf_algorithm == "costmatrix") {
     source_to_target_algorithm = COST_MATRIX;
+  } else if (conf_algorithm == "bucketmatrix") {
+    source_to_target_algorithm = BUCKET_MATRIX;
   } else {
     source_to_target_algorithm = SELECT_OPTIMAL;
   }
 
   max_timedep_distance =
       config.get<float>("service_limits.max_timedep_distance", kDefaultMaxTimeDependentDistance);
+  time_dependent_bidirectional = config.get<bool>("thor.time_dependent_bidirectional", false);
 
   // signal that the worker started successfully
   started();
@@ -134,9 +172,13 @@ thor_worker_t::work(const std::list<zmq::message_t>& job,
 
     // do request specific processing
     switch (options.action()) {
-      case Options::sources_to_targets:
-        result = to_response(matrix(request), info, request);
+      case Options::sources_to_targets: {
+        const auto& mime = options.format() == Options::ndjson   ? worker::NDJSON_MIME
+                           : options.format() == Options::binary ? worker::BINARY_MIME
+                                                                 : worker::JSON_MIME;
+        result = to_response(matrix(request), info, request, mime);
         break;
+      }
       case Options::optimized_route: {
         optimized_route(request);
         result.messages.emplace_back(serialize_to_pbf(request));
@@ -167,6 +209,11 @@ thor_worker_t::work(const std::list<zmq::message_t>& job,
         result.messages.emplace_back(serialize_to_pbf(request));
         break;
       }
+      case Options::batch_route: {
+        batch_route(request);
+        result.messages.emplace_back(serialize_to_pbf(request));
+        break;
+      }
       case Options::status: {
         status(request);
         result.messages.emplace_back(serialize_to_pbf(request));
@@ -337,19 +384,76 @@ void thor_worker_t::parse_filter_attributes(const Api& request, bool is_strict_f
 }
 
 void thor_worker_t::cleanup() {
-  service_worker_t::cleanup();
+  enqueue_cache_statistics(*reader);
   bidir_astar.Clear();
   timedep_forward.Clear();
   timedep_reverse.Clear();
   multi_modal_astar.Clear();
   bss_astar.Clear();
+  bucket_matrix.Clear();
   trace.clear();
   isochrone_gen.Clear();
   centroid_gen.Clear();
+  path_tree.Clear();
+  // now that the algorithms handed back their labels report how much the arena keeps
+  const auto& arena_stats = label_arena->stats();
+  const auto prefix = service_name() + ".label_arena.";
+  enqueue_gauge(prefix + "kilobytes", arena_stats.retained_bytes / 1024);
+  enqueue_gauge(prefix + "peak_kilobytes", arena_stats.peak_bytes / 1024);
+  enqueue_gauge(prefix + "max_kilobytes", label_arena->max_bytes() / 1024);
+  enqueue_gauge(prefix + "reused", arena_stats.reused);
+  enqueue_gauge(prefix + "allocated", arena_stats.allocated);
+  enqueue_gauge(prefix + "freed", arena_stats.freed);
+  service_worker_t::cleanup();
   matcher_factory.ClearFullCache();
   if (reader->OverCommitted()) {
     reader->Trim();
   }
+  if (reverse_reader && reverse_reader->OverCommitted()) {
+    reverse_reader->Trim();
+  }
+  for (const auto& costmatrix_reader : costmatrix_readers) {
+    if (costmatrix_reader->OverCommitted()) {
+      costmatrix_reader->Trim();
+    }
+  }
+}
+
+void thor_worker_t::reset_search_counters() {
+  for (auto* alg : std::vector<PathAlgorithm*>{&timedep_forward, &timedep_reverse, &bidir_astar}) {
+    alg->reset_counters();
+  }
+  search_tiles_start = reader->GetCacheStats().total();
+  if (reverse_reader) {
+    search_tiles_start += reverse_reader->GetCacheStats().total();
+  }
+}
+
+void thor_worker_t::add_search_statistics(Api& request) {
+  SearchCounters counters;
+  for (auto* alg : std::vector<PathAlgorithm*>{&timedep_forward, &timedep_reverse, &bidir_astar}) {
+    counters += alg->counters();
+  }
+  auto tiles = reader->GetCacheStats().total();
+  if (reverse_reader) {
+    tiles += reverse_reader->GetCacheStats().total();
+  }
+
+  const auto prefix =
+      Options_Action_Enum_Name(request.options().action()) + ".info." + service_name() + ".";
+  const auto add = [&request, &prefix](const std::string& key, uint64_t value) {
+    auto* stat = request.mutable_info()->mutable_statistics()->Add();
+    stat->set_key(prefix + key);
+    stat->set_value(value);
+    stat->set_type(count);
+  };
+  add("settled_edges", counters.settled_edges);
+  add("queue_operations", counters.settled_edges + counters.queue_adds + counters.queue_decreases);
+  add("predicted_speeds", counters.predicted_speeds);
+  add("parallel_searches", counters.parallel_searches);
+  add("tile_lookups",
+      (tiles.hits + tiles.misses) - (search_tiles_start.hits + search_tiles_start.misses));
+  add("tile_loads", tiles.misses - search_tiles_start.misses);
 }
 
 void thor_worker_t::set_interrupt(const std::function<void()>* interrupt_function) {
@@ -299,6 +299,31 @@ actor_t::centroid(const std::string& request_str, const std::function<void()>* i
   return bytes;
 }
 
+std::string actor_t::batch_route(const std::string& request_str,
+                                 const std::function<void()>* interrupt,
+                                 Api* api) {
+  // set the interrupts
+  pimpl->set_interrupts(interrupt);
+  // parse the request
+  Api request;
+  ParseApi(request_str, Options::batch_route, request);
+  // check the request and locate the sources and targets in the graph
+  pimpl->loki_worker.matrix(request);
+  // find the path of each pair with one expansion per distinct source
+  pimpl->thor_worker.batch_route(request);
+  // get some directions back from them and serialize
+  auto bytes = pimpl->odin_worker.narrate(request);
+  // if they want you do to do the cleanup automatically
+  if (auto_cleanup) {
+    cleanup();
+  }
+  // give the caller a copy
+  if (api) {
+    api->Swap(&request);
+  }
+  return bytes;
+}
+
 std::string
 actor_t::status(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
   // set the interrupts
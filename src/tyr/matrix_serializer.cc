@@ -1,4 +1,7 @@
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <limits>
 
 #include "baldr/json.h"
 #include "proto_conversions.h"
@@ -136,6 +139,140 @@ json::MapPtr serialize(const Api& request,
 }
 } // namespace valhalla_serializers
 
+namespace ndjson_serializers {
+
+/*
+ndjson output is one json object per line, a header followed by a line for each row in the order
+the rows were done:
+
+{"units":"kilometers","sources":[{"lat":..,"lon":..}],"targets":[{"lat":..,"lon":..}],"id":".."}
+{"from_index":1,"times":[120,null],"distances":[1.5,null]}
+{"from_index":0,"times":[0,90],"distances":[0.0,1.1]}
+*/
+
+void locations(rapidjson::writer_wrapper_t& writer,
+               const char* name,
+               const google::protobuf::RepeatedPtrField<valhalla::Location>& correlated) {
+  writer.start_array(name);
+  for (const auto& location : correlated) {
+    writer.start_object();
+    writer("lat", location.ll().lat());
+    writer("lon", location.ll().lng());
+    writer.end_object();
+  }
+  writer.end_array();
+}
+
+std::string header(const Api& request) {
+  const auto& options = request.options();
+  rapidjson::writer_wrapper_t writer(64 * (options.sources_size() + options.targets_size()));
+  writer.set_precision(6);
+  writer.start_object();
+  writer("units", Options_Units_Enum_Name(options.units()));
+  locations(writer, "sources", options.sources());
+  locations(writer, "targets", options.targets());
+  if (options.has_id()) {
+    writer("id", options.id());
+  }
+  writer.end_object();
+  return std::string(writer.get_buffer()) + '\n';
+}
+
+void row(const uint32_t source_index,
+         const std::vector<TimeDistance>& row,
+         double distance_scale,
+         std::string& output) {
+  rapidjson::writer_wrapper_t writer(16 * row.size() + 64);
+  writer.set_precision(3);
+  writer.start_object();
+  writer("from_index", static_cast<uint64_t>(source_index));
+  // unreachable targets are null in both arrays
+  writer.start_array("times");
+  for (const auto& td : row) {
+    if (td.time != kMaxCost) {
+      writer(static_cast<uint64_t>(td.time));
+    } else {
+      writer(nullptr);
+    }
+  }
+  writer.end_array();
+  writer.start_array("distances");
+  for (const auto& td : row) {
+    if (td.time != kMaxCost) {
+      writer(td.dist * distance_scale);
+    } else {
+      writer(nullptr);
+    }
+  }
+  writer.end_array();
+  writer.end_object();
+  output.append(writer.get_buffer()).push_back('\n');
+}
+} // namespace ndjson_serializers
+
+namespace binary_serializers {
+
+/*
+binary output is little endian with a 16 byte header followed by a record for each row in the
+order the rows were done:
+
+char[4]   "VMTX"
+uint32    version, 1
+uint32    number of sources
+uint32    number of targets
+then per row:
+uint32    source index
+uint32[]  time in seconds to each target, 0xffffffff where unreachable
+float32[] distance in the requested units to each target, NaN where unreachable
+*/
+
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kUnreachableTime = std::numeric_limits<uint32_t>::max();
+
+// writes the bytes from the least significant up regardless of the byte order of the machine
+inline char* write(char* out, const uint32_t value) {
+  out[0] = static_cast<char>(value & 0xff);
+  out[1] = static_cast<char>((value >> 8) & 0xff);
+  out[2] = static_cast<char>((value >> 16) & 0xff);
+  out[3] = static_cast<char>((value >> 24) & 0xff);
+  return out + sizeof(value);
+}
+
+inline char* write(char* out, const float value) {
+  static_assert(sizeof(float) == sizeof(uint32_t), "float32 is written as 4 bytes");
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return write(out, bits);
+}
+
+std::string header(const Api& request) {
+  std::string output(4 * sizeof(uint32_t), '\0');
+  auto* out = &output[0];
+  std::memcpy(out, "VMTX", 4);
+  out = write(out + 4, kVersion);
+  out = write(out, static_cast<uint32_t>(request.options().sources_size()));
+  write(out, static_cast<uint32_t>(request.options().targets_size()));
+  return output;
+}
+
+void row(const uint32_t source_index,
+         const std::vector<TimeDistance>& row,
+         double distance_scale,
+         std::string& output) {
+  // the whole record is sized up front and written in place
+  const auto offset = output.size();
+  output.resize(offset + (1 + 2 * row.size()) * sizeof(uint32_t));
+  auto* out = write(&output[offset], source_index);
+  for (const auto& td : row) {
+    out = write(out, td.time != kMaxCost ? td.time : kUnreachableTime);
+  }
+  for (const auto& td : row) {
+    out = write(out, td.time != kMaxCost ? static_cast<float>(td.dist * distance_scale)
+                                         : std::numeric_limits<float>::quiet_NaN());
+  }
+}
+} // namespace binary_serializers
+
 namespace valhalla {
 namespace tyr {
 
@@ -152,5 +289,34 @@ std::string serializeMatrix(const Api& request,
   return ss.str();
 }
 
+std::string serializeMatrixHeader(const Api& request) {
+  return request.options().format() == Options::binary ? binary_serializers::header(request)
+                                                       : ndjson_serializers::header(request);
+}
+
+void serializeMatrixRow(const Api& request,
+                        const uint32_t source_index,
+                        const std::vector<TimeDistance>& row,
+                        double distance_scale,
+                        std::string& output) {
+  if (request.options().format() == Options::binary) {
+    binary_serializers::row(source_index, row, distance_scale, output);
+  } else {
+    ndjson_serializers::row(source_index, row, distance_scale, output);
+  }
+}
+
+void serializeMatrixRows(const Api& request,
+                         const std::vector<TimeDistance>& time_distances,
+                         double distance_scale,
+                         std::string& output) {
+  const size_t target_count = request.options().targets_size();
+  std::vector<TimeDistance> row(target_count);
+  for (size_t i = 0; i * target_count < time_distances.size(); ++i) {
+    std::copy_n(time_distances.begin() + i * target_count, target_count, row.begin());
+    serializeMatrixRow(request, i, row, distance_scale, output);
+  }
+}
+
 } // namespace tyr
 } // namespace valhalla
@@ -542,11 +542,23 @@ std::string serialize(const Api& api) {
   // build up the json object, reserve 4k bytes
   rapidjson::writer_wrapper_t writer(4096);
 
+  // a batch lists the route of every pair instead of a route and its alternates, the pairs without
+  // a path are null
+  const bool batch = api.options().action() == Options::batch_route;
+  if (batch) {
+    writer.start_object();
+    writer.start_array("trips");
+  }
+
   // for each route
   for (int i = 0; i < api.directions().routes_size(); ++i) {
-    if (i == 1) {
+    if (i == 1 && !batch) {
       writer.start_array("alternates");
     }
+    if (batch && api.directions().routes(i).legs_size() == 0) {
+      writer(nullptr);
+      continue;
+    }
 
     // the route itself
     writer.start_object();
@@ -567,12 +579,14 @@ std::string serialize(const Api& api) {
     writer.end_object(); // trip
 
     // leave space for alternates by closing this one outside the loop
-    if (i > 0) {
+    if (i > 0 || batch) {
       writer.end_object();
     }
   }
 
-  if (api.directions().routes_size() > 1) {
+  if (batch) {
+    writer.end_array(); // trips
+  } else if (api.directions().routes_size() > 1) {
     writer.end_array(); // alternates
   }
 
@@ -106,6 +106,23 @@ std::string serializeStatus(const Api& request) {
     status_doc.AddMember("has_live_traffic",
                          rapidjson::Value().SetBool(request.status().has_live_traffic()), alloc);
 
+  if (request.status().tile_cache_size()) {
+    rapidjson::Value tile_cache(rapidjson::kArrayType);
+    for (const auto& level : request.status().tile_cache()) {
+      rapidjson::Value stats(rapidjson::kObjectType);
+      stats.AddMember("level", rapidjson::Value().SetUint(level.level()), alloc);
+      stats.AddMember("hits", rapidjson::Value().SetUint64(level.hits()), alloc);
+      stats.AddMember("misses", rapidjson::Value().SetUint64(level.misses()), alloc);
+      stats.AddMember("inserts", rapidjson::Value().SetUint64(level.inserts()), alloc);
+      stats.AddMember("evictions", rapidjson::Value().SetUint64(level.evictions()), alloc);
+      stats.AddMember("tiles", rapidjson::Value().SetUint64(level.tiles()), alloc);
+      stats.AddMember("bytes", rapidjson::Value().SetUint64(level.bytes()), alloc);
+      stats.AddMember("load_micros", rapidjson::Value().SetUint64(level.load_micros()), alloc);
+      tile_cache.PushBack(stats, alloc);
+    }
+    status_doc.AddMember("tile_cache", tile_cache, alloc);
+  }
+
   rapidjson::Document bbox_doc;
   if (request.status().has_bbox()) {
     bbox_doc.Parse(request.status().bbox());
@@ -114,6 +114,9 @@ int main(int argc, char** argv) {
         case valhalla::Options::expansion:
           std::cout << actor.expansion(request_str, nullptr, &request) << std::endl;
           break;
+        case valhalla::Options::batch_route:
+          std::cout << actor.batch_route(request_str, nullptr, &request) << std::endl;
+          break;
         case valhalla::Options::status:
           std::cout << actor.status(request_str, nullptr, &request) << std::endl;
           break;
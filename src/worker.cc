@@ -1,4 +1,5 @@
 #include <iostream>
+#include <limits>
 #include <sstream>
 #include <typeinfo>
 #include <unordered_map>
@@ -66,6 +67,7 @@ const std::unordered_map<unsigned, valhalla::valhalla_exception_t> error_codes{
     {125, {125, "No costing method found", 400, HTTP_400, OSRM_INVALID_OPTIONS, "wrong_costing"}},
     {126, {126, "No shape provided", 400, HTTP_400, OSRM_INVALID_OPTIONS, "shape_required"}},
     {127, {127, "Recostings require both name and costing parameters", 400, HTTP_400, OSRM_INVALID_OPTIONS, "recosting_parse_failed"}},
+    {128, {128, "The number of sources and targets must match for batch_route", 400, HTTP_400, OSRM_INVALID_OPTIONS, "unpaired_sources_targets"}},
     {130, {130, "Failed to parse location", 400, HTTP_400, OSRM_INVALID_VALUE, "location_parse_failed"}},
     {131, {131, "Failed to parse source", 400, HTTP_400, OSRM_INVALID_VALUE, "source_parse_failed"}},
     {132, {132, "Failed to parse target", 400, HTTP_400, OSRM_INVALID_VALUE, "target_parse_failed"}},
@@ -490,7 +492,11 @@ void from_json(rapidjson::Document& doc, Options& options) {
   auto fmt = rapidjson::get_optional<std::string>(doc, "/format");
   Options::Format format;
   if (fmt && Options_Format_Enum_Parse(*fmt, &format)) {
-    options.set_format(format);
+    // only a matrix can be written a row at a time, the other actions stay json
+    if ((format != Options::ndjson && format != Options::binary) ||
+        options.action() == Options::sources_to_targets) {
+      options.set_format(format);
+    }
   }
 
   auto id = rapidjson::get_optional<std::string>(doc, "/id");
@@ -1106,6 +1112,7 @@ struct statsd_client_t : public Statsd::StatsdClient {
     if (!errorMessage().empty() && !host.empty()) {
       LOG_ERROR(errorMessage());
     }
+    enabled = !host.empty();
     auto added_tags = conf.get_child_optional("statsd.tags");
     if (added_tags) {
       for (const auto& tag : *added_tags) {
@@ -1114,6 +1121,7 @@ struct statsd_client_t : public Statsd::StatsdClient {
     }
   }
   std::vector<std::string> tags;
+  bool enabled;
 };
 
 service_worker_t::service_worker_t(const boost::property_tree::ptree& config)
@@ -1164,6 +1172,35 @@ void service_worker_t::enqueue_statistics(Api& api) const {
     statsd_client->count(action + ".info." + service_name() + ".ok", 1, 1.f, statsd_client->tags);
   }
 }
+void service_worker_t::enqueue_cache_statistics(const baldr::GraphReader& reader) const {
+  // no point in gathering them if nobody is listening
+  if (!statsd_client->enabled)
+    return;
+
+  auto gauge = [this](const std::string& key, uint64_t value) { enqueue_gauge(key, value); };
+
+  auto cache_stats = reader.GetCacheStats();
+  for (size_t level = 0; level < cache_stats.levels.size(); ++level) {
+    const auto& stats = cache_stats.levels[level];
+    if (stats.hits == 0 && stats.misses == 0 && stats.inserts == 0)
+      continue;
+    auto prefix = service_name() + ".tile_cache." + std::to_string(level) + ".";
+    gauge(prefix + "hits", stats.hits);
+    gauge(prefix + "misses", stats.misses);
+    gauge(prefix + "inserts", stats.inserts);
+    gauge(prefix + "evictions", stats.evictions);
+    gauge(prefix + "tiles", stats.tiles);
+    gauge(prefix + "kilobytes", stats.bytes / 1024);
+    gauge(prefix + "load_ms", stats.load_micros / 1000);
+  }
+}
+void service_worker_t::enqueue_gauge(const std::string& key, uint64_t value) const {
+  if (!statsd_client->enabled)
+    return;
+
+  auto clamped = std::min<uint64_t>(value, std::numeric_limits<unsigned int>::max());
+  statsd_client->gauge(key, static_cast<unsigned int>(clamped), 1.f, statsd_client->tags);
+}
 midgard::Finally<std::function<void()>> service_worker_t::measure_scope_time(Api& api) const {
   // we copy the captures that could go out of scope
   auto start = std::chrono::steady_clock::now();
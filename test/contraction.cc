@@ -0,0 +1,264 @@
+#include "test.h"
+
+#include "baldr/contraction.h"
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "mjolnir/contractionbuilder.h"
+#include "thor/contraction_metric.h"
+#include "thor/contraction_query.h"
+#include "tyr/actor.h"
+#include "worker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::thor;
+
+namespace {
+
+const std::string kHierarchyFile = "test/data/utrecht_contraction.cch";
+
+boost::property_tree::ptree make_config(bool with_hierarchy) {
+  auto conf = test::make_config("test/data/utrecht_tiles",
+                                {{"mjolnir.contraction_hierarchy", kHierarchyFile}});
+  if (with_hierarchy) {
+    test::put_costings(conf, "thor.contraction_costings", {"auto"});
+  }
+  return conf;
+}
+
+const auto& kLocations = test::utrecht_routes();
+
+class ContractionTest : public ::testing::Test {
+protected:
+  static void SetUpTestSuite() {
+    std::remove(kHierarchyFile.c_str());
+    mjolnir::ContractionBuilder::Build(make_config(true).get_child("mjolnir"));
+  }
+};
+
+TEST_F(ContractionTest, hierarchy_covers_graph) {
+  auto hierarchy = ContractionHierarchy::Load(kHierarchyFile);
+  ASSERT_GT(hierarchy->node_count(), 0);
+  ASSERT_GT(hierarchy->arc_count(), 0);
+
+  // every edge which isnt a shortcut or a loop is on the arc between its nodes
+  GraphReader reader(make_config(true).get_child("mjolnir"));
+  size_t edges = 0;
+  for (const auto& tile_id : reader.GetTileSet()) {
+    auto tile = reader.GetGraphTile(tile_id);
+    for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
+      const auto* edge = tile->directededge(i);
+      GraphId edgeid(tile_id.tileid(), tile_id.level(), i);
+      auto start = hierarchy->rank(reader.edge_startnode(edgeid));
+      auto end = hierarchy->rank(edge->endnode());
+      ASSERT_NE(start, kInvalidContractionIndex);
+      ASSERT_NE(end, kInvalidContractionIndex);
+      if (edge->is_shortcut() || edge->IsTransitLine() || start == end) {
+        continue;
+      }
+      auto index = hierarchy->input_edge(edgeid);
+      ASSERT_NE(index, kInvalidContractionIndex) << "Missing edge " << edgeid;
+      const auto& input_edge = hierarchy->input_edges()[index];
+      EXPECT_EQ(input_edge.arc, hierarchy->find_arc(std::min(start, end), std::max(start, end)));
+      EXPECT_EQ(input_edge.upward != 0, start < end);
+      ++edges;
+    }
+  }
+  EXPECT_EQ(edges, hierarchy->input_edges().size());
+}
+
+TEST_F(ContractionTest, parallel_customization_matches_serial) {
+  auto conf = make_config(true);
+  auto hierarchy = ContractionHierarchy::Load(kHierarchyFile);
+  auto slot = ContractionMetric::Get(conf, Costing::auto_);
+  ContractionMetric serial(hierarchy, slot->get()->options());
+  serial.Customize(conf.get_child("mjolnir"), 1);
+  ContractionMetric parallel(hierarchy, slot->get()->options());
+  parallel.Customize(conf.get_child("mjolnir"), 4);
+
+  size_t reachable = 0;
+  for (uint32_t arc = 0; arc < hierarchy->arc_count(); ++arc) {
+    ASSERT_EQ(serial.up_weight(arc), parallel.up_weight(arc));
+    ASSERT_EQ(serial.down_weight(arc), parallel.down_weight(arc));
+    ASSERT_EQ(serial.up_via(arc), parallel.up_via(arc));
+    ASSERT_EQ(serial.down_via(arc), parallel.down_via(arc));
+    reachable += serial.up_weight(arc) != kUnreachableWeight;
+  }
+  EXPECT_GT(reachable, 0);
+
+  // the levels of the elimination tree hold every node once
+  std::vector<uint32_t> nodes;
+  for (uint32_t level = 0; level < hierarchy->level_count(); ++level) {
+    for (auto i = hierarchy->first_level_node(level); i < hierarchy->last_level_node(level); ++i) {
+      nodes.push_back(hierarchy->level_node(i));
+    }
+  }
+  std::sort(nodes.begin(), nodes.end());
+  ASSERT_EQ(nodes.size(), hierarchy->node_count());
+  for (uint32_t rank = 0; rank < nodes.size(); ++rank) {
+    ASSERT_EQ(nodes[rank], rank);
+  }
+}
+
+TEST_F(ContractionTest, supports_default_options_only) {
+  auto conf = make_config(true);
+  ContractionQuery query(conf.get_child("thor"));
+  query.Customize(conf);
+
+  Api request;
+  ParseApi(test::route_request(kLocations.front()), Options::route, request);
+  EXPECT_TRUE(query.Supports(request.options()));
+
+  request.Clear();
+  ParseApi(test::route_request(kLocations.front(), R"(,"costing_options":{"auto":{"use_tolls":0}})"),
+           Options::route, request);
+  EXPECT_FALSE(query.Supports(request.options()));
+
+  request.Clear();
+  ParseApi(R"({"costing":"bicycle","locations":[)" + kLocations.front().first + "," +
+               kLocations.front().second + "]}",
+           Options::route, request);
+  EXPECT_FALSE(query.Supports(request.options()));
+}
+
+TEST_F(ContractionTest, matches_bidirectional_astar) {
+  tyr::actor_t bidirectional(make_config(false), true);
+  tyr::actor_t contraction(make_config(true), true);
+
+  for (const auto& locations : kLocations) {
+    auto request = test::route_request(locations);
+    auto expected = test::route_summary(bidirectional, request);
+    auto actual = test::route_summary(contraction, request);
+
+    // the hierarchy finds the optimum without turn costs, bidirectional a* is limited by the
+    // road hierarchy, so they can differ a little
+    EXPECT_NEAR(actual.time, expected.time, expected.time * 0.05) << request;
+  }
+}
+
+TEST_F(ContractionTest, bucket_matrix_matches_costmatrix) {
+  auto cost_config = make_config(false);
+  cost_config.put("thor.source_to_target_algorithm", "costmatrix");
+  auto bucket_config = make_config(true);
+  bucket_config.put("thor.source_to_target_algorithm", "bucketmatrix");
+  tyr::actor_t costmatrix(cost_config, true);
+  tyr::actor_t bucketmatrix(bucket_config, true);
+
+  // the last target is the first source so it has an empty path
+  std::string sources, targets;
+  for (const auto& locations : kLocations) {
+    sources += (sources.empty() ? "" : ",") + locations.first;
+    targets += (targets.empty() ? "" : ",") + locations.second;
+  }
+  targets += "," + kLocations.front().first;
+  auto request =
+      R"({"costing":"auto","sources":[)" + sources + R"(],"targets":[)" + targets + "]}";
+
+  rapidjson::Document expected, actual;
+  expected.Parse(costmatrix.matrix(request));
+  actual.Parse(bucketmatrix.matrix(request));
+  ASSERT_FALSE(expected.HasParseError());
+  ASSERT_FALSE(actual.HasParseError());
+
+  for (size_t i = 0; i < kLocations.size(); ++i) {
+    for (size_t j = 0; j <= kLocations.size(); ++j) {
+      auto path = "/sources_to_targets/" + std::to_string(i) + "/" + std::to_string(j);
+      auto expected_time = rapidjson::get<double>(expected, (path + "/time").c_str());
+      auto actual_time = rapidjson::get<double>(actual, (path + "/time").c_str());
+      auto expected_distance = rapidjson::get<double>(expected, (path + "/distance").c_str());
+      auto actual_distance = rapidjson::get<double>(actual, (path + "/distance").c_str());
+      // the hierarchy has no turn costs and costmatrix is limited by the road hierarchy
+      EXPECT_NEAR(actual_time, expected_time, expected_time * 0.1) << path;
+      EXPECT_NEAR(actual_distance, expected_distance, expected_distance * 0.1) << path;
+    }
+  }
+  auto trivial = "/sources_to_targets/0/" + std::to_string(kLocations.size()) + "/time";
+  EXPECT_EQ(rapidjson::get<double>(actual, trivial.c_str()), 0);
+}
+
+// the edges of the route between the locations
+std::vector<uint64_t> route_edges(tyr::actor_t& actor, const test::location_pair_t& locations) {
+  Api api;
+  actor.route(test::route_request(locations), nullptr, &api);
+  std::vector<uint64_t> edges;
+  for (const auto& node : api.trip().routes(0).legs(0).node()) {
+    if (node.has_edge()) {
+      edges.push_back(node.edge().id());
+    }
+  }
+  return edges;
+}
+
+TEST_F(ContractionTest, live_traffic_is_customized_into_the_route) {
+  // a copy of the hierarchy gets its own metric which is customized again every second
+  const std::string hierarchy_file = "test/data/utrecht_contraction_traffic.cch";
+  {
+    std::ifstream in(kHierarchyFile, std::ios::binary);
+    std::ofstream out(hierarchy_file, std::ios::binary | std::ios::trunc);
+    out << in.rdbuf();
+  }
+  auto conf = make_config(true);
+  conf.put("mjolnir.contraction_hierarchy", hierarchy_file);
+  conf.put("mjolnir.traffic_extract", "test/data/utrecht_contraction_traffic.tar");
+  conf.put("thor.contraction_customize_interval", 1);
+  test::build_live_traffic_data(conf);
+
+  tyr::actor_t actor(conf, true);
+  auto slot = ContractionMetric::Get(conf, Costing::auto_);
+  auto before = slot->get();
+  auto edges = route_edges(actor, kLocations.front());
+  ASSERT_GT(edges.size(), 2);
+
+  // crawl along all but the first and last edge of the route
+  std::unordered_set<uint64_t> slowed(edges.begin() + 1, edges.end() - 1);
+  test::customize_live_traffic_data(conf, [&](GraphReader&, TrafficTile& tile, int index,
+                                              TrafficSpeed* current) {
+    GraphId edge_id(tile.header->tile_id);
+    edge_id.set_id(index);
+    if (slowed.count(edge_id.value)) {
+      current->overall_encoded_speed = 2 >> 1;
+      current->encoded_speed1 = 2 >> 1;
+      current->breakpoint1 = 255;
+    }
+  });
+
+  // the first swap may have started customizing before the update so wait for the second
+  auto after = before;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::minutes(1);
+  for (int swaps = 0; swaps < 2 && std::chrono::steady_clock::now() < deadline;) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto current = slot->get();
+    swaps += current != after;
+    after = current;
+  }
+  ASSERT_NE(after, before) << "The metric was never customized again";
+
+  // nothing got faster and the slowed edges made some arcs slower
+  size_t slower = 0;
+  for (uint32_t arc = 0; arc < after->hierarchy().arc_count(); ++arc) {
+    ASSERT_GE(after->up_weight(arc), before->up_weight(arc) * 0.999f);
+    ASSERT_GE(after->down_weight(arc), before->down_weight(arc) * 0.999f);
+    slower += after->up_weight(arc) > before->up_weight(arc) * 1.001f ||
+              after->down_weight(arc) > before->down_weight(arc) * 1.001f;
+  }
+  EXPECT_GT(slower, 0);
+
+  // and the route goes around them now
+  auto detour = route_edges(actor, kLocations.front());
+  EXPECT_NE(detour, edges);
+  auto still_slowed = std::count_if(detour.begin(), detour.end(),
+                                    [&](uint64_t edge) { return slowed.count(edge) != 0; });
+  EXPECT_LT(static_cast<size_t>(still_slowed), slowed.size());
+}
+
+} // namespace
@@ -53,6 +53,11 @@ TEST(EdgeStatus, TestStatus) {
   TryGet(edgestatus, GraphId(555, 2, 1), EdgeSet::kPermanent);
   TryGet(edgestatus, GraphId(555, 3, 1), EdgeSet::kPermanent);
 
+  // Peeking finds the same without the lookup cache
+  EXPECT_EQ(edgestatus.Peek(GraphId(555, 2, 55555)).set(), EdgeSet::kTemporary);
+  EXPECT_EQ(edgestatus.Peek(GraphId(555, 2, 55555)).index(), 5);
+  EXPECT_EQ(edgestatus.Peek(GraphId(556, 2, 55555)).set(), EdgeSet::kUnreachedOrReset);
+
   // Clear and make sure all status are kUnreachedOrReset
   edgestatus.clear();
   TryGet(edgestatus, GraphId(555, 1, 100100), EdgeSet::kUnreachedOrReset);
@@ -66,6 +71,82 @@ TEST(EdgeStatus, TestStatus) {
   TryGet(edgestatus, GraphId(555, 3, 1), EdgeSet::kUnreachedOrReset);
 }
 
+TEST(EdgeStatus, TestReuseAfterClear) {
+  EdgeStatus edgestatus;
+
+  GraphTileHeader small_header, large_header;
+  small_header.set_directededgecount(100);
+  large_header.set_directededgecount(5000);
+  test_tile* small_tt = new test_tile;
+  small_tt->header_ = &small_header;
+  test_tile* large_tt = new test_tile;
+  large_tt->header_ = &large_header;
+  graph_tile_ptr small_tile{small_tt}, large_tile{large_tt};
+
+  // enough tiles and paths to make the table grow while pointers are held
+  EdgeStatusInfo* first = edgestatus.GetPtr(GraphId(0, 2, 99), small_tile);
+  *first = {EdgeSet::kTemporary, 42};
+  for (uint32_t tileid = 1; tileid < 500; ++tileid) {
+    edgestatus.Set(GraphId(tileid, 2, 99), EdgeSet::kPermanent, tileid, small_tile);
+    edgestatus.Set(GraphId(tileid, 1, 4999), EdgeSet::kTemporary, tileid, large_tile, 3);
+  }
+  EXPECT_EQ(first, edgestatus.GetPtr(GraphId(0, 2, 99), small_tile));
+  EXPECT_EQ(edgestatus.Get(GraphId(0, 2, 99)).index(), 42);
+  for (uint32_t tileid = 1; tileid < 500; ++tileid) {
+    EXPECT_EQ(edgestatus.Get(GraphId(tileid, 2, 99)).index(), tileid);
+    EXPECT_EQ(edgestatus.Get(GraphId(tileid, 1, 4999), 3).set(), EdgeSet::kTemporary);
+    EXPECT_EQ(edgestatus.Get(GraphId(tileid, 1, 4999)).set(), EdgeSet::kUnreachedOrReset);
+  }
+  edgestatus.Update(GraphId(7, 2, 99), EdgeSet::kSkipped);
+  TryGet(edgestatus, GraphId(7, 2, 99), EdgeSet::kSkipped);
+  EXPECT_THROW(edgestatus.Update(GraphId(7, 0, 99), EdgeSet::kSkipped), std::runtime_error);
+
+  // the recycled arrays must not leak the status of the previous search
+  edgestatus.clear();
+  for (uint32_t tileid = 0; tileid < 500; ++tileid) {
+    TryGet(edgestatus, GraphId(tileid, 2, 99), EdgeSet::kUnreachedOrReset);
+    edgestatus.Set(GraphId(tileid, 0, 0), EdgeSet::kTemporary, tileid, large_tile);
+    for (uint32_t id = 1; id < 5000; id += 499) {
+      TryGet(edgestatus, GraphId(tileid, 0, id), EdgeSet::kUnreachedOrReset);
+    }
+  }
+
+  // moving keeps the statuses
+  EdgeStatus moved;
+  moved = std::move(edgestatus);
+  TryGet(moved, GraphId(3, 0, 0), EdgeSet::kTemporary);
+}
+
+TEST(PublishedEdges, PublishAndFind) {
+  PublishedEdges published;
+  EXPECT_EQ(published.Find(GraphId(1, 2, 3)), nullptr);
+  published.Reserve(100);
+
+  for (uint32_t id = 0; id < 100; ++id) {
+    ASSERT_TRUE(published.Publish(GraphId(id % 7, 2, id), {float(id), 1.f, 2.f, id % 2 == 0}));
+  }
+  EXPECT_EQ(published.size(), 100);
+  for (uint32_t id = 0; id < 100; ++id) {
+    const auto* entry = published.Find(GraphId(id % 7, 2, id));
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->cost, float(id));
+    EXPECT_EQ(entry->settled, id % 2 == 0);
+  }
+  EXPECT_EQ(published.Find(GraphId(1, 2, 3)), nullptr);
+
+  // the first entry of an edge stays and a full table refuses new edges
+  EXPECT_TRUE(published.Publish(GraphId(0, 2, 0), {42.f, 0.f, 0.f, false}));
+  EXPECT_EQ(published.Find(GraphId(0, 2, 0))->cost, 0.f);
+  EXPECT_FALSE(published.Publish(GraphId(1, 2, 3), {42.f, 0.f, 0.f, false}));
+
+  // clearing makes room again and forgets everything
+  published.clear();
+  EXPECT_EQ(published.size(), 0);
+  EXPECT_EQ(published.Find(GraphId(0, 2, 0)), nullptr);
+  EXPECT_TRUE(published.Publish(GraphId(1, 2, 3), {42.f, 0.f, 0.f, false}));
+  EXPECT_EQ(published.Find(GraphId(1, 2, 3))->cost, 42.f);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
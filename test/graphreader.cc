@@ -1,12 +1,18 @@
 #include <cstdint>
 
+#include "baldr/compression_utils.h"
 #include "baldr/connectivity_map.h"
 #include "baldr/graphreader.h"
 #include "baldr/tilehierarchy.h"
 #include "filesystem.h"
 
+#include <chrono>
+#include <cstring>
 #include <fcntl.h>
+#include <fstream>
+#include <thread>
 
+#include "microtar.h"
 #include "test.h"
 
 using namespace valhalla::baldr;
@@ -400,6 +406,111 @@ TEST(CacheLruHard, InsertWithEvictionBasic) {
   CheckGraphTile(cache.Get(tile5_id), tile5_id, tile5_size);
 }
 
+TEST(CacheSlru, ScanResistance) {
+  TileCacheSLRU cache(1000, TileCacheLRU::MemoryLimitControl::HARD, 0.5f, 0);
+
+  // a local tile that is used twice gets protected
+  GraphId reused_id(1, 2, 0);
+  cache.Put(reused_id, graph_tile_ptr{new TestGraphTile(reused_id, 100)}, 100);
+  CheckGraphTile(cache.Get(reused_id), reused_id, 100);
+
+  // a burst of local tiles which are only used once only push each other out
+  for (uint32_t i = 2; i < 40; ++i) {
+    GraphId once_id(i, 2, 0);
+    cache.Put(once_id, graph_tile_ptr{new TestGraphTile(once_id, 100)}, 100);
+  }
+  EXPECT_TRUE(cache.Contains(reused_id));
+  EXPECT_FALSE(cache.Contains(GraphId(2, 2, 0)));
+  EXPECT_TRUE(cache.Contains(GraphId(39, 2, 0)));
+  EXPECT_FALSE(cache.OverCommitted());
+}
+
+TEST(CacheSlru, PinnedLevels) {
+  TileCacheSLRU cache(1000, TileCacheLRU::MemoryLimitControl::HARD, 0.5f, 1);
+
+  // highway and arterial tiles are protected from the start
+  GraphId highway_id(1, 0, 0);
+  cache.Put(highway_id, graph_tile_ptr{new TestGraphTile(highway_id, 200)}, 200);
+  GraphId arterial_id(1, 1, 0);
+  cache.Put(arterial_id, graph_tile_ptr{new TestGraphTile(arterial_id, 200)}, 200);
+
+  for (uint32_t i = 0; i < 20; ++i) {
+    GraphId local_id(i, 2, 0);
+    cache.Put(local_id, graph_tile_ptr{new TestGraphTile(local_id, 200)}, 200);
+  }
+  EXPECT_TRUE(cache.Contains(highway_id));
+  EXPECT_TRUE(cache.Contains(arterial_id));
+
+  // the protected segment is bounded so a third pinned tile demotes the oldest one
+  GraphId highway2_id(2, 0, 0);
+  cache.Put(highway2_id, graph_tile_ptr{new TestGraphTile(highway2_id, 200)}, 200);
+  GraphId local_id(100, 2, 0);
+  cache.Put(local_id, graph_tile_ptr{new TestGraphTile(local_id, 200)}, 200);
+  cache.Put(GraphId(101, 2, 0), graph_tile_ptr{new TestGraphTile(GraphId(101, 2, 0), 200)}, 200);
+  cache.Put(GraphId(102, 2, 0), graph_tile_ptr{new TestGraphTile(GraphId(102, 2, 0), 200)}, 200);
+  EXPECT_FALSE(cache.Contains(highway_id));
+  EXPECT_TRUE(cache.Contains(arterial_id));
+  EXPECT_TRUE(cache.Contains(highway2_id));
+
+  auto stats = cache.Stats();
+  EXPECT_EQ(stats.total().bytes, 1000);
+  EXPECT_EQ(stats.total().tiles, 5);
+}
+
+TEST(CacheSlru, SoftTrim) {
+  TileCacheSLRU cache(500, TileCacheLRU::MemoryLimitControl::SOFT, 0.8f, 0);
+
+  GraphId protected_id(1, 2, 0);
+  cache.Put(protected_id, graph_tile_ptr{new TestGraphTile(protected_id, 200)}, 200);
+  cache.Get(protected_id);
+  for (uint32_t i = 2; i < 6; ++i) {
+    GraphId id(i, 2, 0);
+    cache.Put(id, graph_tile_ptr{new TestGraphTile(id, 200)}, 200);
+  }
+  EXPECT_TRUE(cache.OverCommitted());
+
+  // probationary tiles go first
+  cache.Trim();
+  EXPECT_FALSE(cache.OverCommitted());
+  EXPECT_TRUE(cache.Contains(protected_id));
+  EXPECT_TRUE(cache.Contains(GraphId(5, 2, 0)));
+  EXPECT_FALSE(cache.Contains(GraphId(2, 2, 0)));
+}
+
+TEST(CacheLruHard, Stats) {
+  TileCacheLRU cache(500, TileCacheLRU::MemoryLimitControl::HARD);
+
+  GraphId tile1_id(1000, 1, 0);
+  cache.Put(tile1_id, graph_tile_ptr{new TestGraphTile(tile1_id, 200)}, 200);
+  GraphId tile2_id(300, 2, 0);
+  cache.Put(tile2_id, graph_tile_ptr{new TestGraphTile(tile2_id, 250)}, 250);
+  GraphId tile3_id(1, 1, 0);
+  cache.Put(tile3_id, graph_tile_ptr{new TestGraphTile(tile3_id, 45)}, 45);
+
+  // this evicts tile1
+  GraphId tile4_id(400, 2, 0);
+  cache.Put(tile4_id, graph_tile_ptr{new TestGraphTile(tile4_id, 20)}, 20);
+
+  auto stats = cache.Stats();
+  EXPECT_EQ(stats.levels[1].inserts, 2);
+  EXPECT_EQ(stats.levels[1].evictions, 1);
+  EXPECT_EQ(stats.levels[1].tiles, 1);
+  EXPECT_EQ(stats.levels[1].bytes, 45);
+  EXPECT_EQ(stats.levels[2].inserts, 2);
+  EXPECT_EQ(stats.levels[2].evictions, 0);
+  EXPECT_EQ(stats.levels[2].tiles, 2);
+  EXPECT_EQ(stats.levels[2].bytes, 270);
+  EXPECT_EQ(stats.total().bytes, 315);
+
+  // everything left is evicted
+  cache.Clear();
+  stats = cache.Stats();
+  EXPECT_EQ(stats.total().inserts, 4);
+  EXPECT_EQ(stats.total().evictions, 4);
+  EXPECT_EQ(stats.total().tiles, 0);
+  EXPECT_EQ(stats.total().bytes, 0);
+}
+
 TEST(CacheLruHard, OverwriteSameSize) {
   TileCacheLRU cache(500, TileCacheLRU::MemoryLimitControl::HARD);
 
@@ -880,6 +991,416 @@ TEST(CacheLruSoft, TrimOnExactlyFullCache) {
   CheckGraphTile(cache.Get(tile2_id), tile2_id, tile2_size);
 }
 
+TEST(ShardedCache, PutGetAcrossShards) {
+  ShardedTileCache cache(16000, 4, TileCacheLRU::MemoryLimitControl::HARD);
+
+  std::vector<GraphId> ids;
+  for (uint32_t i = 0; i < 10; ++i) {
+    ids.emplace_back(i * 7, i % 3, 0);
+    cache.Put(ids.back(), graph_tile_ptr{new TestGraphTile(ids.back(), 100)}, 100);
+  }
+
+  EXPECT_FALSE(cache.OverCommitted());
+  for (const auto& id : ids) {
+    EXPECT_TRUE(cache.Contains(id));
+    CheckGraphTile(cache.Get(id), id, 100);
+  }
+  EXPECT_FALSE(cache.Contains({1234, 2, 0}));
+  EXPECT_EQ(cache.Get({1234, 2, 0}), nullptr);
+
+  cache.Clear();
+  for (const auto& id : ids) {
+    EXPECT_FALSE(cache.Contains(id));
+  }
+}
+
+TEST(ShardedCache, CopiesShareShards) {
+  ShardedTileCache cache(1000, 2, TileCacheLRU::MemoryLimitControl::HARD);
+  ShardedTileCache copy(cache);
+
+  GraphId id(42, 1, 0);
+  copy.Put(id, graph_tile_ptr{new TestGraphTile(id, 100)}, 100);
+  CheckGraphTile(cache.Get(id), id, 100);
+
+  cache.Clear();
+  EXPECT_FALSE(copy.Contains(id));
+}
+
+TEST(ShardedCache, SoftOvercommitTrim) {
+  // one shard so we know exactly where the budget goes
+  ShardedTileCache cache(1000, 1, TileCacheLRU::MemoryLimitControl::SOFT);
+
+  GraphId id1(1, 2, 0), id2(2, 2, 0);
+  cache.Put(id1, graph_tile_ptr{new TestGraphTile(id1, 600)}, 600);
+  cache.Put(id2, graph_tile_ptr{new TestGraphTile(id2, 600)}, 600);
+  EXPECT_TRUE(cache.OverCommitted());
+
+  // the least recently used tile goes
+  cache.Trim();
+  EXPECT_FALSE(cache.OverCommitted());
+  EXPECT_FALSE(cache.Contains(id1));
+  EXPECT_TRUE(cache.Contains(id2));
+}
+
+// tiles can only be shared between threads with thread safe reference counting
+#ifdef ENABLE_THREAD_SAFE_TILE_REF_COUNT
+TEST(ShardedCache, ConcurrentAccess) {
+  ShardedTileCache cache(1000000, 8, TileCacheLRU::MemoryLimitControl::HARD);
+
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < 4; ++t) {
+    threads.emplace_back([&cache, t]() {
+      for (uint32_t i = 0; i < 1000; ++i) {
+        GraphId id((i + t) % 100, 2, 0);
+        if (!cache.Get(id))
+          cache.Put(id, graph_tile_ptr{new TestGraphTile(id, 100)}, 100);
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  EXPECT_FALSE(cache.OverCommitted());
+  for (uint32_t i = 0; i < 100; ++i) {
+    CheckGraphTile(cache.Get({i, 2, 0}), {i, 2, 0}, 100);
+  }
+}
+#endif
+
+TEST(ShardedCache, FactorySharesGlobalCache) {
+  boost::property_tree::ptree pt;
+  pt.put("use_sharded_cache", true);
+  std::unique_ptr<TileCache> cache1(TileCacheFactory::createTileCache(pt));
+  std::unique_ptr<TileCache> cache2(TileCacheFactory::createTileCache(pt));
+
+  GraphId id(7, 0, 0);
+  cache1->Put(id, graph_tile_ptr{new TestGraphTile(id, 100)}, 100);
+  CheckGraphTile(cache2->Get(id), id, 100);
+  cache2->Clear();
+}
+
+TEST(SharedFlatCache, PutGetClear) {
+  SharedFlatTileCache cache(250);
+
+  GraphId id1(100, 2, 0), id2(300, 1, 0);
+  auto tile1 = cache.Put(id1, graph_tile_ptr{new TestGraphTile(id1, 100)}, 100);
+  EXPECT_EQ(cache.Get(id1), tile1);
+  EXPECT_TRUE(cache.Contains(id1));
+  EXPECT_FALSE(cache.Contains(id2));
+  EXPECT_EQ(cache.Get(id2), nullptr);
+  EXPECT_FALSE(cache.OverCommitted());
+
+  // the first tile put wins
+  auto again = cache.Put(id1, graph_tile_ptr{new TestGraphTile(id1, 100)}, 100);
+  EXPECT_EQ(again, tile1);
+  EXPECT_FALSE(cache.OverCommitted());
+
+  cache.Put(id2, graph_tile_ptr{new TestGraphTile(id2, 200)}, 200);
+  CheckGraphTile(cache.Get(id2), id2, 200);
+  EXPECT_TRUE(cache.OverCommitted());
+
+  // tiles handed out before the clear are still valid
+  cache.Trim();
+  EXPECT_FALSE(cache.OverCommitted());
+  EXPECT_FALSE(cache.Contains(id1));
+  EXPECT_FALSE(cache.Contains(id2));
+  CheckGraphTile(tile1, id1, 100);
+
+  // invalid levels are never cached
+  GraphId bad(1, 7, 0);
+  EXPECT_NE(cache.Put(bad, graph_tile_ptr{new TestGraphTile(bad, 10)}, 10), nullptr);
+  EXPECT_FALSE(cache.Contains(bad));
+}
+
+TEST(SharedFlatCache, CopiesShareSlots) {
+  SharedFlatTileCache cache(1000);
+  SharedFlatTileCache copy(cache);
+
+  GraphId id(42, 0, 0);
+  copy.Put(id, graph_tile_ptr{new TestGraphTile(id, 100)}, 100);
+  CheckGraphTile(cache.Get(id), id, 100);
+  cache.Clear();
+  EXPECT_FALSE(copy.Contains(id));
+}
+
+#ifdef ENABLE_THREAD_SAFE_TILE_REF_COUNT
+TEST(SharedFlatCache, ConcurrentReadersAndClear) {
+  SharedFlatTileCache cache(1000000);
+
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+  for (uint32_t t = 0; t < 4; ++t) {
+    readers.emplace_back([&cache, &done, t]() {
+      while (!done.load()) {
+        GraphId id(t, 2, 0);
+        auto tile = cache.Get(id);
+        if (!tile)
+          tile = cache.Put(id, graph_tile_ptr{new TestGraphTile(id, 100)}, 100);
+        ASSERT_EQ(tile->header()->graphid(), id);
+      }
+    });
+  }
+  for (int i = 0; i < 100; ++i) {
+    cache.Clear();
+    std::this_thread::yield();
+  }
+  done.store(true);
+  for (auto& reader : readers)
+    reader.join();
+}
+#endif
+
+TEST(GraphReader, MmapTileDir) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/data/utrecht_tiles");
+  GraphReader reader(pt);
+  pt.put("use_tile_mmap", true);
+  GraphReader mmap_reader(pt);
+  pt.put("advise_tile_sections", true);
+  GraphReader advised_reader(pt);
+
+  auto tile_ids = reader.GetTileSet();
+  ASSERT_FALSE(tile_ids.empty());
+  for (const auto& tile_id : tile_ids) {
+    auto tile = reader.GetGraphTile(tile_id);
+    auto mmap_tile = mmap_reader.GetGraphTile(tile_id);
+    ASSERT_NE(tile, nullptr);
+    ASSERT_NE(mmap_tile, nullptr);
+    // the tiles should have the same bytes but not share the same memory
+    ASSERT_EQ(tile->header()->end_offset(), mmap_tile->header()->end_offset());
+    EXPECT_NE(tile->header(), mmap_tile->header());
+    EXPECT_EQ(memcmp(tile->header(), mmap_tile->header(), tile->header()->end_offset()), 0);
+    // page advice doesnt change what we read
+    auto advised_tile = advised_reader.GetGraphTile(tile_id);
+    ASSERT_NE(advised_tile, nullptr);
+    EXPECT_EQ(memcmp(tile->header(), advised_tile->header(), tile->header()->end_offset()), 0);
+  }
+}
+
+TEST(GraphReader, CacheStats) {
+  for (const auto* cache_type : {"", "use_simple_mem_cache", "use_lru_mem_cache"}) {
+    boost::property_tree::ptree pt;
+    pt.put("tile_dir", "test/data/utrecht_tiles");
+    if (*cache_type) {
+      pt.put(cache_type, true);
+    }
+    GraphReader reader(pt);
+
+    auto tile_ids = reader.GetTileSet();
+    ASSERT_FALSE(tile_ids.empty());
+    const auto tile_id = *tile_ids.begin();
+    const auto level = tile_id.level();
+
+    // the first time it has to be loaded, the second time its already there
+    auto tile = reader.GetGraphTile(tile_id);
+    ASSERT_NE(tile, nullptr);
+    reader.GetGraphTile(tile_id);
+    auto stats = reader.GetCacheStats();
+    EXPECT_EQ(stats.levels[level].misses, 1) << cache_type;
+    EXPECT_EQ(stats.levels[level].hits, 1) << cache_type;
+    EXPECT_EQ(stats.levels[level].inserts, 1) << cache_type;
+    EXPECT_EQ(stats.levels[level].tiles, 1) << cache_type;
+    EXPECT_EQ(stats.levels[level].bytes, tile->header()->end_offset()) << cache_type;
+    EXPECT_EQ(stats.total().misses, 1) << cache_type;
+
+    reader.Clear();
+    stats = reader.GetCacheStats();
+    EXPECT_EQ(stats.levels[level].evictions, 1) << cache_type;
+    EXPECT_EQ(stats.levels[level].tiles, 0) << cache_type;
+    EXPECT_EQ(stats.levels[level].bytes, 0) << cache_type;
+  }
+}
+
+TEST(GraphReader, Prefetch) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/data/utrecht_tiles");
+  GraphReader reader(pt);
+  EXPECT_FALSE(reader.PrefetchEnabled());
+  pt.put("prefetch_threads", 2);
+  GraphReader prefetch_reader(pt);
+  ASSERT_TRUE(prefetch_reader.PrefetchEnabled());
+
+  auto tile_ids = reader.GetTileSet();
+  ASSERT_FALSE(tile_ids.empty());
+  prefetch_reader.Prefetch({tile_ids.begin(), tile_ids.end()});
+  // a tile that doesnt exist should just come back empty
+  prefetch_reader.Prefetch({GraphId(0, 2, 0)});
+  prefetch_reader.PrefetchCorridor({{5.1079374, 52.0887174}, {5.1, 52.1}});
+
+  // whether they were loaded in the background or not we should get the same tiles
+  for (const auto& tile_id : tile_ids) {
+    auto tile = reader.GetGraphTile(tile_id);
+    auto prefetched_tile = prefetch_reader.GetGraphTile(tile_id);
+    ASSERT_NE(tile, nullptr);
+    ASSERT_NE(prefetched_tile, nullptr);
+    ASSERT_EQ(tile->header()->end_offset(), prefetched_tile->header()->end_offset());
+    EXPECT_EQ(memcmp(tile->header(), prefetched_tile->header(), tile->header()->end_offset()), 0);
+  }
+  EXPECT_EQ(prefetch_reader.GetGraphTile(GraphId(0, 2, 0)), nullptr);
+  prefetch_reader.Clear();
+}
+
+TEST(GraphReader, PrefetchRecovers) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/data/utrecht_tiles");
+  pt.put("prefetch_threads", 1);
+  pt.put("prefetch_max_tiles", 2);
+  GraphReader reader(pt);
+  auto tile_set = reader.GetTileSet();
+  std::vector<GraphId> tile_ids(tile_set.begin(), tile_set.end());
+  ASSERT_GE(tile_ids.size(), 3u);
+
+  // fill up the prefetcher with tiles nobody asks for
+  reader.Prefetch({tile_ids[0], tile_ids[1]});
+  reader.WaitForPrefetch();
+  ASSERT_TRUE(reader.IsPrefetched(tile_ids[0]));
+  ASSERT_TRUE(reader.IsPrefetched(tile_ids[1]));
+
+  // another tile takes the place of the one which was waiting the longest
+  reader.Prefetch({tile_ids[2]});
+  reader.WaitForPrefetch();
+  ASSERT_TRUE(reader.IsPrefetched(tile_ids[2]));
+  EXPECT_FALSE(reader.IsPrefetched(tile_ids[0]));
+  EXPECT_TRUE(reader.IsPrefetched(tile_ids[1]));
+
+  // trimming drops them all and the prefetcher takes more work after
+  reader.Trim();
+  EXPECT_FALSE(reader.IsPrefetched(tile_ids[1]));
+  EXPECT_FALSE(reader.IsPrefetched(tile_ids[2]));
+  reader.Prefetch({tile_ids[0]});
+  reader.WaitForPrefetch();
+  ASSERT_TRUE(reader.IsPrefetched(tile_ids[0]));
+
+  // asking for the tile hands it over
+  EXPECT_NE(reader.GetGraphTile(tile_ids[0]), nullptr);
+  EXPECT_FALSE(reader.IsPrefetched(tile_ids[0]));
+}
+
+struct extract_reader : public GraphReader {
+  using GraphReader::tile_extract_t;
+  extract_reader(const boost::property_tree::ptree& pt) : GraphReader(pt) {
+    tile_extract_.reset(new tile_extract_t(pt));
+  }
+};
+
+TEST(GraphReader, TileExtractIndex) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/data/utrecht_tiles");
+  GraphReader reader(pt);
+  auto tile_ids = reader.GetTileSet();
+  ASSERT_FALSE(tile_ids.empty());
+
+  // pack the tiles into an extract
+  const std::string extract = "test/data/utrecht_tiles_indexed.tar";
+  const std::string index = extract + ".index";
+  filesystem::remove(extract);
+  filesystem::remove(index);
+  mtar_t tar;
+  ASSERT_EQ(mtar_open(&tar, extract.c_str(), "w"), MTAR_ESUCCESS);
+  for (const auto& tile_id : tile_ids) {
+    auto tile = reader.GetGraphTile(tile_id);
+    ASSERT_NE(tile, nullptr);
+    auto name = GraphTile::FileSuffix(tile_id);
+    auto size = tile->header()->end_offset();
+    ASSERT_EQ(mtar_write_file_header(&tar, name.c_str(), size), MTAR_ESUCCESS);
+    ASSERT_EQ(mtar_write_data(&tar, tile->header(), size), MTAR_ESUCCESS);
+  }
+  ASSERT_EQ(mtar_finalize(&tar), MTAR_ESUCCESS);
+  ASSERT_EQ(mtar_close(&tar), MTAR_ESUCCESS);
+
+  // the first load reads through the tar and leaves the index behind
+  pt.put("tile_extract", extract);
+  pt.put("use_tile_extract_index", true);
+  extract_reader::tile_extract_t walked(pt);
+  ASSERT_EQ(walked.tiles.size(), tile_ids.size());
+  ASSERT_TRUE(filesystem::exists(index));
+
+  // the second load only uses the index and finds the same tiles
+  extract_reader::tile_extract_t indexed(pt);
+  EXPECT_TRUE(indexed.archive->contents.empty());
+  ASSERT_EQ(indexed.tiles.size(), walked.tiles.size());
+  for (const auto& tile : walked.tiles) {
+    auto found = indexed.tiles.find(tile.first);
+    ASSERT_NE(found, indexed.tiles.end());
+    ASSERT_EQ(found->second.second, tile.second.second);
+    EXPECT_EQ(memcmp(found->second.first, tile.second.first, tile.second.second), 0);
+  }
+
+  // an index that doesnt match the extract is ignored
+  {
+    std::fstream file(index, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(16);
+    uint64_t wrong_size = 0;
+    file.write(reinterpret_cast<const char*>(&wrong_size), sizeof(wrong_size));
+  }
+  extract_reader::tile_extract_t stale(pt);
+  EXPECT_FALSE(stale.archive->contents.empty());
+  EXPECT_EQ(stale.tiles.size(), walked.tiles.size());
+}
+
+std::vector<char> gzip(const char* data, size_t size) {
+  std::vector<char> compressed;
+  auto src_func = [data, size](z_stream& s) -> int {
+    s.next_in = static_cast<Byte*>(static_cast<void*>(const_cast<char*>(data)));
+    s.avail_in = static_cast<unsigned int>(size);
+    return Z_FINISH;
+  };
+  auto dst_func = [&compressed](z_stream& s) -> void {
+    auto size = compressed.size();
+    if (s.total_out < size)
+      compressed.resize(s.total_out);
+    else {
+      compressed.resize(size + 4096);
+      s.next_out = static_cast<Byte*>(static_cast<void*>(compressed.data() + size));
+      s.avail_out = 4096;
+    }
+  };
+  EXPECT_TRUE(valhalla::baldr::deflate(src_func, dst_func));
+  return compressed;
+}
+
+TEST(GraphReader, CompressedTileExtract) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/data/utrecht_tiles");
+  GraphReader reader(pt);
+  auto tile_ids = reader.GetTileSet();
+  ASSERT_FALSE(tile_ids.empty());
+
+  // pack the tiles into an extract with every other one gzipped
+  const std::string extract = "test/data/utrecht_tiles_compressed.tar";
+  filesystem::remove(extract);
+  mtar_t tar;
+  ASSERT_EQ(mtar_open(&tar, extract.c_str(), "w"), MTAR_ESUCCESS);
+  bool compress = false;
+  for (const auto& tile_id : tile_ids) {
+    auto tile = reader.GetGraphTile(tile_id);
+    ASSERT_NE(tile, nullptr);
+    const char* data = reinterpret_cast<const char*>(tile->header());
+    auto compressed = gzip(data, tile->header()->end_offset());
+    auto name =
+        GraphTile::FileSuffix(tile_id, compress ? SUFFIX_COMPRESSED : SUFFIX_NON_COMPRESSED);
+    auto bytes = compress ? compressed.data() : data;
+    auto size = compress ? compressed.size() : tile->header()->end_offset();
+    ASSERT_EQ(GraphTile::IsCompressed(bytes, size), compress);
+    ASSERT_EQ(mtar_write_file_header(&tar, name.c_str(), size), MTAR_ESUCCESS);
+    ASSERT_EQ(mtar_write_data(&tar, bytes, size), MTAR_ESUCCESS);
+    compress = !compress;
+  }
+  ASSERT_EQ(mtar_finalize(&tar), MTAR_ESUCCESS);
+  ASSERT_EQ(mtar_close(&tar), MTAR_ESUCCESS);
+
+  // whether they were compressed or not we should get the same tiles back out
+  pt.put("tile_extract", extract);
+  extract_reader compressed_reader(pt);
+  for (const auto& tile_id : tile_ids) {
+    auto tile = reader.GetGraphTile(tile_id);
+    auto extract_tile = compressed_reader.GetGraphTile(tile_id);
+    ASSERT_NE(extract_tile, nullptr);
+    ASSERT_EQ(tile->header()->end_offset(), extract_tile->header()->end_offset());
+    EXPECT_EQ(memcmp(tile->header(), extract_tile->header(), tile->header()->end_offset()), 0);
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
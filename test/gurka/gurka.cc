@@ -62,28 +62,30 @@ std::vector<midgard::PointLL> to_lls(const nodelayout& nodes,
  * @param stop_type      break, through, via, break_through
  * @return json string
  */
-std::string build_valhalla_request(const std::string& location_type,
-                                   const std::vector<midgard::PointLL>& waypoints,
-                                   const std::string& costing = "auto",
-                                   const std::unordered_map<std::string, std::string>& options = {},
-                                   const std::string& stop_type = "break") {
+std::string build_valhalla_request(
+    const std::vector<std::pair<std::string, std::vector<midgard::PointLL>>>& location_lists,
+    const std::string& costing = "auto",
+    const std::unordered_map<std::string, std::string>& options = {},
+    const std::string& stop_type = "break") {
 
   rapidjson::Document doc;
   doc.SetObject();
   auto& allocator = doc.GetAllocator();
 
-  rapidjson::Value locations(rapidjson::kArrayType);
-  for (const auto& waypoint : waypoints) {
-    rapidjson::Value p(rapidjson::kObjectType);
-    p.AddMember("lon", waypoint.lng(), allocator);
-    p.AddMember("lat", waypoint.lat(), allocator);
-    if (!stop_type.empty()) {
-      p.AddMember("type", stop_type, allocator);
+  // e.g. locations or shape, or sources and targets
+  for (const auto& location_list : location_lists) {
+    rapidjson::Value locations(rapidjson::kArrayType);
+    for (const auto& waypoint : location_list.second) {
+      rapidjson::Value p(rapidjson::kObjectType);
+      p.AddMember("lon", waypoint.lng(), allocator);
+      p.AddMember("lat", waypoint.lat(), allocator);
+      if (!stop_type.empty()) {
+        p.AddMember("type", stop_type, allocator);
+      }
+      locations.PushBack(p, allocator);
     }
-    locations.PushBack(p, allocator);
+    doc.AddMember(rapidjson::Value(location_list.first, allocator), locations, allocator);
   }
-
-  doc.AddMember(rapidjson::Value(location_type, allocator), locations, allocator);
   doc.AddMember("costing", costing, allocator);
 
   // check if we are overriding speed types etc
@@ -599,6 +601,9 @@ valhalla::Api do_action(const valhalla::Options::Action& action,
     case valhalla::Options::centroid:
       json_str = actor.centroid(request_json, nullptr, &api);
       break;
+    case valhalla::Options::batch_route:
+      json_str = actor.batch_route(request_json, nullptr, &api);
+      break;
     case valhalla::Options::expansion:
       json_str = actor.expansion(request_json, nullptr, &api);
       std::cout << json_str << std::endl;
@@ -607,6 +612,9 @@ valhalla::Api do_action(const valhalla::Options::Action& action,
       json_str = actor.isochrone(request_json, nullptr, &api);
       std::cout << json_str << std::endl;
       break;
+    case valhalla::Options::sources_to_targets:
+      json_str = actor.matrix(request_json, nullptr, &api);
+      break;
     default:
       throw std::logic_error("Unsupported action");
       break;
@@ -642,7 +650,30 @@ valhalla::Api do_action(const valhalla::Options::Action& action,
   auto lls = detail::to_lls(map.nodes, waypoints);
   auto location_type =
       action == Options::trace_route || action == Options::trace_attributes ? "shape" : "locations";
-  auto request_json = detail::build_valhalla_request(location_type, lls, costing, options, stop_type);
+  auto request_json =
+      detail::build_valhalla_request({{location_type, lls}}, costing, options, stop_type);
+  return do_action(action, map, request_json, reader, json);
+}
+
+valhalla::Api do_action(const valhalla::Options::Action& action,
+                        const map& map,
+                        const std::vector<std::string>& sources,
+                        const std::vector<std::string>& targets,
+                        const std::string& costing,
+                        const std::unordered_map<std::string, std::string>& options,
+                        std::shared_ptr<valhalla::baldr::GraphReader> reader,
+                        std::string* json) {
+  if (!reader)
+    reader = test::make_clean_graphreader(map.config.get_child("mjolnir"));
+
+  std::cerr << "[          ] " << Options_Action_Enum_Name(action)
+            << " with mjolnir.tile_dir = " << map.config.get<std::string>("mjolnir.tile_dir")
+            << " with " << sources.size() << " sources and " << targets.size() << " targets"
+            << " with costing " << costing << std::endl;
+  auto request_json =
+      detail::build_valhalla_request({{"sources", detail::to_lls(map.nodes, sources)},
+                                      {"targets", detail::to_lls(map.nodes, targets)}},
+                                     costing, options);
   return do_action(action, map, request_json, reader, json);
 }
 
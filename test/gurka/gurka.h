@@ -172,6 +172,18 @@ valhalla::Api do_action(const valhalla::Options::Action& action,
                         std::string* json = nullptr,
                         const std::string& stop_type = "break");
 
+/**
+ * Runs an action with sources and targets, e.g. a matrix, on the named nodes of the map
+ */
+valhalla::Api do_action(const valhalla::Options::Action& action,
+                        const map& map,
+                        const std::vector<std::string>& sources,
+                        const std::vector<std::string>& targets,
+                        const std::string& costing,
+                        const std::unordered_map<std::string, std::string>& options = {},
+                        std::shared_ptr<valhalla::baldr::GraphReader> reader = {},
+                        std::string* json = nullptr);
+
 /* Returns the raw_result formatted as a JSON document in the given format.
  *
  * @param raw_result the result of a /route or /match request
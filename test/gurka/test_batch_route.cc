@@ -0,0 +1,120 @@
+#include "gurka.h"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+using namespace valhalla;
+
+class BatchRoute : public ::testing::Test {
+protected:
+  static gurka::map map;
+
+  static void SetUpTestSuite() {
+    const std::string ascii_map = R"(
+      A-----B-----C
+            |
+            D-----E
+    )";
+    const gurka::ways ways = {
+        {"AB", {{"highway", "residential"}}},
+        {"BC", {{"highway", "residential"}}},
+        {"BD", {{"highway", "residential"}}},
+        {"DE", {{"highway", "residential"}}},
+    };
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+    map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_batch_route");
+  }
+
+  // runs the pairs of the sources and targets at the same index
+  static valhalla::Api batch(const std::vector<std::pair<std::string, std::string>>& pairs,
+                             std::string* json = nullptr) {
+    std::vector<std::string> sources, targets;
+    for (const auto& pair : pairs) {
+      sources.push_back(pair.first);
+      targets.push_back(pair.second);
+    }
+    return gurka::do_action(Options::batch_route, map, sources, targets, "auto", {}, nullptr, json);
+  }
+
+  // how many expansions the pairs took
+  static uint64_t expansions(const valhalla::Api& api) {
+    const auto& statistics = api.info().statistics();
+    auto found = std::find_if(statistics.begin(), statistics.end(), [](const auto& stat) {
+      return stat.key() == "batch_route.info.thor.expansions";
+    });
+    return found == statistics.end() ? 0 : found->value();
+  }
+};
+
+gurka::map BatchRoute::map = {};
+
+TEST_F(BatchRoute, routes_match_single_routes) {
+  const std::vector<std::pair<std::string, std::string>> pairs = {
+      {"A", "C"}, {"A", "E"}, {"E", "A"}, {"A", "D"}, {"C", "E"},
+  };
+  std::string json;
+  auto api = batch(pairs, &json);
+  ASSERT_EQ(api.trip().routes_size(), pairs.size());
+
+  for (size_t i = 0; i < pairs.size(); ++i) {
+    ASSERT_EQ(api.trip().routes(i).legs_size(), 1);
+    auto single = gurka::do_action(Options::route, map, {pairs[i].first, pairs[i].second}, "auto");
+    const auto& expected = single.directions().routes(0).legs(0).summary();
+    const auto& actual = api.directions().routes(i).legs(0).summary();
+    EXPECT_NEAR(actual.length(), expected.length(), 0.001) << pairs[i].first << pairs[i].second;
+    EXPECT_NEAR(actual.time(), expected.time(), 0.1) << pairs[i].first << pairs[i].second;
+  }
+
+  // every pair is a trip in the order of the request
+  rapidjson::Document doc;
+  doc.Parse(json.c_str());
+  ASSERT_FALSE(doc.HasParseError());
+  ASSERT_TRUE(doc.HasMember("trips"));
+  EXPECT_EQ(doc["trips"].Size(), pairs.size());
+  EXPECT_FALSE(doc.HasMember("alternates"));
+}
+
+TEST_F(BatchRoute, shared_sources_expand_once) {
+  // the three pairs from A share one expansion, the one from C has its own
+  auto api = batch({{"A", "C"}, {"A", "E"}, {"C", "E"}, {"A", "D"}});
+  ASSERT_EQ(api.trip().routes_size(), 4);
+  for (const auto& route : api.trip().routes()) {
+    EXPECT_EQ(route.legs_size(), 1);
+  }
+  EXPECT_EQ(expansions(api), 2u);
+
+  api = batch({{"E", "A"}, {"E", "B"}, {"E", "C"}});
+  EXPECT_EQ(expansions(api), 1u);
+}
+
+TEST_F(BatchRoute, unpaired_sources_and_targets) {
+  try {
+    gurka::do_action(Options::batch_route, map, {"A", "A"}, {"C", "E", "D"}, "auto");
+    FAIL() << "Expected valhalla_exception_t.";
+  } catch (const valhalla_exception_t& err) { EXPECT_EQ(err.code, 128); }
+}
+
+TEST(BatchRouteLimit, expansion_stops_at_matrix_distance) {
+  // B is close to A as the crow flies but far away by road
+  const std::string ascii_map = R"(
+      A       B
+      E       |
+      |       |
+      |       |
+      C-------D
+  )";
+  const gurka::ways ways = {
+      {"AEC", {{"highway", "residential"}}},
+      {"CD", {{"highway", "residential"}}},
+      {"DB", {{"highway", "residential"}}},
+  };
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_batch_route_limit",
+                               {{"service_limits.auto.max_matrix_distance", "1000"}});
+
+  // the expansion gives up on B before it goes all the way around to it
+  auto api = gurka::do_action(Options::batch_route, map, {"A", "A"}, {"E", "B"}, "auto");
+  ASSERT_EQ(api.trip().routes_size(), 2);
+  EXPECT_EQ(api.trip().routes(0).legs_size(), 1);
+  EXPECT_EQ(api.trip().routes(1).legs_size(), 0);
+}
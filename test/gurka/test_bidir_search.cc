@@ -129,3 +129,149 @@ TEST(StandAlone, failed_search) {
 
   auto result = gurka::do_action(valhalla::Options::route, map, {"A", "F"}, "auto", {});
 }
+
+TEST(StandAlone, time_dependent) {
+  const std::string ascii_map = R"(
+  A---B---C---D
+  |   |   |   |
+  E---F---G---H
+  )";
+  const gurka::ways ways = {{"AB", {{"highway", "residential"}}},
+                            {"BC", {{"highway", "residential"}}},
+                            {"CD", {{"highway", "residential"}}},
+                            {"EF", {{"highway", "primary"}}},
+                            {"FG", {{"highway", "primary"}}},
+                            {"GH", {{"highway", "primary"}}},
+                            {"AE", {{"highway", "residential"}}},
+                            {"BF", {{"highway", "residential"}}},
+                            {"CG", {{"highway", "residential"}}},
+                            {"DH", {{"highway", "residential"}}}};
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, tile_dir);
+
+  // The time dependent mode of bidirectional a* finds the routes the time dependent a* finds
+  for (const auto& type : {"1", "2"}) {
+    const std::unordered_map<std::string, std::string> options = {{"/date_time/type", type},
+                                                                  {"/date_time/value",
+                                                                   "2020-10-30T09:00"}};
+    map.config.put("thor.time_dependent_bidirectional", false);
+    auto expected = gurka::do_action(valhalla::Options::route, map, {"A", "D"}, "auto", options);
+    map.config.put("thor.time_dependent_bidirectional", true);
+    auto result = gurka::do_action(valhalla::Options::route, map, {"A", "D"}, "auto", options);
+
+    EXPECT_EQ(result.trip().routes(0).legs(0).algorithms(0), "bidirectional_a*");
+    gurka::assert::raw::expect_path(result, {"AB", "BC", "CD"});
+    EXPECT_NEAR(result.directions().routes(0).legs(0).summary().time(),
+                expected.directions().routes(0).legs(0).summary().time(), 0.1);
+
+    // the work of the search is part of the statistics of the request
+    const auto& statistics = result.info().statistics();
+    auto settled = std::find_if(statistics.begin(), statistics.end(), [](const auto& stat) {
+      return stat.key() == "route.info.thor.settled_edges";
+    });
+    ASSERT_NE(settled, statistics.end());
+    EXPECT_GT(settled->value(), 0);
+  }
+}
+
+TEST(StandAlone, time_dependent_historical_traffic) {
+  // BC is slow at night and fast during the day, going around it takes longer during the day
+  const std::string ascii_map = R"(
+                           X
+  A------------------------WB-------CD
+  E-----G-----H-----I-----J-----K----F
+        L     M     N     O     P
+  )";
+  const gurka::ways ways = {{"AWB", {{"highway", "residential"}, {"maxspeed", "50"}}},
+                            {"WX", {{"highway", "residential"}, {"maxspeed", "50"}}},
+                            {"BC", {{"highway", "primary"}}},
+                            {"CD", {{"highway", "residential"}, {"maxspeed", "50"}}},
+                            {"AE", {{"highway", "residential"}, {"maxspeed", "50"}}},
+                            {"EGHIJKF", {{"highway", "residential"}, {"maxspeed", "50"}}},
+                            {"FD", {{"highway", "residential"}, {"maxspeed", "50"}}},
+                            {"GL", {{"highway", "residential"}, {"maxspeed", "50"}}},
+                            {"HM", {{"highway", "residential"}, {"maxspeed", "50"}}},
+                            {"IN", {{"highway", "residential"}, {"maxspeed", "50"}}},
+                            {"JO", {{"highway", "residential"}, {"maxspeed", "50"}}},
+                            {"KP", {{"highway", "residential"}, {"maxspeed", "50"}}}};
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/bidir_search_historical");
+
+  // 10 kph at midnight, 78 kph at 9am and 90 kph at noon
+  test::customize_historical_traffic(map.config, [](baldr::DirectedEdge& e) {
+    boost::optional<std::array<float, kBucketsPerWeek>> historical;
+    if (e.classification() == baldr::RoadClass::kPrimary) {
+      historical.emplace();
+      for (size_t i = 0; i < historical->size(); ++i) {
+        (*historical)[i] = 50.f - 40.f * cosf(i * 2.f * midgard::kPi / 288.f);
+      }
+    }
+    return historical;
+  });
+
+  // Costed at midnight speeds the reverse search would not get past BC before the searches meet
+  // on the way around, and the route would go around
+  const std::unordered_map<std::string, std::string> options = {{"/date_time/type", "1"},
+                                                                {"/date_time/value",
+                                                                 "2020-10-30T09:00"}};
+  map.config.put("thor.time_dependent_bidirectional", false);
+  auto expected = gurka::do_action(valhalla::Options::route, map, {"A", "D"}, "auto", options);
+  gurka::assert::raw::expect_path(expected, {"AWB", "AWB", "BC", "CD"});
+  map.config.put("thor.time_dependent_bidirectional", true);
+  auto result = gurka::do_action(valhalla::Options::route, map, {"A", "D"}, "auto", options);
+
+  EXPECT_EQ(result.trip().routes(0).legs(0).algorithms(0), "bidirectional_a*");
+  gurka::assert::raw::expect_path(result, {"AWB", "AWB", "BC", "CD"});
+  EXPECT_NEAR(result.directions().routes(0).legs(0).summary().time(),
+              expected.directions().routes(0).legs(0).summary().time(), 0.1);
+}
+
+TEST(StandAlone, time_dependent_meeting_edge) {
+  // BD is fast at night and slow during the day. The reverse search bounds it by its night time
+  // speed and goes that way while at 9am the best path from the edge where the searches meet, XB,
+  // goes around. The spur keeps the reverse search busy so the forward search gets to XB after
+  // the reverse search but before it goes on to AX
+  const std::string ascii_map = R"(
+  A-----------------------------X-B---------Dabcdefghijklmnopqrstuvwxyz
+                                  |         |
+                                  E---------F
+  )";
+  gurka::ways ways = {{"AX", {{"highway", "residential"}, {"maxspeed", "50"}}},
+                      {"XB", {{"highway", "residential"}, {"maxspeed", "50"}}},
+                      {"BD", {{"highway", "primary"}}},
+                      {"BE", {{"highway", "residential"}, {"maxspeed", "50"}}},
+                      {"EF", {{"highway", "residential"}, {"maxspeed", "50"}}},
+                      {"FD", {{"highway", "residential"}, {"maxspeed", "50"}}}};
+  const std::string spur = "Dabcdefghijklmnopqrstuvwxyz";
+  for (size_t i = 1; i < spur.size(); ++i) {
+    ways[spur.substr(i - 1, 2)] = {{"highway", "residential"}, {"maxspeed", "50"}};
+  }
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/bidir_search_meeting");
+
+  // 90 kph at midnight, 22 kph at 9am and 10 kph at noon
+  test::customize_historical_traffic(map.config, [](baldr::DirectedEdge& e) {
+    boost::optional<std::array<float, kBucketsPerWeek>> historical;
+    if (e.classification() == baldr::RoadClass::kPrimary) {
+      historical.emplace();
+      for (size_t i = 0; i < historical->size(); ++i) {
+        (*historical)[i] = 50.f + 40.f * cosf(i * 2.f * midgard::kPi / 288.f);
+      }
+    }
+    return historical;
+  });
+
+  const std::unordered_map<std::string, std::string> options = {{"/date_time/type", "1"},
+                                                                {"/date_time/value",
+                                                                 "2020-10-30T09:00"}};
+  map.config.put("thor.time_dependent_bidirectional", false);
+  auto expected = gurka::do_action(valhalla::Options::route, map, {"A", "D"}, "auto", options);
+  gurka::assert::raw::expect_path(expected, {"AX", "XB", "BE", "EF", "FD"});
+  map.config.put("thor.time_dependent_bidirectional", true);
+  auto result = gurka::do_action(valhalla::Options::route, map, {"A", "D"}, "auto", options);
+
+  EXPECT_EQ(result.trip().routes(0).legs(0).algorithms(0), "bidirectional_a*");
+  gurka::assert::raw::expect_path(result, {"AX", "XB", "BE", "EF", "FD"});
+  EXPECT_NEAR(result.directions().routes(0).legs(0).summary().time(),
+              expected.directions().routes(0).legs(0).summary().time(), 0.1);
+}
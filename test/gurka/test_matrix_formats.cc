@@ -0,0 +1,138 @@
+#include "gurka.h"
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+using namespace valhalla;
+
+class MatrixFormats : public ::testing::Test {
+protected:
+  static gurka::map map;
+
+  static void SetUpTestSuite() {
+    const std::string ascii_map = R"(
+      A-----B-----C
+            |
+            D-----E
+    )";
+    const gurka::ways ways = {
+        {"AB", {{"highway", "residential"}}}, {"BC", {{"highway", "residential"}}},
+        {"BD", {{"highway", "residential"}}}, {"DE", {{"highway", "residential"}}},
+    };
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+    map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_matrix_formats");
+  }
+
+  // the same matrix in each of the formats
+  static std::string matrix(const std::string& format) {
+    std::unordered_map<std::string, std::string> options;
+    if (!format.empty()) {
+      options["/format"] = format;
+    }
+    std::string output;
+    gurka::do_action(Options::sources_to_targets, map, {"A", "E", "C"}, {"B", "D", "E", "A"}, "auto",
+                     options, nullptr, &output);
+    return output;
+  }
+
+  // the time and distance of each cell from the default json, nan where it is unreachable
+  static std::vector<std::pair<double, double>> expected() {
+    const auto json = matrix("");
+    rapidjson::Document doc;
+    doc.Parse(json.c_str());
+    std::vector<std::pair<double, double>> cells;
+    for (const auto& row : doc["sources_to_targets"].GetArray()) {
+      for (const auto& cell : row.GetArray()) {
+        if (cell["time"].IsNull()) {
+          cells.emplace_back(NAN, NAN);
+        } else {
+          cells.emplace_back(cell["time"].GetDouble(), cell["distance"].GetDouble());
+        }
+      }
+    }
+    return cells;
+  }
+};
+
+gurka::map MatrixFormats::map = {};
+
+TEST_F(MatrixFormats, ndjson_matches_json) {
+  const auto cells = expected();
+  const auto ndjson = matrix("ndjson");
+
+  std::istringstream lines(ndjson);
+  std::string line;
+  ASSERT_TRUE(std::getline(lines, line));
+  rapidjson::Document header;
+  header.Parse(line.c_str());
+  EXPECT_EQ(header["sources"].GetArray().Size(), 3u);
+  EXPECT_EQ(header["targets"].GetArray().Size(), 4u);
+
+  // one line per row, in whatever order the rows were done
+  std::vector<int> row_counts(3, 0);
+  while (std::getline(lines, line)) {
+    rapidjson::Document row;
+    row.Parse(line.c_str());
+    const auto source = row["from_index"].GetUint();
+    ASSERT_LT(source, 3u);
+    ++row_counts[source];
+    const auto& times = row["times"].GetArray();
+    const auto& distances = row["distances"].GetArray();
+    ASSERT_EQ(times.Size(), 4u);
+    ASSERT_EQ(distances.Size(), 4u);
+    for (uint32_t t = 0; t < 4; ++t) {
+      const auto& cell = cells[source * 4 + t];
+      if (std::isnan(cell.first)) {
+        EXPECT_TRUE(times[t].IsNull());
+        EXPECT_TRUE(distances[t].IsNull());
+      } else {
+        EXPECT_EQ(times[t].GetDouble(), cell.first);
+        EXPECT_NEAR(distances[t].GetDouble(), cell.second, 0.001);
+      }
+    }
+  }
+  EXPECT_EQ(row_counts, std::vector<int>(3, 1));
+}
+
+TEST_F(MatrixFormats, binary_matches_json) {
+  const auto cells = expected();
+  const auto binary = matrix("binary");
+
+  // the header and then a record of the source index, the times and the distances per row
+  ASSERT_EQ(binary.size(), 16u + 3 * (4 + 4 * 4 + 4 * 4));
+  auto read = [&binary](size_t offset) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < 4; ++i) {
+      value |= static_cast<uint32_t>(static_cast<uint8_t>(binary[offset + i])) << (8 * i);
+    }
+    return value;
+  };
+  EXPECT_EQ(binary.substr(0, 4), "VMTX");
+  EXPECT_EQ(read(4), 1u);
+  EXPECT_EQ(read(8), 3u);
+  EXPECT_EQ(read(12), 4u);
+
+  std::vector<int> row_counts(3, 0);
+  for (size_t offset = 16; offset < binary.size(); offset += 4 + 4 * 4 + 4 * 4) {
+    const auto source = read(offset);
+    ASSERT_LT(source, 3u);
+    ++row_counts[source];
+    for (uint32_t t = 0; t < 4; ++t) {
+      const auto time = read(offset + 4 + 4 * t);
+      const auto bits = read(offset + 4 + 16 + 4 * t);
+      float distance;
+      std::memcpy(&distance, &bits, sizeof(distance));
+      const auto& cell = cells[source * 4 + t];
+      if (std::isnan(cell.first)) {
+        EXPECT_EQ(time, std::numeric_limits<uint32_t>::max());
+        EXPECT_TRUE(std::isnan(distance));
+      } else {
+        EXPECT_EQ(time, cell.first);
+        EXPECT_NEAR(distance, cell.second, 0.001);
+      }
+    }
+  }
+  EXPECT_EQ(row_counts, std::vector<int>(3, 1));
+}
@@ -221,6 +221,47 @@ TEST(HttpTiles, test_graphreader_multiple_threads) {
   test_graphreader_tile_download(8, 2, 4);
 }
 
+TEST(HttpTiles, test_batch_download) {
+  using namespace baldr;
+
+  TestTileDownloadData params;
+  const auto non_existent_tile_id = params.get_nonexistent_tile_id();
+
+  curl_tile_getter_t tile_getter(1, "", params.is_gzipped_tile);
+  std::vector<std::string> tile_uris;
+  for (const auto& tile_name : params.test_tile_names) {
+    tile_uris.push_back(params.tile_url_base + tile_name + params.request_params);
+  }
+
+  // the same connections should be reused between batches
+  for (int batch = 0; batch < 2; ++batch) {
+    auto results = tile_getter.get_many(tile_uris);
+    ASSERT_EQ(results.size(), tile_uris.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+      if (results[i].status_ == tile_getter_t::status_code_t::SUCCESS) {
+        auto tile = GraphTile::Create(GraphId(), std::move(results[i].bytes_));
+        ASSERT_TRUE(tile);
+        EXPECT_EQ(tile->id(), params.test_tile_ids[i]);
+      } else {
+        EXPECT_EQ(params.test_tile_ids[i], non_existent_tile_id);
+      }
+    }
+  }
+
+  // and the graph tiles come back in the order they were asked for
+  auto tiles = GraphTile::CacheTileURLs(params.full_tile_url_pattern, params.test_tile_ids,
+                                        &tile_getter, "");
+  ASSERT_EQ(tiles.size(), params.test_tile_ids.size());
+  for (size_t i = 0; i < tiles.size(); ++i) {
+    if (params.test_tile_ids[i] != non_existent_tile_id) {
+      ASSERT_TRUE(tiles[i]);
+      EXPECT_EQ(tiles[i]->id(), params.test_tile_ids[i]);
+    } else {
+      EXPECT_FALSE(tiles[i]) << "Expected no tile";
+    }
+  }
+}
+
 TEST(HttpTiles, test_interrupt) {
   using namespace baldr;
 
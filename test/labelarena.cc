@@ -0,0 +1,81 @@
+#include "thor/labelarena.h"
+
+#include <vector>
+
+#include "test.h"
+
+using namespace valhalla::sif;
+using namespace valhalla::thor;
+
+namespace {
+
+TEST(LabelArena, ReusesStorage) {
+  LabelArena arena;
+  std::vector<BDEdgeLabel> labels;
+  arena.Acquire(labels, 3000);
+  EXPECT_EQ(labels.capacity(), 4096);
+  EXPECT_EQ(arena.stats().allocated, 1);
+
+  // a long search grows the labels, they come back without being shrunk
+  labels.resize(100000);
+  const auto* storage = labels.data();
+  const auto capacity = labels.capacity();
+  arena.Release(labels);
+  EXPECT_EQ(labels.capacity(), 0);
+  EXPECT_EQ(arena.stats().retained_bytes, capacity * sizeof(BDEdgeLabel));
+
+  // a short search after it gets the same storage
+  std::vector<BDEdgeLabel> other;
+  arena.Acquire(other, 3000);
+  EXPECT_EQ(other.data(), storage);
+  EXPECT_TRUE(other.empty());
+  EXPECT_EQ(arena.stats().reused, 1);
+  EXPECT_EQ(arena.stats().retained_bytes, 0);
+  EXPECT_EQ(arena.stats().peak_bytes, capacity * sizeof(BDEdgeLabel));
+
+  // a vector that is large enough already is left alone and so are the labels of other types
+  arena.Acquire(other, 50000);
+  EXPECT_EQ(other.data(), storage);
+  std::vector<MMEdgeLabel> mm_labels;
+  arena.Acquire(mm_labels, 3000);
+  EXPECT_EQ(arena.stats().allocated, 2);
+}
+
+TEST(LabelArena, PicksSizeClasses) {
+  LabelArena arena;
+  std::vector<EdgeLabel> small, large;
+  arena.Acquire(small, 1000);
+  arena.Acquire(large, 20000);
+  const auto* small_storage = small.data();
+  const auto* large_storage = large.data();
+  arena.Release(large);
+  arena.Release(small);
+
+  // the smallest storage that is large enough is handed out
+  std::vector<EdgeLabel> labels;
+  arena.Acquire(labels, 500);
+  EXPECT_EQ(labels.data(), small_storage);
+  std::vector<EdgeLabel> more_labels;
+  arena.Acquire(more_labels, 10000);
+  EXPECT_EQ(more_labels.data(), large_storage);
+  EXPECT_EQ(arena.stats().reused, 2);
+}
+
+TEST(LabelArena, StaysWithinLimit) {
+  LabelArena arena(10000 * sizeof(BDEdgeLabel));
+  std::vector<BDEdgeLabel> first, second;
+  arena.Acquire(first, 8000);
+  arena.Acquire(second, 8000);
+  arena.Release(first);
+  arena.Release(second);
+  EXPECT_EQ(arena.stats().retained_bytes, 8192 * sizeof(BDEdgeLabel));
+  EXPECT_EQ(arena.stats().freed, 1);
+  EXPECT_EQ(second.capacity(), 0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,191 @@
+#include "test.h"
+
+#include "baldr/graphreader.h"
+#include "baldr/landmarks.h"
+#include "baldr/rapidjson_utils.h"
+#include "filesystem.h"
+#include "mjolnir/landmarkbuilder.h"
+#include "sif/costfactory.h"
+#include "tyr/actor.h"
+
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+const std::string kLandmarkDir = "test/data/utrecht_landmarks";
+const std::string kStaleLandmarkDir = "test/data/utrecht_stale_landmarks";
+
+boost::property_tree::ptree make_config(bool with_landmarks,
+                                        const std::string& landmark_dir = kLandmarkDir) {
+  auto conf = test::make_config("test/data/utrecht_tiles",
+                                {{"mjolnir.landmark_dir", with_landmarks ? landmark_dir : ""}});
+  test::put_costings(conf, "mjolnir.landmark_costings", {"auto"});
+  conf.put("mjolnir.landmark_count", 4);
+  return conf;
+}
+
+const auto& kLocations = test::utrecht_routes();
+
+// The distances as if every tile was rebuilt with a node less after they were computed
+struct stale_landmarks_t : public LandmarkDistances {
+  stale_landmarks_t(const LandmarkDistances& landmarks) : LandmarkDistances(landmarks) {
+    for (auto& tile : tiles_) {
+      tile.node_count -= tile.node_count > 0;
+    }
+  }
+};
+
+class LandmarkTest : public ::testing::Test {
+protected:
+  static void SetUpTestSuite() {
+    std::remove(LandmarkDistances::FileName(kLandmarkDir, "auto").c_str());
+    mjolnir::LandmarkBuilder::Build(make_config(true));
+  }
+};
+
+TEST_F(LandmarkTest, costs_are_consistent) {
+  auto landmarks = LandmarkDistances::Load(LandmarkDistances::FileName(kLandmarkDir, "auto"));
+  ASSERT_GT(landmarks->landmark_count(), 0);
+  const auto count = landmarks->landmark_count();
+
+  GraphReader reader(make_config(true).get_child("mjolnir"));
+  auto index = [&landmarks, &reader](const GraphId& node) {
+    auto tile = reader.GetGraphTile(node);
+    auto offset = landmarks->tile_offset(node.Tile_Base(), tile->header()->nodecount());
+    EXPECT_NE(offset, LandmarkDistances::kInvalidLandmarkIndex);
+    return offset + node.id();
+  };
+
+  // the landmarks are where their costs start
+  for (const auto& landmark : landmarks->landmarks()) {
+    auto i = &landmark - landmarks->landmarks().data();
+    EXPECT_EQ(landmarks->from_landmarks(index(landmark))[i], 0.f);
+    EXPECT_EQ(landmarks->to_landmarks(index(landmark))[i], 0.f);
+  }
+
+  // no edge can be cheaper than the difference in cost of its nodes
+  rapidjson::Document doc;
+  doc.SetObject();
+  CostingOptions options;
+  ParseCostingOptions(doc, "/costing_options/auto", &options, Costing::auto_);
+  EXPECT_EQ(landmarks->options(), options.SerializeAsString());
+  auto costing = CostFactory().Create(options);
+  size_t edges = 0;
+  for (const auto& tile_id : reader.GetTileSet()) {
+    auto tile = reader.GetGraphTile(tile_id);
+    for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
+      const auto* edge = tile->directededge(i);
+      if (edge->is_shortcut() || edge->IsTransitLine() ||
+          !costing->Allowed(edge, tile, kDisallowShortcut)) {
+        continue;
+      }
+      auto start_node = reader.edge_startnode(GraphId(tile_id.tileid(), tile_id.level(), i));
+      if (!start_node.Is_Valid()) {
+        continue;
+      }
+      uint8_t flow_sources;
+      auto cost = costing->EdgeCost(edge, tile, kInvalidSecondsOfWeek, flow_sources).cost;
+      auto start = index(start_node);
+      auto end = index(edge->endnode());
+      for (uint32_t l = 0; l < count; ++l) {
+        auto from_start = landmarks->from_landmarks(start)[l];
+        auto to_end = landmarks->to_landmarks(end)[l];
+        if (from_start != kUnreachableLandmark) {
+          ASSERT_LE(landmarks->from_landmarks(end)[l], from_start + cost + 0.01f);
+        }
+        if (to_end != kUnreachableLandmark) {
+          ASSERT_LE(landmarks->to_landmarks(start)[l], to_end + cost + 0.01f);
+        }
+      }
+      ++edges;
+    }
+  }
+  EXPECT_GT(edges, 0);
+}
+
+TEST_F(LandmarkTest, routes_match_distance_heuristic) {
+  tyr::actor_t distance(make_config(false), true);
+  tyr::actor_t landmarks(make_config(true), true);
+
+  for (const auto& locations : kLocations) {
+    auto request = test::route_request(locations);
+    auto expected = test::route_summary(distance, request);
+    auto actual = test::route_summary(landmarks, request);
+
+    // both heuristics are lower bounds but the order of expansion changes which hierarchy limits
+    // kick in, so the routes can differ a tiny bit
+    EXPECT_NEAR(actual.time, expected.time, expected.time * 0.01) << request;
+  }
+}
+
+TEST_F(LandmarkTest, timed_routes_do_without_landmarks) {
+  tyr::actor_t distance(make_config(false), true);
+  tyr::actor_t landmarks(make_config(true), true);
+
+  // the landmark costs are not lower bounds for the speeds at a given time so these routes dont
+  // use them and come out exactly the same as with the distance heuristic
+  const std::vector<std::string> date_times = {
+      R"("date_time":{"type":1,"value":"2021-06-01T03:00"})",
+      R"("date_time":{"type":2,"value":"2021-06-01T03:00"})",
+  };
+  for (const auto& locations : kLocations) {
+    for (const auto& date_time : date_times) {
+      auto request = test::route_request(locations, "," + date_time);
+      auto expected = test::route_summary(distance, request);
+      auto actual = test::route_summary(landmarks, request);
+      EXPECT_EQ(actual.time, expected.time) << request;
+      EXPECT_EQ(actual.length, expected.length) << request;
+    }
+  }
+}
+
+TEST_F(LandmarkTest, stale_tiles_are_not_covered) {
+  auto landmarks = LandmarkDistances::Load(LandmarkDistances::FileName(kLandmarkDir, "auto"));
+  filesystem::create_directories(kStaleLandmarkDir);
+  const auto stale_file = LandmarkDistances::FileName(kStaleLandmarkDir, "auto");
+  stale_landmarks_t(*landmarks).Save(stale_file);
+  auto stale = LandmarkDistances::Load(stale_file);
+
+  // the node counts go through the file and a tile whose count differs is not covered
+  GraphReader reader(make_config(true).get_child("mjolnir"));
+  for (const auto& landmark : landmarks->landmarks()) {
+    auto node_count = reader.GetGraphTile(landmark)->header()->nodecount();
+    EXPECT_NE(landmarks->tile_offset(landmark.Tile_Base(), node_count),
+              LandmarkDistances::kInvalidLandmarkIndex);
+    EXPECT_EQ(stale->tile_offset(landmark.Tile_Base(), node_count),
+              LandmarkDistances::kInvalidLandmarkIndex);
+    EXPECT_EQ(stale->tile_offset(landmark.Tile_Base(), node_count - 1),
+              landmarks->tile_offset(landmark.Tile_Base(), node_count));
+  }
+
+  // without any node covered the routes are exactly the ones of the distance heuristic
+  tyr::actor_t distance(make_config(false), true);
+  tyr::actor_t stale_landmarks(make_config(true, kStaleLandmarkDir), true);
+  for (const auto& locations : kLocations) {
+    auto request = test::route_request(locations);
+    auto expected = test::route_summary(distance, request);
+    auto actual = test::route_summary(stale_landmarks, request);
+    EXPECT_EQ(actual.time, expected.time) << request;
+    EXPECT_EQ(actual.length, expected.length) << request;
+  }
+}
+
+TEST(LandmarkDistances, tiles_must_fit_the_distances) {
+  // one landmark and three nodes, the second tile claims more nodes than there are
+  auto make = [](uint32_t node_count) {
+    return LandmarkDistances({GraphId(1, 2, 0)},
+                             {{GraphId(1, 2, 0), 0, 2}, {GraphId(2, 2, 0), 2, node_count}},
+                             std::vector<float>(3 * 2, 0.f), "");
+  };
+  EXPECT_NO_THROW(make(1));
+  EXPECT_THROW(make(2), std::runtime_error);
+}
+
+} // namespace
@@ -214,6 +214,38 @@ bool within_tolerance(const uint32_t v1, const uint32_t v2) {
   return (v1 > v2) ? v1 - v2 <= kThreshold : v2 - v1 <= kThreshold;
 }
 
+// Correlates the locations of the request and scores their candidates the way thor would
+Api make_matrix_request(const std::string& json) {
+  loki_worker_t loki_worker(config);
+  Api request;
+  ParseApi(json, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  adjust_scores(*request.mutable_options());
+  return request;
+}
+
+sif::mode_costing_t make_mode_costing(const Api& request) {
+  sif::mode_costing_t mode_costing;
+  mode_costing[0] = CreateSimpleCost(
+      request.options().costing_options(static_cast<int>(request.options().costing())));
+  return mode_costing;
+}
+
+void expect_answers(const std::vector<TimeDistance>& results,
+                    const std::vector<TimeDistance>& answers,
+                    const std::string& algorithm) {
+  ASSERT_EQ(results.size(), answers.size());
+  for (uint32_t i = 0; i < results.size(); ++i) {
+    EXPECT_NEAR(results[i].dist, answers[i].dist, kThreshold)
+        << "result " + std::to_string(i) + "'s distance is not close enough" +
+               " to expected value for " + algorithm;
+
+    EXPECT_NEAR(results[i].time, answers[i].time, kThreshold)
+        << "result " + std::to_string(i) + "'s time is not close enough" +
+               " to expected value for " + algorithm;
+  }
+}
+
 TEST(Matrix, test_matrix) {
   loki_worker_t loki_worker(config);
 
@@ -256,6 +288,140 @@ TEST(Matrix, test_matrix) {
   }
 }
 
+TEST(Matrix, test_parallel_costmatrix) {
+  auto request = make_matrix_request(test_request);
+  GraphReader reader(config.get_child("mjolnir"));
+  auto mode_costing = make_mode_costing(request);
+
+  // the searches run on 4 threads and find the same connections
+  std::vector<std::shared_ptr<GraphReader>> readers;
+  for (int i = 0; i < 3; ++i) {
+    readers.push_back(std::make_shared<GraphReader>(config.get_child("mjolnir")));
+  }
+  CostMatrix cost_matrix;
+  cost_matrix.set_readers(readers);
+  std::vector<TimeDistance> results =
+      cost_matrix.SourceToTarget(request.options().sources(), request.options().targets(), reader,
+                                 mode_costing, TravelMode::kDrive, 400000.0);
+  expect_answers(results, matrix_answers, "the parallel CostMatrix");
+}
+
+TEST(Matrix, test_costmatrix_rows) {
+  auto request = make_matrix_request(test_request);
+  GraphReader reader(config.get_child("mjolnir"));
+  auto mode_costing = make_mode_costing(request);
+
+  // every row comes through the callback once and the matrix is not returned on top of them
+  const size_t target_count = request.options().targets_size();
+  std::vector<TimeDistance> rows(matrix_answers.size());
+  std::vector<int> row_counts(request.options().sources_size(), 0);
+  auto row_callback = [&](const uint32_t source_index, const std::vector<TimeDistance>& row) {
+    ASSERT_EQ(row.size(), target_count);
+    std::copy(row.begin(), row.end(), rows.begin() + source_index * target_count);
+    ++row_counts[source_index];
+  };
+  CostMatrix cost_matrix;
+  std::vector<TimeDistance> results =
+      cost_matrix.SourceToTarget(request.options().sources(), request.options().targets(), reader,
+                                 mode_costing, TravelMode::kDrive, 400000.0, row_callback);
+  EXPECT_TRUE(results.empty());
+  for (auto count : row_counts) {
+    EXPECT_EQ(count, 1);
+  }
+  expect_answers(rows, matrix_answers, "the CostMatrix rows");
+}
+
+TEST(Matrix, test_timedistancematrix_many_to_one_rows) {
+  // with more sources than targets the searches run backwards from each target, so the columns
+  // have to be transposed into rows
+  auto request = make_matrix_request(test_request);
+  request.mutable_options()->mutable_targets()->RemoveLast();
+  GraphReader reader(config.get_child("mjolnir"));
+  auto mode_costing = make_mode_costing(request);
+
+  const size_t source_count = request.options().sources_size();
+  const size_t target_count = request.options().targets_size();
+  ASSERT_GT(source_count, target_count);
+  std::vector<TimeDistance> answers;
+  for (size_t i = 0; i < source_count; ++i) {
+    auto row = matrix_answers.begin() + i * (target_count + 1);
+    answers.insert(answers.end(), row, row + target_count);
+  }
+
+  std::vector<TimeDistance> rows(answers.size());
+  std::vector<int> row_counts(source_count, 0);
+  auto row_callback = [&](const uint32_t source_index, const std::vector<TimeDistance>& row) {
+    ASSERT_EQ(row.size(), target_count);
+    std::copy(row.begin(), row.end(), rows.begin() + source_index * target_count);
+    ++row_counts[source_index];
+  };
+  TimeDistanceMatrix timedist_matrix;
+  std::vector<TimeDistance> results =
+      timedist_matrix.SourceToTarget(request.options().sources(), request.options().targets(),
+                                     reader, mode_costing, TravelMode::kDrive, 400000.0,
+                                     row_callback);
+  EXPECT_TRUE(results.empty());
+  for (auto count : row_counts) {
+    EXPECT_EQ(count, 1);
+  }
+  expect_answers(rows, answers, "the TimeDistMatrix rows");
+}
+
+// Exposes the destinations of the time distance matrix
+struct test_timedistancematrix_t : public TimeDistanceMatrix {
+  using TimeDistanceMatrix::Destinations;
+};
+
+TEST(Matrix, test_timedistancematrix_destinations) {
+  // more than a few vectors worth of destinations, settled or not and with a path or not
+  test_timedistancematrix_t::Destinations destinations;
+  for (uint32_t i = 0; i < 37; ++i) {
+    destinations.add();
+    destinations.thresholds[i] = 10.f + i % 4;
+    destinations.costs[i] = i % 3 == 0 ? kMaxCost : 100.f + i;
+    destinations.settled[i] = i % 5 == 0;
+  }
+
+  // the sweeps match a plain loop over the destinations
+  const auto check = [&destinations](const float cost) {
+    uint32_t unfound = 0, settle = 0;
+    float max_bound = 0.f;
+    std::vector<uint8_t> settled = destinations.settled;
+    for (size_t i = 0; i < destinations.size(); ++i) {
+      if (destinations.settled[i]) {
+        continue;
+      }
+      if (destinations.costs[i] == kMaxCost) {
+        ++unfound;
+        continue;
+      }
+      const float bound = destinations.costs[i] + destinations.thresholds[i];
+      max_bound = std::max(max_bound, bound);
+      if (bound < cost) {
+        settled[i] = 1;
+        ++settle;
+      }
+    }
+    EXPECT_EQ(destinations.unfound(), unfound);
+    EXPECT_EQ(destinations.max_bound(), max_bound);
+    EXPECT_EQ(destinations.settle(cost), settle);
+    EXPECT_EQ(destinations.settled, settled);
+    return settle;
+  };
+  EXPECT_EQ(check(0.f), 0u);
+  EXPECT_GT(check(125.f), 0u);
+  EXPECT_EQ(check(125.f), 0u);
+
+  // once every destination has a path the highest bound is the cost threshold
+  for (size_t i = 0; i < destinations.size(); ++i) {
+    destinations.costs[i] = std::min(destinations.costs[i], 200.f);
+  }
+  EXPECT_EQ(destinations.unfound(), 0u);
+  EXPECT_EQ(destinations.max_bound(), 213.f);
+  EXPECT_GT(check(1000.f), 0u);
+  EXPECT_EQ(destinations.max_bound(), 0.f);
+}
+
 // TODO: it was commented before. Why?
 TEST(Matrix, DISABLED_test_matrix_osrm) {
   loki_worker_t loki_worker(config);
@@ -254,6 +254,20 @@ TEST(PredictedSpeeds, test_compress_decompress_accuracy) {
   EXPECT_LE(max_diff, 2.f) << "Low decompression accuracy"; // <= 2 KPH
 }
 
+TEST(PredictedSpeeds, test_max_speed_bucket) {
+  // a slow night and a fast afternoon every day
+  std::array<float, kBucketsPerWeek> speeds;
+  for (uint32_t i = 0; i < kBucketsPerWeek; ++i)
+    speeds[i] = 50.f - 40.f * cosf(i * 2.f * kPi / 288.f);
+  auto compressed_speeds = compress_speed_buckets(speeds.data());
+
+  // no bucket is faster than the bound which is not far off the fastest
+  float max_speed = max_speed_bucket(compressed_speeds.data());
+  for (uint32_t i = 0; i < kBucketsPerWeek; ++i)
+    ASSERT_LE(decompress_speed_bucket(compressed_speeds.data(), i), max_speed);
+  EXPECT_LE(max_speed, 100.f);
+}
+
 struct EncoderDecoderTest : public ::testing::Test {
   EncoderDecoderTest() {
     // fill in coefficients
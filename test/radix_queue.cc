@@ -0,0 +1,96 @@
+#include "baldr/radix_queue.h"
+#include "baldr/double_bucket_queue.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "test.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+struct simple_label {
+  float c;
+  float sortcost() const {
+    return c;
+  }
+};
+
+TEST(RadixQueue, TestInvalidConstruction) {
+  std::vector<simple_label> edgelabels;
+  EXPECT_THROW(RadixQueue<simple_label> adjlist(0, 0, &edgelabels), std::runtime_error);
+}
+
+TEST(RadixQueue, TestAddRemove) {
+  std::vector<simple_label> edgelabels = {{67},  {325}, {25},  {466},   {1000}, {100005},
+                                          {758}, {167}, {258}, {16442}, {278},  {111111000}};
+  RadixQueue<simple_label> adjlist(0, 1, &edgelabels);
+  for (uint32_t i = 0; i < edgelabels.size(); ++i) {
+    adjlist.add(i);
+  }
+
+  std::vector<float> popped;
+  for (auto label = adjlist.pop(); label != kInvalidLabel; label = adjlist.pop()) {
+    popped.push_back(edgelabels[label].c);
+  }
+  EXPECT_EQ(popped.size(), edgelabels.size());
+  EXPECT_TRUE(std::is_sorted(popped.begin(), popped.end()));
+
+  // cleared queues are empty and can be used again
+  adjlist.add(3);
+  adjlist.clear();
+  EXPECT_EQ(adjlist.pop(), kInvalidLabel);
+  adjlist.add(5);
+  EXPECT_EQ(adjlist.pop(), 5);
+}
+
+TEST(RadixQueue, TestMatchesDoubleBucketQueue) {
+  // a dijkstra like expansion, each popped label adds a few more costing at least as much, some
+  // labels get decreased. both queues pop labels in the same order of their bucket.
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> increment(0, 5000);
+  std::vector<simple_label> buckets_labels, radix_labels;
+  DoubleBucketQueue<simple_label> buckets(0, 1000, 10, &buckets_labels);
+  RadixQueue<simple_label> radix(0, 10, &radix_labels);
+  auto add = [&](float cost) {
+    buckets_labels.push_back({cost});
+    radix_labels.push_back({cost});
+    buckets.add(buckets_labels.size() - 1);
+    radix.add(radix_labels.size() - 1);
+  };
+  add(0);
+
+  std::vector<uint32_t> radix_keys, bucket_keys;
+  for (size_t i = 0; i < 20000; ++i) {
+    auto b = buckets.pop();
+    auto r = radix.pop();
+    ASSERT_EQ(b == kInvalidLabel, r == kInvalidLabel);
+    if (b == kInvalidLabel) {
+      break;
+    }
+    bucket_keys.push_back(static_cast<uint32_t>(buckets_labels[b].c / 10));
+    radix_keys.push_back(static_cast<uint32_t>(radix_labels[r].c / 10));
+    const float cost = radix_labels[r].c;
+    for (int j = 0; j < 3 && radix_labels.size() < 30000; ++j) {
+      add(cost + increment(gen));
+    }
+    const auto decreased = radix_labels.size() - 1;
+    if (i % 5 == 0 && radix_labels[decreased].c > cost + 100) {
+      buckets.decrease(decreased, cost + 100);
+      radix.decrease(decreased, cost + 100);
+      buckets_labels[decreased].c = radix_labels[decreased].c = cost + 100;
+    }
+  }
+  EXPECT_EQ(radix_keys, bucket_keys);
+  EXPECT_TRUE(std::is_sorted(radix_keys.begin(), radix_keys.end()));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
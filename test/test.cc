@@ -6,6 +6,7 @@
 #include "baldr/rapidjson_utils.h"
 #include "baldr/traffictile.h"
 #include "mjolnir/graphtilebuilder.h"
+#include "tyr/actor.h"
 
 #include <cmath>
 #include <fstream>
@@ -145,7 +146,8 @@ boost::property_tree::ptree make_config(const std::string& path_prefix,
           "transit_available",
           "expansion",
           "centroid",
-          "status"
+          "status",
+          "batch_route"
         ],
         "logging": {
           "color": false,
@@ -410,6 +412,43 @@ boost::property_tree::ptree make_config(const std::string& path_prefix,
   return pt;
 }
 
+void put_costings(boost::property_tree::ptree& config,
+                  const std::string& key,
+                  const std::vector<std::string>& costings) {
+  boost::property_tree::ptree list;
+  for (const auto& name : costings) {
+    boost::property_tree::ptree costing;
+    costing.put_value(name);
+    list.push_back(std::make_pair("", costing));
+  }
+  config.put_child(key, list);
+}
+
+const std::vector<location_pair_t>& utrecht_routes() {
+  static const std::vector<location_pair_t> routes = {
+      {R"({"lat":52.0764279,"lon":5.0323097})", R"({"lat":52.0763011,"lon":5.1574637})"},
+      {R"({"lat":52.048267,"lon":5.074825})", R"({"lat":52.0792731,"lon":5.1343818})"},
+      {R"({"lat":52.0607180,"lon":5.0950566})", R"({"lat":52.0785070,"lon":5.110835})"},
+      {R"({"lat":52.072534,"lon":5.125980})", R"({"lat":52.0630834,"lon":5.1037227})"},
+  };
+  return routes;
+}
+
+std::string route_request(const location_pair_t& locations, const std::string& extra) {
+  return R"({"costing":"auto","locations":[)" + locations.first + "," + locations.second + "]" +
+         extra + "}";
+}
+
+route_summary_t route_summary(valhalla::tyr::actor_t& actor, const std::string& request) {
+  rapidjson::Document route;
+  route.Parse(actor.route(request));
+  if (route.HasParseError()) {
+    throw std::runtime_error("Failed to parse the route of " + request);
+  }
+  return {rapidjson::get<double>(route, "/trip/summary/time"),
+          rapidjson::get<double>(route, "/trip/summary/length")};
+}
+
 std::shared_ptr<valhalla::baldr::GraphReader>
 make_clean_graphreader(const boost::property_tree::ptree& mjolnir_conf) {
 
@@ -13,6 +13,8 @@
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 #ifndef _MSC_VER
 #include <sys/mman.h>
 #endif
@@ -24,6 +26,12 @@
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/property_tree/ptree.hpp>
 
+namespace valhalla {
+namespace tyr {
+class actor_t;
+}
+} // namespace valhalla
+
 namespace test {
 
 // Return a random number inside [0, 1)
@@ -53,6 +61,25 @@ make_config(const std::string& path_prefix,
             const std::unordered_map<std::string, std::string>& overrides = {},
             const std::unordered_set<std::string>& removes = {});
 
+// Sets the costings, eg mjolnir.landmark_costings, to a json list of the given costing names
+void put_costings(boost::property_tree::ptree& config,
+                  const std::string& key,
+                  const std::vector<std::string>& costings);
+
+// Origin and destination json locations of a few routes across the utrecht tiles
+using location_pair_t = std::pair<std::string, std::string>;
+const std::vector<location_pair_t>& utrecht_routes();
+
+// An auto route request between the pair of locations, extra is appended to the json object
+std::string route_request(const location_pair_t& locations, const std::string& extra = "");
+
+// The time and length of the trip summary of a route, throws if the route fails
+struct route_summary_t {
+  double time;
+  double length;
+};
+route_summary_t route_summary(valhalla::tyr::actor_t& actor, const std::string& request);
+
 /**
  * Generate a new GraphReader that doesn't re-use a previously
  * statically initizalized tile_extract member variable.
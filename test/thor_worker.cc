@@ -120,6 +120,47 @@ TEST(ThorWorker, test_linear_references) {
   }
 }
 
+TEST(ThorWorker, test_parallel_bidirectional) {
+  auto parallel_conf = test::make_config("test/data/utrecht_tiles",
+                                         {{"thor.parallel_bidirectional", "true"},
+                                          {"thor.parallel_bidirectional_min_distance", "0"}});
+  tyr::actor_t serial(conf, true);
+  tyr::actor_t parallel(parallel_conf, true);
+  // these costings have no hierarchy limits so both searches settle on the optimal route
+  const std::vector<std::string> requests = {
+      R"({"costing":"pedestrian","locations":[{"lat":52.0607180,"lon":5.0950566},
+          {"lat":52.0785070,"lon":5.110835}]})",
+      R"({"costing":"pedestrian","locations":[{"lat":52.072534,"lon":5.125980},
+          {"lat":52.0630834,"lon":5.1037227}]})",
+      R"({"costing":"bicycle","locations":[{"lat":52.048267,"lon":5.074825},
+          {"lat":52.0792731,"lon":5.1343818}]})",
+  };
+  auto parallel_searches = [](const Api& api) {
+    const auto& statistics = api.info().statistics();
+    auto stat = std::find_if(statistics.begin(), statistics.end(), [](const Statistic& stat) {
+      return stat.key() == "route.info.thor.parallel_searches";
+    });
+    EXPECT_NE(stat, statistics.end());
+    return stat == statistics.end() ? -1.0 : stat->value();
+  };
+  for (const auto& request : requests) {
+    Api serial_api, parallel_api;
+    auto expected = test::json_to_pt(serial.route(request, nullptr, &serial_api));
+    auto actual = test::json_to_pt(parallel.route(request, nullptr, &parallel_api));
+    // only the second one ran its directions on separate threads, it didnt fall back
+    EXPECT_EQ(parallel_searches(serial_api), 0) << request;
+    EXPECT_EQ(parallel_searches(parallel_api), 1) << request;
+    EXPECT_EQ(actual.get<double>("trip.summary.time"), expected.get<double>("trip.summary.time"))
+        << request;
+    EXPECT_EQ(actual.get<double>("trip.summary.length"),
+              expected.get<double>("trip.summary.length"))
+        << request;
+    EXPECT_EQ(actual.get<std::string>("trip.legs..shape"),
+              expected.get<std::string>("trip.legs..shape"))
+        << request;
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
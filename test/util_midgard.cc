@@ -3,7 +3,9 @@
 #include "midgard/encoded.h"
 #include "midgard/polyline2.h"
 #include "midgard/sequence.h"
+#include "midgard/threads.h"
 #include "midgard/util.h"
+#include <atomic>
 #include <cmath>
 #include <cstdlib>
 #include <random>
@@ -764,6 +766,25 @@ TEST(UtilMidgard, PolygonArea) {
   }
 }
 
+TEST(UtilMidgard, RunThreads) {
+  // every thread runs once with its own index
+  std::vector<int> runs(4, 0);
+  run_threads(runs.size(), [&](uint32_t i) { runs[i]++; });
+  EXPECT_EQ(runs, std::vector<int>(4, 1));
+
+  // the others finish before the failure of one is rethrown
+  std::atomic<int> finished(0);
+  EXPECT_THROW(run_threads(4,
+                           [&](uint32_t i) {
+                             if (i == 2) {
+                               throw std::runtime_error("failed");
+                             }
+                             finished++;
+                           }),
+               std::runtime_error);
+  EXPECT_EQ(finished, 3);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <valhalla/baldr/graphid.h>
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+// Marks a rank, arc or input edge which does not exist
+constexpr uint32_t kInvalidContractionIndex = std::numeric_limits<uint32_t>::max();
+
+/**
+ * The metric independent part of a customizable contraction hierarchy (CCH) over the routable
+ * graph of all non transit hierarchy levels. The nodes of all levels which are connected by
+ * transitions are merged into a single hierarchy node and every node has a rank in a nested
+ * dissection order. The hierarchy is the chordal supergraph of the routing graph under that order
+ * and is stored as the upward arcs of each node, from the node to the higher ranked neighbours,
+ * sorted by the rank of the higher node. Because it doesnt depend on a metric the same hierarchy
+ * can be customized with the weights of any costing.
+ *
+ * Every directed edge of the graph maps onto the arc between its two nodes, either in the upward
+ * direction (from the lower to the higher rank) or the downward direction.
+ */
+class ContractionHierarchy {
+public:
+  // A directed edge of the graph and the arc it maps onto
+  struct input_edge_t {
+    GraphId edgeid;
+    uint32_t arc;
+    uint32_t upward; // 1 if the edge goes from the lower to the higher ranked node of the arc
+  };
+
+  /**
+   * Constructs the hierarchy from its parts, this is used by the builder
+   * @param node_ranks    the graph node ids and the rank of the hierarchy node they were merged
+   *                      into, sorted by graph node id
+   * @param first_arcs    for each rank the index of its first upward arc, plus one past the end
+   * @param arc_heads     for each arc the rank of its higher node
+   * @param input_edges   the directed edges and the arcs they map onto, sorted by edge id
+   */
+  ContractionHierarchy(std::vector<std::pair<GraphId, uint32_t>>&& node_ranks,
+                       std::vector<uint32_t>&& first_arcs,
+                       std::vector<uint32_t>&& arc_heads,
+                       std::vector<input_edge_t>&& input_edges);
+
+  /**
+   * Loads a hierarchy written by Save
+   * @param file  the file to read
+   * @return the hierarchy, throws if the file cannot be read or is not a valid hierarchy
+   */
+  static std::shared_ptr<const ContractionHierarchy> Load(const std::string& file);
+
+  /**
+   * Writes the hierarchy to a file
+   * @param file  the file to write
+   */
+  void Save(const std::string& file) const;
+
+  /**
+   * @return the number of hierarchy nodes
+   */
+  uint32_t node_count() const {
+    return static_cast<uint32_t>(parents_.size());
+  }
+
+  /**
+   * @return the number of arcs
+   */
+  uint32_t arc_count() const {
+    return static_cast<uint32_t>(arc_heads_.size());
+  }
+
+  /**
+   * @param node  graph node id on any non transit level
+   * @return the rank of the hierarchy node or kInvalidContractionIndex if its not part of it
+   */
+  uint32_t rank(const GraphId& node) const;
+
+  /**
+   * @param rank  the rank of the node
+   * @return the parent of the node in the elimination tree which is its lowest ranked upward
+   *         neighbour or kInvalidContractionIndex for the root of a component
+   */
+  uint32_t parent(const uint32_t rank) const {
+    return parents_[rank];
+  }
+
+  /**
+   * @param rank  the rank of the node
+   * @return the index of the first upward arc of the node
+   */
+  uint32_t first_arc(const uint32_t rank) const {
+    return first_arcs_[rank];
+  }
+
+  /**
+   * @param rank  the rank of the node
+   * @return one past the index of the last upward arc of the node
+   */
+  uint32_t last_arc(const uint32_t rank) const {
+    return first_arcs_[rank + 1];
+  }
+
+  /**
+   * @param arc  the arc
+   * @return the rank of the higher node of the arc
+   */
+  uint32_t head(const uint32_t arc) const {
+    return arc_heads_[arc];
+  }
+
+  /**
+   * @param arc  the arc
+   * @return the rank of the lower node of the arc
+   */
+  uint32_t tail(const uint32_t arc) const {
+    return arc_tails_[arc];
+  }
+
+  /**
+   * @param rank  the rank of the node
+   * @return the index of the first downward arc of the node, see down_arc
+   */
+  uint32_t first_down_arc(const uint32_t rank) const {
+    return first_down_arcs_[rank];
+  }
+
+  /**
+   * @param rank  the rank of the node
+   * @return one past the index of the last downward arc of the node
+   */
+  uint32_t last_down_arc(const uint32_t rank) const {
+    return first_down_arcs_[rank + 1];
+  }
+
+  /**
+   * The arcs from lower ranked neighbours of each node are grouped by node and sorted by the rank
+   * of their lower node
+   * @param index  between first_down_arc and last_down_arc of a node
+   * @return the arc
+   */
+  uint32_t down_arc(const uint32_t index) const {
+    return down_arcs_[index];
+  }
+
+  /**
+   * @return the height of the elimination tree, the number of levels of nodes
+   */
+  uint32_t level_count() const {
+    return static_cast<uint32_t>(first_level_nodes_.size() - 1);
+  }
+
+  /**
+   * The nodes are grouped by their height in the elimination tree. All lower neighbours of a node
+   * are its descendants so they are on lower levels, which means that the nodes of one level can
+   * be customized independently of each other once the levels below are done.
+   * @param level  the level
+   * @return the index of the first node of the level, see level_node
+   */
+  uint32_t first_level_node(const uint32_t level) const {
+    return first_level_nodes_[level];
+  }
+
+  /**
+   * @param level  the level
+   * @return one past the index of the last node of the level
+   */
+  uint32_t last_level_node(const uint32_t level) const {
+    return first_level_nodes_[level + 1];
+  }
+
+  /**
+   * @param index  between first_level_node and last_level_node of a level
+   * @return the rank of the node
+   */
+  uint32_t level_node(const uint32_t index) const {
+    return level_nodes_[index];
+  }
+
+  /**
+   * Finds the arc between two nodes
+   * @param lower   the rank of the lower node
+   * @param higher  the rank of the higher node
+   * @return the arc or kInvalidContractionIndex if the nodes are not adjacent
+   */
+  uint32_t find_arc(const uint32_t lower, const uint32_t higher) const;
+
+  /**
+   * @return the directed edges of the graph sorted by edge id
+   */
+  const std::vector<input_edge_t>& input_edges() const {
+    return input_edges_;
+  }
+
+  /**
+   * @param edgeid  the directed edge
+   * @return the index of the input edge or kInvalidContractionIndex if it isnt part of the graph
+   */
+  uint32_t input_edge(const GraphId& edgeid) const;
+
+protected:
+  std::vector<std::pair<GraphId, uint32_t>> node_ranks_;
+  std::vector<uint32_t> parents_;
+  std::vector<uint32_t> first_arcs_;
+  std::vector<uint32_t> arc_heads_;
+  std::vector<uint32_t> arc_tails_;
+  std::vector<uint32_t> first_down_arcs_;
+  std::vector<uint32_t> down_arcs_;
+  std::vector<uint32_t> first_level_nodes_;
+  std::vector<uint32_t> level_nodes_;
+  std::vector<input_edge_t> input_edges_;
+};
+
+} // namespace baldr
+} // namespace valhalla
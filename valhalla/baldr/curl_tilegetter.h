@@ -5,6 +5,7 @@
 
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace valhalla {
 namespace baldr {
@@ -39,6 +40,22 @@ public:
     return result;
   }
 
+  std::vector<response_t> get_many(const std::vector<std::string>& urls) override {
+    scoped_curler_t curler(curlers_);
+    std::vector<long> http_codes;
+    auto tiles_data = curler.get()(urls, http_codes, gzipped_, interrupt_);
+    std::vector<response_t> results(urls.size());
+    for (size_t i = 0; i < urls.size(); ++i) {
+      // TODO: Check other codes.
+      if (http_codes[i] == 200) {
+        results[i].bytes_ = std::move(tiles_data[i]);
+        results[i].status_ = tile_getter_t::status_code_t::SUCCESS;
+      }
+    }
+
+    return results;
+  }
+
   bool gzipped() const override {
     return gzipped_;
   }
@@ -35,6 +35,21 @@ struct curler_t {
                                bool gzipped,
                                const interrupt_t* interrupt) const;
 
+  /**
+   * Fetch several urls concurrently over the connections kept alive by this curler and
+   * return the bytes we got for each of them, in the same order as the urls
+   *
+   * @param  urls               the urls to fetch
+   * @param  http_codes         the codes we got back when fetching each url
+   * @param  gzipped            whether to request for gzip compressed data
+   * @param  interrupt          throws if request should be interrupted
+   * @return the bytes we fetched for each url
+   */
+  std::vector<std::vector<char>> operator()(const std::vector<std::string>& urls,
+                                            std::vector<long>& http_codes,
+                                            bool gzipped,
+                                            const interrupt_t* interrupt) const;
+
   /**
    * Allow only moves and forbid copies. We don't want
    * several curlers to share the same state to completely exclude
@@ -619,6 +619,8 @@ constexpr uint8_t kDefaultFlowMask =
 constexpr uint32_t kFreeFlowSecondOfDay = 60 * 60 * 0;         // midnight
 constexpr uint32_t kConstrainedFlowSecondOfDay = 60 * 60 * 12; // noon
 constexpr uint32_t kInvalidSecondsOfWeek = -1;                 // invalid
+// Not a time but the fastest speed of the week, the largest value TimeInfo::second_of_week holds
+constexpr uint32_t kFastestSecondOfWeek = (1 << 20) - 1;
 
 } // namespace baldr
 } // namespace valhalla
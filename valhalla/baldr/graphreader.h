@@ -1,6 +1,8 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <mutex>
@@ -37,6 +39,58 @@ struct IncidentResult {
   int end_index;
 };
 
+/**
+ * Counters describing how the tile cache is doing, broken down by hierarchy level.
+ */
+struct TileCacheStats {
+  struct Level {
+    uint64_t hits = 0;        // lookups that found the tile in the cache
+    uint64_t misses = 0;      // lookups that had to load the tile
+    uint64_t inserts = 0;     // tiles put into the cache
+    uint64_t evictions = 0;   // tiles dropped from the cache
+    uint64_t tiles = 0;       // tiles in the cache right now
+    uint64_t bytes = 0;       // bytes the cache accounts for right now
+    uint64_t load_micros = 0; // time spent loading the tiles that missed
+
+    Level& operator+=(const Level& other);
+  };
+
+  // Keeps track of a tile going into the cache
+  void insert(const GraphId& graphid, size_t size) {
+    auto& level = levels[graphid.level()];
+    ++level.inserts;
+    ++level.tiles;
+    level.bytes += size;
+  }
+
+  // Keeps track of a tile being dropped from the cache
+  void evict(const GraphId& graphid, size_t size) {
+    auto& level = levels[graphid.level()];
+    ++level.evictions;
+    --level.tiles;
+    level.bytes -= size;
+  }
+
+  // Keeps track of the whole cache being dropped
+  void evict_all() {
+    for (auto& level : levels) {
+      level.evictions += level.tiles;
+      level.tiles = 0;
+      level.bytes = 0;
+    }
+  }
+
+  /**
+   * Sums up the counters of all levels.
+   * @return the totals
+   */
+  Level total() const;
+
+  TileCacheStats& operator+=(const TileCacheStats& other);
+
+  std::array<Level, kMaxGraphHierarchy + 1> levels;
+};
+
 /**
  * Tile cache interface.
  */
@@ -91,6 +145,13 @@ public:
    *  Some implementations may simply clear the entire cache
    */
   virtual void Trim() = 0;
+
+  /**
+   * Gets the inserts, evictions and residency of the cache. Hits, misses and load times are
+   * left to the reader so that lookups stay as cheap as they can be.
+   * @return the counters of the cache
+   */
+  virtual TileCacheStats Stats() const = 0;
 };
 
 /**
@@ -150,6 +211,12 @@ public:
    */
   void Trim() override;
 
+  /**
+   * Gets the inserts, evictions and residency of the cache.
+   * @return the counters of the cache
+   */
+  TileCacheStats Stats() const override;
+
 protected:
   inline uint32_t get_offset(const GraphId& graphid) const {
     return graphid.level() < 4 ? index_offsets_[graphid.level()] + graphid.tileid()
@@ -174,6 +241,9 @@ protected:
 
   // The max cache size in bytes
   size_t max_cache_size_;
+
+  // Inserts, evictions and residency
+  TileCacheStats stats_;
 };
 
 /**
@@ -233,6 +303,12 @@ public:
    */
   void Trim() override;
 
+  /**
+   * Gets the inserts, evictions and residency of the cache.
+   * @return the counters of the cache
+   */
+  TileCacheStats Stats() const override;
+
 protected:
   // The actual cached GraphTile objects
   std::unordered_map<uint64_t, graph_tile_ptr> cache_;
@@ -242,6 +318,9 @@ protected:
 
   // The max cache size in bytes
   size_t max_cache_size_;
+
+  // Inserts, evictions and residency
+  TileCacheStats stats_;
 };
 
 /**
@@ -308,12 +387,21 @@ public:
    */
   void Trim() override;
 
+  /**
+   * Gets the inserts, evictions and residency of the cache.
+   * @return the counters of the cache
+   */
+  TileCacheStats Stats() const override;
+
 protected:
   struct KeyValue {
-    KeyValue(GraphId id_, graph_tile_ptr tile_) : id(id_), tile(std::move(tile_)) {
+    KeyValue(GraphId id_, graph_tile_ptr tile_, size_t size_)
+        : id(id_), tile(std::move(tile_)), size(size_) {
     }
     GraphId id;
     graph_tile_ptr tile;
+    // the size the tile was put into the cache with
+    size_t size;
   };
   using KeyValueIter = std::list<KeyValue>::iterator;
 
@@ -350,6 +438,136 @@ protected:
 
   // The max cache size in bytes
   size_t max_cache_size_;
+
+  // Inserts, evictions and residency
+  TileCacheStats stats_;
+};
+
+/**
+ * Segmented LRU tile cache. Tiles start out in a probationary segment and are promoted to a
+ * protected segment the second time they are asked for, so a burst of tiles that are only used
+ * once cannot push out the tiles that are used over and over. Tiles on the levels up to the
+ * pinned level (the highway and arterial tiles most long routes go through) are admitted
+ * straight into the protected segment. Tiles are evicted from the back of the probationary
+ * segment first and the protected segment only gives up tiles once the probationary one is empty.
+ * It is NOT thread-safe!
+ */
+class TileCacheSLRU : public TileCache {
+public:
+  /**
+   * Constructor.
+   * @param max_size            maximum size of the cache
+   * @param mem_control         strategy our cache will use to control its memory
+   * @param protected_fraction  fraction of the cache the protected segment may use
+   * @param pinned_max_level    tiles up to this level go straight into the protected segment
+   */
+  TileCacheSLRU(size_t max_size,
+                TileCacheLRU::MemoryLimitControl mem_control,
+                float protected_fraction,
+                uint32_t pinned_max_level);
+
+  /**
+   * Reserves enough cache to hold (max_cache_size / tile_size) items.
+   * @param tile_size appeoximate size of one tile
+   */
+  void Reserve(size_t tile_size) override;
+
+  /**
+   * Checks if tile exists in the cache.
+   * @param graphid  the graphid of the tile
+   * @return true if tile exists in the cache
+   */
+  bool Contains(const GraphId& graphid) const override;
+
+  /**
+   * Puts a copy of a tile of into the cache.
+   * @param graphid  the graphid of the tile
+   * @param tile the graph tile
+   * @param size size of the tile in memory
+   */
+  graph_tile_ptr Put(const GraphId& graphid, graph_tile_ptr tile, size_t tile_size) override;
+
+  /**
+   * Get a pointer to a graph tile object given a GraphId.
+   * @param graphid  the graphid of the tile
+   * @return GraphTile* a pointer to the graph tile
+   */
+  graph_tile_ptr Get(const GraphId& graphid) const override;
+
+  /**
+   * Lets you know if the cache is too large.
+   * @return true if the cache is over committed with respect to the limit
+   */
+  bool OverCommitted() const override;
+
+  /**
+   * Clears the cache.
+   */
+  void Clear() override;
+
+  /**
+   *  Does its best to reduce the cache size to remove overcommitted state.
+   *  Evicts probationary tiles first and protected tiles only if that is not enough.
+   */
+  void Trim() override;
+
+  /**
+   * Gets the inserts, evictions and residency of the cache.
+   * @return the counters of the cache
+   */
+  TileCacheStats Stats() const override;
+
+protected:
+  struct KeyValue {
+    KeyValue(GraphId id_, graph_tile_ptr tile_, size_t size_)
+        : id(id_), tile(std::move(tile_)), size(size_), is_protected(false) {
+    }
+    GraphId id;
+    graph_tile_ptr tile;
+    // the size the tile was put into the cache with
+    size_t size;
+    // which of the segments the tile is in
+    bool is_protected;
+  };
+  using KeyValueIter = std::list<KeyValue>::iterator;
+
+  /**
+   * Moves the entry to the front of the protected segment and moves the least recently used
+   * protected entries back to the probationary segment if it got too big.
+   * @param entry_iter  entry in either segment
+   */
+  void Protect(const KeyValueIter& entry_iter) const;
+
+  /**
+   * If needed, delete cache items until required_size in bytes is free in cache.
+   * @param  required_size   size in bytes that should be free in the cache
+   * @return  bytes freed by the eviction
+   */
+  size_t TrimToFit(const size_t required_size);
+
+  // The GraphId -> Iterator into whichever segment owns the cached object
+  std::unordered_map<uint64_t, KeyValueIter> cache_;
+
+  // The segments, most recently used at the front
+  mutable std::list<KeyValue> probation_;
+  mutable std::list<KeyValue> protected_;
+
+  // Determines how we deal with
+  TileCacheLRU::MemoryLimitControl mem_control_;
+
+  // The current cache size and the size of the protected segment in bytes
+  size_t cache_size_;
+  mutable size_t protected_size_;
+
+  // The max cache size and the max size of the protected segment in bytes
+  size_t max_cache_size_;
+  size_t max_protected_size_;
+
+  // Tiles up to this level skip the probationary segment
+  uint32_t pinned_max_level_;
+
+  // Inserts, evictions and residency
+  TileCacheStats stats_;
 };
 
 /**
@@ -409,11 +627,238 @@ public:
    */
   void Trim() override;
 
+  /**
+   * Gets the inserts, evictions and residency of the cache.
+   * @return the counters of the cache
+   */
+  TileCacheStats Stats() const override;
+
 private:
   TileCache& cache_;
   std::mutex& mutex_ref_;
 };
 
+/**
+ * Tile cache split into shards keyed by the hash of the tile id. Each shard is an LRU
+ * cache guarded by its own mutex so threads looking up different tiles rarely contend.
+ * The byte budget is split evenly between the shards. Copies of the cache share the
+ * same shards so many readers can use one process wide cache.
+ * It is thread-safe, though sharing tiles between threads also requires
+ * ENABLE_THREAD_SAFE_TILE_REF_COUNT.
+ */
+class ShardedTileCache : public TileCache {
+public:
+  /**
+   * Constructor.
+   * @param max_size     maximum size of the cache, split evenly between the shards
+   * @param shard_count  number of independently locked shards
+   * @param mem_control  strategy each shard will use to control its memory
+   */
+  ShardedTileCache(size_t max_size,
+                   size_t shard_count,
+                   TileCacheLRU::MemoryLimitControl mem_control);
+
+  /**
+   * Reserves enough cache to hold (max_cache_size / tile_size) items.
+   * @param tile_size appeoximate size of one tile
+   */
+  void Reserve(size_t tile_size) override;
+
+  /**
+   * Checks if tile exists in the cache.
+   * @param graphid  the graphid of the tile
+   * @return true if tile exists in the cache
+   */
+  bool Contains(const GraphId& graphid) const override;
+
+  /**
+   * Puts a copy of a tile of into the cache.
+   * @param graphid  the graphid of the tile
+   * @param tile the graph tile
+   * @param size size of the tile in memory
+   */
+  graph_tile_ptr Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) override;
+
+  /**
+   * Get a pointer to a graph tile object given a GraphId.
+   * @param graphid  the graphid of the tile
+   * @return GraphTile* a pointer to the graph tile
+   */
+  graph_tile_ptr Get(const GraphId& graphid) const override;
+
+  /**
+   * Lets you know if the cache is too large.
+   * @return true if any of the shards is over committed with respect to its limit
+   */
+  bool OverCommitted() const override;
+
+  /**
+   * Clears the cache.
+   */
+  void Clear() override;
+
+  /**
+   *  Does its best to reduce the cache size to remove overcommitted state.
+   *  Evicts the least recently used tiles of each overcommitted shard
+   */
+  void Trim() override;
+
+  /**
+   * Gets the inserts, evictions and residency of the cache.
+   * @return the counters of the cache
+   */
+  TileCacheStats Stats() const override;
+
+protected:
+  struct Shard {
+    Shard(size_t max_size, TileCacheLRU::MemoryLimitControl mem_control)
+        : cache(max_size, mem_control) {
+    }
+    std::mutex mutex;
+    TileCacheLRU cache;
+  };
+
+  inline Shard& get_shard(const GraphId& graphid) const {
+    // tile ids are sequential so mix the bits to spread neighbouring tiles over the shards
+    uint64_t hash = graphid.Tile_Base().value * 0x9E3779B97F4A7C15ull;
+    return *(*shards_)[(hash >> 32) % shards_->size()];
+  }
+
+  // The shards, shared between copies of this cache
+  std::shared_ptr<std::vector<std::unique_ptr<Shard>>> shards_;
+};
+
+/**
+ * Flat tile cache which can be shared by all threads in a process. Lookups are an atomic
+ * load of a slot indexed directly by the tile id, so readers never take a lock. Inserts
+ * are serialized by a writer mutex and, since they are rare compared to lookups, are
+ * allowed to be slow. Tiles are only removed by Clear/Trim, which unlinks them and waits
+ * for an epoch based grace period before releasing its own references. Copies of the cache
+ * share the same slots.
+ * It is thread-safe, though sharing tiles between threads also requires
+ * ENABLE_THREAD_SAFE_TILE_REF_COUNT.
+ */
+class SharedFlatTileCache : public TileCache {
+public:
+  /**
+   * Constructor.
+   * @param max_size  maximum size of the cache
+   */
+  SharedFlatTileCache(size_t max_size);
+
+  /**
+   * Reserves enough cache to hold (max_cache_size / tile_size) items.
+   * @param tile_size appeoximate size of one tile
+   */
+  void Reserve(size_t tile_size) override;
+
+  /**
+   * Checks if tile exists in the cache.
+   * @param graphid  the graphid of the tile
+   * @return true if tile exists in the cache
+   */
+  bool Contains(const GraphId& graphid) const override;
+
+  /**
+   * Puts a copy of a tile of into the cache. If another thread already put the same tile
+   * the tile that is already in the cache is kept and returned.
+   * @param graphid  the graphid of the tile
+   * @param tile the graph tile
+   * @param size size of the tile in memory
+   */
+  graph_tile_ptr Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) override;
+
+  /**
+   * Get a pointer to a graph tile object given a GraphId.
+   * @param graphid  the graphid of the tile
+   * @return GraphTile* a pointer to the graph tile
+   */
+  graph_tile_ptr Get(const GraphId& graphid) const override;
+
+  /**
+   * Lets you know if the cache is too large.
+   * @return true if the cache is over committed with respect to the limit
+   */
+  bool OverCommitted() const override;
+
+  /**
+   * Clears the cache.
+   */
+  void Clear() override;
+
+  /**
+   *  Does its best to reduce the cache size to remove overcommitted state.
+   *  Some implementations may simply clear the entire cache
+   */
+  void Trim() override;
+
+  /**
+   * Gets the inserts, evictions and residency of the cache.
+   * @return the counters of the cache
+   */
+  TileCacheStats Stats() const override;
+
+protected:
+  // Number of independent reader counters, readers pick one by their thread id
+  static constexpr size_t kReaderStripes = 64;
+
+  // Readers announce which epoch they are reading in. Padded to avoid false sharing
+  struct ReaderStripe {
+    std::atomic<uint32_t> count[2];
+    char padding[64 - 2 * sizeof(std::atomic<uint32_t>)];
+  };
+
+  // Everything that is shared between copies of the cache
+  struct Slots {
+    explicit Slots(size_t slot_count);
+    ~Slots();
+    // Holders of the cached tiles or nullptr, indexed by get_offset
+    std::unique_ptr<std::atomic<const graph_tile_ptr*>[]> slots;
+    size_t slot_count;
+    // Offsets of the occupied slots, only touched by writers
+    std::vector<uint32_t> occupied;
+    // Serializes writers
+    std::mutex writer_mutex;
+    // Current epoch and the readers in each of the last two epochs
+    std::atomic<uint32_t> epoch;
+    ReaderStripe readers[kReaderStripes];
+    // The current cache size in bytes
+    std::atomic<size_t> cache_size;
+    // Inserts, evictions and residency, only touched by writers
+    TileCacheStats stats;
+  };
+
+  // Marks the calling thread as reading for the lifetime of the guard
+  class ReadGuard {
+  public:
+    explicit ReadGuard(Slots& slots);
+    ~ReadGuard();
+
+  private:
+    std::atomic<uint32_t>* count_;
+  };
+
+  /**
+   * Waits until every reader which could still see unlinked slots has finished.
+   * Must be called while holding the writer mutex.
+   */
+  void Synchronize();
+
+  inline uint32_t get_offset(const GraphId& graphid) const {
+    return graphid.level() < 4 ? index_offsets_[graphid.level()] + graphid.tileid()
+                               : slots_->slot_count;
+  }
+
+  // Offsets in the slot list for where a set of tiles begin
+  std::array<uint32_t, 8> index_offsets_;
+
+  // The slots, shared between copies of this cache
+  std::shared_ptr<Slots> slots_;
+
+  // The max cache size in bytes
+  size_t max_cache_size_;
+};
+
 /**
  * Creates tile caches.
  */
@@ -443,7 +888,7 @@ public:
   explicit GraphReader(const boost::property_tree::ptree& pt,
                        std::unique_ptr<tile_getter_t>&& tile_getter = nullptr);
 
-  virtual ~GraphReader() = default;
+  virtual ~GraphReader();
 
   virtual void SetInterrupt(const tile_getter_t::interrupt_t* interrupt) {
     if (tile_getter_) {
@@ -471,6 +916,43 @@ public:
    */
   virtual graph_tile_ptr GetGraphTile(const GraphId& graphid);
 
+  /**
+   * Asks the background loader to get the given tiles ready before they are requested.
+   * This is only a hint, tiles which are cached, already being loaded or over the limit
+   * of outstanding tiles are ignored. Does nothing unless prefetch_threads is configured
+   * and tiles are read from a tile directory or url rather than an extract.
+   * @param graphids  the tiles which will likely be needed soon
+   */
+  void Prefetch(const std::vector<GraphId>& graphids);
+
+  /**
+   * Hints that a search around the given locations is about to start. Prefetches the
+   * tiles of each hierarchy level within a padded bounding box of the locations, or if there
+   * would be too many of them on a level, just the tiles around each location.
+   * @param locations  the locations of the search (eg. origin and destination)
+   */
+  void PrefetchCorridor(const std::vector<midgard::PointLL>& locations);
+
+  /**
+   * Whether or not calls to Prefetch will do anything
+   * @return true if tiles are loaded in the background
+   */
+  bool PrefetchEnabled() const {
+    return prefetcher_ != nullptr;
+  }
+
+  /**
+   * Whether the tile was loaded in the background and is waiting to be asked for
+   * @param graphid  the tile
+   * @return true if the next request for the tile will not have to load it
+   */
+  bool IsPrefetched(const GraphId& graphid) const;
+
+  /**
+   * Blocks until the background loader has finished every tile it was asked to prefetch
+   */
+  void WaitForPrefetch() const;
+
   /**
    * Get a pointer to a graph tile object given a GraphId. This method also
    * supplies the current graph tile - so if the same tile is requested in
@@ -507,17 +989,14 @@ public:
   /**
    * Clears the cache
    */
-  virtual void Clear() {
-    cache_->Clear();
-  }
+  virtual void Clear();
 
   /**
    * Tries to ensure the cache footprint below allowed maximum
-   * In some cases may even remove the entire cache.
+   * In some cases may even remove the entire cache. Tiles which were
+   * loaded in the background but not asked for are dropped as well.
    */
-  virtual void Trim() {
-    cache_->Trim();
-  }
+  virtual void Trim();
 
   /**
    * Returns the maximum number of threads that can
@@ -535,6 +1014,14 @@ public:
     return cache_->OverCommitted();
   }
 
+  /**
+   * Gets counters describing how the tile cache is doing per hierarchy level. Hits, misses and
+   * load times are those of this reader, the rest describe its cache which may be shared with
+   * other readers.
+   * @return the cache counters
+   */
+  TileCacheStats GetCacheStats() const;
+
   /**
    * Convenience method to get an opposing directed edge.
    * @param  edgeid  Graph Id of the directed edge.
@@ -930,6 +1417,12 @@ protected:
   // Information about where the tiles are kept
   const std::string tile_dir_;
 
+  // Whether uncompressed tiles in the tile_dir are mmap'd rather than copied into memory
+  const bool use_tile_mmap_;
+
+  // Whether mmap'd tiles get different page advice for their routing and trip building sections
+  const bool advise_tile_sections_;
+
   // Stuff for getting at remote tiles
   std::unique_ptr<tile_getter_t> tile_getter_;
   const size_t max_concurrent_users_;
@@ -940,7 +1433,31 @@ protected:
 
   std::unique_ptr<TileCache> cache_;
 
+  // Hits, misses and load times of this reader
+  TileCacheStats cache_stats_;
+
   bool enable_incidents_;
+
+  /**
+   * Loads a tile from the tile directory or the tile url without touching the
+   * cache. This is safe to call from multiple threads.
+   * @param base  the base id of the tile
+   * @return the tile or nullptr if it couldnt be found anywhere
+   */
+  graph_tile_ptr LoadGraphTile(const GraphId& base);
+
+  /**
+   * Loads tiles from the tile directory or the tile url without touching the cache. The
+   * tiles which arent in the tile directory are downloaded from the tile url in one batch.
+   * This is safe to call from multiple threads.
+   * @param bases  the base ids of the tiles
+   * @return the tiles in the same order as the ids, nullptr for those which couldnt be found
+   */
+  std::vector<graph_tile_ptr> LoadGraphTiles(const std::vector<GraphId>& bases);
+
+  // Loads tiles in background threads ahead of the search asking for them
+  struct tile_prefetcher_t;
+  std::unique_ptr<tile_prefetcher_t> prefetcher_;
 };
 
 // Given the Location relation, return the full metadata
@@ -56,14 +56,18 @@ public:
 
   /**
    * Constructs with a given GraphId. Reads the graph tile from file
-   * into memory.
-   * @param  tile_dir   Tile directory.
-   * @param  graphid    GraphId (tileid and level)
+   * into memory or, if requested, maps the uncompressed file read-only so that the
+   * pages are shared via the page cache between every process using the same tiles.
+   * @param  tile_dir        Tile directory.
+   * @param  graphid         GraphId (tileid and level)
+   * @param  traffic_memory  Optional live traffic memory for this tile
+   * @param  mmap_tile       Whether to mmap the uncompressed tile file instead of copying it
    * @return nullptr if the tile could not be loaded. may throw
    */
   static graph_tile_ptr Create(const std::string& tile_dir,
                                const GraphId& graphid,
-                               std::unique_ptr<const GraphMemory>&& traffic_memory = nullptr);
+                               std::unique_ptr<const GraphMemory>&& traffic_memory = nullptr,
+                               bool mmap_tile = false);
 
   /**
    * Constructs with a given the graph Id, pointer to the tile data, and the
@@ -84,6 +88,28 @@ public:
                                std::unique_ptr<const GraphMemory>&& memory,
                                std::unique_ptr<const GraphMemory>&& traffic_memory = nullptr);
 
+  /**
+   * Constructs a tile from gzip or zlib compressed tile data, for example a compressed entry in
+   * a tile extract. The data is inflated into memory owned by the tile.
+   * @param  graphid         Tile Id
+   * @param  compressed      Pointer to the start of the compressed data
+   * @param  size            Size in bytes of the compressed data
+   * @param  traffic_memory  Optional live traffic memory for this tile
+   * @return nullptr if the data could not be inflated
+   */
+  static graph_tile_ptr DecompressTile(const GraphId& graphid,
+                                       const char* compressed,
+                                       size_t size,
+                                       std::unique_ptr<const GraphMemory>&& traffic_memory = nullptr);
+
+  /**
+   * Whether or not the tile data is gzipped rather than a raw tile
+   * @param  data  Pointer to the start of the tile data
+   * @param  size  Size in bytes of the tile data
+   * @return true if the data starts with a gzip header
+   */
+  static bool IsCompressed(const char* data, size_t size);
+
   /**
    * Constructs a tile given a url for the tile using curl
    * @param  tile_url URL of tile
@@ -97,6 +123,19 @@ public:
                                      tile_getter_t* tile_getter,
                                      const std::string& cache_location);
 
+  /**
+   * Constructs several tiles given a url for the tiles, downloading them all in one batch
+   * @param  tile_url URL of tile
+   * @param  graphids Tile Ids
+   * @param  tile_getter object that will handle tile downloading
+   * @param  cache_location where to cache the tiles on disk, empty to not cache them
+   * @return the tiles in the same order as the ids, nullptr for those which couldnt be fetched
+   */
+  static std::vector<graph_tile_ptr> CacheTileURLs(const std::string& tile_url,
+                                                   const std::vector<GraphId>& graphids,
+                                                   tile_getter_t* tile_getter,
+                                                   const std::string& cache_location);
+
   /**
    * Construct a tile given a url for the tile using curl
    * @param  tile_data graph tile raw bytes
@@ -149,6 +188,16 @@ public:
     return header_;
   }
 
+  /**
+   * Advises the kernel how a memory mapped tile will be read. The nodes, transitions, directed
+   * edges and access restrictions at the front of the tile, the complex restrictions and the
+   * predicted speeds at the back are read by every expansion so they are requested up front.
+   * Readahead is turned off for everything in between (transit, signs, edge info, names, etc)
+   * since that is only read when forming the trip, which keeps the page cache for the parts of the
+   * tile the search actually touches.
+   */
+  void AdviseMemory() const;
+
   /**
    * Get a pointer to a node.
    * @return  Returns a pointer to the node.
@@ -519,6 +568,7 @@ public:
    * @param  seconds       Seconds of the week since midnight (ie Monday morning). Defaults to noon
    *                       Monday. Note that for free and constrained flow there is no concept of a
    *                       week so we modulus the time to day based seconds
+   *                       kFastestSecondOfWeek gets the fastest speed the edge has at any time
    * @param  flow_sources  Which speed sources were used in this speed calculation. Optional pointer,
    *                       if nullptr is passed in flow_sources does nothing.
    * @return Returns the speed for the edge.
@@ -534,6 +584,10 @@ public:
       flow_sources = &temp_sources;
     *flow_sources = kNoFlowMask;
 
+    if (seconds == kFastestSecondOfWeek) {
+      return GetFastestSpeed(de, flow_mask, is_truck, flow_sources);
+    }
+
     // TODO(danpat): this needs to consider the time - we should not use live speeds if
     //               the request is not for "now", or we're some X % along the route
     // TODO(danpat): for short-ish durations along the route, we should fade live
@@ -626,6 +680,61 @@ public:
     return (is_truck && (de->truck_speed() > 0)) ? std::min(de->truck_speed(), speed) : speed;
   }
 
+  /**
+   * Get the fastest speed GetSpeed returns for the edge at any time of the week, costs using it are
+   * lower bounds of the costs at any time. Blended speeds are within the speeds they blend so the
+   * maximum of the speed sources is enough, the predicted speed is bounded without decompressing.
+   *
+   * @param  de            Directed edge information.
+   * @param  flow_mask     A mask denoting which types of traffic data should be used to get the speed
+   * @param  is_truck      Whether the truck speed of the edge limits its speed
+   * @param  flow_sources  Which speed sources were considered
+   * @return Returns the fastest speed for the edge.
+   */
+  inline uint32_t GetFastestSpeed(const DirectedEdge* de,
+                                  uint8_t flow_mask,
+                                  bool is_truck,
+                                  uint8_t* flow_sources) const {
+    uint32_t speed = 0;
+    if ((flow_mask & kCurrentFlowMask) && traffic_tile()) {
+      auto volatile& live_speed = trafficspeed(de);
+      if (live_speed.speed_valid()) {
+        *flow_sources |= kCurrentFlowMask;
+        speed = live_speed.get_overall_speed();
+      }
+    }
+
+    // Only valid predicted speeds are used, they are slower than kMaxAssumedSpeed
+    if ((flow_mask & kPredictedFlowMask) && de->has_predicted_speed()) {
+      *flow_sources |= kPredictedFlowMask;
+      float predicted = std::min(predictedspeeds_.max_speed(de - directededges_),
+                                 static_cast<float>(kMaxAssumedSpeed));
+      speed = std::max(speed, static_cast<uint32_t>(predicted + 0.5f));
+    }
+
+    // Constrained and free flow speeds hold for either half of the day, the edge speed fills in for
+    // the half which has none
+    bool constrained =
+        (flow_mask & kConstrainedFlowMask) && valid_speed(de->constrained_flow_speed());
+    bool free_flow = (flow_mask & kFreeFlowMask) && valid_speed(de->free_flow_speed());
+    if (constrained) {
+      *flow_sources |= kConstrainedFlowMask;
+      speed = std::max(speed, de->constrained_flow_speed());
+    }
+    if (free_flow) {
+      *flow_sources |= kFreeFlowMask;
+      speed = std::max(speed, de->free_flow_speed());
+    }
+    if (!constrained || !free_flow) {
+      uint32_t edge_speed = de->speed();
+      if (is_truck && de->truck_speed() > 0) {
+        edge_speed = std::min(edge_speed, de->truck_speed());
+      }
+      speed = std::max(speed, edge_speed);
+    }
+    return speed;
+  }
+
   inline const volatile TrafficSpeed& trafficspeed(const DirectedEdge* de) const {
     auto directed_edge_index = std::distance(const_cast<const DirectedEdge*>(directededges_), de);
     return traffic_tile.trafficspeed(directed_edge_index);
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <valhalla/baldr/graphid.h>
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+// Distance to or from a landmark which cannot be reached
+constexpr float kUnreachableLandmark = std::numeric_limits<float>::infinity();
+
+/**
+ * Lower bounds for the cost of paths between the graph nodes and a handful of landmarks of one
+ * costing, used for the ALT (A*, landmarks and triangle inequality) heuristic. For every node of
+ * the non transit levels it holds the cost from each landmark to the node and from the node to
+ * each landmark. By the triangle inequality the cost from a node v to a node t is at least
+ * d(L, t) - d(L, v) and d(v, L) - d(t, L) for every landmark L.
+ */
+class LandmarkDistances {
+public:
+  // The nodes of a tile are consecutive in the distances
+  struct tile_t {
+    GraphId id;          // the tile
+    uint32_t offset;     // the index of its first node
+    uint32_t node_count; // the number of nodes the tile had when the distances were computed
+  };
+
+  /**
+   * Constructs the distances from their parts, this is used by the builder
+   * @param landmarks  the graph nodes which are the landmarks
+   * @param tiles      the tiles with the index and count of their nodes, sorted by tile
+   * @param distances  for each node the costs from all landmarks followed by the costs to them
+   * @param options    serialized costing options the distances were computed with
+   */
+  LandmarkDistances(std::vector<GraphId>&& landmarks,
+                    std::vector<tile_t>&& tiles,
+                    std::vector<float>&& distances,
+                    std::string&& options);
+
+  /**
+   * Loads distances written by Save
+   * @param file  the file to read
+   * @return the distances, throws if the file cannot be read or is not valid
+   */
+  static std::shared_ptr<const LandmarkDistances> Load(const std::string& file);
+
+  /**
+   * Gets the distances of a costing from the landmark directory. They are loaded once and shared
+   * by everyone in the process.
+   * @param dir      directory holding a file per costing
+   * @param costing  name of the costing
+   * @return the distances or nullptr if there are none for the costing
+   */
+  static std::shared_ptr<const LandmarkDistances> Get(const std::string& dir,
+                                                      const std::string& costing);
+
+  /**
+   * @param dir      directory holding a file per costing
+   * @param costing  name of the costing
+   * @return the file the distances of the costing are kept in
+   */
+  static std::string FileName(const std::string& dir, const std::string& costing);
+
+  /**
+   * Writes the distances to a file
+   * @param file  the file to write
+   */
+  void Save(const std::string& file) const;
+
+  /**
+   * @return the number of landmarks
+   */
+  uint32_t landmark_count() const {
+    return static_cast<uint32_t>(landmarks_.size());
+  }
+
+  /**
+   * @return the graph nodes which are the landmarks
+   */
+  const std::vector<GraphId>& landmarks() const {
+    return landmarks_;
+  }
+
+  /**
+   * @return the serialized costing options the distances were computed with
+   */
+  const std::string& options() const {
+    return options_;
+  }
+
+  /**
+   * The tiles can change after the distances were computed, so the caller has to say how many
+   * nodes the tile it has in hand has and a tile whose count differs is not covered.
+   * @param tile        the tile id
+   * @param node_count  the number of nodes the tile has
+   * @return the index of the first node of the tile or kInvalidLandmarkIndex if its not covered
+   */
+  uint32_t tile_offset(const GraphId& tile, const uint32_t node_count) const;
+
+  /**
+   * @param index  the index of the node, its tile offset plus its id
+   * @return the costs from each landmark to the node
+   */
+  const float* from_landmarks(const uint32_t index) const {
+    return distances_.data() + static_cast<size_t>(index) * 2 * landmarks_.size();
+  }
+
+  /**
+   * @param index  the index of the node, its tile offset plus its id
+   * @return the costs from the node to each landmark
+   */
+  const float* to_landmarks(const uint32_t index) const {
+    return from_landmarks(index) + landmarks_.size();
+  }
+
+  // Marks a tile which is not covered
+  static constexpr uint32_t kInvalidLandmarkIndex = std::numeric_limits<uint32_t>::max();
+
+protected:
+  std::vector<GraphId> landmarks_;
+  std::vector<tile_t> tiles_;
+  std::vector<float> distances_;
+  std::string options_;
+};
+
+} // namespace baldr
+} // namespace valhalla
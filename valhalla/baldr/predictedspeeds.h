@@ -33,6 +33,14 @@ std::array<int16_t, kCoefficientCount> compress_speed_buckets(const float* speed
  */
 float decompress_speed_bucket(const int16_t* coefficients, uint32_t bucket_idx);
 
+/**
+ * Bound the speed of every bucket from above without recovering them. The cos values of the
+ * DCT-III are within [-1, 1] so no bucket can be faster than the sum of the absolute coefficients.
+ * @param coefficients  Transformed speed buckets (must be 200 values).
+ * @return  Speed value (in KPH) no bucket exceeds.
+ */
+float max_speed_bucket(const int16_t* coefficients);
+
 /**
  * Pack transformed speed values into base64-encoded string.
  * @param coefficients  Array of transformed speed buckets (must be 200 values).
@@ -90,6 +98,14 @@ public:
     return decompress_speed_bucket(coefficients, seconds_of_week / kSpeedBucketSizeSeconds);
   }
 
+  /**
+   * Get an upper bound of the speed at any time of the week given the edge Id.
+   * @param  idx  Directed edge index.
+   */
+  float max_speed(const uint32_t idx) const {
+    return max_speed_bucket(profiles_ + offset_[idx]);
+  }
+
 protected:
   const uint32_t* offset_;  // Offset into the array of compressed speed profiles
                             // for each directed edge
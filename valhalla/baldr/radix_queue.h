@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include <valhalla/baldr/graphconstants.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Radix Queue - a monotone priority queue of label indexes, an alternative to the
+ * DoubleBucketQueue with the same interface. The sort costs are divided into integer keys by the
+ * bucket size, like the buckets of the DoubleBucketQueue. Each label is kept in the bucket of the
+ * highest bit in which its key differs from the key popped last, so there are only 33 buckets and
+ * no cost range or overflow bucket. A bitmap of the non empty buckets finds the next one with a
+ * single count of trailing zeros. The buckets keep the keys next to the labels so moving them to
+ * lower buckets never looks at the labels, and their memory is kept when the queue is cleared.
+ * Decreasing a cost adds the label again, the outdated entry is dropped when it comes up.
+ *
+ * As with the DoubleBucketQueue, costs below the last popped cost are treated as that cost and
+ * the labels with the same key come out last in, first out.
+ */
+template <typename label_t> class RadixQueue final {
+public:
+  /**
+   * Default c-tor creates empty object that needs to be initialized with `reuse` method
+   */
+  RadixQueue() {
+    reuse(0.f, 1, nullptr);
+  }
+
+  /**
+   * Constructor given a minimum cost and a bucket size.
+   * @param mincost         Minimum cost, lower costs are treated as this.
+   * @param bucketsize      Range of costs that get the same key. Must be 1 or larger.
+   * @param labelcontainer  Container of labels with sortcosts.
+   */
+  RadixQueue(const float mincost,
+             const uint32_t bucketsize,
+             const std::vector<label_t>* labelcontainer) {
+    reuse(mincost, bucketsize, labelcontainer);
+  }
+
+  RadixQueue(RadixQueue&&) = default;
+  RadixQueue& operator=(RadixQueue&&) = default;
+  RadixQueue(const RadixQueue&) = delete;
+  RadixQueue& operator=(const RadixQueue&) = delete;
+
+  /**
+   * The same as c-tor, but keeps the memory of the previous use and clears the queue.
+   * @param mincost         Minimum cost, lower costs are treated as this.
+   * @param bucketsize      Range of costs that get the same key. Must be 1 or larger.
+   * @param labelcontainer  Container of labels with sortcosts.
+   */
+  void reuse(const float mincost,
+             const uint32_t bucketsize,
+             const std::vector<label_t>* labelcontainer) {
+    if (bucketsize < 1) {
+      throw std::runtime_error("Bucketsize must be 1 or greater");
+    }
+    labelcontainer_ = labelcontainer;
+    mincost_ = mincost;
+    inv_ = 1.0f / static_cast<float>(bucketsize);
+    clear();
+  }
+
+  /**
+   * Removes all labels, keeping the memory.
+   */
+  void clear() {
+    for (auto bits = nonempty_; bits != 0; bits &= bits - 1) {
+      buckets_[lowest_bit(bits)].clear();
+    }
+    nonempty_ = 0;
+    last_ = 0;
+    keys_.clear();
+  }
+
+  /**
+   * Adds a label index to the queue.
+   * @param  label  Label index to add to the queue.
+   */
+  void add(const uint32_t label) {
+    if (label >= keys_.size()) {
+      keys_.resize(label + 1, kPopped);
+    }
+    keys_[label] = key((*labelcontainer_)[label].sortcost());
+    push({keys_[label], label});
+  }
+
+  /**
+   * The specified label index now has a smaller cost, adds it again with the new cost.
+   * @param  label    Label index to reorder.
+   * @param  newcost  New sort cost.
+   */
+  void decrease(const uint32_t label, const float newcost) {
+    const uint32_t newkey = key(newcost);
+    if (newkey != keys_[label]) {
+      keys_[label] = newkey;
+      push({newkey, label});
+    }
+  }
+
+  /**
+   * Removes the lowest cost label index from the queue.
+   * @return  Returns the label index of the lowest cost label. Returns
+   *          kInvalidLabel if the queue is empty.
+   */
+  uint32_t pop() {
+    while (true) {
+      auto& first = buckets_[0];
+      while (!first.empty()) {
+        const entry_t entry = first.back();
+        first.pop_back();
+        // skip the entries of labels which were decreased since
+        if (keys_[entry.label] == entry.key) {
+          keys_[entry.label] = kPopped;
+          if (first.empty()) {
+            nonempty_ &= ~uint64_t(1);
+          }
+          return entry.label;
+        }
+      }
+      nonempty_ &= ~uint64_t(1);
+      if (nonempty_ == 0) {
+        return kInvalidLabel;
+      }
+
+      // The lowest non empty bucket holds the next keys. The smallest of them becomes the last key
+      // and relative to it the others all fall into lower buckets, some into the first one.
+      const uint32_t index = lowest_bit(nonempty_);
+      auto& bucket = buckets_[index];
+      uint32_t min = kPopped;
+      for (const auto& entry : bucket) {
+        if (keys_[entry.label] == entry.key) {
+          min = std::min(min, entry.key);
+        }
+      }
+      nonempty_ &= ~(uint64_t(1) << index);
+      if (min != kPopped) {
+        last_ = min;
+        for (const auto& entry : bucket) {
+          if (keys_[entry.label] == entry.key) {
+            push(entry);
+          }
+        }
+      }
+      bucket.clear();
+    }
+  }
+
+private:
+  // Keys are 32 bits so a key differs from the last key in one of 32 bits, or not at all
+  static constexpr uint32_t kBucketCount = 33;
+  // The key of labels which are not in the queue
+  static constexpr uint32_t kPopped = std::numeric_limits<uint32_t>::max();
+
+  struct entry_t {
+    uint32_t key;
+    uint32_t label;
+  };
+
+  static uint32_t lowest_bit(const uint64_t bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return static_cast<uint32_t>(index);
+#else
+    return static_cast<uint32_t>(__builtin_ctzll(bits));
+#endif
+  }
+
+  static uint32_t highest_bit(const uint32_t bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse(&index, bits);
+    return static_cast<uint32_t>(index);
+#else
+    return static_cast<uint32_t>(31 - __builtin_clz(bits));
+#endif
+  }
+
+  // The key of a cost, never less than the last key so the queue stays monotone
+  uint32_t key(const float cost) const {
+    const float scaled = (cost - mincost_) * inv_;
+    const uint32_t key = scaled <= 0.f ? 0
+                         : scaled >= static_cast<float>(kPopped - 1)
+                             ? kPopped - 1
+                             : static_cast<uint32_t>(scaled);
+    return std::max(key, last_);
+  }
+
+  // Puts an entry into the bucket of its key
+  void push(const entry_t& entry) {
+    const uint32_t index = entry.key == last_ ? 0 : highest_bit(entry.key ^ last_) + 1;
+    buckets_[index].push_back(entry);
+    nonempty_ |= uint64_t(1) << index;
+  }
+
+  float mincost_;         // Cost of key 0
+  float inv_;             // 1/bucketsize (so we can avoid division)
+  uint32_t last_ = 0;     // Key of the label popped last
+  uint64_t nonempty_ = 0; // A bit for each bucket which has entries
+
+  std::array<std::vector<entry_t>, kBucketCount> buckets_;
+
+  // The current key of each label index in the queue
+  std::vector<uint32_t> keys_;
+
+  // Access to a container of labels to get cost given the label index.
+  const std::vector<label_t>* labelcontainer_;
+};
+
+template <typename label_t> constexpr uint32_t RadixQueue<label_t>::kPopped;
+
+} // namespace baldr
+} // namespace valhalla
@@ -36,6 +36,20 @@ public:
    * */
   virtual response_t get(const std::string& url) = 0;
 
+  /**
+   * Makes synchronous requests to all of the urls and returns a response_t object for each of
+   * them, in the same order as the urls. Implementations which can download several tiles at
+   * once should override this, by default the urls are simply requested one after another.
+   */
+  virtual std::vector<response_t> get_many(const std::vector<std::string>& urls) {
+    std::vector<response_t> results;
+    results.reserve(urls.size());
+    for (const auto& url : urls) {
+      results.emplace_back(get(url));
+    }
+    return results;
+  }
+
   /**
    * Whether tiles are with .gz extension.
    */
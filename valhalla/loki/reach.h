@@ -91,7 +91,8 @@ protected:
 
   // tell the expansion how many labels to expect and how many buckets to use
   virtual void GetExpansionHints(uint32_t& bucket_count,
-                                 uint32_t& edge_label_reservation) const override;
+                                 uint32_t& edge_label_reservation,
+                                 thor::QueueType& queue_type) const override;
 
   // need to reset the queues
   virtual void Clear() override;
@@ -657,7 +657,7 @@ struct tar {
     }
   };
 
-  tar(const std::string& tar_file, bool regular_files_only = true)
+  tar(const std::string& tar_file, bool regular_files_only = true, bool traverse = true)
       : tar_file(tar_file), corrupt_blocks(0) {
     // get the file size
     struct stat s;
@@ -673,6 +673,11 @@ struct tar {
     // map the file
     mm.map_readonly(tar_file, s.st_size);
 
+    // the caller already knows where everything is so dont touch the rest of the archive
+    if (!traverse) {
+      return;
+    }
+
     // determine opposite of preferred path separator (needed to update OS-specific path separator)
     const char opp_sep = filesystem::path::preferred_separator == '/' ? '\\' : '/';
 
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace valhalla {
+namespace midgard {
+
+/**
+ * Runs the function on the given number of threads and waits for them to finish. The function
+ * gets the index of the thread it runs on. The first failure of a thread is rethrown.
+ * @param concurrency  number of threads
+ * @param function     what each thread runs
+ */
+template <typename function_t> void run_threads(uint32_t concurrency, const function_t& function) {
+  std::vector<std::exception_ptr> failures(concurrency);
+  std::vector<std::thread> threads;
+  threads.reserve(concurrency);
+  for (uint32_t i = 0; i < concurrency; ++i) {
+    threads.emplace_back([&function, &failures, i]() {
+      try {
+        function(i);
+      } catch (...) { failures[i] = std::current_exception(); }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& failure : failures) {
+    if (failure) {
+      std::rethrow_exception(failure);
+    }
+  }
+}
+
+} // namespace midgard
+} // namespace valhalla
@@ -0,0 +1,26 @@
+#ifndef VALHALLA_MJOLNIR_CONTRACTIONBUILDER_H
+#define VALHALLA_MJOLNIR_CONTRACTIONBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to build the metric independent contraction hierarchy of the routing graph.
+ */
+class ContractionBuilder {
+public:
+  /**
+   * Computes a nested dissection order of the nodes of all non transit levels, contracts the
+   * graph in that order and writes the resulting hierarchy to mjolnir.contraction_hierarchy.
+   * Does nothing if no file is configured.
+   * @param pt  the valhalla config
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_CONTRACTIONBUILDER_H
@@ -0,0 +1,28 @@
+#ifndef VALHALLA_MJOLNIR_LANDMARKBUILDER_H
+#define VALHALLA_MJOLNIR_LANDMARKBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to select landmarks and precompute the costs between them and every graph node for
+ * the ALT heuristic of the path algorithms.
+ */
+class LandmarkBuilder {
+public:
+  /**
+   * For each costing in mjolnir.landmark_costings, splits the non transit levels of the graph into
+   * connected regions, spreads mjolnir.landmark_count landmarks over them by farthest selection
+   * and writes the costs from and to the landmarks of every node into mjolnir.landmark_dir.
+   * Does nothing if no directory is configured.
+   * @param pt  the valhalla config
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_LANDMARKBUILDER_H
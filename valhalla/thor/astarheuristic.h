@@ -1,13 +1,26 @@
 #ifndef VALHALLA_THOR_ASTARHEURISTIC_H_
 #define VALHALLA_THOR_ASTARHEURISTIC_H_
 
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphtile.h>
+#include <valhalla/baldr/landmarks.h>
 #include <valhalla/midgard/distanceapproximator.h>
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/midgard/util.h>
 
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
 namespace valhalla {
 namespace thor {
 
+// The landmark bounds leave out turn costs and node access which only make a path costlier. They
+// are still scaled down a little as the costs of the hierarchy shortcuts, which the landmarks do
+// not use, are not exactly the sums of the edges they cover
+constexpr float kLandmarkBoundFactor = 0.9f;
+
 /**
  * Class to calculate A* cost heuristics based on distances of nodes from
  * a destination within the shortest path computation.
@@ -33,6 +46,49 @@ public:
   void Init(const midgard::PointLL& ll, const float factor) {
     distapprox_.SetTestPoint(ll);
     costfactor_ = factor;
+    landmarks_.reset();
+  }
+
+  /**
+   * Tightens the heuristic with the precomputed costs between the graph nodes and the landmarks.
+   * Must be called after Init. The landmarks are not used if any of the nodes is not covered.
+   * @param  landmarks  the landmark costs of the costing in use
+   * @param  nodes      the nodes at the location, the start and end nodes of its candidate edges,
+   *                    with the number of nodes of their tiles
+   * @param  toward     true if the heuristic estimates the cost from a node to the location
+   *                    (forward search), false if it estimates the cost from the location to
+   *                    a node (reverse search)
+   */
+  void InitLandmarks(const std::shared_ptr<const baldr::LandmarkDistances>& landmarks,
+                     const std::vector<std::pair<baldr::GraphId, uint32_t>>& nodes,
+                     const bool toward) {
+    landmarks_.reset();
+    if (!landmarks || nodes.empty()) {
+      return;
+    }
+    const auto count = landmarks->landmark_count();
+    // the bounds must hold for whichever of the nodes the path ends up using, so take the
+    // loosest costs between them and each landmark
+    from_location_.assign(count, toward ? baldr::kUnreachableLandmark : 0.f);
+    to_location_.assign(count, toward ? 0.f : baldr::kUnreachableLandmark);
+    for (const auto& node : nodes) {
+      auto offset = landmarks->tile_offset(node.first.Tile_Base(), node.second);
+      if (offset == baldr::LandmarkDistances::kInvalidLandmarkIndex) {
+        return;
+      }
+      const float* from = landmarks->from_landmarks(offset + node.first.id());
+      const float* to = landmarks->to_landmarks(offset + node.first.id());
+      for (uint32_t i = 0; i < count; ++i) {
+        from_location_[i] =
+            toward ? std::min(from_location_[i], from[i]) : std::max(from_location_[i], from[i]);
+        to_location_[i] =
+            toward ? std::max(to_location_[i], to[i]) : std::min(to_location_[i], to[i]);
+      }
+    }
+    landmarks_ = landmarks;
+    toward_ = toward;
+    last_tile_ = {};
+    last_offset_ = baldr::LandmarkDistances::kInvalidLandmarkIndex;
   }
 
   /**
@@ -77,10 +133,67 @@ public:
     return dist * costfactor_;
   }
 
+  /**
+   * Get the A* heuristic given the lat,lng of a node and the node. The distance based estimate
+   * is raised to the landmark bound of the node if there is one. The distance is returned via
+   * an argument.
+   * @param   ll    Lat,lng of the node
+   * @param   node  The node
+   * @param   tile  The tile of the node
+   * @param   dist  Distance (meters) to the destination.
+   * @return  Returns an estimate of the cost to the destination.
+   *          For A* shortest path this MUST UNDERESTIMATE the true cost.
+   */
+  float Get(const midgard::PointLL& ll,
+            const baldr::GraphId& node,
+            const graph_tile_ptr& tile,
+            float& dist) const {
+    dist = sqrtf(distapprox_.DistanceSquared(ll));
+    return std::max(dist * costfactor_, LandmarkBound(node, tile));
+  }
+
 private:
+  // the highest lower bound given by the triangle inequality over all landmarks
+  float LandmarkBound(const baldr::GraphId& node, const graph_tile_ptr& tile) const {
+    if (!landmarks_) {
+      return 0.f;
+    }
+    // neighbouring nodes are usually in the same tile
+    if (node.Tile_Base() != last_tile_) {
+      last_tile_ = node.Tile_Base();
+      last_offset_ = landmarks_->tile_offset(last_tile_, tile->header()->nodecount());
+    }
+    if (last_offset_ == baldr::LandmarkDistances::kInvalidLandmarkIndex) {
+      return 0.f;
+    }
+    const float* from = landmarks_->from_landmarks(last_offset_ + node.id());
+    const float* to = landmarks_->to_landmarks(last_offset_ + node.id());
+    float bound = 0.f;
+    for (uint32_t i = 0; i < from_location_.size(); ++i) {
+      // a landmark that cant reach one side tells us nothing
+      if (from[i] != baldr::kUnreachableLandmark &&
+          from_location_[i] != baldr::kUnreachableLandmark) {
+        bound =
+            std::max(bound, toward_ ? from_location_[i] - from[i] : from[i] - from_location_[i]);
+      }
+      if (to[i] != baldr::kUnreachableLandmark && to_location_[i] != baldr::kUnreachableLandmark) {
+        bound = std::max(bound, toward_ ? to[i] - to_location_[i] : to_location_[i] - to[i]);
+      }
+    }
+    return bound * kLandmarkBoundFactor;
+  }
+
   midgard::DistanceApproximator<midgard::PointLL> distapprox_; // Distance approximation
   float costfactor_; // Cost factor - ensures the cost estimate
                      // underestimates the true cost.
+
+  // Landmark costs, if the costing has them
+  std::shared_ptr<const baldr::LandmarkDistances> landmarks_;
+  std::vector<float> from_location_; // Costs between each landmark and the location, the lowest
+  std::vector<float> to_location_;   // or highest depending on which keeps the bounds valid
+  bool toward_ = true;
+  mutable baldr::GraphId last_tile_;
+  mutable uint32_t last_offset_ = baldr::LandmarkDistances::kInvalidLandmarkIndex;
 };
 
 } // namespace thor
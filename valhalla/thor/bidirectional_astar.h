@@ -84,6 +84,34 @@ public:
    */
   void Clear() override;
 
+  /**
+   * Lets the forward and reverse search run on their own threads for routes of at least
+   * thor.parallel_bidirectional_min_distance meters. The reverse search reads the tiles with
+   * the given reader since graph readers are not thread safe.
+   * @param  reverse_reader  the reader for the reverse search, nullptr runs everything serially
+   */
+  void set_reverse_reader(const std::shared_ptr<baldr::GraphReader>& reverse_reader) {
+    reverse_reader_ = reverse_reader;
+  }
+
+  /**
+   * Gets the counters of the searches of both directions since they were last reset.
+   * @return the counters
+   */
+  SearchCounters counters() const override {
+    auto counters = counters_;
+    counters += reverse_counters_;
+    return counters;
+  }
+
+  /**
+   * Resets the counters of the searches of both directions.
+   */
+  void reset_counters() override {
+    counters_ = {};
+    reverse_counters_ = {};
+  }
+
 protected:
   // Access mode used by the costing method
   uint32_t access_mode_;
@@ -134,6 +162,26 @@ protected:
   // edge)
   bool pruning_disabled_at_origin_, pruning_disabled_at_destination_;
 
+  // Running the directions in parallel, see set_reverse_reader
+  struct ParallelSearch;
+  std::shared_ptr<baldr::GraphReader> reverse_reader_;
+  float parallel_min_distance_;
+  uint32_t parallel_max_edges_;
+  bool parallel_;
+  // The edges each direction has settled, for the meeting point test of the other one
+  PublishedEdges published_forward_;
+  PublishedEdges published_reverse_;
+
+  // The reverse search keeps its own counters so the directions can run in parallel
+  SearchCounters reverse_counters_;
+
+  // Searches with a time in the time dependent mode, see thor.time_dependent_bidirectional
+  bool time_dependent_;
+  // the forward search only follows the edges the reverse search reached
+  bool restrict_forward_;
+  // the time at the destination of an arrive by route, used to find the departure time
+  baldr::TimeInfo arrival_time_info_;
+
   /**
    * Initialize the A* heuristic and adjacency lists for both the forward
    * and reverse search.
@@ -142,6 +190,60 @@ protected:
    */
   void Init(const midgard::PointLL& origll, const midgard::PointLL& destll);
 
+  /**
+   * Runs the forward search on this thread and the reverse search on another one until their
+   * costs pass the threshold of the best connection between them or they are exhausted. The
+   * connections found are checked against the finished trees afterwards.
+   * @param graphreader        to access graph data on this thread
+   * @param forward_time_info  time information of the forward search
+   * @param reverse_time_info  time information of the reverse search
+   * @param invariant          static date_time, dont offset the time as the path lengthens
+   * @return false if the searches settled more edges than could be published, in which case
+   *         the search has to be done again serially
+   */
+  bool SearchInParallel(baldr::GraphReader& graphreader,
+                        const baldr::TimeInfo& forward_time_info,
+                        const baldr::TimeInfo& reverse_time_info,
+                        const bool invariant);
+
+  /**
+   * The loop of one direction of the parallel search.
+   * @param graphreader   to access graph data, only used by this direction
+   * @param time_info     time information of the direction
+   * @param invariant     static date_time, dont offset the time as the path lengthens
+   * @param opp_heuristic a copy of the heuristic of the other direction for the reach pruning
+   * @param search        the state both directions share
+   */
+  template <const ExpansionType expansion_direction>
+  void ExpandInParallel(baldr::GraphReader& graphreader,
+                        const baldr::TimeInfo& time_info,
+                        const bool invariant,
+                        const AStarHeuristic& opp_heuristic,
+                        ParallelSearch& search);
+
+  /**
+   * The time dependent search of a depart at route. It runs in three phases:
+   *  1. The forward search tracks the time from the departure while the reverse search uses the
+   *     fastest speed each edge has at any time so its costs are lower bounds. Once they meet, the
+   *     path through the connection is costed at the departure time which is an upper bound of the
+   *     cost of the route.
+   *  2. The reverse search goes on until its sort cost passes the upper bound. Every edge of a
+   *     path cheaper than the upper bound has been reached by then.
+   *  3. The forward search goes on from where they met, only along the edges the reverse search
+   *     reached, until its sort cost passes the upper bound. Every destination edge it reaches is
+   *     costed up to the destination and lowers the upper bound if it is cheaper.
+   * The path is costed at the departure time along its whole length so its times are consistent.
+   * @param graphreader  to access graph data
+   * @param origin       the origin location
+   * @param destination  the destination location
+   * @param time_info    time information at the origin
+   * @return the path or no path if there is none
+   */
+  std::vector<std::vector<PathInfo>> SearchTimeDependent(baldr::GraphReader& graphreader,
+                                                         const valhalla::Location& origin,
+                                                         const valhalla::Location& destination,
+                                                         const baldr::TimeInfo& time_info);
+
   /**
    * Expand from the node along the forward search path
    *
@@ -242,6 +344,28 @@ protected:
                                               const baldr::TimeInfo& time_info,
                                               const bool invariant);
 
+  /**
+   * Forms the path through one connection of the trees and costs it from the origin. An arrive
+   * by route in the time dependent mode is costed from the departure which gets it to the
+   * destination at the arrival time.
+   * @param   graphreader  Graph tile reader (for getting opposing edges)
+   * @param   connection   Where the trees meet, on the destination edge the reverse tree is
+   *                       not used
+   * @param   origin       The origin location
+   * @param   dest         The destination location
+   * @param   time_info    What time is it when we start the route
+   * @param   invariant    Static date_time, dont offset the time as the path lengthens
+   * @param   path         The path infos, ordered from origin to destination
+   * @return  false if the path could not be costed
+   */
+  bool FormConnectionPath(baldr::GraphReader& graphreader,
+                          const CandidateConnection& connection,
+                          const valhalla::Location& origin,
+                          const valhalla::Location& dest,
+                          const baldr::TimeInfo& time_info,
+                          const bool invariant,
+                          std::vector<PathInfo>& path);
+
   /**
    * Modify default (optimized for unidirectional search) hierarchy limits.
    */
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/api.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/contraction_query.h>
+#include <valhalla/thor/costmatrix.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Many to many time and distance matrices on a customized contraction hierarchy. The upward
+ * search from every target leaves an entry in the bucket of each node it reaches with the
+ * distance from there to the target. The upward search from a source then only has to scan the
+ * buckets of the nodes it reaches to find its best meeting node with every target. Each location
+ * is searched once, so the work grows with the number of sources plus targets rather than with
+ * their product, which is what makes matrices with thousands of locations feasible.
+ *
+ * Like point to point queries on the hierarchy the matrix has no turn costs or turn restrictions
+ * and only exists for the default options of the configured costings, the caller falls back to
+ * another matrix for the requests it does not support.
+ */
+class BucketMatrix : protected ContractionQuery {
+public:
+  /**
+   * Constructor.
+   * @param config  thor config, contraction_costings lists the costings to customize
+   */
+  explicit BucketMatrix(const boost::property_tree::ptree& config = {});
+
+  using ContractionQuery::Customize;
+  using ContractionQuery::set_interrupt;
+  using ContractionQuery::Supports;
+
+  /**
+   * Forms a time distance matrix from the set of source locations
+   * to the set of target locations.
+   * @param  source_location_list  List of source/origin locations.
+   * @param  target_location_list  List of target/destination locations.
+   * @param  graphreader           Graph reader for accessing routing graph.
+   * @param  mode_costing          Costing methods.
+   * @param  mode                  Travel mode to use.
+   * @param  options               The request options, the costing picks the metric.
+   * @return time/distance from origin index to all other locations
+   */
+  std::vector<TimeDistance>
+  SourceToTarget(const google::protobuf::RepeatedPtrField<valhalla::Location>& source_location_list,
+                 const google::protobuf::RepeatedPtrField<valhalla::Location>& target_location_list,
+                 baldr::GraphReader& graphreader,
+                 const sif::mode_costing_t& mode_costing,
+                 const sif::TravelMode mode,
+                 const Options& options);
+
+  /**
+   * Clear the temporary information generated during time+distance
+   * matrix construction.
+   */
+  void Clear() override;
+
+protected:
+  // what the search from a target left at a node: the distance from there to the target along
+  // with the time and length of the path
+  struct bucket_entry_t {
+    uint32_t target;
+    float weight;
+    float secs;
+    float length;
+  };
+
+  // computes the time and length to every rank the last search of a side reached, from the
+  // arcs they were reached over
+  void Accumulate(const std::vector<seed_t>& seeds, bool forward);
+
+  // sets the pairs whose target is on the edge of the source ahead of it, which the searches
+  // dont find because they start from the nodes at the ends of the edges
+  void SetTrivialPairs(
+      const google::protobuf::RepeatedPtrField<valhalla::Location>& source_location_list,
+      const google::protobuf::RepeatedPtrField<valhalla::Location>& target_location_list,
+      baldr::GraphReader& graphreader,
+      std::vector<float>& weights,
+      std::vector<TimeDistance>& time_distances) const;
+
+  // per rank time and length of the side being searched
+  std::vector<float> secs_;
+  std::vector<float> lengths_;
+
+  // the bucket entries sorted by rank and the first entry of each rank in the buckets
+  std::vector<std::pair<uint32_t, bucket_entry_t>> buckets_;
+  std::vector<uint32_t> first_entry_;
+};
+
+} // namespace thor
+} // namespace valhalla
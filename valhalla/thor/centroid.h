@@ -151,7 +151,8 @@ protected:
    * @param edge_label_reservation  an estimate of the total number of edgelabels for this exapansion
    */
   virtual void GetExpansionHints(uint32_t& bucket_count,
-                                 uint32_t& edge_label_reservation) const override;
+                                 uint32_t& edge_label_reservation,
+                                 QueueType& queue_type) const override;
 
   /**
    * Walks back the labels in the label set for a each location to recover its path to the centroid
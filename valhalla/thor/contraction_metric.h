@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/contraction.h>
+#include <valhalla/proto/options.pb.h>
+#include <valhalla/sif/costconstants.h>
+
+namespace valhalla {
+namespace thor {
+
+// Weight of an arc direction which cannot be traversed
+constexpr float kUnreachableWeight = std::numeric_limits<float>::infinity();
+
+class ContractionMetricSlot;
+
+/**
+ * The weights of a contraction hierarchy for one costing. Every arc has a weight in the upward
+ * direction (from its lower to its higher node) and in the downward direction, along with what
+ * the weight stands for so paths can be unpacked: either an input edge of the graph or a middle
+ * node lower than both ends of the arc, in which case the arc is a shortcut over the two arcs
+ * to the middle node. The time and length of the path behind the weight are kept as well so
+ * matrices can report them without unpacking it.
+ */
+class ContractionMetric {
+public:
+  // Set on the via of an arc direction which stands for an input edge rather than a middle node
+  static constexpr uint32_t kInputEdge = 0x80000000;
+
+  /**
+   * @param hierarchy  the hierarchy to customize
+   * @param options    the costing options the metric is customized for
+   */
+  ContractionMetric(const std::shared_ptr<const baldr::ContractionHierarchy>& hierarchy,
+                    const CostingOptions& options);
+
+  /**
+   * Computes the weights of all arcs for the costing. The input edges are weighted with the
+   * costing, including the live traffic of the tiles, and the shortcuts by enumerating the lower
+   * triangles of each arc. Both are spread over threads, the input edges by tile and the
+   * shortcuts a level of the elimination tree at a time. Turn costs and restrictions are not
+   * part of the metric, paths found with it are recosted.
+   * @param config       mjolnir config, each thread reads the tiles with its own graph reader
+   * @param concurrency  the number of threads to use
+   */
+  void Customize(const boost::property_tree::ptree& config, uint32_t concurrency);
+
+  /**
+   * Gets the current metric of a costing for the hierarchy in mjolnir.contraction_hierarchy. The
+   * hierarchy is loaded and customized with the default options of the costing on first use and
+   * then shared by everyone in the process. If thor.contraction_customize_interval is set the
+   * metrics are customized again in the background that often to pick up new live traffic.
+   * @param config   the whole config
+   * @param costing  the costing to get the metric of
+   * @return where the current metric of the costing is, throws if the hierarchy could not be loaded
+   */
+  static std::shared_ptr<const ContractionMetricSlot>
+  Get(const boost::property_tree::ptree& config, Costing costing);
+
+  /**
+   * @return the hierarchy this metric belongs to
+   */
+  const baldr::ContractionHierarchy& hierarchy() const {
+    return *hierarchy_;
+  }
+
+  /**
+   * @return the options the metric is customized for
+   */
+  const CostingOptions& options() const {
+    return options_;
+  }
+
+  /**
+   * @return whether paths for the given costing options can be found with this metric
+   */
+  bool Matches(const CostingOptions& options) const {
+    return options.SerializeAsString() == serialized_options_;
+  }
+
+  float up_weight(const uint32_t arc) const {
+    return up_weights_[arc];
+  }
+
+  float down_weight(const uint32_t arc) const {
+    return down_weights_[arc];
+  }
+
+  uint32_t up_via(const uint32_t arc) const {
+    return up_via_[arc];
+  }
+
+  uint32_t down_via(const uint32_t arc) const {
+    return down_via_[arc];
+  }
+
+  float up_secs(const uint32_t arc) const {
+    return up_secs_[arc];
+  }
+
+  float down_secs(const uint32_t arc) const {
+    return down_secs_[arc];
+  }
+
+  float up_length(const uint32_t arc) const {
+    return up_lengths_[arc];
+  }
+
+  float down_length(const uint32_t arc) const {
+    return down_lengths_[arc];
+  }
+
+protected:
+  // weighs the input edges in by_tile[begin, end) into edge_costs and edge_lengths
+  void WeighInputEdges(const boost::property_tree::ptree& config,
+                       const std::vector<uint32_t>& by_tile,
+                       size_t begin,
+                       size_t end,
+                       std::vector<sif::Cost>& edge_costs,
+                       std::vector<float>& edge_lengths) const;
+
+  // computes the weights of the upward arcs of a node from its lower triangles
+  void CustomizeNode(uint32_t rank);
+
+  std::shared_ptr<const baldr::ContractionHierarchy> hierarchy_;
+  CostingOptions options_;
+  std::string serialized_options_;
+  std::vector<float> up_weights_;
+  std::vector<float> down_weights_;
+  std::vector<uint32_t> up_via_;
+  std::vector<uint32_t> down_via_;
+  std::vector<float> up_secs_;
+  std::vector<float> down_secs_;
+  std::vector<float> up_lengths_;
+  std::vector<float> down_lengths_;
+};
+
+/**
+ * Holds the current metric of a costing. A new customization is swapped in atomically while
+ * queries keep the metric they started with until they are done with it.
+ */
+class ContractionMetricSlot {
+public:
+  /**
+   * @return the current metric
+   */
+  std::shared_ptr<const ContractionMetric> get() const {
+    return std::atomic_load(&metric_);
+  }
+
+  /**
+   * Replaces the current metric
+   * @param metric  the new metric
+   */
+  void set(std::shared_ptr<const ContractionMetric> metric) {
+    std::atomic_store(&metric_, std::move(metric));
+  }
+
+protected:
+  std::shared_ptr<const ContractionMetric> metric_;
+};
+
+} // namespace thor
+} // namespace valhalla
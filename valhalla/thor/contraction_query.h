@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/api.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/contraction_metric.h>
+#include <valhalla/thor/pathalgorithm.h>
+#include <valhalla/thor/pathinfo.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Point to point queries on a customized contraction hierarchy. Both searches only go upward
+ * in the hierarchy so they only visit the ancestors of the origin and destination nodes in the
+ * elimination tree, which are scanned in rank order without a priority queue. The best meeting
+ * node gives the shortest path which is unpacked into graph edges and recosted.
+ *
+ * The metric has no turn costs or turn restrictions and only exists for the default options of
+ * the configured costings. If the unpacked path runs into a complex restriction or the recosting
+ * rejects a turn no path is returned so the caller can fall back to bidirectional A*.
+ */
+class ContractionQuery : public PathAlgorithm {
+public:
+  /**
+   * Constructor.
+   * @param config  thor config, contraction_costings lists the costings to customize
+   */
+  explicit ContractionQuery(const boost::property_tree::ptree& config = {});
+
+  /**
+   * Gets the metrics of the configured costings, customizing them if nobody in the process
+   * has done so yet. Queries are disabled if the hierarchy cannot be loaded.
+   * @param config  the whole config, mjolnir.contraction_hierarchy is the hierarchy built by
+   *                mjolnir, if its empty queries are disabled
+   */
+  void Customize(const boost::property_tree::ptree& config);
+
+  /**
+   * Whether a path for the request can be found on the hierarchy, which requires a customized
+   * metric for the costing of the request and the default options of that costing.
+   * @param options  the request options
+   */
+  bool Supports(const Options& options) const;
+
+  /**
+   * Form path between and origin and destination location using the supplied
+   * costing method.
+   * @param  origin       Origin location
+   * @param  dest         Destination location
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  mode_costing Costing methods.
+   * @param  mode         Travel mode to use.
+   * @return Returns the path edges (and elapsed time/modes at end of
+   *          each edge) or nothing if the caller should use another algorithm.
+   */
+  std::vector<std::vector<PathInfo>>
+  GetBestPath(valhalla::Location& origin,
+              valhalla::Location& dest,
+              baldr::GraphReader& graphreader,
+              const sif::mode_costing_t& mode_costing,
+              const sif::TravelMode mode,
+              const Options& options = Options::default_instance()) override;
+
+  /**
+   * Returns the name of the algorithm
+   * @return the name of the algorithm
+   */
+  const char* name() const override {
+    return "contraction_hierarchy";
+  }
+
+  /**
+   * Clear the temporary information generated during path construction.
+   */
+  void Clear() override;
+
+protected:
+  // Set on the arc a rank was reached over when it is where the search started, the rest of the
+  // bits are the index of the seed
+  static constexpr uint32_t kSeedArc = 0x80000000;
+
+  // where a search starts: a node of the hierarchy, the edge leading to or from it and the
+  // percent along that edge of the location, with the time and length of the part of the edge
+  // between the location and the node
+  struct seed_t {
+    uint32_t rank;
+    baldr::GraphId edgeid;
+    float percent_along;
+    float weight;
+    float secs;
+    float length;
+  };
+
+  // sets up the seeds of one side, returns false if there are none
+  bool Seed(const valhalla::Location& location,
+            baldr::GraphReader& graphreader,
+            bool forward,
+            std::vector<seed_t>& seeds);
+
+  // scans the ancestors of the seeds in rank order
+  void Search(const std::vector<seed_t>& seeds, bool forward);
+
+  // forgets what the last search of one side reached
+  void Reset(bool forward);
+
+  // appends the graph edges of an arc in the given direction
+  void Unpack(uint32_t arc, bool upward, std::vector<baldr::GraphId>& edges) const;
+
+  std::vector<std::string> costings_;
+  std::unordered_map<int, std::shared_ptr<const ContractionMetricSlot>> metrics_;
+
+  // the metric and costing of the current query, the metric of a costing can be swapped for a
+  // new customization at any time so the query holds on to the one it started with
+  std::shared_ptr<const ContractionMetric> metric_;
+  sif::cost_ptr_t costing_;
+
+  // per rank distance and the arc it was reached over in each direction
+  std::vector<float> forward_weights_;
+  std::vector<float> reverse_weights_;
+  std::vector<uint32_t> forward_arcs_;
+  std::vector<uint32_t> reverse_arcs_;
+  // which sides have visited a rank
+  std::vector<uint8_t> visited_;
+  std::vector<uint32_t> forward_nodes_;
+  std::vector<uint32_t> reverse_nodes_;
+};
+
+} // namespace thor
+} // namespace valhalla
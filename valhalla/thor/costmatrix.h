@@ -2,6 +2,7 @@
 #define VALHALLA_THOR_COSTMATRIX_H_
 
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <set>
@@ -41,6 +42,11 @@ struct TimeDistance {
   }
 };
 
+// Receives a row of a matrix as soon as it is final: the index of its source and the time and
+// distance to each of the targets
+using MatrixRowCallback =
+    std::function<void(const uint32_t source_index, const std::vector<TimeDistance>& row)>;
+
 /**
  * Status of a location. Tracks remaining locations to be found
  * and a threshold or iterations. When threshold goes to 0 expansion
@@ -103,7 +109,10 @@ public:
    * @param  mode_costing          Costing methods.
    * @param  mode                  Travel mode to use.
    * @param  max_matrix_distance   Maximum arc-length distance for current mode.
-   * @return time/distance from origin index to all other locations
+   * @param  row_callback          Optional, receives the row of each source as soon as its
+   *                               search is done instead of the whole matrix at the end.
+   * @return time/distance from origin index to all other locations, empty if the rows went to
+   *         the callback
    */
   std::vector<TimeDistance>
   SourceToTarget(const google::protobuf::RepeatedPtrField<valhalla::Location>& source_location_list,
@@ -111,7 +120,8 @@ public:
                  baldr::GraphReader& graphreader,
                  const sif::mode_costing_t& mode_costing,
                  const sif::TravelMode mode,
-                 const float max_matrix_distance);
+                 const float max_matrix_distance,
+                 const MatrixRowCallback& row_callback = nullptr);
 
   /**
    * Clear the temporary information generated during time+distance
@@ -119,7 +129,28 @@ public:
    */
   void Clear();
 
+  /**
+   * Runs the searches on one more thread for each of the given readers, which the threads read
+   * the tiles with. Without any the searches all run on the calling thread.
+   * @param  readers  graph readers of the additional threads
+   */
+  void set_readers(const std::vector<std::shared_ptr<baldr::GraphReader>>& readers) {
+    readers_ = readers;
+  }
+
 protected:
+  // What a thread of a parallel iteration leaves to be applied once all threads are done: the
+  // connections found between sources and targets, the edges the backward searches reached and
+  // the number of searches which stopped
+  struct pending_t {
+    std::vector<std::pair<uint32_t, uint32_t>> connections;
+    std::vector<std::pair<baldr::GraphId, uint32_t>> reached;
+    uint32_t finished = 0;
+  };
+
+  // Graph readers of the additional threads
+  std::vector<std::shared_ptr<baldr::GraphReader>> readers_;
+
   // Access mode used by the costing method
   uint32_t access_mode_;
 
@@ -159,6 +190,10 @@ protected:
   // List of best connections found so far
   std::vector<BestCandidate> best_connection_;
 
+  // Where the rows go as the sources are done and which of them went already
+  MatrixRowCallback row_callback_;
+  std::vector<bool> row_sent_;
+
   /**
    * Get the cost threshold based on the current mode and the max arc-length distance
    * for that mode.
@@ -175,36 +210,73 @@ protected:
   void Initialize(const google::protobuf::RepeatedPtrField<valhalla::Location>& source_location_list,
                   const google::protobuf::RepeatedPtrField<valhalla::Location>& target_location_list);
 
+  /**
+   * Runs the searches on all threads until they are done. The threads are started once and take
+   * turns a number of iterations at a time: all backward searches expand in parallel, then all
+   * forward searches do against what the backward searches reached. Each thread only writes to
+   * the searches it runs and to the connections of their sources, the rest is applied by one of
+   * them after each half of an iteration while the others wait.
+   * @param  graphreader  Graph reader of the calling thread.
+   */
+  void ParallelSearch(baldr::GraphReader& graphreader);
+
+  /**
+   * Applies what the threads of a parallel iteration left to be done.
+   * @param  pending    What each thread left.
+   * @param  remaining  The remaining sources or targets to take the finished searches off.
+   */
+  void ApplyPending(std::vector<pending_t>& pending, uint32_t& remaining);
+
+  /**
+   * Hands the row of a source to the row callback, if there is one and the row did not go yet.
+   * Only the forward search of a source connects it to the targets so its row is final once that
+   * search is done.
+   * @param  source  Index of the source.
+   */
+  void SendRow(const uint32_t source);
+
   /**
    * Iterate the forward search from the source/origin location.
    * @param  index        Index of the source location.
    * @param  n            Iteration counter.
    * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  pending      Where to leave the changes to shared state when running in parallel.
    */
-  void ForwardSearch(const uint32_t index, const uint32_t n, baldr::GraphReader& graphreader);
+  void ForwardSearch(const uint32_t index,
+                     const uint32_t n,
+                     baldr::GraphReader& graphreader,
+                     pending_t* pending = nullptr);
 
   /**
    * Check if the edge on the forward search connects to a reached edge
    * on the reverse search tree.
-   * @param  source  Source index.
-   * @param  pred    Edge label of the predecessor.
-   * @param  n       Iteration counter.
+   * @param  source   Source index.
+   * @param  pred     Edge label of the predecessor.
+   * @param  n        Iteration counter.
+   * @param  pending  Where to leave the connections when running in parallel.
    */
-  void CheckForwardConnections(const uint32_t source, const sif::BDEdgeLabel& pred, const uint32_t n);
+  void CheckForwardConnections(const uint32_t source,
+                               const sif::BDEdgeLabel& pred,
+                               const uint32_t n,
+                               pending_t* pending = nullptr);
 
   /**
    * Update status when a connection is found.
-   * @param  source  Source index
-   * @param  target  Target index
+   * @param  source   Source index
+   * @param  target   Target index
+   * @param  pending  Where to leave the connection when running in parallel.
    */
-  void UpdateStatus(const uint32_t source, const uint32_t target);
+  void UpdateStatus(const uint32_t source, const uint32_t target, pending_t* pending = nullptr);
 
   /**
    * Iterate the backward search from the target/destination location.
    * @param  index        Index of the target location.
    * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  pending      Where to leave the changes to shared state when running in parallel.
    */
-  void BackwardSearch(const uint32_t index, baldr::GraphReader& graphreader);
+  void BackwardSearch(const uint32_t index,
+                      baldr::GraphReader& graphreader,
+                      pending_t* pending = nullptr);
 
   /**
    * Sets the source/origin locations. Search expands forward from these
@@ -8,7 +8,6 @@
 #include <utility>
 #include <vector>
 
-#include <valhalla/baldr/double_bucket_queue.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/location.h>
@@ -17,6 +16,7 @@
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/expansionqueue.h>
 #include <valhalla/thor/pathalgorithm.h>
 
 namespace valhalla {
@@ -64,6 +64,15 @@ public:
               const sif::mode_costing_t& costings,
               const sif::TravelMode mode);
 
+  /**
+   * Sets the arena the edge labels are kept in between requests, so the algorithms of a worker
+   * can share one
+   * @param  label_arena  the arena
+   */
+  void set_label_arena(const std::shared_ptr<LabelArena>& label_arena) {
+    label_arena_ = label_arena;
+  }
+
 protected:
   /**
    * Compute the best first graph traversal from a list of origin locations
@@ -105,7 +114,10 @@ protected:
                                                const ExpansionType route_type) = 0;
 
   // A child-class must implement this to tell the algorithm how much expansion to expect to do
-  virtual void GetExpansionHints(uint32_t& bucket_count, uint32_t& edge_label_reservation) const = 0;
+  // and which priority queue suits it
+  virtual void GetExpansionHints(uint32_t& bucket_count,
+                                 uint32_t& edge_label_reservation,
+                                 QueueType& queue_type) const = 0;
 
   sif::TravelMode mode_; // Current travel mode
   uint32_t access_mode_; // Access mode used by the costing method
@@ -129,10 +141,11 @@ protected:
   std::vector<sif::BDEdgeLabel> bdedgelabels_;
   std::vector<sif::MMEdgeLabel> mmedgelabels_;
   uint32_t max_reserved_labels_count_;
+  std::shared_ptr<LabelArena> label_arena_;
 
   // Adjacency list - approximate double bucket sort
-  baldr::DoubleBucketQueue<sif::BDEdgeLabel> adjacencylist_;
-  baldr::DoubleBucketQueue<sif::MMEdgeLabel> mmadjacencylist_;
+  ExpansionQueue<sif::BDEdgeLabel> adjacencylist_;
+  ExpansionQueue<sif::MMEdgeLabel> mmadjacencylist_;
 
   // Edge status. Mark edges that are in adjacency list or settled.
   EdgeStatus edgestatus_;
@@ -154,7 +167,7 @@ protected:
    */
   template <typename label_container_t>
   void Initialize(label_container_t& labels,
-                  baldr::DoubleBucketQueue<typename label_container_t::value_type>& queue,
+                  ExpansionQueue<typename label_container_t::value_type>& queue,
                   const uint32_t bucketsize);
 
   /**
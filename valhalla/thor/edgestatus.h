@@ -1,6 +1,13 @@
 #pragma once
 
-#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphtile.h>
 
@@ -50,6 +57,12 @@ struct EdgeStatusInfo {
  * edges within arrays for each tile. This allows the path algorithms to get
  * a pointer to the first edge status and iterate that pointer over sequential
  * edges. This reduces the number of map lookups.
+ *
+ * The arrays are found through a small open addressing table keyed by tile (and
+ * path id), with the last tile looked up remembered since the searches mostly
+ * stay within a tile for a while. Cleared arrays are kept in a pool, by power of
+ * two capacity, and handed out again to the next search instead of going back
+ * to the allocator.
  */
 class EdgeStatus {
 public:
@@ -58,29 +71,46 @@ public:
    */
   EdgeStatus() = default;
 
-  // in order no to delete objects twice in destructor we should explicitly
-  // forbid copying
+  // the arrays are owned by the pool so we explicitly forbid copying
   EdgeStatus(const EdgeStatus&) = delete;
   EdgeStatus& operator=(const EdgeStatus&) = delete;
   EdgeStatus(EdgeStatus&&) = default;
-  EdgeStatus& operator=(EdgeStatus&&) = default;
+  EdgeStatus& operator=(EdgeStatus&& other) {
+    // the arrays in use here are deleted along with other
+    std::swap(slots_, other.slots_);
+    std::swap(used_, other.used_);
+    std::swap(shift_, other.shift_);
+    std::swap(pools_, other.pools_);
+    std::swap(pooled_, other.pooled_);
+    std::swap(last_key_, other.last_key_);
+    std::swap(last_statuses_, other.last_statuses_);
+    return *this;
+  }
 
   /**
-   * Destructor. Delete any allocated EdgeStatusInfo arrays.
+   * Destructor. Delete the arrays which are in use, the pooled ones delete themselves.
    */
   ~EdgeStatus() {
-    clear();
+    for (const auto& slot : slots_) {
+      if (slot.key != kEmptyKey) {
+        delete[] slot.statuses;
+      }
+    }
   }
 
   /**
-   * Clear the EdgeStatusInfo arrays and the edge status map.
+   * Clear the edge status of all tiles. The arrays are kept for reuse.
    */
   void clear() {
-    // Delete any allocated arrays for tiles within the map.
-    for (auto& iter : edgestatus_) {
-      delete[] iter.second;
+    for (auto& slot : slots_) {
+      if (slot.key != kEmptyKey) {
+        Release(slot);
+        slot = {};
+      }
     }
-    edgestatus_.clear();
+    used_ = 0;
+    last_key_ = kEmptyKey;
+    last_statuses_ = nullptr;
   }
 
   /**
@@ -98,16 +128,7 @@ public:
            const graph_tile_ptr& tile,
            const uint8_t path_id = 0) {
     assert(path_id <= baldr::kMaxMultiPathId);
-    auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    if (p != edgestatus_.end()) {
-      p->second[edgeid.id()] = {set, index};
-    } else {
-      // Tile is not in the map. Add an array of EdgeStatusInfo, sized to
-      // the number of directed edges in the specified tile.
-      auto inserted = edgestatus_.emplace(edgeid.tile_value() | SHIFT_path_id(path_id),
-                                          new EdgeStatusInfo[tile->header()->directededgecount()]);
-      inserted.first->second[edgeid.id()] = {set, index};
-    }
+    Acquire(edgeid.tile_value() | SHIFT_path_id(path_id), tile)[edgeid.id()] = {set, index};
   }
 
   /**
@@ -120,9 +141,9 @@ public:
    */
   void Update(const baldr::GraphId& edgeid, const EdgeSet set, const uint8_t path_id = 0) {
     assert(path_id <= baldr::kMaxMultiPathId);
-    const auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    if (p != edgestatus_.end()) {
-      p->second[edgeid.id()].set_ = static_cast<uint32_t>(set);
+    auto* statuses = Find(edgeid.tile_value() | SHIFT_path_id(path_id));
+    if (statuses != nullptr) {
+      statuses[edgeid.id()].set_ = static_cast<uint32_t>(set);
     } else {
       throw std::runtime_error("EdgeStatus Update on edge not previously set");
     }
@@ -137,8 +158,25 @@ public:
    */
   EdgeStatusInfo Get(const baldr::GraphId& edgeid, const uint8_t path_id = 0) const {
     assert(path_id <= baldr::kMaxMultiPathId);
-    const auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    return (p == edgestatus_.end()) ? EdgeStatusInfo() : p->second[edgeid.id()];
+    const auto* statuses = Find(edgeid.tile_value() | SHIFT_path_id(path_id));
+    return statuses == nullptr ? EdgeStatusInfo() : statuses[edgeid.id()];
+  }
+
+  /**
+   * Get the status info of a directed edge without remembering its tile for the next lookup, so
+   * several threads can look up statuses at once as long as none of them change.
+   * @param   edgeid     GraphId of the directed edge.
+   * @param  path_id     Identifies which path the edge status belongs to when tracking multiple paths
+   *                     valid ids are from 0 to 127 (since we only have 7 bits free)
+   * @return  Returns edge status info.
+   */
+  EdgeStatusInfo Peek(const baldr::GraphId& edgeid, const uint8_t path_id = 0) const {
+    assert(path_id <= baldr::kMaxMultiPathId);
+    if (slots_.empty()) {
+      return EdgeStatusInfo();
+    }
+    const auto& slot = slots_[Probe(edgeid.tile_value() | SHIFT_path_id(path_id))];
+    return slot.key == kEmptyKey ? EdgeStatusInfo() : slot.statuses[edgeid.id()];
   }
 
   /**
@@ -154,23 +192,258 @@ public:
   EdgeStatusInfo*
   GetPtr(const baldr::GraphId& edgeid, const graph_tile_ptr& tile, const uint8_t path_id = 0) {
     assert(path_id <= baldr::kMaxMultiPathId);
-    const auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    if (p != edgestatus_.end()) {
-      return &p->second[edgeid.id()];
-    } else {
-      // Tile is not in the map. Add an array of EdgeStatusInfo, sized to
-      // the number of directed edges in the specified tile.
-      auto inserted = edgestatus_.emplace(edgeid.tile_value() | SHIFT_path_id(path_id),
-                                          new EdgeStatusInfo[tile->header()->directededgecount()]);
-      return &(inserted.first->second)[edgeid.id()];
-    }
+    return &Acquire(edgeid.tile_value() | SHIFT_path_id(path_id), tile)[edgeid.id()];
   }
 
 private:
-  // Edge status - keys are the tile Ids (level and tile Id) and the
-  // values are dynamically allocated arrays of EdgeStatusInfo (sized
-  // based on the directed edge count within the tile).
-  std::unordered_map<uint32_t, EdgeStatusInfo*> edgestatus_;
+  // Marks an empty slot, tile and path ids never use all 32 bits
+  static constexpr uint32_t kEmptyKey = std::numeric_limits<uint32_t>::max();
+
+  // Number of slots the table starts out with
+  static constexpr size_t kInitialSlots = 64;
+
+  // Statuses kept in the pool for reuse, beyond this arrays go back to the allocator
+  static constexpr size_t kMaxPooledStatuses = 16 * 1024 * 1024;
+
+  struct tile_slot_t {
+    uint32_t key = kEmptyKey;
+    uint32_t bucket = 0; // log2 of the capacity of the array
+    EdgeStatusInfo* statuses = nullptr;
+  };
+
+  // the arrays of one power of two capacity
+  using pool_t = std::vector<std::unique_ptr<EdgeStatusInfo[]>>;
+
+  // index of the slot for the key, either the one holding it or the empty one it would go into
+  size_t Probe(const uint32_t key) const {
+    // fibonacci hashing spreads the ids of neighbouring tiles over the table
+    const size_t mask = slots_.size() - 1;
+    auto i = static_cast<size_t>((static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ull) >> shift_);
+    for (;; i = (i + 1) & mask) {
+      if (slots_[i].key == key || slots_[i].key == kEmptyKey) {
+        return i;
+      }
+    }
+  }
+
+  // the statuses of the tile or nullptr if none have been set
+  EdgeStatusInfo* Find(const uint32_t key) const {
+    if (key == last_key_) {
+      return last_statuses_;
+    }
+    if (slots_.empty()) {
+      return nullptr;
+    }
+    const auto& slot = slots_[Probe(key)];
+    if (slot.key == kEmptyKey) {
+      return nullptr;
+    }
+    last_key_ = key;
+    last_statuses_ = slot.statuses;
+    return slot.statuses;
+  }
+
+  // the statuses of the tile, taking an array for them if the tile hasnt been seen yet
+  EdgeStatusInfo* Acquire(const uint32_t key, const graph_tile_ptr& tile) {
+    if (key == last_key_) {
+      return last_statuses_;
+    }
+    // keep the table at most half full so that probes stay short
+    if ((used_ + 1) * 2 > slots_.size()) {
+      Grow();
+    }
+    auto& slot = slots_[Probe(key)];
+    if (slot.key == kEmptyKey) {
+      slot.key = key;
+      Take(tile->header()->directededgecount(), slot);
+      ++used_;
+    }
+    last_key_ = key;
+    last_statuses_ = slot.statuses;
+    return slot.statuses;
+  }
+
+  void Grow() {
+    std::vector<tile_slot_t> slots(slots_.empty() ? kInitialSlots : slots_.size() * 2);
+    slots.swap(slots_);
+    shift_ = 64;
+    for (auto size = slots_.size(); size > 1; size >>= 1) {
+      --shift_;
+    }
+    for (const auto& slot : slots) {
+      if (slot.key != kEmptyKey) {
+        slots_[Probe(slot.key)] = slot;
+      }
+    }
+  }
+
+  // gives the slot a zeroed array for count statuses, from the pool if there is one big enough
+  void Take(const uint32_t count, tile_slot_t& slot) {
+    slot.bucket = 0;
+    while ((size_t(1) << slot.bucket) < count) {
+      ++slot.bucket;
+    }
+    if (slot.bucket >= pools_.size()) {
+      pools_.resize(slot.bucket + 1);
+    }
+    auto& pool = pools_[slot.bucket];
+    if (pool.empty()) {
+      slot.statuses = new EdgeStatusInfo[size_t(1) << slot.bucket];
+      return;
+    }
+    slot.statuses = pool.back().release();
+    pool.pop_back();
+    pooled_ -= size_t(1) << slot.bucket;
+    std::fill_n(slot.statuses, count, EdgeStatusInfo());
+  }
+
+  // puts the array of the slot back into its pool or frees it if the pool is full
+  void Release(const tile_slot_t& slot) {
+    std::unique_ptr<EdgeStatusInfo[]> statuses(slot.statuses);
+    if (pooled_ + (size_t(1) << slot.bucket) <= kMaxPooledStatuses) {
+      pooled_ += size_t(1) << slot.bucket;
+      pools_[slot.bucket].push_back(std::move(statuses));
+    }
+  }
+
+  std::vector<tile_slot_t> slots_;
+  size_t used_ = 0;
+  uint32_t shift_ = 64;
+  std::vector<pool_t> pools_;
+  size_t pooled_ = 0;
+
+  // the tile looked up last
+  mutable uint32_t last_key_ = kEmptyKey;
+  mutable EdgeStatusInfo* last_statuses_ = nullptr;
+};
+
+/**
+ * Edges settled by one direction of a parallel bidirectional search, published without locks so
+ * the other direction can test whether it met them. There is one writer, the thread of the
+ * direction, while the other thread reads. The costs of an edge are written before its key and
+ * never change after, and the keys are stored and loaded sequentially consistent: a reader which
+ * finds a key sees its costs, and when both directions publish opposing edges at the same time at
+ * least one of them finds the other. The table never grows, once it holds the reserved number of
+ * edges Publish fails.
+ */
+class PublishedEdges {
+public:
+  // What the other direction needs to know to cost a connection through the edge
+  struct entry_t {
+    float cost;            // cost at the end of the edge
+    float pred_cost;       // cost at the start of the edge, 0 where the search started
+    float transition_cost; // cost of turning onto the edge
+    bool settled;          // false for the edges the search started on, they could still improve
+  };
+
+  PublishedEdges() = default;
+  PublishedEdges(const PublishedEdges&) = delete;
+  PublishedEdges& operator=(const PublishedEdges&) = delete;
+
+  /**
+   * Makes room for the given number of edges. Must not be called while searching.
+   * @param  max_edges  the most edges that can be published
+   */
+  void Reserve(const uint32_t max_edges) {
+    max_edges_ = max_edges;
+    size_t count = 1;
+    uint32_t bits = 0;
+    // keep the load at half or less so the probes stay short
+    while (count < std::max<size_t>(max_edges, 1) * 2) {
+      count <<= 1;
+      ++bits;
+    }
+    if (slots_ && count <= mask_ + size_t(1)) {
+      return;
+    }
+    slots_.reset(new slot_t[count]);
+    for (size_t i = 0; i < count; ++i) {
+      slots_[i].key.store(baldr::kInvalidGraphId, std::memory_order_relaxed);
+    }
+    mask_ = static_cast<uint32_t>(count - 1);
+    shift_ = 64 - bits;
+    used_.clear();
+  }
+
+  /**
+   * Removes all edges. Must not be called while searching.
+   */
+  void clear() {
+    for (auto i : used_) {
+      slots_[i].key.store(baldr::kInvalidGraphId, std::memory_order_relaxed);
+    }
+    used_.clear();
+  }
+
+  /**
+   * Publishes an edge, unless it already is, in which case the first entry stays.
+   * Only the thread of the direction may call this.
+   * @param  edgeid  GraphId of the directed edge
+   * @param  entry   costs of the edge
+   * @return false if there is no more room
+   */
+  bool Publish(const baldr::GraphId& edgeid, const entry_t& entry) {
+    for (auto i = Hash(edgeid); true; i = (i + 1) & mask_) {
+      // only this thread writes keys so it can read them without ordering
+      const auto key = slots_[i].key.load(std::memory_order_relaxed);
+      if (key == edgeid.value) {
+        return true;
+      }
+      if (key == baldr::kInvalidGraphId) {
+        if (used_.size() >= max_edges_) {
+          return false;
+        }
+        slots_[i].entry = entry;
+        slots_[i].key.store(edgeid.value);
+        used_.push_back(i);
+        return true;
+      }
+    }
+  }
+
+  /**
+   * Finds a published edge, any thread may call this.
+   * @param  edgeid  GraphId of the directed edge
+   * @return the costs of the edge or nullptr if it has not been published (yet)
+   */
+  const entry_t* Find(const baldr::GraphId& edgeid) const {
+    if (!slots_) {
+      return nullptr;
+    }
+    for (auto i = Hash(edgeid); true; i = (i + 1) & mask_) {
+      const auto key = slots_[i].key.load();
+      if (key == edgeid.value) {
+        return &slots_[i].entry;
+      }
+      if (key == baldr::kInvalidGraphId) {
+        return nullptr;
+      }
+    }
+  }
+
+  /**
+   * @return the number of published edges, only for the thread of the direction
+   */
+  size_t size() const {
+    return used_.size();
+  }
+
+protected:
+  struct slot_t {
+    std::atomic<uint64_t> key;
+    entry_t entry;
+  };
+
+  uint32_t Hash(const baldr::GraphId& edgeid) const {
+    // fibonacci hashing spreads the sequential ids of a tile over the table
+    return static_cast<uint32_t>((edgeid.value * 0x9E3779B97F4A7C15ull) >> shift_);
+  }
+
+  std::unique_ptr<slot_t[]> slots_;
+  uint32_t mask_ = 0;
+  uint32_t shift_ = 64;
+  uint32_t max_edges_ = 0;
+  std::vector<uint32_t> used_;
 };
 
 } // namespace thor
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/radix_queue.h>
+
+namespace valhalla {
+namespace thor {
+
+// The priority queues an expansion can use, see Dijkstras::GetExpansionHints
+enum class QueueType : uint8_t {
+  kDoubleBucket = 0, // bucket sort over a fixed cost range with an overflow bucket
+  kRadix = 1,        // monotone radix queue without a cost range
+};
+
+/**
+ * The adjacency list of an expansion which uses the queue it was last reused with. Both queues
+ * order the label indexes the same way, they differ in how they get there.
+ */
+template <typename label_t> class ExpansionQueue final {
+public:
+  /**
+   * Prepares the queue for an expansion.
+   * @param type            which queue to use
+   * @param mincost         minimum cost
+   * @param range           cost range of the low-level buckets of the DoubleBucketQueue
+   * @param bucketsize      range of costs within the same bucket
+   * @param labelcontainer  container of labels with sortcosts
+   */
+  void reuse(const QueueType type,
+             const float mincost,
+             const float range,
+             const uint32_t bucketsize,
+             const std::vector<label_t>* labelcontainer) {
+    type_ = type;
+    if (type_ == QueueType::kRadix) {
+      radix_.reuse(mincost, bucketsize, labelcontainer);
+    } else {
+      buckets_.reuse(mincost, range, bucketsize, labelcontainer);
+    }
+  }
+
+  void clear() {
+    buckets_.clear();
+    radix_.clear();
+  }
+
+  void add(const uint32_t label) {
+    type_ == QueueType::kRadix ? radix_.add(label) : buckets_.add(label);
+  }
+
+  void decrease(const uint32_t label, const float newcost) {
+    type_ == QueueType::kRadix ? radix_.decrease(label, newcost) : buckets_.decrease(label, newcost);
+  }
+
+  uint32_t pop() {
+    return type_ == QueueType::kRadix ? radix_.pop() : buckets_.pop();
+  }
+
+  QueueType type() const {
+    return type_;
+  }
+
+private:
+  QueueType type_ = QueueType::kDoubleBucket;
+  baldr::DoubleBucketQueue<label_t> buckets_;
+  baldr::RadixQueue<label_t> radix_;
+};
+
+} // namespace thor
+} // namespace valhalla
@@ -76,7 +76,8 @@ protected:
 
   // tell the expansion how many labels to expect and how many buckets to use
   virtual void GetExpansionHints(uint32_t& bucket_count,
-                                 uint32_t& edge_label_reservation) const override;
+                                 uint32_t& edge_label_reservation,
+                                 QueueType& queue_type) const override;
 
   float shape_interval_; // Interval along shape to mark time
   float max_seconds_;
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/sif/edgelabel.h>
+
+namespace valhalla {
+namespace thor {
+
+// Default limit of the label storage a worker keeps between requests, see
+// thor.label_arena_max_megabytes
+constexpr size_t kDefaultLabelArenaMegabytes = 256;
+
+/**
+ * Keeps the storage of the edge label vectors of the path algorithms between requests. The
+ * algorithms hand their vectors back when they are cleared and get one of a fitting size class
+ * when they start, so a short request after a long one neither frees nor copies the labels of
+ * the long one and the next long one does not allocate them again. The storage is only freed when
+ * keeping it would exceed the limit of the arena. One arena can be shared by all the algorithms of
+ * a worker but it is not thread safe.
+ */
+class LabelArena {
+public:
+  // The statistics of the arena
+  struct stats_t {
+    size_t retained_bytes = 0; // storage kept for the next requests
+    size_t peak_bytes = 0;     // most storage kept at once
+    uint64_t reused = 0;       // vectors handed out from the kept storage
+    uint64_t allocated = 0;    // vectors which had to be allocated
+    uint64_t freed = 0;        // vectors freed to stay within the limit
+  };
+
+  /**
+   * @param  max_bytes  the most label storage to keep between requests
+   */
+  explicit LabelArena(const size_t max_bytes = kDefaultLabelArenaMegabytes * 1024 * 1024)
+      : max_bytes_(max_bytes) {
+  }
+
+  /**
+   * @param  config  the thor config, the limit is read from label_arena_max_megabytes
+   */
+  explicit LabelArena(const boost::property_tree::ptree& config)
+      : LabelArena(config.get<size_t>("label_arena_max_megabytes", kDefaultLabelArenaMegabytes) *
+                   1024 * 1024) {
+  }
+
+  LabelArena(const LabelArena&) = delete;
+  LabelArena& operator=(const LabelArena&) = delete;
+
+  /**
+   * Makes sure an empty vector of labels can hold the given count without reallocating, taking
+   * storage of the arena if it has some that is large enough. A vector which is not empty is
+   * just reserved.
+   * @param  labels  the vector of labels
+   * @param  count   how many labels it should hold
+   */
+  template <typename label_t> void Acquire(std::vector<label_t>& labels, const size_t count) {
+    if (labels.capacity() >= count) {
+      return;
+    }
+    if (!labels.empty()) {
+      labels.reserve(count);
+      return;
+    }
+
+    Release(labels);
+    auto& free = std::get<free_lists_t<label_t>>(free_lists_);
+    const auto size_class = SizeClass(count, true);
+    for (auto i = size_class; i < kSizeClassCount; ++i) {
+      if (!free[i].empty()) {
+        labels.swap(free[i].back());
+        free[i].pop_back();
+        stats_.retained_bytes -= labels.capacity() * sizeof(label_t);
+        ++stats_.reused;
+        // only counts beyond the largest class can need more
+        labels.reserve(count);
+        return;
+      }
+    }
+
+    // round up to the size class so the storage fits its class when it comes back
+    labels.reserve(std::max(count, ClassCount(size_class)));
+    ++stats_.allocated;
+  }
+
+  /**
+   * Takes the storage of a vector of labels, which is left empty without capacity. The storage is
+   * freed instead if keeping it would exceed the limit.
+   * @param  labels  the vector of labels
+   */
+  template <typename label_t> void Release(std::vector<label_t>& labels) {
+    labels.clear();
+    const size_t bytes = labels.capacity() * sizeof(label_t);
+    if (bytes == 0) {
+      return;
+    }
+    if (stats_.retained_bytes + bytes > max_bytes_ || labels.capacity() < ClassCount(0)) {
+      std::vector<label_t>().swap(labels);
+      ++stats_.freed;
+      return;
+    }
+
+    auto& free = std::get<free_lists_t<label_t>>(free_lists_);
+    free[SizeClass(labels.capacity(), false)].emplace_back(std::move(labels));
+    labels = std::vector<label_t>();
+    stats_.retained_bytes += bytes;
+    stats_.peak_bytes = std::max(stats_.peak_bytes, stats_.retained_bytes);
+  }
+
+  /**
+   * @return the statistics of the arena
+   */
+  const stats_t& stats() const {
+    return stats_;
+  }
+
+  /**
+   * @return the most label storage the arena keeps
+   */
+  size_t max_bytes() const {
+    return max_bytes_;
+  }
+
+protected:
+  // The smallest size class holds this many labels, each next one twice as many
+  static constexpr size_t kMinClassCount = 1024;
+  static constexpr uint32_t kSizeClassCount = 24;
+
+  static size_t ClassCount(const uint32_t size_class) {
+    return kMinClassCount << size_class;
+  }
+
+  // The class a count fits in when rounding up, or the largest class it fills when rounding down
+  static uint32_t SizeClass(const size_t count, const bool round_up) {
+    uint32_t size_class = 0;
+    while (size_class + 1 < kSizeClassCount &&
+           (round_up ? ClassCount(size_class) < count : ClassCount(size_class + 1) <= count)) {
+      ++size_class;
+    }
+    return size_class;
+  }
+
+  template <typename label_t>
+  using free_lists_t = std::array<std::vector<std::vector<label_t>>, kSizeClassCount>;
+
+  size_t max_bytes_;
+  stats_t stats_;
+  std::tuple<free_lists_t<sif::EdgeLabel>,
+             free_lists_t<sif::BDEdgeLabel>,
+             free_lists_t<sif::MMEdgeLabel>>
+      free_lists_;
+};
+
+} // namespace thor
+} // namespace valhalla
@@ -3,16 +3,20 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/landmarks.h>
 #include <valhalla/proto/api.pb.h>
+#include <valhalla/proto_conversions.h>
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/labelarena.h>
 #include <valhalla/thor/pathinfo.h>
 
 namespace valhalla {
@@ -23,6 +27,26 @@ constexpr size_t kInterruptIterationsInterval = 5000;
 
 enum class ExpansionType { forward = 0, reverse = 1, multimodal = 2 };
 
+/**
+ * Counters of the work the searches of a path algorithm did, see PathAlgorithm::counters
+ */
+struct SearchCounters {
+  uint64_t settled_edges = 0;     // labels taken off the adjacency lists
+  uint64_t queue_adds = 0;        // labels put on the adjacency lists
+  uint64_t queue_decreases = 0;   // labels whose sort cost was lowered on the adjacency lists
+  uint64_t predicted_speeds = 0;  // edge costs which used a predicted speed
+  uint64_t parallel_searches = 0; // searches whose directions ran on separate threads
+
+  SearchCounters& operator+=(const SearchCounters& other) {
+    settled_edges += other.settled_edges;
+    queue_adds += other.queue_adds;
+    queue_decreases += other.queue_decreases;
+    predicted_speeds += other.predicted_speeds;
+    parallel_searches += other.parallel_searches;
+    return *this;
+  }
+};
+
 /**
  * Pure virtual class defining the interface for PathAlgorithm - the algorithm
  * to create shortest path.
@@ -33,7 +57,8 @@ public:
    * Constructor
    */
   PathAlgorithm()
-      : interrupt(nullptr), has_ferry_(false), not_thru_pruning_(true), expansion_callback_() {
+      : interrupt(nullptr), has_ferry_(false), not_thru_pruning_(true), expansion_callback_(),
+        label_arena_(std::make_shared<LabelArena>()) {
   }
 
   PathAlgorithm(const PathAlgorithm&) = delete;
@@ -130,6 +155,39 @@ public:
     expansion_callback_ = expansion_callback;
   }
 
+  /**
+   * Sets the directory with the landmark costs of the costings, see mjolnir.landmark_dir
+   * @param  landmark_dir  the directory, if its empty landmarks are not used
+   */
+  void set_landmark_dir(const std::string& landmark_dir) {
+    landmark_dir_ = landmark_dir;
+  }
+
+  /**
+   * Sets the arena the edge labels are kept in between requests, so the algorithms of a worker
+   * can share one
+   * @param  label_arena  the arena
+   */
+  void set_label_arena(const std::shared_ptr<LabelArena>& label_arena) {
+    label_arena_ = label_arena;
+  }
+
+  /**
+   * Gets the counters of the searches since they were last reset. Clear does not reset them so
+   * they add up over the passes of a route.
+   * @return the counters
+   */
+  virtual SearchCounters counters() const {
+    return counters_;
+  }
+
+  /**
+   * Resets the counters of the searches.
+   */
+  virtual void reset_counters() {
+    counters_ = {};
+  }
+
 protected:
   const std::function<void()>* interrupt;
 
@@ -143,6 +201,77 @@ protected:
   // when doing timezone differencing a timezone cache speeds up the computation
   baldr::DateTime::tz_sys_info_cache_t tz_cache_;
 
+  // where the landmark costs of the costings are, if anywhere
+  std::string landmark_dir_;
+
+  // keeps the storage of the edge labels between requests
+  std::shared_ptr<LabelArena> label_arena_;
+
+  // the work the searches did, not every algorithm keeps track of it
+  SearchCounters counters_;
+
+  /**
+   * Gets the landmark costs of the costing of the request. They are only usable as lower bounds
+   * if they were computed with the same costing options the request uses. They are also costed
+   * with the speeds an edge has when neither the time nor live traffic is known, a search with
+   * a time or with live traffic can find edges to be faster than that so it does without them.
+   * @param  options      the request options
+   * @param  origin       the origin of the search
+   * @param  destination  the destination of the search
+   * @param  costing      the costing of the search
+   * @param  graphreader  to tell if there is live traffic
+   * @return the landmark costs or nullptr if there are none for the request
+   */
+  std::shared_ptr<const baldr::LandmarkDistances>
+  GetLandmarks(const Options& options,
+               const valhalla::Location& origin,
+               const valhalla::Location& destination,
+               const sif::cost_ptr_t& costing,
+               baldr::GraphReader& graphreader) const {
+    if (landmark_dir_.empty() || origin.has_date_time() || destination.has_date_time() ||
+        ((costing->flow_mask() & baldr::kCurrentFlowMask) && graphreader.HasLiveTraffic())) {
+      return nullptr;
+    }
+    auto landmarks =
+        baldr::LandmarkDistances::Get(landmark_dir_, Costing_Enum_Name(options.costing()));
+    if (!landmarks ||
+        landmarks->options() !=
+            options.costing_options(static_cast<int>(options.costing())).SerializeAsString()) {
+      return nullptr;
+    }
+    return landmarks;
+  }
+
+  /**
+   * Gets the nodes a path to or from the location can go through first or last, the start and
+   * end nodes of the candidate edges of the location, along with the number of nodes of their
+   * tiles so the landmarks can tell whether they were computed for the same tiles
+   * @param  location     the location
+   * @param  graphreader  to look up the nodes of the edges
+   * @return the nodes, empty if any of them could not be found
+   */
+  static std::vector<std::pair<baldr::GraphId, uint32_t>>
+  GetLocationNodes(const valhalla::Location& location, baldr::GraphReader& graphreader) {
+    std::vector<std::pair<baldr::GraphId, uint32_t>> nodes;
+    graph_tile_ptr tile;
+    for (const auto& edge : location.path_edges()) {
+      baldr::GraphId edgeid(edge.graph_id());
+      const baldr::DirectedEdge* directededge = graphreader.directededge(edgeid, tile);
+      auto start = graphreader.edge_startnode(edgeid, tile);
+      if (directededge == nullptr || !start.Is_Valid()) {
+        return {};
+      }
+      for (const auto& node : {directededge->endnode(), start}) {
+        graph_tile_ptr node_tile = tile;
+        if (!graphreader.GetGraphTile(node, node_tile)) {
+          return {};
+        }
+        nodes.emplace_back(node, node_tile->header()->nodecount());
+      }
+    }
+    return nodes;
+  }
+
   /**
    * Check for path completion along the same edge. Edge ID in question
    * is along both an origin and destination and origin shows up at the
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/api.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/dijkstras.h>
+#include <valhalla/thor/pathinfo.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * A best first (dijkstras) expansion from one origin which stops once the shortest paths to all of
+ * a set of destinations are known. Many routes which share their origin come out of the one tree
+ * instead of a search each, which is what the batch_route action uses it for.
+ */
+class ShortestPathTree : public Dijkstras {
+public:
+  /**
+   * Finds the shortest path from the origin to each of the destinations
+   *
+   * @param origin        The location the paths start at
+   * @param destinations  The locations the paths end at
+   * @param reader        Graph reader to provide access to graph primitives
+   * @param costings      Per mode costing objects
+   * @param mode          The mode specifying which costing to use
+   * @param max_matrix_distance  Maximum arc-length distance for the mode, the expansion stops at
+   *                             the cost it takes to go that far
+   * @return One path per destination, empty where no path was found
+   */
+  std::vector<std::vector<PathInfo>>
+  FindPaths(const valhalla::Location& origin,
+            const std::vector<const valhalla::Location*>& destinations,
+            baldr::GraphReader& reader,
+            const sif::mode_costing_t& costings,
+            const sif::TravelMode mode,
+            const float max_matrix_distance);
+
+  /**
+   * Resets internal state before the next call
+   */
+  virtual void Clear() override;
+
+protected:
+  static constexpr float kNoCost = std::numeric_limits<float>::max();
+
+  // A destination and the best way found to reach it so far
+  struct Destination {
+    bool settled = false;
+    float threshold = 0.f;                 // cost of its costliest edge, beyond which it is settled
+    uint32_t label = baldr::kInvalidLabel; // label of the edge it is reached on
+    sif::Cost best_cost{kNoCost, kNoCost};
+    std::unordered_map<uint64_t, float> dest_edges; // edges not yet settled and their remainder
+  };
+
+  virtual void ExpandingNode(baldr::GraphReader&,
+                             graph_tile_ptr,
+                             const baldr::NodeInfo*,
+                             const sif::EdgeLabel&,
+                             const sif::EdgeLabel*) override {
+    // we only care about settled edges
+  }
+
+  /**
+   * Updates the destinations on the settled edge and stops once they are all settled
+   *
+   * @param reader      used for accessing graph primitives
+   * @param pred        label of the edge which has just been settled
+   * @param route_type  enum of forward/reverse/multimodal
+   * @return whether to stop or continue the expansion
+   */
+  virtual ExpansionRecommendation ShouldExpand(baldr::GraphReader& reader,
+                                               const sif::EdgeLabel& pred,
+                                               const ExpansionType route_type) override;
+
+  /**
+   * Tell the expansion how many labels to expect and how many buckets to use
+   *
+   * @param bucket_count            impacts the number of buckets in the double bucket queue
+   * @param edge_label_reservation  an estimate of the total number of edgelabels for this exapansion
+   * @param queue_type              the priority queue to use
+   */
+  virtual void GetExpansionHints(uint32_t& bucket_count,
+                                 uint32_t& edge_label_reservation,
+                                 QueueType& queue_type) const override;
+
+  /**
+   * Get the cost threshold based on the current mode and the max arc-length distance
+   * for that mode.
+   * @param  max_matrix_distance   Maximum arc-length distance for current mode.
+   */
+  float GetCostThreshold(const float max_matrix_distance) const;
+
+  /**
+   * Sets up the destinations and the edges they are on
+   *
+   * @param reader        used for accessing graph primitives
+   * @param destinations  the locations the paths end at
+   */
+  void SetDestinations(baldr::GraphReader& reader,
+                       const std::vector<const valhalla::Location*>& destinations);
+
+  /**
+   * Walks back the labels from each settled destination to recover its path
+   *
+   * @return The list of paths, one for each destination
+   */
+  std::vector<std::vector<PathInfo>> FormPaths() const;
+
+  // the origin and destinations, to tell if a destination on the origin edge is ahead of it
+  const valhalla::Location* origin_ = nullptr;
+  std::vector<const valhalla::Location*> dest_locations_;
+
+  // the destinations and the destinations on each edge
+  std::vector<Destination> destinations_;
+  std::unordered_map<uint64_t, std::vector<uint32_t>> dest_edges_;
+  uint32_t settled_count_ = 0;
+
+  // the lowest cost at which a destination which was found can no longer get cheaper
+  float next_threshold_ = kNoCost;
+
+  // the cost beyond which the expansion gives up on the destinations it has not found, so one
+  // which can not be reached does not flood the whole graph
+  float cost_threshold_ = kNoCost;
+};
+
+} // namespace thor
+} // namespace valhalla
@@ -95,7 +95,10 @@ public:
    * @param  mode_costing          Costing methods.
    * @param  mode                  Travel mode to use.
    * @param  max_matrix_distance   Maximum arc-length distance for current mode.
-   * @return time/distance from origin index to all other locations
+   * @param  row_callback          Optional, receives the row of each source as soon as it is
+   *                               done instead of the whole matrix at the end.
+   * @return time/distance from origin index to all other locations, empty if the rows went to
+   *         the callback
    */
   std::vector<TimeDistance>
   SourceToTarget(const google::protobuf::RepeatedPtrField<valhalla::Location>& source_location_list,
@@ -103,7 +106,8 @@ public:
                  baldr::GraphReader& graphreader,
                  const sif::mode_costing_t& mode_costing,
                  const sif::TravelMode mode,
-                 const float max_matrix_distance);
+                 const float max_matrix_distance,
+                 const MatrixRowCallback& row_callback = nullptr);
 
   /**
    * Clear the temporary information generated during time+distance
@@ -119,8 +123,51 @@ protected:
   // The cost threshold being used for the currently executing query
   float current_cost_threshold_;
 
-  // List of destinations
-  std::vector<Destination> destinations_;
+  // The destinations as a structure of arrays. After every settled edge with a destination on it
+  // all of them are swept to settle those which can no longer improve and to find the cost
+  // threshold, each in its own loop over a few dense arrays without branches
+  struct Destinations {
+    std::vector<float> costs;        // current best cost, kMaxCost until one is found
+    std::vector<float> secs;         // time of the best cost path
+    std::vector<uint32_t> distances; // distance of the best cost path
+    std::vector<float> thresholds;   // cost above the best where it no longer needs to be searched
+    std::vector<uint8_t> settled;    // has the best time/distance been found?
+    // potential edges of each destination (and their partial distance)
+    std::vector<std::unordered_map<uint64_t, float>> edges;
+
+    size_t size() const {
+      return costs.size();
+    }
+
+    void add() {
+      costs.push_back(kMaxCost);
+      secs.push_back(kMaxCost);
+      distances.push_back(0);
+      thresholds.push_back(0.0f);
+      settled.push_back(0);
+      edges.emplace_back();
+    }
+
+    void clear() {
+      costs.clear();
+      secs.clear();
+      distances.clear();
+      thresholds.clear();
+      settled.clear();
+      edges.clear();
+    }
+
+    // settles the unsettled destinations with a path whose cost plus threshold is below the
+    // cost and returns how many it settled
+    uint32_t settle(const float cost);
+
+    // the number of unsettled destinations without a path
+    uint32_t unfound() const;
+
+    // the highest cost plus threshold of the unsettled destinations with a path, 0 if none
+    float max_bound() const;
+  };
+  Destinations destinations_;
 
   // Current costing mode
   std::shared_ptr<sif::DynamicCost> costing_;
@@ -21,9 +21,13 @@
 #include <valhalla/thor/astar_bss.h>
 #include <valhalla/thor/attributes_controller.h>
 #include <valhalla/thor/bidirectional_astar.h>
+#include <valhalla/thor/bucketmatrix.h>
 #include <valhalla/thor/centroid.h>
+#include <valhalla/thor/contraction_query.h>
 #include <valhalla/thor/isochrone.h>
+#include <valhalla/thor/labelarena.h>
 #include <valhalla/thor/multimodal.h>
+#include <valhalla/thor/shortestpathtree.h>
 #include <valhalla/thor/triplegbuilder.h>
 #include <valhalla/thor/unidirectional_astar.h>
 #include <valhalla/tyr/actor.h>
@@ -38,7 +42,12 @@ void run_service(const boost::property_tree::ptree& config);
 
 class thor_worker_t : public service_worker_t {
 public:
-  enum SOURCE_TO_TARGET_ALGORITHM { SELECT_OPTIMAL = 0, COST_MATRIX = 1, TIME_DISTANCE_MATRIX = 2 };
+  enum SOURCE_TO_TARGET_ALGORITHM {
+    SELECT_OPTIMAL = 0,
+    COST_MATRIX = 1,
+    TIME_DISTANCE_MATRIX = 2,
+    BUCKET_MATRIX = 3
+  };
   thor_worker_t(const boost::property_tree::ptree& config,
                 const std::shared_ptr<baldr::GraphReader>& graph_reader = {});
   virtual ~thor_worker_t();
@@ -63,6 +72,7 @@ public:
   std::string trace_attributes(Api& request);
   std::string expansion(Api& request);
   void centroid(Api& request);
+  void batch_route(Api& request);
   void status(Api& request) const;
 
   void set_interrupt(const std::function<void()>* interrupt) override;
@@ -91,6 +101,18 @@ protected:
   void path_arrive_by(Api& api, const std::string& costing);
   void path_depart_at(Api& api, const std::string& costing);
 
+  /**
+   * Resets the counters of the route searches and remembers how many tiles were looked up so far
+   */
+  void reset_search_counters();
+  /**
+   * Adds the work the route searches did since their counters were reset to the statistics of
+   * the request: the edges they settled, their adjacency list operations, how many edge costs
+   * used predicted speeds and how many tiles they looked up and loaded
+   * @param request  the request to add the statistics to
+   */
+  void add_search_statistics(Api& request);
+
   void parse_locations(Api& request);
   void parse_measurements(const Api& request);
   std::string parse_costing(const Api& request);
@@ -121,16 +143,29 @@ protected:
   MultiModalPathAlgorithm multi_modal_astar;
   TimeDepForward timedep_forward;
   TimeDepReverse timedep_reverse;
+  ContractionQuery contraction_query;
+  BucketMatrix bucket_matrix;
 
   Isochrone isochrone_gen;
   std::shared_ptr<meili::MapMatcher> matcher;
   float max_timedep_distance;
+  // routes with a time use the time dependent mode of bidirectional a* at any distance
+  bool time_dependent_bidirectional;
   std::unordered_map<std::string, float> max_matrix_distance;
   SOURCE_TO_TARGET_ALGORITHM source_to_target_algorithm;
   meili::MapMatcherFactory matcher_factory;
   std::shared_ptr<baldr::GraphReader> reader;
+  // the reader of the reverse direction of bidirectional a* when it runs in parallel
+  std::shared_ptr<baldr::GraphReader> reverse_reader;
+  // the readers of the additional threads of the cost matrix
+  std::vector<std::shared_ptr<baldr::GraphReader>> costmatrix_readers;
+  // the tile lookups of the readers when the search counters were reset
+  baldr::TileCacheStats::Level search_tiles_start;
   AttributesController controller;
   Centroid centroid_gen;
+  ShortestPathTree path_tree;
+  // keeps the edge labels of all the algorithms between requests
+  std::shared_ptr<LabelArena> label_arena;
 
 private:
   std::string service_name() const override {
@@ -34,6 +34,31 @@ std::string serializeMatrix(const Api& request,
                             const std::vector<thor::TimeDistance>& time_distances,
                             double distance_scale);
 
+/**
+ * Start of a matrix which is written a row at a time as the rows are done, so neither the whole
+ * matrix nor all of its json have to be held at once. Only formats with rows of their own (ndjson
+ * and binary) can be written this way
+ */
+std::string serializeMatrixHeader(const Api& request);
+
+/**
+ * Appends the row of a source to a matrix written a row at a time, the rows may come in any order
+ */
+void serializeMatrixRow(const Api& request,
+                        const uint32_t source_index,
+                        const std::vector<thor::TimeDistance>& row,
+                        double distance_scale,
+                        std::string& output);
+
+/**
+ * Appends all rows of a whole matrix to a matrix written a row at a time, for the algorithms which
+ * only have the matrix at the end
+ */
+void serializeMatrixRows(const Api& request,
+                         const std::vector<thor::TimeDistance>& time_distances,
+                         double distance_scale,
+                         std::string& output);
+
 /**
  * Turn grid data contours into geojson
  *
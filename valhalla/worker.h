@@ -65,6 +65,8 @@ const content_type JSON_MIME{"Content-type", "application/json;charset=utf-8"};
 const content_type JS_MIME{"Content-type", "application/javascript;charset=utf-8"};
 const content_type XML_MIME{"Content-type", "text/xml;charset=utf-8"};
 const content_type GPX_MIME{"Content-type", "application/gpx+xml;charset=utf-8"};
+const content_type NDJSON_MIME{"Content-type", "application/x-ndjson;charset=utf-8"};
+const content_type BINARY_MIME{"Content-type", "application/octet-stream"};
 } // namespace worker
 
 prime_server::worker_t::result_t
@@ -75,6 +77,10 @@ to_response(const std::string& data,
             const bool as_attachment = false);
 #endif
 
+namespace baldr {
+class GraphReader;
+}
+
 struct statsd_client_t;
 class service_worker_t {
 public:
@@ -120,6 +126,19 @@ protected:
    */
   void enqueue_statistics(Api& api) const;
 
+  /**
+   * Queues up gauges describing how the tile cache of the reader is doing on each hierarchy level
+   * @param reader  The reader whose cache counters should be sent
+   */
+  void enqueue_cache_statistics(const baldr::GraphReader& reader) const;
+
+  /**
+   * Queues up a gauge, if anyone is listening
+   * @param key    The key of the gauge, without the prefix
+   * @param value  The value, clamped to what a gauge can hold
+   */
+  void enqueue_gauge(const std::string& key, uint64_t value) const;
+
   /**
    * Returns name of the service used in statistics
    */